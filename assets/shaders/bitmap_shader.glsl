@@ -13,10 +13,8 @@
 #define BITMAP_256_BORDER   32
 #define BITMAP_320_BORDER   20
 
-#define SIZEOF_COLOR        4
-/* The tileset texture is stored with 4 pixels per color: 64KB / sizeof(Color) = 16KB */
-#define TILESET_TEX_WIDTH   64
-#define TILESET_TEX_HEIGHT  256
+/* The tileset texture holds one byte per texel, 256 per line */
+#define TILESET_TEX_WIDTH   256
 
 #ifdef OPENGL_ES
 precision highp float;
@@ -35,27 +33,35 @@ uniform int         video_mode;
 
 out vec4 finalColor;
 
-/* Returns a color index that can be retrieved from the palette [0:1[ */
-float color_from_idx(int idx)
+/**
+ * @brief Get a byte of the VRAM out of a texture holding one byte per texel
+ */
+int vram_byte(sampler2D tex, ivec2 coord)
+{
+    return int(texelFetch(tex, coord, 0).r * 255.0 + 0.5);
+}
+
+
+/**
+ * @brief The palette texture holds the RGB565 colors as they are in VRAM, in little-endian
+ */
+vec4 palette_color(int idx)
+{
+    int rgb = vram_byte(palette, ivec2(idx * 2, 0)) | (vram_byte(palette, ivec2(idx * 2 + 1, 0)) << 8);
+    return vec4(float((rgb >> 11) << 3), float(((rgb >> 5) & 0x3f) << 2), float((rgb & 0x1f) << 3), 255.0) / 255.0;
+}
+
+
+/* Returns the color index of a pixel of the bitmap */
+int color_from_idx(int idx)
 {
-    /* Each entry in the tileset contains SIZEOF_COLOR (4) pixels */
-    int pixel_index = idx / SIZEOF_COLOR;
-    ivec2 coordinates = ivec2(pixel_index % TILESET_TEX_WIDTH, pixel_index / TILESET_TEX_WIDTH);
-    vec2 addr = (vec2(coordinates) + vec2(0.5, 0.5)) / vec2(64.0, 256.0);
-    /* Get one set of color per layer, each containing 4 pixels */
-    vec4 set = texture(tileset, addr);
-    int channel = idx % SIZEOF_COLOR;
-    float byte_value = (channel == 0) ? set.r :
-                       (channel == 1) ? set.g :
-                       (channel == 2) ? set.b :
-                                        set.a;
-    return byte_value;
+    return vram_byte(tileset, ivec2(idx % TILESET_TEX_WIDTH, idx / TILESET_TEX_WIDTH));
 }
 
 
 void main() {
-    /* Divide by 2 since we are in 320x240 mode */
-    ivec2 coord = ivec2(gl_FragCoord.x, gl_FragCoord.y) / 2;
+    /* The target is 320x240, like the bitmap modes */
+    ivec2 coord = ivec2(gl_FragCoord.x, gl_FragCoord.y);
     int index = 0;
 
     if (video_mode == MODE_BITMAP_256) {
@@ -76,5 +82,5 @@ void main() {
     }
 
     /* Convert the color index into an RGB color */
-    finalColor = texture(palette, vec2(color_from_idx(index), 0.5));
+    finalColor = palette_color(color_from_idx(index));
 }
@@ -34,15 +34,12 @@
 /* Number of tiles per row when debugging the tileset */
 #define TILESET_MAX_X   (16)
 
-#define TILEMAP_ENTRIES     3200.0
-/* The tileset texture is stored with 4 pixels per color: 64KB / sizeof(Color) = 16KB */
-#define TILESET_TEX_WIDTH   64
+/* The tileset texture holds one byte per texel, 256 per line */
+#define TILESET_TEX_WIDTH   256
 #define TILESET_TEX_HEIGHT  256
 /* Size of a single tile in bytes: 256 */
 #define TILESET_SIZE        (256)
 
-#define SIZEOF_COLOR        (4)
-
 #ifdef OPENGL_ES
 precision highp float;
 precision highp int;
@@ -62,6 +59,34 @@ uniform int         debug_mode;
 
 out vec4 finalColor;
 
+/**
+ * @brief Get a byte of the VRAM out of a texture holding one byte per texel
+ */
+int vram_byte(sampler2D tex, ivec2 coord)
+{
+    return int(texelFetch(tex, coord, 0).r * 255.0 + 0.5);
+}
+
+
+/**
+ * @brief The palette texture holds the RGB565 colors as they are in VRAM, in little-endian
+ */
+vec4 palette_color(int idx)
+{
+    int rgb = vram_byte(palette, ivec2(idx * 2, 0)) | (vram_byte(palette, ivec2(idx * 2 + 1, 0)) << 8);
+    return vec4(float((rgb >> 11) << 3), float(((rgb >> 5) & 0x3f) << 2), float((rgb & 0x1f) << 3), 255.0) / 255.0;
+}
+
+
+/**
+ * @brief The tilemaps texture holds a row of tiles per line, the lines of layer 1 follow the ones of layer 0
+ */
+int tilemap_byte(int layer, int tile_idx)
+{
+    return vram_byte(tilemaps, ivec2(tile_idx % MAX_X, tile_idx / MAX_X + layer * MAX_Y));
+}
+
+
 /**
  * @param idx Index of the tile to render (from a tilemap layer)
  * @param offset Offset within the tile to get the pixel
@@ -78,30 +103,22 @@ int color_from_idx(int idx, int offset, bool color_4bit)
         /* In 4-bit mode, we can simply divide the index by two to get the correct pixel(s) */
         final_idx = final_idx / 2;
     }
-    /* Each pixel in the texture has 4 colors */
-    int pixel_index = final_idx / SIZEOF_COLOR;
-    ivec2 coordinates = ivec2(pixel_index % TILESET_TEX_WIDTH, pixel_index / TILESET_TEX_WIDTH);
-    vec2 addr = (vec2(coordinates) + vec2(0.5, 0.5)) / vec2(64.0, 256.0);
-    /* Get one set of color per layer, each containing 4 pixels */
-    vec4 set = texture(tileset, addr);
-    int channel = final_idx % SIZEOF_COLOR;
-    float byte_value = (channel == 0) ? set.r :
-                        (channel == 1) ? set.g :
-                        (channel == 2) ? set.b : set.a;
+    /* Tiles past the end of the 64KB wrap around to the beginning */
+    int byte_int = vram_byte(tileset, ivec2(final_idx % TILESET_TEX_WIDTH,
+                                            (final_idx / TILESET_TEX_WIDTH) % TILESET_TEX_HEIGHT));
     if (color_4bit) {
-        /* Convert to 8-bit (0-255 range) */
-        int byte_int = int(byte_value * 255.0);
         /* Extract 4-bit value */
-        int color_4bit = lsb ? (byte_int & 0x0F) : (byte_int >> 4);
-        /* Normalize 4-bit color to 0-1 range */
-        return color_4bit;
+        return lsb ? (byte_int & 0x0F) : (byte_int >> 4);
     } else {
-        return int(byte_value * 255.0);
+        return byte_int;
     }
 }
 
 
-vec4 get_attr(ivec2 pix_pos, out ivec3 offset_in_tile) {
+/**
+ * @returns the tile of layer 0 (x) and the tile or attributes of layer 1 (y)
+ */
+ivec2 get_attr(ivec2 pix_pos, out ivec3 offset_in_tile) {
     ivec2 tile_pos = ivec2(int(pix_pos.x) / TILE_WIDTH, int(pix_pos.y) / TILE_HEIGHT);
 
     /* Get the address of the pixel to show within the 16x16 tile. Get it in one dimension */
@@ -109,31 +126,25 @@ vec4 get_attr(ivec2 pix_pos, out ivec3 offset_in_tile) {
     offset_in_tile.y = int(pix_pos.y) % TILE_HEIGHT;
     offset_in_tile.z = offset_in_tile.x + (offset_in_tile.y * TILE_WIDTH);
 
-    vec4 ret;
     if (debug_mode == GFX_DEBUG_TILESET_MODE) {
-        float tile_idx = float(tile_pos.x + tile_pos.y * TILESET_MAX_X);
-        ret = vec4(tile_idx / float(TILE_COUNT - 1), 0.0, 0.0, 0.0);
+        return ivec2(tile_pos.x + tile_pos.y * TILESET_MAX_X, 0);
     } else {
         int tile_idx = tile_pos.x + tile_pos.y * MAX_X;
-        /* Added 0.1 to the divider to make sure we don't go beyond 1.0 */
-        float float_idx = (float(tile_idx) + 0.5) / TILEMAP_ENTRIES;
-        ret = texture(tilemaps, vec2(float_idx, 1.0));
+        return ivec2(tilemap_byte(0, tile_idx), tilemap_byte(1, tile_idx));
     }
-
-    return ret;
 }
 
 
 vec4 gfx_mode(ivec2 flipped, bool color_4bit, out int l0_icolor, out int l1_icolor) {
     ivec3 offset;
-    vec4 s_attr = get_attr(flipped, offset);
+    ivec2 s_attr = get_attr(flipped, offset);
 
     if (color_4bit) {
         /* In 4-bit mode, the original index needs to be divided by 2 (so that 255 is the last tile)
          * of the first half */
-        int l0_idx = int(s_attr.r * float(TILE_COUNT - 1));
+        int l0_idx = s_attr.x;
         /* Get the lowest nibble of layer1 (attributes), if 1, offset the tile to the next tileset */
-        int attr = int(s_attr.g * 255.0);
+        int attr = s_attr.y;
         l0_idx += (attr & 1) != 0 ? 256 : 0;
         /* Check for Flip Y attribute */
         if ((attr & 4) != 0) {
@@ -149,24 +160,21 @@ vec4 gfx_mode(ivec2 flipped, bool color_4bit, out int l0_icolor, out int l1_icol
         /* The color is between 0 and 15, append the palette index to it */
         int palette_idx = attr & 0xf0;
         /* No transparency in 4-bit mode */
-        return texture(palette, vec2((float(color + palette_idx) + 0.5) / PALETTE_SIZE, 0.5));
-        // return vec4(palette[color + palette_idx], 1.0f);
+        return palette_color(color + palette_idx);
     } else {
         /* 8-bit color mode */
         /* Get the two indexes */
-        int l0_idx = int(s_attr.r * float(TILE_COUNT - 1));
-        int l1_idx = int(s_attr.g * float(TILE_COUNT - 1));
+        int l0_idx = s_attr.x;
+        int l1_idx = s_attr.y;
 
         l0_icolor = color_from_idx(l0_idx, int(offset.z), color_4bit);
         l1_icolor = color_from_idx(l1_idx, int(offset.z), color_4bit);
 
         /* If layer1 color index is 0, count it as transparent */
         if (l1_icolor == 0) {
-            // return vec4(palette[l0_icolor], 0.0f);
-            return texture(palette, vec2((float(l0_icolor) + 0.5) / PALETTE_SIZE, 0.5));
+            return palette_color(l0_icolor);
         } else {
-            // return vec4(palette[l1_icolor], 1.0f);
-            return texture(palette, vec2((float(l1_icolor) + 0.5) / PALETTE_SIZE, 0.5));
+            return palette_color(l1_icolor);
         }
     }
 }
@@ -206,8 +214,7 @@ void main() {
     } else if (debug_mode == GFX_DEBUG_PALETTE_MODE) {
         /* In this mode we have 16 colors per line */
         int color = cell_idx.y * 16 + cell_idx.x;
-        // finalColor = vec4(palette[color], 1.0f);
-        finalColor = texture(palette, vec2((float(color) + 0.5) / PALETTE_SIZE, 0.5));
+        finalColor = palette_color(color);
     } else {
         int l0_icolor;
         int l1_icolor;
@@ -218,14 +225,11 @@ void main() {
         if (color_4bit) {
             finalColor = ret;
         } else if (debug_mode == GFX_DEBUG_TILESET_MODE) {
-            // finalColor = vec4(palette[l0_icolor], 1.0f);
-            finalColor = texture(palette, vec2((float(l0_icolor) + 0.5) / PALETTE_SIZE, 0.5));
+            finalColor = palette_color(l0_icolor);
         } else if (debug_mode == GFX_DEBUG_LAYER0_MODE  || color_4bit)  {
-            // finalColor = vec4(palette[l0_icolor], 1.0f);
-            finalColor = texture(palette, vec2((float(l0_icolor) + 0.5) / PALETTE_SIZE, 0.5));
+            finalColor = palette_color(l0_icolor);
         } else if (l1_icolor != 0) {
-            // finalColor = vec4(palette[l1_icolor], 1.0f);
-            finalColor = texture(palette, vec2((float(l1_icolor) + 0.5) / PALETTE_SIZE, 0.5));
+            finalColor = palette_color(l1_icolor);
         } else {
             // Compute 2x2 subgrid index to show a grey grid
             int idx = (in_cell.y / 8) * 2 + (in_cell.x / 8);
@@ -26,14 +26,14 @@
 #define MAX_X           (80)
 #define MAX_Y           (40)
 
-#define TILEMAP_ENTRIES     3200.0
-/* The tileset texture is stored with 4 pixels per color: 64KB / sizeof(Color) = 16KB */
-#define TILESET_TEX_WIDTH   64
+/* The tileset texture holds one byte per texel, 256 per line */
+#define TILESET_TEX_WIDTH   256
 #define TILESET_TEX_HEIGHT  256
 /* Size of a single tile in bytes: 256 */
 #define TILESET_SIZE        (256)
 
-#define SIZEOF_COLOR        (4)
+/* The sprites are sorted in bands of 16 lines, each band gives the number of sprites crossing it, then their index */
+#define SPRITES_BAND_HEIGHT 16
 
 #ifdef OPENGL_ES
 precision highp float;
@@ -49,6 +49,7 @@ uniform sampler2D   tilemaps;
 uniform sampler2D   sprites;
 uniform sampler2D   tileset;
 uniform sampler2D   palette;
+uniform sampler2D   sprite_bands;
 uniform int         video_mode;
 uniform ivec2       scroll_l0;
 uniform ivec2       scroll_l1;
@@ -56,6 +57,34 @@ uniform ivec2       scroll_l1;
 
 out vec4 finalColor;
 
+/**
+ * @brief Get a byte of the VRAM out of a texture holding one byte per texel
+ */
+int vram_byte(sampler2D tex, ivec2 coord)
+{
+    return int(texelFetch(tex, coord, 0).r * 255.0 + 0.5);
+}
+
+
+/**
+ * @brief The palette texture holds the RGB565 colors as they are in VRAM, in little-endian
+ */
+vec4 palette_color(int idx)
+{
+    int rgb = vram_byte(palette, ivec2(idx * 2, 0)) | (vram_byte(palette, ivec2(idx * 2 + 1, 0)) << 8);
+    return vec4(float((rgb >> 11) << 3), float(((rgb >> 5) & 0x3f) << 2), float((rgb & 0x1f) << 3), 255.0) / 255.0;
+}
+
+
+/**
+ * @brief The tilemaps texture holds a row of tiles per line, the lines of layer 1 follow the ones of layer 0
+ */
+int tilemap_byte(int layer, int tile_idx)
+{
+    return vram_byte(tilemaps, ivec2(tile_idx % MAX_X, tile_idx / MAX_X + layer * MAX_Y));
+}
+
+
 /**
  * @param idx Index of the tile to render (from a tilemap layer)
  * @param offset Offset within the tile to get the pixel
@@ -72,31 +101,22 @@ int color_from_idx(int idx, int offset, bool color_4bit)
         /* In 4-bit mode, we can simply divide the index by two to get the correct pixel(s) */
         final_idx = final_idx / 2;
     }
-    /* Each pixel in the texture has 4 colors */
-    int pixel_index = final_idx / SIZEOF_COLOR;
-    ivec2 coordinates = ivec2(pixel_index % TILESET_TEX_WIDTH, pixel_index / TILESET_TEX_WIDTH);
-    vec2 addr = (vec2(coordinates) + vec2(0.5, 0.5)) / vec2(64.0, 256.0);
-
-    /* Get one set of color per layer, each containing 4 pixels */
-    vec4 set = texture(tileset, addr);
-    int channel = final_idx % SIZEOF_COLOR;
-    float byte_value = (channel == 0) ? set.r :
-                        (channel == 1) ? set.g :
-                        (channel == 2) ? set.b : set.a;
+    /* Tiles past the end of the 64KB wrap around to the beginning */
+    int byte_int = vram_byte(tileset, ivec2(final_idx % TILESET_TEX_WIDTH,
+                                            (final_idx / TILESET_TEX_WIDTH) % TILESET_TEX_HEIGHT));
     if (color_4bit) {
-        /* Convert to 8-bit (0-255 range) */
-        int byte_int = int(byte_value * 255.0);
         /* Extract 4-bit value */
-        int color_4bit = lsb ? (byte_int & 0x0F) : (byte_int >> 4);
-        /* Normalize 4-bit color to 0-1 range */
-        return color_4bit;
+        return lsb ? (byte_int & 0x0F) : (byte_int >> 4);
     } else {
-        return int(byte_value * 255.0);
+        return byte_int;
     }
 }
 
 
-vec4 get_attr(ivec2 orig, ivec2 scroll, out ivec2 offset_in_tile) {
+/**
+ * @returns the tile of layer 0 (x), the tile or attributes of layer 1 (y) and the offset within the tile (z)
+ */
+ivec3 get_attr(ivec2 orig, ivec2 scroll, out ivec2 offset_in_tile) {
     ivec2 pix_pos = orig + scroll;
 
     /* Take scrolling into account */
@@ -111,28 +131,22 @@ vec4 get_attr(ivec2 orig, ivec2 scroll, out ivec2 offset_in_tile) {
     offset_in_tile.y = int(pix_pos.y) % TILE_HEIGHT;
     int in_tile = offset_in_tile.x + (offset_in_tile.y * TILE_WIDTH);
 
-    /* Added 0.1 to the divider to make sure we don't go beyond 1.0 */
-    float float_idx = (float(tile_idx) + 0.5) / TILEMAP_ENTRIES;
-    vec4 ret = texture(tilemaps, vec2(float_idx, 1.0));
-
-    /* Replace unused B attribute with in_tile value */
-    ret.b = float(in_tile);
-    return ret;
+    return ivec3(tilemap_byte(0, tile_idx), tilemap_byte(1, tile_idx), in_tile);
 }
 
 
 vec4 gfx_mode(ivec2 flipped, bool mode_320, bool color_4bit) {
     ivec2 l0_offset;
     ivec2 l1_offset;
-    vec4 attr_l0 = get_attr(flipped, scroll_l0, l0_offset);
-    vec4 attr_l1 = get_attr(flipped, scroll_l1, l1_offset);
+    ivec3 attr_l0 = get_attr(flipped, scroll_l0, l0_offset);
+    ivec3 attr_l1 = get_attr(flipped, scroll_l1, l1_offset);
 
     if (color_4bit) {
         /* In 4-bit mode, the original index needs to be divided by 2 (so that 255 is the last tile)
          * of the first half */
-        int l0_idx = int(attr_l0.r * float(TILE_COUNT - 1));
+        int l0_idx = attr_l0.x;
         /* Get the lowest nibble of layer1 (attributes), if 1, offset the tile to the next tileset */
-        int attr = int(attr_l0.g * 255.0);
+        int attr = attr_l0.y;
         l0_idx += (attr & 1) != 0 ? 256 : 0;
         /* Check for Flip Y attribute */
         if ((attr & 4) != 0) {
@@ -145,65 +159,65 @@ vec4 gfx_mode(ivec2 flipped, bool mode_320, bool color_4bit) {
         int offset_in_tile = l0_offset.y * TILE_WIDTH + l0_offset.x;
         /* Get the color out of that tile's pixel, between 0 and 15 */
         int color = color_from_idx(l0_idx, offset_in_tile, color_4bit);
-        /* If the layer1's lowest bit was 1, we need to get the right pixel (lowest nibble) */
         /* The color is between 0 and 15, append the palette index to it */
         int palette_idx = attr & 0xf0;
         /* No transparency in 4-bit mode */
-        float color_idx = float(color + palette_idx) + 0.5;
-        return texture(palette, vec2(color_idx / PALETTE_SIZE, 0.5));
+        return palette_color(color + palette_idx);
     } else {
         /* 8-bit color mode */
         /* Get the two indexes */
-        int l0_idx = int(attr_l0.r * float(TILE_COUNT - 1));
-        int l1_idx = int(attr_l1.g * float(TILE_COUNT - 1));
+        int l0_idx = attr_l0.x;
+        int l1_idx = attr_l1.y;
 
-        int l0_icolor = color_from_idx(l0_idx, int(attr_l0.b), color_4bit);
-        int l1_icolor = color_from_idx(l1_idx, int(attr_l1.b), color_4bit);
+        int l0_icolor = color_from_idx(l0_idx, attr_l0.z, color_4bit);
+        int l1_icolor = color_from_idx(l1_idx, attr_l1.z, color_4bit);
 
         /* If layer1 color index is 0, count it as transparent */
         if (l1_icolor == 0) {
-            vec4 color = texture(palette, vec2((float(l0_icolor) + 0.5) / PALETTE_SIZE, 0.5));
+            vec4 color = palette_color(l0_icolor);
             color.a = 0.0;
             return color;
         } else {
-            vec4 color = texture(palette, vec2((float(l1_icolor) + 0.5) / PALETTE_SIZE, 0.5));
             /* Alpha channel is already 1.0f */
-            return color;
+            return palette_color(l1_icolor);
         }
     }
 }
 
 
 void main() {
-    // Create absolute coordinates, with (0,0) at the top-left
+    // Create absolute coordinates, with (0,0) at the top-left. In 320x240px modes, the target is 320x240 too
     ivec2 flipped = ivec2(gl_FragCoord.x, gl_FragCoord.y);
     bool mode_320   = video_mode == MODE_GFX_320_8BIT || video_mode == MODE_GFX_320_4BIT;
     bool color_4bit = video_mode == MODE_GFX_640_4BIT || video_mode == MODE_GFX_320_4BIT;
 
-    if (mode_320) {
-        flipped.x = flipped.x / 2;
-        flipped.y = flipped.y / 2;
-    }
     vec2 fcoord = vec2(flipped);
 
     vec4 layers_color = gfx_mode(flipped, mode_320, color_4bit);
 
     vec4 sprite_color = vec4(0.0, 0.0, 0.0, 0.0);
 
-    for (int i = 0; i < 256; i += 2) {
-
-        vec4 fst_attr = texture(sprites, vec2(float(i) / 255.5, 0.5));
-        vec4 snd_attr = texture(sprites, vec2(float(i + 1) / 255.5, 0.5));
-
-        vec2 sprite_pos   = fst_attr.xy - vec2(TILE_WIDTH, TILE_HEIGHT);
-        int tile_number   = int(fst_attr.z);
-        int palette_msk   = int(fst_attr.w);
-        float f_behind_fg = snd_attr.x;
-        float f_flip_y    = snd_attr.y;
-        float f_flip_x    = snd_attr.z;
-        float f_height_32 = snd_attr.w;
-
-        float sprite_height = (f_height_32 > 0.5) ? 32.0 : 16.0;
+    /* Only go through the sprites crossing the band of lines the pixel is in */
+    int band = flipped.y / SPRITES_BAND_HEIGHT;
+    int band_count = vram_byte(sprite_bands, ivec2(0, band));
+
+    for (int j = 0; j < band_count; j++) {
+        int i = vram_byte(sprite_bands, ivec2(j + 1, band));
+        /* The sprites texture holds the 8 bytes of a sprite in two texels: Y, X, flags and extra flags,
+         * all in little-endian */
+        ivec4 fst_attr = ivec4(texelFetch(sprites, ivec2(i * 2, 0), 0) * 255.0 + 0.5);
+        ivec4 snd_attr = ivec4(texelFetch(sprites, ivec2(i * 2 + 1, 0), 0) * 255.0 + 0.5);
+
+        vec2 sprite_pos = vec2(float(fst_attr.z | (fst_attr.w << 8)), float(fst_attr.x | (fst_attr.y << 8)))
+                        - vec2(TILE_WIDTH, TILE_HEIGHT);
+        int tile_number = ((snd_attr.y & 1) << 8) | snd_attr.x;
+        int palette_msk = snd_attr.y & 0xf0;
+        bool behind_fg  = (snd_attr.y & 2) != 0;
+        bool flip_y     = (snd_attr.y & 4) != 0;
+        bool flip_x     = (snd_attr.y & 8) != 0;
+        bool height_32  = (snd_attr.z & 2) != 0;
+
+        float sprite_height = height_32 ? 32.0 : 16.0;
         /* Ignore the palette in 8-bit mode */
         if (!color_4bit) {
             palette_msk = 0;
@@ -216,22 +230,21 @@ void main() {
             fcoord.y <  sprite_pos.y + sprite_height &&
             /* Check if we have to show the layer1 instead:
              * If the layers_color variable comes from layer1, the `a` field is not 0 */
-            (f_behind_fg < 0.1 || layers_color.a < 0.5)
+            (!behind_fg || layers_color.a < 0.5)
             )
         {
             vec2 pix_pos = fcoord - sprite_pos;
-            if (f_flip_y > 0.5) {
+            if (flip_y) {
                 pix_pos.y = sprite_height - 1.0 - pix_pos.y;
             }
-            if (f_flip_x > 0.5) {
+            if (flip_x) {
                 pix_pos.x = float(TILE_WIDTH) - 1.0 - pix_pos.x;
             }
             /* Get the address of the pixel to show within the 16x16 tile. Get it in one dimension */
             int in_tile = int(pix_pos.x) + int(pix_pos.y) * TILE_WIDTH;
             int icolor = color_from_idx(tile_number, in_tile, color_4bit);
             if (icolor != 0) {
-                float color_idx = float(palette_msk + icolor) + 0.5;
-                sprite_color = texture(palette, vec2(color_idx / PALETTE_SIZE, 0.5));
+                sprite_color = palette_color(palette_msk + icolor);
             }
         }
     }
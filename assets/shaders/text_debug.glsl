@@ -20,8 +20,6 @@
 #define GRID_THICKNESS  1
 #define GRID_WIDTH      (CHAR_WIDTH + GRID_THICKNESS)
 #define GRID_HEIGHT     (CHAR_HEIGHT + GRID_THICKNESS)
-#define FONT_TEX_WIDTH  (256 * CHAR_WIDTH)
-#define FONT_TEX_HEIGHT (CHAR_HEIGHT)
 
 #define SCREEN_WIDTH    (640)
 #define SCREEN_HEIGHT   (480)
@@ -29,8 +27,6 @@
 #define MAX_X           (80)
 #define MAX_Y           (40)
 
-#define TILEMAP_ENTRIES  3200.0
-
 #ifdef OPENGL_ES
 precision highp float;
 precision highp int;
@@ -50,38 +46,64 @@ uniform int         debug_mode;
 
 out vec4 finalColor;
 
+/**
+ * @brief Get a byte of the VRAM out of a texture holding one byte per texel
+ */
+int vram_byte(sampler2D tex, ivec2 coord)
+{
+    return int(texelFetch(tex, coord, 0).r * 255.0 + 0.5);
+}
+
+
+/**
+ * @brief The palette texture holds the RGB565 colors as they are in VRAM, in little-endian
+ */
+vec4 palette_color(int idx)
+{
+    int rgb = vram_byte(palette, ivec2(idx * 2, 0)) | (vram_byte(palette, ivec2(idx * 2 + 1, 0)) << 8);
+    return vec4(float((rgb >> 11) << 3), float(((rgb >> 5) & 0x3f) << 2), float((rgb & 0x1f) << 3), 255.0) / 255.0;
+}
+
+
+/**
+ * @brief The tilemaps texture holds a row of tiles per line, the lines of layer 1 follow the ones of layer 0
+ */
+int tilemap_byte(int layer, int char_idx)
+{
+    return vram_byte(tilemaps, ivec2(char_idx % MAX_X, char_idx / MAX_X + layer * MAX_Y));
+}
+
+
+/**
+ * @brief The font texture holds the bytes of a character per line, bit 7 being the leftmost pixel
+ */
+bool font_pixel(int c, ivec2 in_tile)
+{
+    return ((vram_byte(font, ivec2(in_tile.y, c)) >> (CHAR_WIDTH - 1 - in_tile.x)) & 1) != 0;
+}
+
+
 vec4 text_mode(ivec2 char_pos, ivec2 in_tile,
                out vec4 fg_color, out vec4 bg_color)
 {
-    vec2 addr;
+    int tile_idx;
 
     if (debug_mode == TEXT_DEBUG_LAYER0_MODE || debug_mode == TEXT_DEBUG_LAYER1_MODE)
     {
         int char_idx = char_pos.x + char_pos.y * MAX_X;
-        /* Added 0.1 to the divider to make sure we don't go beyond 1.0 */
-        float float_idx = (float(char_idx) + 0.5) / TILEMAP_ENTRIES;
-        vec4 attr = texture(tilemaps, vec2(float_idx, 1.0));
-        /* The tile number is in the RED attribute ([0.0,1.0]) */
-        float tile_idx = attr.r;
-        fg_color = texture(palette, vec2(attr.a, 0.5));
-        bg_color = texture(palette, vec2(attr.b, 0.5));
-        /* As the address will be used to get a pixel from the texture,
-         * it must also be between 0.0 and 1.0 */
-        /* (CHAR_COUNT - 1) = 255 */
-        addr = (vec2(tile_idx * 255.0 * float(CHAR_WIDTH) + 0.5, 0.5) + vec2(in_tile))
-            / vec2(FONT_TEX_WIDTH, CHAR_HEIGHT);
+        tile_idx = tilemap_byte(0, char_idx);
+        int attr = tilemap_byte(1, char_idx);
+        fg_color = palette_color(attr & 0xf);
+        bg_color = palette_color(attr >> 4);
     } else {
         fg_color = vec4 (1.0, 1.0, 1.0, 1.0);
         bg_color = vec4 (0.0, 0.0, 0.0, 1.0);
         /* We only have 16 characters per line for the font texture */
-        int char_idx = char_pos.x + char_pos.y * 16;
-        addr = (vec2(float(char_idx * CHAR_WIDTH) + 0.5, 0.5) + vec2(in_tile))
-            / vec2(FONT_TEX_WIDTH, CHAR_HEIGHT);
+        tile_idx = char_pos.x + char_pos.y * 16;
     }
 
     /* Check whether the color to show is foreground or background */
-    float is_fg = texture(font, addr).r;
-    if (is_fg > 0.5f) return fg_color;
+    if (font_pixel(tile_idx, in_tile)) return fg_color;
     else return bg_color;
 }
 
@@ -103,8 +125,7 @@ void main() {
     } else if (debug_mode == TEXT_DEBUG_PALETTE_MODE) {
         /* In this mode we have 16 colors per line */
         int color = cell_idx.y * 16 + cell_idx.x;
-        float fcolor = float(color) + 0.5;
-        finalColor = texture(palette, vec2(fcolor / PALETTE_SIZE, 0.5));
+        finalColor = palette_color(color);
     } else {
         /* Get the coordinate of the pixel in cell, without the grid */
         in_cell -= ivec2(GRID_THICKNESS, GRID_THICKNESS);
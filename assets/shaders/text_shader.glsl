@@ -12,8 +12,6 @@
 #define CHAR_COUNT      256
 #define CHAR_HEIGHT     12
 #define CHAR_WIDTH      8
-#define FONT_TEX_WIDTH  (256 * CHAR_WIDTH)
-#define FONT_TEX_HEIGHT (CHAR_HEIGHT)
 
 #define SCREEN_WIDTH    (640)
 #define SCREEN_HEIGHT   (480)
@@ -21,8 +19,6 @@
 #define MAX_X           (80)
 #define MAX_Y           (40)
 
-#define TILEMAP_ENTRIES  3200.0
-
 #ifdef OPENGL_ES
 precision highp float;
 precision highp int;
@@ -48,56 +44,75 @@ uniform ivec2       scroll;
 
 out vec4 finalColor;
 
+/**
+ * @brief Get a byte of the VRAM out of a texture holding one byte per texel
+ */
+int vram_byte(sampler2D tex, ivec2 coord)
+{
+    return int(texelFetch(tex, coord, 0).r * 255.0 + 0.5);
+}
+
+
+/**
+ * @brief The palette texture holds the RGB565 colors as they are in VRAM, in little-endian
+ */
+vec4 palette_color(int idx)
+{
+    int rgb = vram_byte(palette, ivec2(idx * 2, 0)) | (vram_byte(palette, ivec2(idx * 2 + 1, 0)) << 8);
+    return vec4(float((rgb >> 11) << 3), float(((rgb >> 5) & 0x3f) << 2), float((rgb & 0x1f) << 3), 255.0) / 255.0;
+}
+
+
+/**
+ * @brief The tilemaps texture holds a row of tiles per line, the lines of layer 1 follow the ones of layer 0
+ */
+int tilemap_byte(int layer, int char_idx)
+{
+    return vram_byte(tilemaps, ivec2(char_idx % MAX_X, char_idx / MAX_X + layer * MAX_Y));
+}
+
+
+/**
+ * @brief The font texture holds the bytes of a character per line, bit 7 being the leftmost pixel
+ */
+bool font_pixel(int c, ivec2 in_tile)
+{
+    return ((vram_byte(font, ivec2(in_tile.y, c)) >> (CHAR_WIDTH - 1 - in_tile.x)) & 1) != 0;
+}
+
+
 vec4 text_mode(ivec2 flipped) {
     ivec2 char_size = ivec2(CHAR_WIDTH, CHAR_HEIGHT);
     ivec2 char_pos = flipped / char_size;
-    float tile_idx;
-    float bg_color;
-    float fg_color;
+    int tile_idx;
+    int bg_color;
+    int fg_color;
 
     if (char_pos == curpos) {
-        tile_idx = float(curchar) / 255.01;
-        bg_color = (float(curcolor.x) + 0.5) / PALETTE_SIZE;
-        fg_color = (float(curcolor.y) + 0.5) / PALETTE_SIZE;
+        tile_idx = curchar;
+        bg_color = curcolor.x;
+        fg_color = curcolor.y;
     } else {
         /* Take scrolling into account */
         char_pos.x = (char_pos.x + scroll.x) % MAX_X;
         char_pos.y = (char_pos.y + scroll.y) % MAX_Y;
         int char_idx = char_pos.x + char_pos.y * MAX_X;
-        float float_idx = (float(char_idx) + 0.5) / TILEMAP_ENTRIES;
-        vec4 attr = texture(tilemaps, vec2(float_idx, 1.0));
-         /* The tile number is in the RED attribute ([0.0,1.0]) */
-        tile_idx = attr.r;
-        /* We can use attr.a and attr.b out of the box since they are 8-bit big, just like the palette */
-        fg_color = attr.a;
-        bg_color = attr.b;
+        tile_idx = tilemap_byte(0, char_idx);
+        /* Layer 1 holds the background color in its upper nibble, the foreground in the lower one */
+        int attr = tilemap_byte(1, char_idx);
+        fg_color = attr & 0xf;
+        bg_color = attr >> 4;
     }
 
-    // Get the address of the pixel to show
-    ivec2 in_tile = flipped % char_size;
-    // As the address will be used to get a pixel from the texture, it must also be between 0.0 and 1.0
-    float coord_x = tile_idx * float((CHAR_COUNT -  1) * CHAR_WIDTH);
-    vec2 addr = (vec2(coord_x + 0.5, 0.5) + vec2(in_tile))
-               / vec2(FONT_TEX_WIDTH, CHAR_HEIGHT);
-
     // Check whether the color to show is foreground or background
-    float is_fg = texture(font, addr).r;
-
-    if (is_fg > 0.5f) {
-        return texture(palette, vec2(fg_color, 0.5));
-    } else {
-        return texture(palette, vec2(bg_color, 0.5));
-    }
+    ivec2 in_tile = flipped % char_size;
+    return palette_color(font_pixel(tile_idx, in_tile) ? fg_color : bg_color);
 }
 
 void main() {
     // Create absolute coordinates, with (0,0) at the top-left
+    // In 320x240px mode, the target is 320x240 too, the scaling is done when showing it
     ivec2 flipped = ivec2(gl_FragCoord.x, gl_FragCoord.y);
-    // 320x240px mode, scale by 2
-    if (video_mode == MODE_TEXT_320) {
-        flipped.x = flipped.x / 2;
-        flipped.y = flipped.y / 2;
-    }
 
     finalColor = text_mode(flipped);
 }
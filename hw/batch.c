@@ -0,0 +1,342 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "hw/batch.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hw/zeal.h"
+#include "utils/config.h"
+#include "utils/file.h"
+#include "utils/helpers.h"
+#include "utils/keyvalue.h"
+#include "utils/log.h"
+
+#ifndef PLATFORM_WEB
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define BATCH_LINE_MAX 4096
+#define BATCH_DEFAULT_THREADS 4
+
+typedef struct {
+    int line;
+    char *rom;
+    char *uprog;
+    char *cf;
+    char *eeprom;
+    unsigned long cycles;
+    /* Expected UART output, NULL if the output is not checked */
+    char *expected;
+    size_t expected_len;
+} batch_job_t;
+
+/**
+ * @brief UART output of a machine, only the bytes that can be compared to the expected output are kept
+ */
+typedef struct {
+    char *data;
+    size_t cap;
+    size_t len;
+} batch_output_t;
+
+typedef struct {
+    const char *manifest;
+    batch_job_t *jobs;
+    int count;
+    int next;
+    int failed;
+#ifndef PLATFORM_WEB
+    /* Protects `next`, `failed`, the console and the parts of the machine setup sharing host state */
+    pthread_mutex_t lock;
+#endif
+} batch_t;
+
+static void batch_job_free(batch_job_t *job) {
+    free(job->rom);
+    free(job->uprog);
+    free(job->cf);
+    free(job->eeprom);
+    free(job->expected);
+}
+
+/**
+ * @brief Parse a single `key=value` pair of a job description
+ */
+static int batch_parse_pair(batch_job_t *job, const char *key, const char *value) {
+    if (strcmp(key, "rom") == 0) {
+        job->rom = zstrdup(value);
+    } else if (strcmp(key, "uprog") == 0) {
+        job->uprog = zstrdup(value);
+    } else if (strcmp(key, "cf") == 0) {
+        job->cf = zstrdup(value);
+    } else if (strcmp(key, "eeprom") == 0) {
+        job->eeprom = zstrdup(value);
+    } else if (strcmp(key, "cycles") == 0) {
+        if (!kv_parse_ulong(value, 0, &job->cycles)) {
+            log_err_printf("[BATCH] line %d: invalid cycle count %s\n", job->line, value);
+            return 1;
+        }
+    } else if (strcmp(key, "expect") == 0) {
+        free(job->expected);
+        job->expected = file_read(value, &job->expected_len);
+        if (job->expected == NULL) {
+            log_perror("[BATCH] Could not read %s", value);
+            return 1;
+        }
+    } else {
+        log_err_printf("[BATCH] line %d: unknown key %s\n", job->line, key);
+        return 1;
+    }
+    return 0;
+}
+
+static int batch_parse_job(batch_job_t *job, char *line) {
+    char *key = NULL;
+    char *value = NULL;
+    kv_result_t res;
+    while ((res = kv_next(&line, &key, &value)) == KV_PAIR) {
+        if (batch_parse_pair(job, key, value)) {
+            return 1;
+        }
+    }
+    if (res == KV_INVALID) {
+        log_err_printf("[BATCH] line %d: expected key=value, got %s\n", job->line, key);
+        return 1;
+    }
+
+    if (job->cycles == 0) {
+        log_err_printf("[BATCH] line %d: the cycle count is mandatory\n", job->line);
+        return 1;
+    }
+    return 0;
+}
+
+static int batch_parse_manifest(batch_t *batch) {
+    FILE *file = fopen(batch->manifest, "r");
+    if (file == NULL) {
+        log_perror("[BATCH] Could not open manifest %s", batch->manifest);
+        return 1;
+    }
+
+    char line[BATCH_LINE_MAX];
+    int line_num = 0;
+    int capacity = 0;
+    int err = 0;
+    while (!err && fgets(line, sizeof(line), file) != NULL) {
+        line_num++;
+        const char *start = line + strspn(line, " \t\r\n");
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+
+        if (batch->count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            batch_job_t *jobs = realloc(batch->jobs, capacity * sizeof(batch_job_t));
+            if (jobs == NULL) {
+                log_err_printf("[BATCH] Could not allocate the jobs\n");
+                err = 1;
+                break;
+            }
+            batch->jobs = jobs;
+        }
+
+        batch_job_t *job = &batch->jobs[batch->count++];
+        memset(job, 0, sizeof(*job));
+        job->line = line_num;
+        err = batch_parse_job(job, line);
+    }
+    fclose(file);
+    return err;
+}
+
+static void batch_uart_output(void *arg, char c) {
+    batch_output_t *output = (batch_output_t *)arg;
+    if (output->len < output->cap) {
+        output->data[output->len] = c;
+    }
+    output->len++;
+}
+
+#ifndef PLATFORM_WEB
+
+/**
+ * @brief Run a single job on `machine`, returns true if it passed
+ */
+static bool batch_run_job(batch_t *batch, zeal_t *machine, const batch_job_t *job) {
+    config_arguments_t args = config.arguments;
+    args.headless = true;
+    args.rom_filename = job->rom;
+    args.uprog_filename = job->uprog;
+    args.cf_filename = job->cf;
+    args.eeprom_filename = job->eeprom;
+    args.tf_filename = NULL;
+
+    /* Keep one more byte than expected to detect the outputs that are too long */
+    batch_output_t output = {.cap = job->expected ? job->expected_len + 1 : 0};
+    if (output.cap != 0) {
+        output.data = malloc(output.cap);
+        if (output.data == NULL) {
+            return false;
+        }
+    }
+
+    /* The ROM lookup and the logs use buffers shared by the whole process */
+    pthread_mutex_lock(&batch->lock);
+    int err = zeal_init_args(machine, &args);
+    /* From here, the machine holds resources to release, even if the job can't run */
+    const bool initialized = err == 0;
+    if (initialized && flash_load_from_file(&machine->rom, job->rom, job->uprog) != FLASH_ERR_OK) {
+        err = 1;
+    }
+    /* Jobs naming the same image run at the same time, each one writes to its own copy */
+    if (err == 0 && zeal_private_images(machine) != 0) {
+        err = 1;
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    bool passed = false;
+    if (err == 0) {
+        uart_set_output(&machine->uart, batch_uart_output, &output);
+        machine->cycle_limit = machine->cpu.cyc + job->cycles;
+        zeal_run(machine);
+        passed = job->expected == NULL ||
+                 (output.len == job->expected_len && memcmp(output.data, job->expected, output.len) == 0);
+    }
+
+    pthread_mutex_lock(&batch->lock);
+    if (err != 0) {
+        log_printf("[BATCH] %s:%d: ERROR, could not initialize the machine\n", batch->manifest, job->line);
+    } else if (passed) {
+        log_printf("[BATCH] %s:%d: PASS (%lu T-states)\n", batch->manifest, job->line, machine->cpu.cyc);
+    } else {
+        size_t diff = 0;
+        const size_t kept = output.len < output.cap ? output.len : output.cap;
+        while (diff < kept && diff < job->expected_len && output.data[diff] == job->expected[diff]) {
+            diff++;
+        }
+        log_printf("[BATCH] %s:%d: FAIL, UART output differs at byte %zu (%zu bytes sent, %zu expected)\n",
+                   batch->manifest, job->line, diff, output.len, job->expected_len);
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    if (initialized) {
+        zeal_deinit(machine);
+    }
+    free(output.data);
+    return passed;
+}
+
+static void *batch_worker(void *arg) {
+    batch_t *batch = (batch_t *)arg;
+    /* The machine is too big for the thread stack */
+    zeal_t *machine = malloc(sizeof(zeal_t));
+    if (machine == NULL) {
+        log_err_printf("[BATCH] Could not allocate a machine\n");
+        return NULL;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        const int index = batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+        if (index >= batch->count) {
+            break;
+        }
+
+        if (!batch_run_job(batch, machine, &batch->jobs[index])) {
+            pthread_mutex_lock(&batch->lock);
+            batch->failed++;
+            pthread_mutex_unlock(&batch->lock);
+        }
+    }
+
+    free(machine);
+    return NULL;
+}
+
+static int batch_default_threads(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0) {
+        return (int)cpus;
+    }
+#endif
+    return BATCH_DEFAULT_THREADS;
+}
+
+int batch_run(const char *manifest, int threads) {
+    batch_t batch = {.manifest = manifest};
+
+    int err = batch_parse_manifest(&batch);
+    if (err == 0 && batch.count == 0) {
+        log_err_printf("[BATCH] No job in manifest %s\n", manifest);
+        err = 1;
+    }
+    if (err != 0) {
+        goto free_jobs;
+    }
+
+    if (threads <= 0) {
+        threads = batch_default_threads();
+    }
+    if (threads > batch.count) {
+        threads = batch.count;
+    }
+
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    if (workers == NULL) {
+        err = 1;
+        goto free_jobs;
+    }
+
+    pthread_mutex_init(&batch.lock, NULL);
+    int started = 0;
+    for (; started < threads; started++) {
+        if (pthread_create(&workers[started], NULL, batch_worker, &batch) != 0) {
+            log_err_printf("[BATCH] Could not start worker %d\n", started);
+            break;
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&batch.lock);
+    free(workers);
+
+    if (started == 0) {
+        err = 1;
+    } else {
+        /* Jobs never picked because a worker failed to allocate its machine count as failures */
+        if (batch.next < batch.count) {
+            batch.failed += batch.count - batch.next;
+        }
+        log_printf("[BATCH] %d/%d jobs passed\n", batch.count - batch.failed, batch.count);
+        err = batch.failed != 0;
+    }
+
+free_jobs:
+    for (int i = 0; i < batch.count; i++) {
+        batch_job_free(&batch.jobs[i]);
+    }
+    free(batch.jobs);
+    return err;
+}
+
+#else
+
+int batch_run(const char *manifest, int threads) {
+    (void)manifest;
+    (void)threads;
+    log_err_printf("[BATCH] Batch mode is not supported on this platform\n");
+    return 1;
+}
+
+#endif  // PLATFORM_WEB
@@ -252,6 +252,12 @@ int compactflash_init(compactflash_t *cf, const char *file_name) {
         return 1;
     }
 
+    if (fstat(fileno(fd), &st) != 0) {
+        log_perror("[COMPACTFLASH] Could not get the image size");
+        fclose(fd);
+        return 1;
+    }
+
     if (st.st_size < 1024 * 1024) {
         log_err_printf("[COMPACTFLASH] Image must be at least 1MB big\n");
         fclose(fd);
@@ -283,3 +289,45 @@ int compactflash_init(compactflash_t *cf, const char *file_name) {
     device_init_io(DEVICE(cf), "compactflash_dev", io_read, io_write, cf->size);
     return 0;
 }
+
+void compactflash_deinit(compactflash_t *cf) {
+    if (cf->fd == NULL) {
+        return;
+    }
+    fclose(cf->fd);
+    free(cf->file_name);
+    cf->fd = NULL;
+    cf->file_name = NULL;
+}
+
+int compactflash_use_copy(compactflash_t *cf) {
+    if (cf->fd == NULL) {
+        return 0;
+    }
+
+    FILE *original = fopen(cf->file_name, "rb");
+    FILE *copy = tmpfile();
+    int err = original == NULL || copy == NULL;
+    uint8_t buffer[16 * 1024];
+    size_t rd = 0;
+    while (!err && (rd = fread(buffer, 1, sizeof(buffer), original)) != 0) {
+        err = fwrite(buffer, 1, rd, copy) != rd;
+    }
+    if (!err && ferror(original)) {
+        err = 1;
+    }
+
+    if (original != NULL) {
+        fclose(original);
+    }
+    if (err) {
+        log_perror("[COMPACTFLASH] Could not copy %s", cf->file_name);
+        if (copy != NULL) {
+            fclose(copy);
+        }
+        return 1;
+    }
+    fclose(cf->fd);
+    cf->fd = copy;
+    return 0;
+}
@@ -306,6 +306,22 @@ void debugger_step_over(dbg_t *dbg)
     dbg->step_over_cb(dbg);
 }
 
+void debugger_step_back(dbg_t *dbg)
+{
+    if (dbg == NULL || dbg->step_back_cb == NULL) {
+        return;
+    }
+    dbg->step_back_cb(dbg);
+}
+
+void debugger_reverse_continue(dbg_t *dbg)
+{
+    if (dbg == NULL || dbg->reverse_continue_cb == NULL) {
+        return;
+    }
+    dbg->reverse_continue_cb(dbg);
+}
+
 void debugger_breakpoint(dbg_t *dbg) {
     if (dbg == NULL || dbg->breakpoint_cb == NULL) {
         return;
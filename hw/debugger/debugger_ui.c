@@ -304,7 +304,7 @@ void debugger_scale_down(dbg_t *dbg) {
 int debugger_ui_init(struct dbg_ui_t** ret_ctx, const dbg_ui_init_args_t* args)
 {
     if (ret_ctx == NULL || args == NULL ||
-        args->main_view == NULL || args->zvb == NULL)
+        args->main_view == NULL || args->zvb == NULL || args->render == NULL)
     {
         return 0;
     }
@@ -332,6 +332,7 @@ int debugger_ui_init(struct dbg_ui_t** ret_ctx, const dbg_ui_init_args_t* args)
         dbg_ctx->vram[i] = TextureToNuklear(args->debug_views[i].texture);
     }
     dbg_ctx->zvb = args->zvb;
+    dbg_ctx->render = args->render;
 
     /* Set the default attributes */
     dbg_ctx->mem_view_size = 256;
@@ -229,7 +229,17 @@ void ui_panel_cpu(struct dbg_ui_panel_t* panel, struct dbg_ui_t* dctx, dbg_t* db
     nk_check_label(ctx, "S",   BIT(regs.f, 7) != 0);
 
 
-    nk_layout_row_dynamic(ctx, CPU_CTRL_REG_HEIGHT, 4);
+    nk_layout_row_dynamic(ctx, CPU_CTRL_REG_HEIGHT, 6);
+
+    dbg_ui_mouse_hover(ctx, MOUSE_POINTER);
+    if (nk_button_label(ctx, "<<")) {
+        debugger_reverse_continue(dbg);
+    }
+
+    dbg_ui_mouse_hover(ctx, MOUSE_POINTER);
+    if (nk_button_label(ctx, "|<")) {
+        debugger_step_back(dbg);
+    }
 
     dbg_ui_mouse_hover(ctx, MOUSE_POINTER);
     if (paused) {
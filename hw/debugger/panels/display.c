@@ -37,6 +37,10 @@ void ui_panel_display(struct dbg_ui_panel_t* panel, struct dbg_ui_t* dctx, dbg_t
         panel->override_header_style = false;
     }
 
+    /* Only show the area of the texture the frame was drawn in, it is scaled up to the panel */
+    img->region[2] = (nk_ushort) dctx->render->width;
+    img->region[3] = (nk_ushort) dctx->render->height;
+
     nk_layout_row_dynamic(ctx, height, 1);
     nk_image(ctx, *img);
 }
@@ -6,6 +6,7 @@
 
 
 #include "hw/zeal.h"
+#include "hw/zeal_window.h"
 #include "debugger/debugger.h"
 #include "debugger/debugger_ui.h"
 
@@ -71,12 +72,24 @@ void ui_menubar(struct dbg_ui_t* dctx, dbg_t* dbg, dbg_ui_panel_t *panels, int p
             if (nk_menu_item_label(ctx, "Step                  Meta+F11", NK_TEXT_LEFT)) {
                 debugger_step(dbg);
             }
+            if (nk_menu_item_label(ctx, "Step Back       Meta+Shift+F11", NK_TEXT_LEFT)) {
+                debugger_step_back(dbg);
+            }
+            if (nk_menu_item_label(ctx, "Reverse Continue Meta+Shift+F5", NK_TEXT_LEFT)) {
+                debugger_reverse_continue(dbg);
+            }
             if (nk_menu_item_label(ctx, "Toggle Breakpoint      Meta+F9", NK_TEXT_LEFT)) {
                 debugger_toggle_breakpoint(dbg, machine->cpu.pc);
             }
             if (nk_menu_item_label(ctx, "Reset          Meta+Shift+Bksp", NK_TEXT_LEFT)) {
                 debugger_reset(dbg);
             }
+            if (nk_menu_item_label(ctx, "Save State             Meta+F2", NK_TEXT_LEFT)) {
+                zeal_window_save_state(machine);
+            }
+            if (nk_menu_item_label(ctx, "Load State             Meta+F3", NK_TEXT_LEFT)) {
+                zeal_window_load_state(machine);
+            }
             nk_menu_end(ctx);
         }
 
@@ -16,6 +16,7 @@
 #include <string.h>
 /* **** */
 #include "hw/flash.h"
+#include "hw/mmu.h"
 #include "utils/helpers.h"
 #include "utils/log.h"
 #include "utils/paths.h"
@@ -56,6 +57,26 @@ typedef enum {
     STATE_PERFORM_ERASE_DELAY,
 } fsm_state_t;
 
+_Static_assert(STATE_PERFORM_ERASE_DELAY + 1 == FLASH_STATE_COUNT, "FLASH_STATE_COUNT must match the FSM states");
+
+/**
+ * @brief Check whether reading the flash in the given state returns the raw content of the array
+ */
+static inline bool flash_state_reads_array(int state) {
+    return state != STATE_PERFORM_ERASE_DELAY && state != STATE_PERFORM_WRITE_DELAY && state != STATE_SOFTWARE_ID;
+}
+
+/**
+ * @brief Switch the FSM to a new state, notify the bus when the direct read pointers become (in)valid
+ */
+static void flash_set_state(flash_t *f, int state) {
+    const bool was_direct = flash_state_reads_array(f->state);
+    f->state = state;
+    if (was_direct != flash_state_reads_array(state)) {
+        device_notify_direct_changed(DEVICE(f));
+    }
+}
+
 static uint8_t flash_read(device_t *dev, uint32_t addr) {
     flash_t *f = (flash_t *)dev;
 
@@ -100,37 +121,65 @@ static uint8_t flash_debug_read(device_t *dev, uint32_t addr) {
     return f->data[addr];
 }
 
+/**
+ * @brief Read a block out of the array, the status reads of the program/erase states toggle bits so they
+ * still go through the FSM. Writes are commands and always go through `flash_write`.
+ */
+static void flash_read_block(device_t *dev, uint32_t addr, uint8_t *dst, uint32_t len) {
+    flash_t *f = (flash_t *)dev;
+    if (!flash_state_reads_array(f->state)) {
+        for (uint32_t i = 0; i < len; i++) {
+            dst[i] = flash_read(dev, addr + i);
+        }
+        return;
+    }
+    if (addr >= f->size || len > f->size - addr) {
+        log_err_printf("[FLASH] Invalid block read: %08x (%u bytes)\n", addr, len);
+        return;
+    }
+    memcpy(dst, &f->data[addr], len);
+}
+
+static uint8_t *flash_direct(device_t *dev, uint32_t addr, bool write) {
+    flash_t *f = (flash_t *)dev;
+    /* Writes always need to go through the FSM */
+    if (write || !flash_state_reads_array(f->state) || addr + MMU_PAGE_SIZE > f->size) {
+        return NULL;
+    }
+    return &f->data[addr];
+}
+
 static void flash_write(device_t *dev, uint32_t addr, uint8_t data) {
     flash_t *f = (flash_t *)dev;
 
     switch (f->state) {
         case STATE_IDLE:
             if (addr == 0x5555 && data == 0xaa) {
-                f->state = STATE_SPECIAL_STEP0;
+                flash_set_state(f, STATE_SPECIAL_STEP0);
             }
             break;
         case STATE_SPECIAL_STEP0:
             if (addr == 0x2aaa && data == 0x55) {
-                f->state = STATE_SPECIAL_STEP1;
+                flash_set_state(f, STATE_SPECIAL_STEP1);
             }
             break;
         case STATE_SPECIAL_STEP1:
             if (addr == 0x5555 && data == 0x90) {
-                f->state = STATE_SOFTWARE_ID;
+                flash_set_state(f, STATE_SOFTWARE_ID);
             } else if (addr == 0x5555 && data == 0xa0) {
-                f->state = STATE_PERFORM_WRITE;
+                flash_set_state(f, STATE_PERFORM_WRITE);
             } else if (addr == 0x5555 && data == 0x80) {
-                f->state = STATE_SPECIAL_STEP2;
+                flash_set_state(f, STATE_SPECIAL_STEP2);
             }
             break;
         case STATE_SPECIAL_STEP2:
             if (addr == 0x5555 && data == 0xaa) {
-                f->state = STATE_SPECIAL_STEP3;
+                flash_set_state(f, STATE_SPECIAL_STEP3);
             }
             break;
         case STATE_SPECIAL_STEP3:
             if (addr == 0x2aaa && data == 0x55) {
-                f->state = STATE_PERFORM_ERASE;
+                flash_set_state(f, STATE_PERFORM_ERASE);
             }
             break;
 
@@ -144,16 +193,16 @@ static void flash_write(device_t *dev, uint32_t addr, uint8_t data) {
             /* The byte being written must have bit 7 flipped, DQ6 must be toggled at each read */
             f->writing_byte = data ^ 0x80;
             /* Writing a byte takes 20us on real hardware, register a callback to actually reflect this */
-            f->ticks_remaining = us_to_tstates(20);
-            f->state = STATE_PERFORM_WRITE_DELAY;
+            sched_in(f->sched, &f->delay_event, us_to_tstates(20));
+            flash_set_state(f, STATE_PERFORM_WRITE_DELAY);
             break;
 
         case STATE_PERFORM_ERASE:
             if (data == 0x30) {
                 /* Erase sector transaction! */
-                f->state = STATE_PERFORM_ERASE_DELAY;
+                flash_set_state(f, STATE_PERFORM_ERASE_DELAY);
                 /* Erasing a sector takes 25ms on real hardware */
-                f->ticks_remaining = us_to_tstates(25000);
+                sched_in(f->sched, &f->delay_event, us_to_tstates(25000));
                 /* Get the corresponding 4KB-sector to erase out of the 22-bit address */
                 const uint32_t sector = addr & 0x3ff000;
                 log_printf("[FLASH] Erasing sector %d @ address 0x%x\n", sector / 4096, sector);
@@ -162,14 +211,14 @@ static void flash_write(device_t *dev, uint32_t addr, uint8_t data) {
             } else if (data == 0x10 && addr == 0x5555) {
                 /* Chip erase! */
                 log_printf("[FLASH] Erasing chip\n");
-                f->state = STATE_PERFORM_ERASE_DELAY;
+                flash_set_state(f, STATE_PERFORM_ERASE_DELAY);
                 /* Erasing the chip takes 100ms on real hardware */
-                f->ticks_remaining = us_to_tstates(100000);
+                sched_in(f->sched, &f->delay_event, us_to_tstates(100000));
                 f->dirty = 1;
                 memset(f->data, 0xff, f->size);
             } else {
                 /* Invalid state, try again */
-                f->state = STATE_IDLE;
+                flash_set_state(f, STATE_IDLE);
                 flash_write(dev, addr, data);
             }
             break;
@@ -181,28 +230,38 @@ static void flash_write(device_t *dev, uint32_t addr, uint8_t data) {
 
         case STATE_SOFTWARE_ID:
             if (data == 0xf0) {
-                f->state = STATE_IDLE;
+                flash_set_state(f, STATE_IDLE);
             }
             break;
 
         default:
             /* The combination was invalid, reset the state and retry, else,
              * the current byte being written would be lost and not part of the FSM. */
-            f->state = STATE_IDLE;
+            flash_set_state(f, STATE_IDLE);
             flash_write(dev, addr, data);
             break;
     }
 }
 
-flash_error_t flash_init(flash_t *f) {
+/**
+ * @brief Event invoked when the program/erase delay is over
+ */
+static void flash_delay_event(scheduler_t *sched, sched_event_t *ev, void *arg) {
+    (void)sched;
+    (void)ev;
+    flash_set_state((flash_t *)arg, STATE_IDLE);
+}
+
+flash_error_t flash_init(flash_t *f, scheduler_t *sched) {
     if (f == NULL) {
         return FLASH_ERR_SYNTAX;
     }
-    /* Empty flash contains FF bytes*/
-    memset(f, 0xFF, sizeof(*f));
+    memset(f, 0, sizeof(*f));
     f->size = NOR_FLASH_SIZE_KB;
     f->state = STATE_IDLE;
     f->dirty = 0;
+    f->sched = sched;
+    sched_event_init(&f->delay_event, "flash_delay", flash_delay_event, f);
 
 #if CONFIG_NOR_FLASH_DYNAMIC_ARRAY
     f->data = malloc(f->size);
@@ -211,20 +270,15 @@ flash_error_t flash_init(flash_t *f) {
         return FLASH_ERR_NO_MEMORY;
     }
 #endif
+    /* Empty flash contains FF bytes*/
+    memset(f->data, 0xFF, f->size);
 
     device_init_mem_debug(DEVICE(f), "nor_flash_dev", flash_read, flash_write, flash_debug_read, f->size);
+    device_register_direct(DEVICE(f), flash_direct);
+    device_register_mem_block(DEVICE(f), flash_read_block, NULL);
     return FLASH_ERR_OK;
 }
 
-void flash_tick(flash_t *flash, int elapsed_tstates) {
-    if (flash->state == STATE_PERFORM_ERASE_DELAY || flash->state == STATE_PERFORM_WRITE_DELAY) {
-        flash->ticks_remaining -= elapsed_tstates;
-        if (flash->ticks_remaining <= 0) {
-            flash->state = STATE_IDLE;
-        }
-    }
-}
-
 static inline uint16_t flash_dereference(flash_t *flash, uint16_t os_addr, uint16_t data_addr) {
     uint8_t *addr = &flash->data[os_addr + data_addr];
     return (addr[0]) | (addr[1] << 8);
@@ -459,6 +513,13 @@ flash_error_t flash_load_from_file(flash_t *flash, const char *rom_filename, con
     return FLASH_ERR_OK;
 }
 
+flash_error_t flash_load_user_program(flash_t *flash, const char *userprog_filename) {
+    if (flash == NULL || userprog_filename == NULL) {
+        return FLASH_ERR_SYNTAX;
+    }
+    return flash_override_romdisk(flash, userprog_filename);
+}
+
 flash_error_t flash_save_to_file(flash_t *flash, const char *name) {
     if (flash == NULL || name == NULL) {
         return FLASH_ERR_SYNTAX;
@@ -0,0 +1,422 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "hw/fork_server.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hw/keyboard.h"
+#include "hw/zeal.h"
+#include "utils/file.h"
+#include "utils/helpers.h"
+#include "utils/keyvalue.h"
+#include "utils/log.h"
+
+#if !defined(PLATFORM_WEB) && (defined(__unix__) || defined(__APPLE__))
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define FORK_LINE_MAX 4096
+#define FORK_MARKER_MAX 256
+#define FORK_BACKLOG 64
+/* The boot is considered failed if the boot point is not reached after a minute of emulated time */
+#define FORK_BOOT_TSTATES US_TO_TSTATES(60 * 1000000UL)
+
+/**
+ * @brief Watches the UART output for the boot marker, only the last bytes received are kept
+ */
+typedef struct {
+    zeal_t *machine;
+    const char *marker;
+    size_t len;
+    char window[FORK_MARKER_MAX];
+    size_t filled;
+    bool found;
+} fork_marker_t;
+
+typedef struct {
+    char *data;
+    size_t cap;
+    size_t len;
+} fork_output_t;
+
+typedef struct {
+    const char *uprog;
+    const char *cf;
+    /* Text typed on the keyboard, `typed` characters were sent already */
+    char *keys;
+    size_t keys_len;
+    size_t typed;
+    bool until_set;
+    uint16_t until;
+    unsigned long cycles;
+} fork_request_t;
+
+static void fork_marker_output(void *arg, char c) {
+    fork_marker_t *marker = (fork_marker_t *)arg;
+    if (marker->found) {
+        return;
+    }
+
+    if (marker->filled == marker->len) {
+        memmove(marker->window, marker->window + 1, marker->len - 1);
+        marker->filled--;
+    }
+    marker->window[marker->filled++] = c;
+
+    if (marker->filled == marker->len && memcmp(marker->window, marker->marker, marker->len) == 0) {
+        marker->found = true;
+        /* Stop right after the instruction that sent the last byte */
+        z80_request_exit(&marker->machine->cpu);
+        zeal_exit(marker->machine);
+    }
+}
+
+static void fork_uart_output(void *arg, char c) {
+    fork_output_t *output = (fork_output_t *)arg;
+    if (output->len == output->cap) {
+        const size_t cap = output->cap ? output->cap * 2 : 4096;
+        char *bigger = realloc(output->data, cap);
+        if (bigger == NULL) {
+            /* Drop the byte, the reply reports what could be kept */
+            return;
+        }
+        output->data = bigger;
+        output->cap = cap;
+    }
+    output->data[output->len++] = c;
+}
+
+static bool fork_parse_address(const char *str, uint16_t *addr) {
+    unsigned long value = 0;
+    if (!kv_parse_ulong(str, 16, &value) || value > 0xffff) {
+        return false;
+    }
+    *addr = (uint16_t)value;
+    return true;
+}
+
+/**
+ * @brief Parse a request line, the strings of the request point inside `line`
+ */
+static int fork_parse_request(fork_request_t *req, char *line) {
+    char *key = NULL;
+    char *value = NULL;
+    kv_result_t res;
+    while ((res = kv_next(&line, &key, &value)) == KV_PAIR) {
+        if (strcmp(key, "uprog") == 0) {
+            req->uprog = value;
+        } else if (strcmp(key, "cf") == 0) {
+            req->cf = value;
+        } else if (strcmp(key, "keys") == 0) {
+            free(req->keys);
+            req->keys = file_read(value, &req->keys_len);
+            if (req->keys == NULL) {
+                log_perror("[FORK] Could not read %s", value);
+                return 1;
+            }
+        } else if (strcmp(key, "until") == 0) {
+            req->until_set = fork_parse_address(value, &req->until);
+            if (!req->until_set) {
+                log_err_printf("[FORK] Invalid address %s\n", value);
+                return 1;
+            }
+        } else if (strcmp(key, "cycles") == 0) {
+            if (!kv_parse_ulong(value, 0, &req->cycles)) {
+                log_err_printf("[FORK] Invalid cycle count %s\n", value);
+                return 1;
+            }
+        } else {
+            log_err_printf("[FORK] Unknown key %s\n", key);
+            return 1;
+        }
+    }
+    if (res == KV_INVALID) {
+        log_err_printf("[FORK] Expected key=value, got %s\n", key);
+        return 1;
+    }
+
+    if (req->cycles == 0) {
+        log_err_printf("[FORK] The cycle count is mandatory\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int fork_write_all(int fd, const char *data, size_t len) {
+    while (len != 0) {
+        const ssize_t wr = write(fd, data, len);
+        if (wr < 0 && errno == EINTR) {
+            continue;
+        }
+        if (wr <= 0) {
+            return 1;
+        }
+        data += wr;
+        len -= wr;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read the request line from the client, returns 0 on success
+ */
+static int fork_read_line(int fd, char *line, size_t size) {
+    size_t len = 0;
+    while (len < size - 1) {
+        const ssize_t rd = read(fd, line + len, 1);
+        if (rd < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rd <= 0) {
+            break;
+        }
+        if (line[len] == '\n') {
+            break;
+        }
+        len++;
+    }
+    line[len] = '\0';
+    return len == 0;
+}
+
+/**
+ * @brief Type the next character of the keyboard script once the previous one was received by the CPU
+ */
+static void fork_type_next(zeal_t *machine, fork_request_t *req) {
+    if (req->typed == req->keys_len || !keyboard_idle(&machine->keyboard)) {
+        return;
+    }
+
+    bool shift = false;
+    const uint16_t scancode = keyboard_ascii_scancode(req->keys[req->typed++], &shift);
+    if (scancode == 0) {
+        return;
+    }
+    if (shift) {
+        key_pressed(&machine->keyboard, PS2_SCANCODE_LEFT_SHIFT);
+    }
+    key_pressed(&machine->keyboard, scancode);
+    key_released(&machine->keyboard, scancode);
+    if (shift) {
+        key_released(&machine->keyboard, PS2_SCANCODE_LEFT_SHIFT);
+    }
+}
+
+/**
+ * @brief Serve a single request, called in the child process which owns its own copy of the machine.
+ * The images of the machine are private to the child too, nothing the request writes reaches the disk.
+ */
+static void fork_serve(zeal_t *machine, int conn) {
+    char line[FORK_LINE_MAX];
+    fork_request_t req = {0};
+    fork_output_t output = {0};
+    const char *status = "error";
+    const unsigned long start = machine->cpu.cyc;
+
+    int err = fork_read_line(conn, line, sizeof(line));
+    if (err == 0) {
+        err = fork_parse_request(&req, line);
+    }
+    if (err == 0 && req.uprog != NULL) {
+        err = zeal_insert_user_program(machine, req.uprog);
+    }
+    if (err == 0 && req.cf != NULL) {
+        err = zeal_insert_cf(machine, req.cf);
+    }
+    if (err == 0) {
+        /* The children share the streams of the server, their writes would also reach the next requests */
+        err = zeal_private_images(machine);
+    }
+
+    if (err == 0) {
+        uart_set_output(&machine->uart, fork_uart_output, &output);
+        machine->stop_pc_enabled = req.until_set;
+        machine->stop_pc = req.until;
+        zeal_update_cpu_hooks(machine);
+        /* Past half the counter the limit would look already reached, and a limit of 0 means none */
+        const unsigned long cycles = req.cycles < LONG_MAX ? req.cycles : LONG_MAX;
+        const unsigned long limit = start + cycles;
+        machine->cycle_limit = limit != 0 ? limit : 1;
+
+        while (!machine->should_exit) {
+            fork_type_next(machine, &req);
+            zeal_run_frame(machine);
+        }
+
+        if (req.until_set && machine->cpu.pc == req.until) {
+            status = "pc";
+        } else if (machine->args.no_reset && machine->cpu.pc == 0) {
+            status = "reset";
+        } else {
+            status = "cycles";
+        }
+    }
+
+    char header[128];
+    const int len = snprintf(header, sizeof(header), "status=%s cycles=%lu uart=%zu\n", status,
+                             machine->cpu.cyc - start, output.len);
+    if (fork_write_all(conn, header, len) == 0 && output.len != 0) {
+        (void)fork_write_all(conn, output.data, output.len);
+    }
+    close(conn);
+    free(output.data);
+    free(req.keys);
+}
+
+/**
+ * @brief Run the machine up to the boot point given in the arguments, returns 0 when it was reached
+ */
+static int fork_boot(zeal_t *machine, const config_arguments_t *args) {
+    fork_marker_t marker = {.machine = machine};
+
+    if (args->boot_pc != NULL) {
+        if (!fork_parse_address(args->boot_pc, &machine->stop_pc)) {
+            log_err_printf("[FORK] Invalid boot address %s\n", args->boot_pc);
+            return 1;
+        }
+        machine->stop_pc_enabled = true;
+        zeal_update_cpu_hooks(machine);
+    } else {
+        marker.marker = args->boot_marker;
+        marker.len = strlen(args->boot_marker);
+        if (marker.len == 0 || marker.len > FORK_MARKER_MAX) {
+            log_err_printf("[FORK] The boot marker must be 1 to %d bytes long\n", FORK_MARKER_MAX);
+            return 1;
+        }
+        uart_set_output(&machine->uart, fork_marker_output, &marker);
+    }
+
+    machine->cycle_limit = FORK_BOOT_TSTATES;
+    zeal_run(machine);
+
+    const bool reached = machine->stop_pc_enabled ? machine->cpu.pc == machine->stop_pc : marker.found;
+    if (!reached) {
+        log_err_printf("[FORK] Boot point not reached after %lu T-states\n", machine->cpu.cyc);
+        return 1;
+    }
+
+    /* Leave the machine ready to run the requests */
+    uart_set_output(&machine->uart, NULL, NULL);
+    machine->stop_pc_enabled = false;
+    zeal_update_cpu_hooks(machine);
+    machine->cycle_limit = 0;
+    machine->should_exit = false;
+    log_printf("[FORK] Booted in %lu T-states\n", machine->cpu.cyc);
+    return 0;
+}
+
+static int fork_listen(const char *path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        log_err_printf("[FORK] Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        log_perror("[FORK] Could not create the socket");
+        return -1;
+    }
+    /* A socket left by a previous server would make the bind fail */
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, FORK_BACKLOG) != 0) {
+        log_perror("[FORK] Could not listen on %s", path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int fork_server_run(const config_arguments_t *args) {
+    if (args->boot_pc == NULL && args->boot_marker == NULL) {
+        log_err_printf("[FORK] The fork server needs a boot point, --boot-pc or --boot-marker\n");
+        return 1;
+    }
+
+    config_arguments_t boot_args = *args;
+    boot_args.headless = true;
+
+    /* The machine state is too big for the stack */
+    zeal_t *machine = malloc(sizeof(zeal_t));
+    if (machine == NULL) {
+        log_err_printf("[FORK] Could not allocate the machine\n");
+        return 1;
+    }
+
+    int err = zeal_init_args(machine, &boot_args);
+    if (err != 0) {
+        free(machine);
+        return 1;
+    }
+    if (flash_load_from_file(&machine->rom, args->rom_filename, args->uprog_filename) != FLASH_ERR_OK ||
+        fork_boot(machine, args) != 0) {
+        err = 1;
+        goto deinit;
+    }
+
+    const int server = fork_listen(args->fork_socket);
+    if (server < 0) {
+        err = 1;
+        goto deinit;
+    }
+    log_printf("[FORK] Listening on %s\n", args->fork_socket);
+
+    /* The children copy the images from the files, nothing may be left in the buffers */
+    fflush(NULL);
+    /* The children report through the socket, no need to wait for them */
+    signal(SIGCHLD, SIG_IGN);
+    /* A client leaving early must not kill the child writing the reply */
+    signal(SIGPIPE, SIG_IGN);
+
+    for (;;) {
+        const int conn = accept(server, NULL, NULL);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            log_perror("[FORK] Could not accept a connection");
+            err = 1;
+            break;
+        }
+
+        const pid_t pid = fork();
+        if (pid == 0) {
+            close(server);
+            fork_serve(machine, conn);
+            _exit(0);
+        }
+        if (pid < 0) {
+            log_perror("[FORK] Could not fork");
+        }
+        close(conn);
+    }
+
+    close(server);
+    unlink(args->fork_socket);
+deinit:
+    zeal_deinit(machine);
+    free(machine);
+    return err;
+}
+
+#else
+
+int fork_server_run(const config_arguments_t *args) {
+    (void)args;
+    log_err_printf("[FORK] The fork server is not supported on this platform\n");
+    return 1;
+}
+
+#endif
@@ -107,3 +107,13 @@ void at24c512_deinit(at24c512_t* eeprom)
     fflush(eeprom->file);
     fclose(eeprom->file);
 }
+
+
+void at24c512_detach(at24c512_t* eeprom)
+{
+    if (eeprom->file == NULL) {
+        return;
+    }
+    fclose(eeprom->file);
+    eeprom->file = NULL;
+}
@@ -12,119 +12,10 @@
 #include <assert.h>
 #include <string.h>
 
-#include "raylib.h"
 #include "utils/helpers.h"
 #include "hw/keyboard.h"
 #include "hw/pio.h"
 
-static unsigned long PS2_SCANCODE_DURATION = 0;
-static unsigned long PS2_KEY_TIMING = 0;
-static unsigned long PS2_RELEASE_DELAY = 0;
-
-
-static const uint16_t TABLE[384] = {
-    [KEY_BACKSPACE]    = 0x66,
-    [KEY_TAB]          = 0x0D,
-    [KEY_ENTER]        = 0x5A,
-    [KEY_LEFT_SHIFT]   = 0x12,
-    [KEY_RIGHT_SHIFT]  = 0x59,
-    [KEY_LEFT_CONTROL] = 0xE014,
-    [KEY_LEFT_ALT]     = 0x11,
-    [KEY_RIGHT_ALT]    = 0xE011,
-    // [KEY_PAUSE] = 0xE1, 0x14, 0x77, 0xE1, 0xF0, 0x14, 0xE0, 0x77,
-    [KEY_CAPS_LOCK] = 0x58,
-    [KEY_ESCAPE]    = 0x76,
-    [KEY_PAGE_UP]   = 0xE07D,
-    [KEY_SPACE]     = 0x29,
-    [KEY_PAGE_DOWN] = 0xE07A,
-    [KEY_END]       = 0xE069,
-    [KEY_HOME]      = 0xE06C,
-    [KEY_LEFT]      = 0xE06B,
-    [KEY_UP]        = 0xE075,
-    [KEY_RIGHT]     = 0xE074,
-    [KEY_DOWN]      = 0xE072,
-    // [KEY_PRINTSCREEN] = 0xE0, 0x12, 0xE0, 0x7C,
-    [KEY_INSERT]        = 0xE070,
-    [KEY_DELETE]        = 0xE071,
-    [KEY_ZERO]          = 0x45,
-    [KEY_ONE]           = 0x16,
-    [KEY_TWO]           = 0x1E,
-    [KEY_THREE]         = 0x26,
-    [KEY_FOUR]          = 0x25,
-    [KEY_FIVE]          = 0x2E,
-    [KEY_SIX]           = 0x36,
-    [KEY_SEVEN]         = 0x3D,
-    [KEY_EIGHT]         = 0x3E,
-    [KEY_NINE]          = 0x46,
-    [KEY_A]             = 0x1C,
-    [KEY_B]             = 0x32,
-    [KEY_C]             = 0x21,
-    [KEY_D]             = 0x23,
-    [KEY_E]             = 0x24,
-    [KEY_F]             = 0x2B,
-    [KEY_G]             = 0x34,
-    [KEY_H]             = 0x33,
-    [KEY_I]             = 0x43,
-    [KEY_J]             = 0x3B,
-    [KEY_K]             = 0x42,
-    [KEY_L]             = 0x4B,
-    [KEY_M]             = 0x3A,
-    [KEY_N]             = 0x31,
-    [KEY_O]             = 0x44,
-    [KEY_P]             = 0x4D,
-    [KEY_Q]             = 0x15,
-    [KEY_R]             = 0x2D,
-    [KEY_S]             = 0x1B,
-    [KEY_T]             = 0x2C,
-    [KEY_U]             = 0x3C,
-    [KEY_V]             = 0x2A,
-    [KEY_W]             = 0x1D,
-    [KEY_X]             = 0x22,
-    [KEY_Y]             = 0x35,
-    [KEY_Z]             = 0x1A,
-    [KEY_LEFT_SUPER]    = 0xE01F,
-    [KEY_RIGHT_SUPER]   = 0xE027,
-    [KEY_KP_0]          = 0x70,
-    [KEY_KP_1]          = 0x69,
-    [KEY_KP_2]          = 0x72,
-    [KEY_KP_3]          = 0x7A,
-    [KEY_KP_4]          = 0x6B,
-    [KEY_KP_5]          = 0x73,
-    [KEY_KP_6]          = 0x74,
-    [KEY_KP_7]          = 0x6C,
-    [KEY_KP_8]          = 0x75,
-    [KEY_KP_9]          = 0x7D,
-    [KEY_KP_MULTIPLY]   = 0x7C,
-    [KEY_KP_ADD]        = 0x79,
-    [KEY_KP_SUBTRACT]   = 0x7B,
-    [KEY_KP_DECIMAL]    = 0x71,
-    [KEY_KP_DIVIDE]     = 0xE04A,
-    [KEY_F1]            = 0x05,
-    [KEY_F2]            = 0x06,
-    [KEY_F3]            = 0x04,
-    [KEY_F4]            = 0x0C,
-    [KEY_F5]            = 0x03,
-    [KEY_F6]            = 0x0B,
-    [KEY_F7]            = 0x83,
-    [KEY_F8]            = 0x0A,
-    [KEY_F9]            = 0x01,
-    [KEY_F10]           = 0x09,
-    [KEY_F11]           = 0x78,
-    [KEY_F12]           = 0x07,
-    [KEY_NUM_LOCK]      = 0x77,
-    [KEY_SCROLL_LOCK]   = 0x7E,
-    [KEY_SEMICOLON]     = 0x4C,
-    [KEY_EQUAL]         = 0x55,
-    [KEY_COMMA]         = 0x41,
-    [KEY_MINUS]         = 0x4E,
-    [KEY_PERIOD]        = 0x49,
-    [KEY_SLASH]         = 0x4A,
-    [KEY_LEFT_BRACKET]  = 0x54,
-    [KEY_BACKSLASH]     = 0x5D,
-    [KEY_RIGHT_BRACKET] = 0x5B,
-    [KEY_APOSTROPHE]    = 0x52,
-    [KEY_GRAVE]         = 0x0E,
-};
 
 static uint8_t io_read(device_t* dev, uint32_t addr)
 {
@@ -140,48 +31,25 @@ static void keyboard_reset(device_t* dev)
     keyboard_t* keyboard = (keyboard_t*) dev;
     keyboard->pin_state = 1;
     keyboard->state = PS2_IDLE;
-    keyboard->elapsed_tstates = 0;
     keyboard->shift_register = 0;
     pio_set_b_pin(keyboard->pio, IO_KEYBOARD_PIN, keyboard->pin_state);
     fifo_reset(&keyboard->queue);
+    sched_cancel(keyboard->sched, &keyboard->ps2_event);
 }
 
 
-int keyboard_init(keyboard_t* keyboard, pio_t* pio)
-{
-    /* On the real hardware, the active signal stays on for ~19.7 microseconds */
-    PS2_SCANCODE_DURATION = us_to_tstates(19.7);
-    /* We have a delay of 3.9ms between each scancode */
-    PS2_KEY_TIMING = us_to_tstates(3900); // 39000
-    /* The release code happens 30ms after the first code is issued */
-    PS2_RELEASE_DELAY = us_to_tstates(30000);
-
-    keyboard->pio = pio;
-    keyboard->size = 0x10;
-    device_init_io(DEVICE(keyboard), "keyboard_dev", io_read, NULL, keyboard->size);
-    device_register_reset(DEVICE(keyboard), keyboard_reset);
-
-    assert(fifo_init(&keyboard->queue, FIFO_SIZE));
-    keyboard_reset(DEVICE(keyboard));
-
-    return 0;
-}
-
-
-bool keyboard_check(keyboard_t* keyboard, int elapsed)
+static void keyboard_check_event(scheduler_t* sched, sched_event_t* ev, void* arg)
 {
-    keyboard->check_timer += elapsed;
-    if (keyboard->check_timer >= KEYBOARD_CHECK_PERIOD) {
-        keyboard->check_timer = 0;
-        return true;
-    }
-    return false;
+    keyboard_t* keyboard = (keyboard_t*) arg;
+    keyboard->check_pending = true;
+    sched_at(sched, ev, ev->deadline + KEYBOARD_CHECK_PERIOD);
 }
 
 
-void keyboard_tick(keyboard_t* keyboard, pio_t* pio, int elapsed)
+static void keyboard_ps2_event(scheduler_t* sched, sched_event_t* ev, void* arg)
 {
-    keyboard->elapsed_tstates += elapsed;
+    keyboard_t* keyboard = (keyboard_t*) arg;
+    pio_t* pio = keyboard->pio;
 
     switch (keyboard->state) {
         case PS2_IDLE:
@@ -190,38 +58,81 @@ void keyboard_tick(keyboard_t* keyboard, pio_t* pio, int elapsed)
             if (fifo_pop(&keyboard->queue, &keyboard->shift_register)) {
                 keyboard->pin_state = 0;
                 pio_set_b_pin(pio, IO_KEYBOARD_PIN, keyboard->pin_state);
-                keyboard->elapsed_tstates = 0;
                 keyboard->state = PS2_ACTIVE;
+                /* Keyboard signal is asserted, this signal lasts `scancode_duration` t-states */
+                sched_in(sched, ev, keyboard->scancode_duration);
             }
             break;
 
         case PS2_ACTIVE:
-            /* Keyboard signal is asserted, this signal lasts PS2_SCANCODE_DURATION t-states */
-            if(keyboard->elapsed_tstates >= PS2_SCANCODE_DURATION) {
-                keyboard->pin_state = 1;
-                pio_set_b_pin(pio, IO_KEYBOARD_PIN, keyboard->pin_state);
-                keyboard->elapsed_tstates = 0;
-                keyboard->state = PS2_INACTIVE;
-            }
+            keyboard->pin_state = 1;
+            pio_set_b_pin(pio, IO_KEYBOARD_PIN, keyboard->pin_state);
+            keyboard->state = PS2_INACTIVE;
+            /* Keyboard signal is deasserted, it needs some time before accepting new keys again */
+            sched_in(sched, ev, keyboard->key_timing);
             break;
 
         case PS2_INACTIVE:
-            /* Keyboard signal is deasserted, it needs some time before accepting new keys again */
-            if(keyboard->elapsed_tstates >= PS2_KEY_TIMING) {
-                keyboard->pin_state = 1;
-                pio_set_b_pin(pio, IO_KEYBOARD_PIN, keyboard->pin_state);
-                keyboard->elapsed_tstates = 0;
-                keyboard->state = PS2_IDLE;
+            keyboard->pin_state = 1;
+            pio_set_b_pin(pio, IO_KEYBOARD_PIN, keyboard->pin_state);
+            keyboard->state = PS2_IDLE;
+            /* Shift in the next code right away if there is any */
+            if (fifo_size(&keyboard->queue) != 0) {
+                sched_in(sched, ev, 0);
             }
             break;
     }
 }
 
 
-static uint8_t get_ps2_code(uint16_t keycode, uint8_t* codes)
+/**
+ * @brief Make sure the PS/2 state machine processes the queue when it is idle
+ */
+static void keyboard_kick(keyboard_t* keyboard)
+{
+    if (keyboard->state == PS2_IDLE && !sched_is_pending(&keyboard->ps2_event)) {
+        sched_in(keyboard->sched, &keyboard->ps2_event, 0);
+    }
+}
+
+
+int keyboard_init(keyboard_t* keyboard, pio_t* pio, scheduler_t* sched)
+{
+    /* On the real hardware, the active signal stays on for ~19.7 microseconds */
+    keyboard->scancode_duration = us_to_tstates(19.7);
+    /* We have a delay of 3.9ms between each scancode */
+    keyboard->key_timing = us_to_tstates(3900); // 39000
+    /* The release code happens 30ms after the first code is issued */
+    keyboard->release_delay = us_to_tstates(30000);
+
+    keyboard->pio = pio;
+    keyboard->sched = sched;
+    keyboard->size = 0x10;
+    sched_event_init(&keyboard->ps2_event, "ps2", keyboard_ps2_event, keyboard);
+    sched_event_init(&keyboard->check_event, "keyboard_check", keyboard_check_event, keyboard);
+    device_init_io(DEVICE(keyboard), "keyboard_dev", io_read, NULL, keyboard->size);
+    device_register_reset(DEVICE(keyboard), keyboard_reset);
+
+    assert(fifo_init(&keyboard->queue, FIFO_SIZE));
+    keyboard_reset(DEVICE(keyboard));
+    sched_in(sched, &keyboard->check_event, KEYBOARD_CHECK_PERIOD);
+
+    return 0;
+}
+
+
+bool keyboard_check(keyboard_t* keyboard)
+{
+    const bool pending = keyboard->check_pending;
+    keyboard->check_pending = false;
+    return pending;
+}
+
+
+static uint8_t get_ps2_code(uint16_t scancode, uint8_t* codes)
 {
-    switch (keycode) {
-        case KEY_PAUSE: {
+    switch (scancode) {
+        case PS2_SCANCODE_PAUSE: {
             codes[0] = 0xE1;
             codes[1] = 0x14;
             codes[2] = 0x77;
@@ -232,7 +143,7 @@ static uint8_t get_ps2_code(uint16_t keycode, uint8_t* codes)
             codes[7] = 0x77;
             return 8;
         } break;
-        case KEY_PRINT_SCREEN: {
+        case PS2_SCANCODE_PRINT_SCREEN: {
             codes[0] = 0xE0;
             codes[0] = 0x12;
             codes[0] = 0xE0;
@@ -240,39 +151,39 @@ static uint8_t get_ps2_code(uint16_t keycode, uint8_t* codes)
             return 4;
         } break;
         default: {
-            uint16_t code = TABLE[keycode];
-            if (code > 256) {
-                codes[0] = code >> 8;
-                codes[1] = code & 0xFF;
+            if (scancode > 256) {
+                codes[0] = scancode >> 8;
+                codes[1] = scancode & 0xFF;
                 return 2;
             }
-            codes[0] = code;
+            codes[0] = scancode;
             return 1;
         }
     }
     return 0;
 }
 
-uint8_t key_pressed(keyboard_t* keyboard, uint16_t keycode)
+uint8_t key_pressed(keyboard_t* keyboard, uint16_t scancode)
 {
     uint8_t codes[MAX_KEYCODES];
-    int n_codes = get_ps2_code(keycode, codes);
+    int n_codes = get_ps2_code(scancode, codes);
     for (int i = 0; i < n_codes; i++) {
         fifo_push(&keyboard->queue, codes[i]);
     }
+    keyboard_kick(keyboard);
 
     return 0;
 }
 
-uint8_t key_released(keyboard_t* keyboard, uint16_t keycode)
+uint8_t key_released(keyboard_t* keyboard, uint16_t scancode)
 {
     /* PAUSE has no break code */
-    if (keycode == KEY_PAUSE) {
+    if (scancode == PS2_SCANCODE_PAUSE) {
         return 0;
     }
 
     uint8_t codes[MAX_KEYCODES];
-    int n_codes = get_ps2_code(keycode, codes);
+    int n_codes = get_ps2_code(scancode, codes);
     if (n_codes < 1) {
         return 1;
     }
@@ -288,6 +199,54 @@ uint8_t key_released(keyboard_t* keyboard, uint16_t keycode)
     for (int i = 0; i < n_codes; i++) {
         fifo_push(&keyboard->queue, from[i]);
     }
+    keyboard_kick(keyboard);
 
     return 0;
 }
+
+
+bool keyboard_idle(keyboard_t* keyboard)
+{
+    return keyboard->state == PS2_IDLE && fifo_size(&keyboard->queue) == 0;
+}
+
+
+/* Characters typed without Shift on a US layout, and their shifted counterpart on the same key */
+static const char ASCII_KEYS[]         = "`1234567890-=qwertyuiop[]\\asdfghjkl;'zxcvbnm,./ ";
+static const char ASCII_SHIFTED_KEYS[] = "~!@#$%^&*()_+QWERTYUIOP{}|ASDFGHJKL:\"ZXCVBNM<>? ";
+static const uint16_t ASCII_SCANCODES[] = {
+    0x0E, 0x16, 0x1E, 0x26, 0x25, 0x2E, 0x36, 0x3D, 0x3E, 0x46, 0x45, 0x4E, 0x55,
+    0x15, 0x1D, 0x24, 0x2D, 0x2C, 0x35, 0x3C, 0x43, 0x44, 0x4D, 0x54, 0x5B, 0x5D,
+    0x1C, 0x1B, 0x23, 0x2B, 0x34, 0x33, 0x3B, 0x42, 0x4B, 0x4C, 0x52,
+    0x1A, 0x22, 0x21, 0x2A, 0x32, 0x31, 0x3A, 0x41, 0x49, 0x4A,
+    0x29,
+};
+
+_Static_assert(sizeof(ASCII_KEYS) == sizeof(ASCII_SHIFTED_KEYS), "Both layers of the layout must have the same keys");
+_Static_assert(sizeof(ASCII_KEYS) - 1 == sizeof(ASCII_SCANCODES) / sizeof(ASCII_SCANCODES[0]),
+               "Each key of the layout needs a scancode");
+
+
+uint16_t keyboard_ascii_scancode(char c, bool* shift)
+{
+    *shift = false;
+    switch (c) {
+        case '\n': return 0x5A;
+        case '\t': return 0x0D;
+        case '\b': return 0x66;
+        case 0x1B: return 0x76;
+        case '\0': return 0;
+        default: break;
+    }
+
+    const char* found = strchr(ASCII_KEYS, c);
+    if (found != NULL) {
+        return ASCII_SCANCODES[found - ASCII_KEYS];
+    }
+    found = strchr(ASCII_SHIFTED_KEYS, c);
+    if (found != NULL) {
+        *shift = true;
+        return ASCII_SCANCODES[found - ASCII_SHIFTED_KEYS];
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Zeal 8-bit Computer <contact@zeal8bit.com>; David Higgins <zoul0813@me.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include <stdint.h>
+
+#include "raylib.h"
+#include "hw/keyboard.h"
+#include "hw/keymap.h"
+
+
+static const uint16_t TABLE[RAYLIB_KEY_COUNT] = {
+    [KEY_BACKSPACE]    = 0x66,
+    [KEY_TAB]          = 0x0D,
+    [KEY_ENTER]        = 0x5A,
+    [KEY_LEFT_SHIFT]   = 0x12,
+    [KEY_RIGHT_SHIFT]  = 0x59,
+    [KEY_LEFT_CONTROL] = 0xE014,
+    [KEY_LEFT_ALT]     = 0x11,
+    [KEY_RIGHT_ALT]    = 0xE011,
+    [KEY_PAUSE]     = PS2_SCANCODE_PAUSE,
+    [KEY_CAPS_LOCK] = 0x58,
+    [KEY_ESCAPE]    = 0x76,
+    [KEY_PAGE_UP]   = 0xE07D,
+    [KEY_SPACE]     = 0x29,
+    [KEY_PAGE_DOWN] = 0xE07A,
+    [KEY_END]       = 0xE069,
+    [KEY_HOME]      = 0xE06C,
+    [KEY_LEFT]      = 0xE06B,
+    [KEY_UP]        = 0xE075,
+    [KEY_RIGHT]     = 0xE074,
+    [KEY_DOWN]      = 0xE072,
+    [KEY_PRINT_SCREEN] = PS2_SCANCODE_PRINT_SCREEN,
+    [KEY_INSERT]        = 0xE070,
+    [KEY_DELETE]        = 0xE071,
+    [KEY_ZERO]          = 0x45,
+    [KEY_ONE]           = 0x16,
+    [KEY_TWO]           = 0x1E,
+    [KEY_THREE]         = 0x26,
+    [KEY_FOUR]          = 0x25,
+    [KEY_FIVE]          = 0x2E,
+    [KEY_SIX]           = 0x36,
+    [KEY_SEVEN]         = 0x3D,
+    [KEY_EIGHT]         = 0x3E,
+    [KEY_NINE]          = 0x46,
+    [KEY_A]             = 0x1C,
+    [KEY_B]             = 0x32,
+    [KEY_C]             = 0x21,
+    [KEY_D]             = 0x23,
+    [KEY_E]             = 0x24,
+    [KEY_F]             = 0x2B,
+    [KEY_G]             = 0x34,
+    [KEY_H]             = 0x33,
+    [KEY_I]             = 0x43,
+    [KEY_J]             = 0x3B,
+    [KEY_K]             = 0x42,
+    [KEY_L]             = 0x4B,
+    [KEY_M]             = 0x3A,
+    [KEY_N]             = 0x31,
+    [KEY_O]             = 0x44,
+    [KEY_P]             = 0x4D,
+    [KEY_Q]             = 0x15,
+    [KEY_R]             = 0x2D,
+    [KEY_S]             = 0x1B,
+    [KEY_T]             = 0x2C,
+    [KEY_U]             = 0x3C,
+    [KEY_V]             = 0x2A,
+    [KEY_W]             = 0x1D,
+    [KEY_X]             = 0x22,
+    [KEY_Y]             = 0x35,
+    [KEY_Z]             = 0x1A,
+    [KEY_LEFT_SUPER]    = 0xE01F,
+    [KEY_RIGHT_SUPER]   = 0xE027,
+    [KEY_KP_0]          = 0x70,
+    [KEY_KP_1]          = 0x69,
+    [KEY_KP_2]          = 0x72,
+    [KEY_KP_3]          = 0x7A,
+    [KEY_KP_4]          = 0x6B,
+    [KEY_KP_5]          = 0x73,
+    [KEY_KP_6]          = 0x74,
+    [KEY_KP_7]          = 0x6C,
+    [KEY_KP_8]          = 0x75,
+    [KEY_KP_9]          = 0x7D,
+    [KEY_KP_MULTIPLY]   = 0x7C,
+    [KEY_KP_ADD]        = 0x79,
+    [KEY_KP_SUBTRACT]   = 0x7B,
+    [KEY_KP_DECIMAL]    = 0x71,
+    [KEY_KP_DIVIDE]     = 0xE04A,
+    [KEY_F1]            = 0x05,
+    [KEY_F2]            = 0x06,
+    [KEY_F3]            = 0x04,
+    [KEY_F4]            = 0x0C,
+    [KEY_F5]            = 0x03,
+    [KEY_F6]            = 0x0B,
+    [KEY_F7]            = 0x83,
+    [KEY_F8]            = 0x0A,
+    [KEY_F9]            = 0x01,
+    [KEY_F10]           = 0x09,
+    [KEY_F11]           = 0x78,
+    [KEY_F12]           = 0x07,
+    [KEY_NUM_LOCK]      = 0x77,
+    [KEY_SCROLL_LOCK]   = 0x7E,
+    [KEY_SEMICOLON]     = 0x4C,
+    [KEY_EQUAL]         = 0x55,
+    [KEY_COMMA]         = 0x41,
+    [KEY_MINUS]         = 0x4E,
+    [KEY_PERIOD]        = 0x49,
+    [KEY_SLASH]         = 0x4A,
+    [KEY_LEFT_BRACKET]  = 0x54,
+    [KEY_BACKSLASH]     = 0x5D,
+    [KEY_RIGHT_BRACKET] = 0x5B,
+    [KEY_APOSTROPHE]    = 0x52,
+    [KEY_GRAVE]         = 0x0E,
+};
+
+
+uint16_t keymap_to_scancode(int key)
+{
+    if (key < 0 || key >= RAYLIB_KEY_COUNT) {
+        return 0;
+    }
+    return TABLE[key];
+}
@@ -8,12 +8,16 @@
  * SPDX-FileContributor: Modified by Robert Maupin 2026
  */
 
+#include <stdlib.h>
+
+#include "hw/batch.h"
+#include "hw/fork_server.h"
 #include "hw/zeal.h"
+#include "hw/zeal_state.h"
+#include "hw/zeal_window.h"
 #include "utils/config.h"
 #include "utils/log.h"
 
-static zeal_t machine;
-
 int main(int argc, char *argv[]) {
     int code = 0;
     code = parse_command_args(argc, argv);
@@ -21,27 +25,60 @@ int main(int argc, char *argv[]) {
         return code;
     }
 
+    if (config.arguments.batch_manifest != NULL) {
+        return batch_run(config.arguments.batch_manifest, config.arguments.batch_threads);
+    }
+    if (config.arguments.fork_socket != NULL) {
+        return fork_server_run(&config.arguments);
+    }
+
+    /* The machine state is too big for the stack */
+    zeal_t *machine = malloc(sizeof(zeal_t));
+    if (machine == NULL) {
+        log_err_printf("Error allocating the machine\n");
+        return 1;
+    }
+    /* The window is only allocated when there is one to show */
+    zeal_window_t *window = NULL;
+
     config_parse_file(config.arguments.config_path);
     if (config.arguments.verbose) {
         config_debug();
     }
 
-    if (zeal_init(&machine)) {
+    if (zeal_init_args(machine, &config.arguments)) {
         log_err_printf("Error initializing the machine\n");
         goto deinit;
     }
 
-    if (flash_load_from_file(&machine.rom, config.arguments.rom_filename, config.arguments.uprog_filename) != FLASH_ERR_OK) {
+    if (!machine->headless) {
+        window = malloc(sizeof(zeal_window_t));
+        if (window == NULL || zeal_window_init(window, machine)) {
+            log_err_printf("Error opening the window\n");
+            goto deinit;
+        }
+    }
+
+    if (flash_load_from_file(&machine->rom, config.arguments.rom_filename, config.arguments.uprog_filename) != FLASH_ERR_OK) {
+        goto deinit;
+    }
+
+    if (config.arguments.tf_filename != NULL && zvb_spi_load_tf_image(&machine->zvb.spi, config.arguments.tf_filename)) {
         goto deinit;
     }
 
-    if (config.arguments.tf_filename != NULL && zvb_spi_load_tf_image(&machine.zvb.spi, config.arguments.tf_filename)) {
+    if (config.arguments.load_state != NULL && zeal_state_load_file(machine, config.arguments.load_state)) {
+        code = 1;
         goto deinit;
     }
 
-    code = zeal_run(&machine);
-    
-    (void)flash_save_to_file(&machine.rom, config.arguments.rom_filename);
+    code = window ? zeal_window_run(window) : zeal_run(machine);
+
+    if (config.arguments.save_state != NULL && zeal_state_save_file(machine, config.arguments.save_state)) {
+        code = 1;
+    }
+
+    (void)flash_save_to_file(&machine->rom, config.arguments.rom_filename);
 
     int saved = config_save();
     config_unload();
@@ -50,6 +87,8 @@ int main(int argc, char *argv[]) {
     }
 
 deinit:
-    zvb_sound_deinit(&machine.zvb.sound);
+    free(window);
+    zeal_deinit(machine);
+    free(machine);
     return code;
 }
@@ -13,6 +13,30 @@
 #include "utils/log.h"
 
 
+static void mmu_refresh_page(mmu_t* mmu, int idx)
+{
+    if (mmu->resolve == NULL) {
+        mmu->fast_read[idx]  = NULL;
+        mmu->fast_write[idx] = NULL;
+        return;
+    }
+    const uint32_t phys_addr = mmu->pages[idx] * MMU_PAGE_SIZE;
+    mmu->fast_read[idx]  = mmu->resolve(mmu->resolve_arg, phys_addr, false);
+    mmu->fast_write[idx] = mmu->resolve(mmu->resolve_arg, phys_addr, true);
+}
+
+
+static void mmu_set_page(mmu_t* mmu, int idx, uint8_t page)
+{
+    const uint8_t previous = mmu->pages[idx];
+    mmu->pages[idx]        = page;
+    mmu_refresh_page(mmu, idx);
+    if (previous != page && mmu->unmap != NULL) {
+        mmu->unmap(mmu->unmap_arg, previous * MMU_PAGE_SIZE);
+    }
+}
+
+
 static uint8_t mmu_read(device_t* dev, uint32_t addr)
 {
     (void)addr; // unused
@@ -26,9 +50,9 @@ static uint8_t mmu_read(device_t* dev, uint32_t addr)
 
 static void mmu_write(device_t* dev, uint32_t addr, uint8_t data)
 {
-    mmu_t* mmu      = (mmu_t*) dev;
-    const int idx   = addr & 0x3;
-    mmu->pages[idx] = data;
+    mmu_t* mmu    = (mmu_t*) dev;
+    const int idx = addr & 0x3;
+    mmu_set_page(mmu, idx, data);
 }
 
 
@@ -36,7 +60,7 @@ static void mmu_reset(device_t* dev)
 {
     mmu_t* mmu = (mmu_t*) dev;
     /* On the real hardware, MMU reset only sets page 0 */
-    mmu->pages[0] = 0;
+    mmu_set_page(mmu, 0, 0);
 }
 
 
@@ -53,6 +77,29 @@ int mmu_init(mmu_t* mmu)
 }
 
 
+void mmu_set_resolver(mmu_t* mmu, mmu_resolve_t resolve, void* arg)
+{
+    mmu->resolve     = resolve;
+    mmu->resolve_arg = arg;
+    mmu_refresh(mmu);
+}
+
+
+void mmu_set_unmap_listener(mmu_t* mmu, mmu_unmap_t unmap, void* arg)
+{
+    mmu->unmap     = unmap;
+    mmu->unmap_arg = arg;
+}
+
+
+void mmu_refresh(mmu_t* mmu)
+{
+    for (int i = 0; i < MMU_PAGES_COUNT; i++) {
+        mmu_refresh_page(mmu, i);
+    }
+}
+
+
 int mmu_get_phys_addr(const mmu_t* mmu, uint16_t virt_addr)
 {
     if (mmu == NULL) {
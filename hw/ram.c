@@ -10,6 +10,7 @@
 #include <string.h>
 #include <stdint.h>
 #include "hw/ram.h"
+#include "hw/mmu.h"
 #include "utils/log.h"
 
 
@@ -33,6 +34,36 @@ static void ram_write(device_t* dev, uint32_t addr, uint8_t data) {
 }
 
 
+static void ram_read_block(device_t* dev, uint32_t addr, uint8_t* dst, uint32_t len) {
+    ram_t* r = (ram_t*)dev;
+    if(addr >= r->size || len > r->size - addr) {
+        log_err_printf("[RAM] Invalid block read: %08x (%u bytes)\n", addr, len);
+        return;
+    }
+    memcpy(dst, &r->data[addr], len);
+}
+
+
+static void ram_write_block(device_t* dev, uint32_t addr, const uint8_t* src, uint32_t len) {
+    ram_t* r = (ram_t*)dev;
+    if(addr >= r->size || len > r->size - addr) {
+        log_err_printf("[RAM] Invalid block write: %08x (%u bytes)\n", addr, len);
+        return;
+    }
+    memcpy(&r->data[addr], src, len);
+}
+
+
+static uint8_t* ram_direct(device_t* dev, uint32_t addr, bool write) {
+    (void) write;
+    ram_t* r = (ram_t*)dev;
+    if(addr + MMU_PAGE_SIZE > r->size) {
+        return NULL;
+    }
+    return &r->data[addr];
+}
+
+
 int ram_init(ram_t *r) {
     if(r == NULL) {
         return 1;
@@ -50,5 +81,7 @@ int ram_init(ram_t *r) {
 #endif
 
     device_init_mem(DEVICE(r), "ram_dev", ram_read, ram_write, r->size);
+    device_register_direct(DEVICE(r), ram_direct);
+    device_register_mem_block(DEVICE(r), ram_read_block, ram_write_block);
     return 0;
 }
@@ -0,0 +1,128 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "hw/scheduler.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "utils/log.h"
+
+static void sched_update_next(scheduler_t *sched) {
+    if (sched->count > 0) {
+        sched->next = sched->heap[0]->deadline;
+    } else {
+        sched->next = *sched->clock + SCHED_IDLE_PERIOD;
+    }
+    if (sched->listener) {
+        sched->listener(sched->listener_arg, sched->next);
+    }
+}
+
+static inline void sched_place(scheduler_t *sched, sched_event_t *ev, int index) {
+    sched->heap[index] = ev;
+    ev->index = index;
+}
+
+static void sched_sift_up(scheduler_t *sched, int index) {
+    sched_event_t *ev = sched->heap[index];
+    while (index > 0) {
+        const int parent = (index - 1) / 2;
+        if (!sched_before(ev->deadline, sched->heap[parent]->deadline)) {
+            break;
+        }
+        sched_place(sched, sched->heap[parent], index);
+        index = parent;
+    }
+    sched_place(sched, ev, index);
+}
+
+static void sched_sift_down(scheduler_t *sched, int index) {
+    sched_event_t *ev = sched->heap[index];
+    for (;;) {
+        const int left = index * 2 + 1;
+        const int right = left + 1;
+        int smallest = index;
+        unsigned long smallest_deadline = ev->deadline;
+
+        if (left < sched->count && sched_before(sched->heap[left]->deadline, smallest_deadline)) {
+            smallest = left;
+            smallest_deadline = sched->heap[left]->deadline;
+        }
+        if (right < sched->count && sched_before(sched->heap[right]->deadline, smallest_deadline)) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        sched_place(sched, sched->heap[smallest], index);
+        index = smallest;
+    }
+    sched_place(sched, ev, index);
+}
+
+static void sched_remove(scheduler_t *sched, sched_event_t *ev) {
+    const int index = ev->index;
+    sched_event_t *last = sched->heap[--sched->count];
+    ev->index = -1;
+
+    if (last != ev) {
+        sched_place(sched, last, index);
+        sched_sift_up(sched, index);
+        sched_sift_down(sched, last->index);
+    }
+}
+
+void sched_init(scheduler_t *sched, const unsigned long *clock) {
+    memset(sched, 0, sizeof(*sched));
+    sched->clock = clock;
+    sched_update_next(sched);
+}
+
+void sched_set_listener(scheduler_t *sched, sched_listener_t listener, void *arg) {
+    sched->listener = listener;
+    sched->listener_arg = arg;
+}
+
+void sched_event_init(sched_event_t *ev, const char *name, sched_callback_t callback, void *arg) {
+    ev->name = name;
+    ev->callback = callback;
+    ev->arg = arg;
+    ev->deadline = 0;
+    ev->index = -1;
+}
+
+void sched_at(scheduler_t *sched, sched_event_t *ev, unsigned long deadline) {
+    if (sched_is_pending(ev)) {
+        sched_remove(sched, ev);
+    } else if (sched->count == SCHED_MAX_EVENTS) {
+        log_err_printf("[SCHED] ERROR: cannot schedule %s, too many events\n", ev->name);
+        return;
+    }
+
+    ev->deadline = deadline;
+    sched_place(sched, ev, sched->count++);
+    sched_sift_up(sched, ev->index);
+    sched_update_next(sched);
+}
+
+void sched_cancel(scheduler_t *sched, sched_event_t *ev) {
+    if (!sched_is_pending(ev)) {
+        return;
+    }
+    sched_remove(sched, ev);
+    sched_update_next(sched);
+}
+
+void sched_dispatch(scheduler_t *sched) {
+    while (sched->count > 0 && !sched_before(*sched->clock, sched->heap[0]->deadline)) {
+        sched_event_t *ev = sched->heap[0];
+        sched_remove(sched, ev);
+        /* The callback may reschedule the event or any other one */
+        ev->callback(sched, ev, ev->arg);
+    }
+    sched_update_next(sched);
+}
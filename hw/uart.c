@@ -12,38 +12,38 @@
 #include "hw/pio.h"
 #include "hw/uart.h"
 
-static unsigned long bit_tstates = 0;
-
-static uint8_t tx_fifo[10];
-static uint8_t tx_pos = 0;
-
-static void transfer_complete(void) {
+static void transfer_complete(uart_t* uart) {
     char c = 0;
-    for(uint8_t i = 1; i < 10; i++) {
-        c |= tx_fifo[i] << (i - 1);
+    for(uint8_t i = 1; i < UART_FRAME_BITS; i++) {
+        c |= uart->tx_fifo[i] << (i - 1);
     }
 
     if(c == 0) return; // can't print null, :shrug:
 
+    if(uart->output) {
+        uart->output(uart->output_arg, c);
+        return;
+    }
+
     log_printf("%c", c);
     fflush(stdout);
 }
 
 void write_tx(void* arg, pio_t* pio, bool read, int pin, int bit, bool transition)
 {
-    (void)arg;
+    uart_t* uart = (uart_t*) arg;
     (void)transition;
     (void)pio;
 
     if(read) return;
     if(pin != IO_UART_TX_PIN) return;
 
-    if(bit == 1 && tx_pos == 0) return;
+    if(bit == 1 && uart->tx_pos == 0) return;
 
-    tx_fifo[tx_pos++] = bit;
-    if(tx_pos == 10) {
-        transfer_complete();
-        tx_pos = 0;
+    uart->tx_fifo[uart->tx_pos++] = bit;
+    if(uart->tx_pos == UART_FRAME_BITS) {
+        transfer_complete(uart);
+        uart->tx_pos = 0;
     }
 }
 
@@ -57,12 +57,20 @@ void read_rx(void* arg, pio_t* pio, bool read, int pin, int bit, bool transition
 
 int uart_init(uart_t* uart, pio_t* pio)
 {
-    (void)uart;
+    uart->tx_pos = 0;
+    uart->output = NULL;
+    uart->output_arg = NULL;
     pio_set_b_pin(pio, IO_UART_RX_PIN, 1);
-    bit_tstates = us_to_tstates(BAUDRATE_US) + 1;
+    uart->bit_tstates = us_to_tstates(BAUDRATE_US) + 1;
 
     pio_listen_b_pin(pio, IO_UART_TX_PIN, write_tx, uart);
     pio_listen_b_pin(pio, IO_UART_RX_PIN, read_rx, uart);
 
     return 0;
 }
+
+void uart_set_output(uart_t* uart, uart_output_t output, void* arg)
+{
+    uart->output = output;
+    uart->output_arg = arg;
+}
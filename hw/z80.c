@@ -12,9 +12,16 @@
  *  - added opcodes size tables;
  */
 
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include "utils/log.h"
 #include "hw/z80.h"
 
+#if CONFIG_Z80_JIT && defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#endif
+
 // MARK: timings
 static const uint8_t op_size[256] = {
     1,  3,  1,  1,  1,  1,  2,  1,  1,  1,  1,  1,  1,  1,  2,  1,  2,  3,  1,  1,  1,  1,  2,  1,  2,  1,  1,  1,  1,
@@ -85,31 +92,79 @@ static const uint8_t cyc_ddfd[256] = {
     4, 4,  4,  4,  4, 4,  4,  4, 4, 4,  4,  0,  4, 4, 4,  4, 4,  4,  4,  4,  4,  4,  4,  4,  4, 4,  4, 4, 4, 4, 4,  4,
     4, 14, 4,  23, 4, 15, 4,  4, 4, 8,  4,  4,  4, 4, 4,  4, 4,  4,  4,  4,  4,  4,  4,  4,  4, 10, 4, 4, 4, 4, 4,  4};
 
+// sign, zero, yf, xf and parity flags of a byte value, as stored in the F register
+static const uint8_t szp_table[256] = {
+    0x44, 0x00, 0x00, 0x04, 0x00, 0x04, 0x04, 0x00, 0x08, 0x0C, 0x0C, 0x08, 0x0C, 0x08, 0x08, 0x0C,
+    0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x04, 0x0C, 0x08, 0x08, 0x0C, 0x08, 0x0C, 0x0C, 0x08,
+    0x20, 0x24, 0x24, 0x20, 0x24, 0x20, 0x20, 0x24, 0x2C, 0x28, 0x28, 0x2C, 0x28, 0x2C, 0x2C, 0x28,
+    0x24, 0x20, 0x20, 0x24, 0x20, 0x24, 0x24, 0x20, 0x28, 0x2C, 0x2C, 0x28, 0x2C, 0x28, 0x28, 0x2C,
+    0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x04, 0x0C, 0x08, 0x08, 0x0C, 0x08, 0x0C, 0x0C, 0x08,
+    0x04, 0x00, 0x00, 0x04, 0x00, 0x04, 0x04, 0x00, 0x08, 0x0C, 0x0C, 0x08, 0x0C, 0x08, 0x08, 0x0C,
+    0x24, 0x20, 0x20, 0x24, 0x20, 0x24, 0x24, 0x20, 0x28, 0x2C, 0x2C, 0x28, 0x2C, 0x28, 0x28, 0x2C,
+    0x20, 0x24, 0x24, 0x20, 0x24, 0x20, 0x20, 0x24, 0x2C, 0x28, 0x28, 0x2C, 0x28, 0x2C, 0x2C, 0x28,
+    0x80, 0x84, 0x84, 0x80, 0x84, 0x80, 0x80, 0x84, 0x8C, 0x88, 0x88, 0x8C, 0x88, 0x8C, 0x8C, 0x88,
+    0x84, 0x80, 0x80, 0x84, 0x80, 0x84, 0x84, 0x80, 0x88, 0x8C, 0x8C, 0x88, 0x8C, 0x88, 0x88, 0x8C,
+    0xA4, 0xA0, 0xA0, 0xA4, 0xA0, 0xA4, 0xA4, 0xA0, 0xA8, 0xAC, 0xAC, 0xA8, 0xAC, 0xA8, 0xA8, 0xAC,
+    0xA0, 0xA4, 0xA4, 0xA0, 0xA4, 0xA0, 0xA0, 0xA4, 0xAC, 0xA8, 0xA8, 0xAC, 0xA8, 0xAC, 0xAC, 0xA8,
+    0x84, 0x80, 0x80, 0x84, 0x80, 0x84, 0x84, 0x80, 0x88, 0x8C, 0x8C, 0x88, 0x8C, 0x88, 0x88, 0x8C,
+    0x80, 0x84, 0x84, 0x80, 0x84, 0x80, 0x80, 0x84, 0x8C, 0x88, 0x88, 0x8C, 0x88, 0x8C, 0x8C, 0x88,
+    0xA0, 0xA4, 0xA4, 0xA0, 0xA4, 0xA0, 0xA0, 0xA4, 0xAC, 0xA8, 0xA8, 0xAC, 0xA8, 0xAC, 0xAC, 0xA8,
+    0xA4, 0xA0, 0xA0, 0xA4, 0xA0, 0xA4, 0xA4, 0xA0, 0xA8, 0xAC, 0xAC, 0xA8, 0xAC, 0xA8, 0xA8, 0xAC,
+};
+
+// MARK: buses
+// The generic core reaches the buses through the function pointers of the
+// z80 structure. With CONFIG_Z80_STATIC_BUS, it is specialised for the Zeal
+// 8-bit Computer instead: the inline accessors of hw/zeal_bus.h are called
+// directly so that the RAM and flash accesses are inlined, and the function
+// pointers are ignored. The verification modes of the block cache run a
+// reference CPU on another bus, they need the generic core.
+#if CONFIG_Z80_STATIC_BUS && !CONFIG_Z80_BLOCK_CACHE_VERIFY && !CONFIG_Z80_JIT_VERIFY
+#include "hw/zeal_bus.h"
+#define bus_read(z, addr)       zeal_bus_mem_read((z)->userdata, addr)
+#define bus_write(z, addr, val) zeal_bus_mem_write((z)->userdata, addr, val)
+#define bus_in(z, port)         zeal_bus_io_read((z)->userdata, port)
+#define bus_out(z, port, val)   zeal_bus_io_write((z)->userdata, port, val)
+#else
+#define bus_read(z, addr)       (z)->read_byte((z)->userdata, addr)
+#define bus_write(z, addr, val) (z)->write_byte((z)->userdata, addr, val)
+#define bus_in(z, port)         (z)->port_in((z)->userdata, port)
+#define bus_out(z, port, val)   (z)->port_out((z)->userdata, port, val)
+#endif
+
 // MARK: helpers
 
+// the undefined opcodes run as NOPs and are reported. CONFIG_Z80_QUIET_UNDEFINED
+// drops the report, for the random programs of the differential test.
+#if CONFIG_Z80_QUIET_UNDEFINED
+#define log_undefined(...) ((void) 0)
+#else
+#define log_undefined(...) fprintf(stderr, __VA_ARGS__)
+#endif
+
 // get bit "n" of number "val"
 #define GET_BIT(n, val) (((val) >> (n)) & 1)
 
 static inline uint8_t rb(z80* const z, uint16_t addr)
 {
-    return z->read_byte(z->userdata, addr);
+    return bus_read(z, addr);
 }
 
 static inline void wb(z80* const z, uint16_t addr, uint8_t val)
 {
-    z->write_byte(z->userdata, addr, val);
+    bus_write(z, addr, val);
 }
 
 static inline uint16_t rw(z80* const z, uint16_t addr)
 {
-    uint8_t data = z->read_byte(z->userdata, addr);
-    return (z->read_byte(z->userdata, addr + 1) << 8) | data;
+    uint8_t data = bus_read(z, addr);
+    return (bus_read(z, addr + 1) << 8) | data;
 }
 
 static inline void ww(z80* const z, uint16_t addr, uint16_t val)
 {
-    z->write_byte(z->userdata, addr, val & 0xFF);
-    z->write_byte(z->userdata, addr + 1, val >> 8);
+    bus_write(z, addr, val & 0xFF);
+    bus_write(z, addr + 1, val >> 8);
 }
 
 static inline void pushw(z80* const z, uint16_t val)
@@ -137,39 +192,196 @@ static inline uint16_t nextw(z80* const z)
 
 static inline uint16_t get_bc(z80* const z)
 {
-    return (z->b << 8) | z->c;
+    return z->bc;
 }
 
 static inline uint16_t get_de(z80* const z)
 {
-    return (z->d << 8) | z->e;
+    return z->de;
 }
 
 static inline uint16_t get_hl(z80* const z)
 {
-    return (z->h << 8) | z->l;
+    return z->hl;
 }
 
 static inline void set_bc(z80* const z, uint16_t val)
 {
-    z->b = val >> 8;
-    z->c = val & 0xFF;
+    z->bc = val;
 }
 
 static inline void set_de(z80* const z, uint16_t val)
 {
-    z->d = val >> 8;
-    z->e = val & 0xFF;
+    z->de = val;
 }
 
 static inline void set_hl(z80* const z, uint16_t val)
 {
-    z->h = val >> 8;
-    z->l = val & 0xFF;
+    z->hl = val;
+}
+
+// MARK: flags
+// flag bits, as stored in the F register
+#define FLAG_C 0x01
+#define FLAG_N 0x02
+#define FLAG_P 0x04
+#define FLAG_X 0x08
+#define FLAG_H 0x10
+#define FLAG_Y 0x20
+#define FLAG_Z 0x40
+#define FLAG_S 0x80
+
+// In lazy flags mode, the ALU operations that set all the flags only record
+// their kind, operands and result. The flags are materialized from that
+// record when they are read (conditions, PUSH AF, z80_get_f, ...) or before
+// an instruction alters some of them.
+#if CONFIG_Z80_LAZY_FLAGS
+#define Z80_LAZY_FLAGS 1
+#else
+#define Z80_LAZY_FLAGS 0
+#endif
+
+enum {
+    LAZY_NONE = 0, // flags are up to date
+    LAZY_ADD,
+    LAZY_SUB,
+    LAZY_CP,
+    LAZY_INC,
+    LAZY_DEC,
+    LAZY_AND,
+    LAZY_OR, // also used for XOR
+};
+
+static inline void unpack_f(z80* const z, uint8_t val)
+{
+    z->cf = (val >> 0) & 1;
+    z->nf = (val >> 1) & 1;
+    z->pf = (val >> 2) & 1;
+    z->xf = (val >> 3) & 1;
+    z->hf = (val >> 4) & 1;
+    z->yf = (val >> 5) & 1;
+    z->zf = (val >> 6) & 1;
+    z->sf = (val >> 7) & 1;
+}
+
+// records the last flag-setting ALU operation, `cy` is the carry in for
+// ADD/SUB and the preserved carry flag for INC/DEC
+static inline void flags_record(z80* const z, uint8_t op, uint8_t a, uint8_t b, bool cy, uint8_t res)
+{
+    z->lazy_op  = op;
+    z->lazy_a   = a;
+    z->lazy_b   = b;
+    z->lazy_cy  = cy;
+    z->lazy_res = res;
+}
+
+// computes the flags out of the recorded ALU operation
+static void flags_materialize(z80* const z)
+{
+    const uint8_t a   = z->lazy_a;
+    const uint8_t b   = z->lazy_b;
+    const uint8_t res = z->lazy_res;
+    const bool cy     = z->lazy_cy;
+    uint8_t f         = szp_table[res] & ~FLAG_P;
+
+    switch (z->lazy_op) {
+        case LAZY_ADD:
+            f |= (a ^ b ^ res) & FLAG_H;
+            f |= ((~(a ^ b) & (a ^ res)) >> 5) & FLAG_P;
+            f |= ((a + b + cy) >> 8) & FLAG_C;
+            break;
+        case LAZY_CP:
+            // xf/yf are taken from the value to be substracted, not the result
+            f = (f & ~(FLAG_X | FLAG_Y)) | (b & (FLAG_X | FLAG_Y));
+            // fall-through
+        case LAZY_SUB:
+            f |= FLAG_N;
+            f |= (a ^ b ^ res) & FLAG_H;
+            f |= (((a ^ b) & (a ^ res)) >> 5) & FLAG_P;
+            f |= ((a - b - cy) >> 8) & FLAG_C;
+            break;
+        case LAZY_INC:
+            f |= (res & 0x0F) == 0 ? FLAG_H : 0;
+            f |= res == 0x80 ? FLAG_P : 0;
+            f |= cy;
+            break;
+        case LAZY_DEC:
+            f |= FLAG_N;
+            f |= (res & 0x0F) == 0x0F ? FLAG_H : 0;
+            f |= res == 0x7F ? FLAG_P : 0;
+            f |= cy;
+            break;
+        case LAZY_AND: f = szp_table[res] | FLAG_H; break;
+        case LAZY_OR: f = szp_table[res]; break;
+        default: return;
+    }
+
+    unpack_f(z, f);
+    z->lazy_op = LAZY_NONE;
+}
+
+// makes sure the flags bitfields are up to date, must be called before
+// reading them or modifying only some of them
+static inline void flags_sync(z80* const z)
+{
+#if Z80_LAZY_FLAGS
+    if (z->lazy_op != LAZY_NONE) {
+        flags_materialize(z);
+    }
+#else
+    (void) z;
+#endif
+}
+
+// carry flag, without materializing the other flags
+static inline bool get_cf(z80* const z)
+{
+#if Z80_LAZY_FLAGS
+    switch (z->lazy_op) {
+        case LAZY_ADD: return (z->lazy_a + z->lazy_b + z->lazy_cy) > 0xFF;
+        case LAZY_SUB:
+        case LAZY_CP: return (z->lazy_a - z->lazy_b - z->lazy_cy) < 0;
+        case LAZY_INC:
+        case LAZY_DEC: return z->lazy_cy;
+        case LAZY_AND:
+        case LAZY_OR: return 0;
+        default: break;
+    }
+#endif
+    return z->cf;
+}
+
+// zero flag, without materializing the other flags
+static inline bool get_zf(z80* const z)
+{
+#if Z80_LAZY_FLAGS
+    if (z->lazy_op != LAZY_NONE) {
+        return z->lazy_res == 0;
+    }
+#endif
+    return z->zf;
+}
+
+// sign flag, without materializing the other flags
+static inline bool get_sf(z80* const z)
+{
+#if Z80_LAZY_FLAGS
+    if (z->lazy_op != LAZY_NONE) {
+        return z->lazy_res >> 7;
+    }
+#endif
+    return z->sf;
+}
+
+static inline bool get_pf(z80* const z)
+{
+    flags_sync(z);
+    return z->pf;
 }
 
 uint8_t z80_get_f(z80* const z)
 {
+    flags_sync(z);
     uint8_t val  = 0;
     val         |= z->cf << 0;
     val         |= z->nf << 1;
@@ -189,14 +401,8 @@ static inline uint8_t get_f(z80* const z)
 
 void z80_set_f(z80* const z, uint8_t val)
 {
-    z->cf = (val >> 0) & 1;
-    z->nf = (val >> 1) & 1;
-    z->pf = (val >> 2) & 1;
-    z->xf = (val >> 3) & 1;
-    z->hf = (val >> 4) & 1;
-    z->yf = (val >> 5) & 1;
-    z->zf = (val >> 6) & 1;
-    z->sf = (val >> 7) & 1;
+    unpack_f(z, val);
+    z->lazy_op = LAZY_NONE;
 }
 
 static inline void set_f(z80* const z, uint8_t val)
@@ -223,13 +429,41 @@ static inline bool carry(int bit_no, uint16_t a, uint16_t b, bool cy)
 // returns the parity of byte: 0 if number of 1 bits in `val` is odd, else 1
 static inline bool parity(uint8_t val)
 {
-    uint8_t nb_one_bits = 0;
-    for (int i = 0; i < 8; i++) {
-        nb_one_bits += ((val >> i) & 1);
-    }
-
-    return (nb_one_bits & 1) == 0;
-}
+    return (szp_table[val] & FLAG_P) != 0;
+}
+
+// MARK: dispatch
+// The opcode handlers are written as the cases of a switch. When the threaded
+// dispatch is enabled (GCC/Clang only), each case also gets a label, and the
+// handlers jump directly through a table of label addresses. The unprefixed
+// handlers then fetch and jump to the next instruction themselves, as long
+// as z80_run does not need to regain control.
+#if CONFIG_Z80_THREADED_DISPATCH && defined(__GNUC__)
+#define Z80_THREADED_DISPATCH 1
+#else
+#define Z80_THREADED_DISPATCH 0
+#endif
+
+#if Z80_THREADED_DISPATCH
+#define OP(n)      case n: op_##n:
+#define OP_DEFAULT default: op_default:
+#define DISPATCH(table, opcode) goto *table[opcode]
+#define NEXT                              \
+    do {                                  \
+        if (!chain_next(z)) {             \
+            return;                       \
+        }                                 \
+        opcode  = nextb(z);               \
+        z->cyc += cyc_00[opcode];         \
+        inc_r(z);                         \
+        goto *dispatch_00[opcode];        \
+    } while (0)
+#else
+#define OP(n)      case n:
+#define OP_DEFAULT default:
+#define DISPATCH(table, opcode)
+#define NEXT break
+#endif
 
 static void exec_opcode(z80* const z, uint8_t opcode);
 static void exec_opcode_cb(z80* const z, uint8_t opcode);
@@ -237,6 +471,212 @@ static void exec_opcode_dcb(z80* const z, const uint8_t opcode, const uint16_t a
 static void exec_opcode_ed(z80* const z, uint8_t opcode);
 static void exec_opcode_ddfd(z80* const z, uint8_t opcode, uint16_t* const iz);
 
+// MARK: idle loops
+// a guest waiting for a device, typically for the V-blank, polls a status
+// register in a short loop. Nothing can change the value it reads until the
+// next scheduled event ends the run, so once two iterations in a row started
+// in the same state, all the remaining ones would run exactly the same
+// instructions: they are executed at once by only advancing the cycle and
+// refresh counters.
+#define IDLE_MAX_BODY 16
+
+enum {
+    IDLE_BC = 1,
+    IDLE_DE = 2,
+    IDLE_HL = 4,
+    IDLE_A  = 8,
+};
+
+// registers written by the 8-bit register operand r[z]
+static inline uint8_t idle_reg(uint8_t r)
+{
+    static const uint8_t pairs[8] = {IDLE_BC, IDLE_BC, IDLE_DE, IDLE_DE, IDLE_HL, IDLE_HL, 0, IDLE_A};
+    return pairs[r];
+}
+
+// whether reading the given memory address or port has no side effect and
+// returns a value that can only change between two runs
+static inline bool idle_pure(z80* const z, uint16_t addr, bool io)
+{
+    if (io) {
+        return z->idle_read != NULL && z->idle_read(z->userdata, addr);
+    }
+    return z->direct != NULL && z->direct(z->userdata, addr, false) != NULL;
+}
+
+// decodes the loop going from `head` to the jump ending at `next`. Returns
+// the t-states of an iteration, or 0 if the loop does anything other than
+// reading memory or ports and testing the value read: no writes, no stack,
+// and the registers used as addresses must not change. When `check` is set,
+// the locations read by the current iteration must also be pure.
+static unsigned idle_decode(z80* const z, uint16_t head, uint16_t next, uint8_t* fetches, bool check)
+{
+    if (z->direct == NULL || (head & ~(Z80_DIRECT_PAGE_SIZE - 1)) != ((next - 1) & ~(Z80_DIRECT_PAGE_SIZE - 1))) {
+        return 0;
+    }
+    const uint8_t* code = z->direct(z->userdata, head, false);
+    if (code == NULL) {
+        return 0;
+    }
+
+    unsigned cycles = 0;
+    uint8_t written = 0;
+    bool closed     = false;
+    *fetches        = 0;
+    for (uint16_t pc = head; pc != next;) {
+        const uint8_t* op     = code + (uint16_t) (pc - head);
+        const uint16_t avail  = next - pc;
+        const uint8_t opcode  = op[0];
+        const uint8_t y       = (opcode >> 3) & 7;
+        const uint8_t x       = opcode & 7;
+        const uint8_t size    = opcode == 0xCB || opcode == 0xED ? 2 : op_size[opcode];
+        bool read             = false;
+        bool io               = false;
+        uint16_t addr         = 0;
+        uint8_t base          = 0;
+
+        if (size == 0 || size > avail) {
+            return 0;
+        }
+        *fetches += 1;
+        cycles   += cyc_00[opcode];
+        if (opcode == 0xCB) {
+            const uint8_t cb = op[1];
+            *fetches        += 1;
+            cycles          += 8;
+            if ((cb & 7) == 6) {
+                // only bit b, (hl)
+                if ((cb & 0xC0) != 0x40) {
+                    return 0;
+                }
+                read    = true;
+                base    = IDLE_HL;
+                addr    = get_hl(z);
+                cycles += 4;
+            } else if ((cb & 0xC0) != 0x40) {
+                written |= idle_reg(cb & 7);
+            }
+        } else if (opcode == 0xED) {
+            // only in r, (c)
+            const uint8_t ed = op[1];
+            if ((ed & 0xC7) != 0x40) {
+                return 0;
+            }
+            *fetches += 1;
+            cycles   += cyc_ed[ed];
+            read      = io = true;
+            base      = IDLE_BC;
+            addr      = get_bc(z);
+            written  |= idle_reg((ed >> 3) & 7);
+        } else if (opcode == 0xDB) { // in a, (n)
+            read     = io = true;
+            base     = IDLE_A;
+            addr     = (z->a << 8) | op[1];
+            written |= IDLE_A;
+        } else if (opcode >= 0x40 && opcode < 0x80) { // ld r, r'
+            if (y == 6) {
+                return 0;
+            }
+            if (x == 6) {
+                read = true;
+                base = IDLE_HL;
+                addr = get_hl(z);
+            }
+            written |= idle_reg(y);
+        } else if (opcode >= 0x80 && opcode < 0xC0) { // alu a, r
+            if (x == 6) {
+                read = true;
+                base = IDLE_HL;
+                addr = get_hl(z);
+            }
+            written |= y == 7 ? 0 : IDLE_A;
+        } else if ((opcode & 0xC7) == 0xC6) { // alu a, n
+            written |= y == 7 ? 0 : IDLE_A;
+        } else if ((opcode & 0xC7) == 0x06 || (opcode & 0xC6) == 0x04) { // ld r, n / inc r / dec r
+            if (y == 6) {
+                return 0;
+            }
+            written |= idle_reg(y);
+        } else if (opcode == 0x0A || opcode == 0x1A || opcode == 0x3A) { // ld a, (rr) / ld a, (nn)
+            read     = true;
+            base     = opcode == 0x0A ? IDLE_BC : opcode == 0x1A ? IDLE_DE : 0;
+            addr     = opcode == 0x0A ? get_bc(z) : opcode == 0x1A ? get_de(z) : (op[1] | (op[2] << 8));
+            written |= IDLE_A;
+        } else if (opcode == 0x07 || opcode == 0x0F || opcode == 0x17 || opcode == 0x1F || opcode == 0x27 ||
+                   opcode == 0x2F) {
+            written |= IDLE_A;
+        } else if (opcode == 0x18 || opcode == 0xC3 || (opcode & 0xE7) == 0x20 || (opcode & 0xC7) == 0xC2) {
+            const bool relative = opcode < 0x40;
+            const uint16_t to   = relative ? pc + 2 + (int8_t) op[1] : op[1] | (op[2] << 8);
+            if (pc + size == next) {
+                // the jump closing the loop, taken
+                if (to != head) {
+                    return 0;
+                }
+                cycles += (opcode & 0xE7) == 0x20 ? 5 : 0;
+                closed  = true;
+            } else if (opcode == 0x18 || opcode == 0xC3 || (uint16_t) (to - head) < (uint16_t) (next - head)) {
+                // only conditional exits, not taken
+                return 0;
+            }
+        } else if (opcode != 0x00 && opcode != 0x37 && opcode != 0x3F) {
+            return 0;
+        }
+
+        if (read && ((written & base) != 0 || (check && !idle_pure(z, addr, io)))) {
+            return 0;
+        }
+        pc += size;
+    }
+    return closed ? cycles : 0;
+}
+
+// called at the head of a short loop, after the jump closing it
+static void idle_loop(z80* const z, uint16_t next)
+{
+    z80_idle* const idle = &z->idle;
+    if (idle->head != z->pc || idle->next != next) {
+        idle->head   = z->pc;
+        idle->next   = next;
+        idle->cycles = idle_decode(z, z->pc, next, &idle->fetches, false);
+        idle->valid  = false;
+    }
+    if (idle->cycles == 0) {
+        return;
+    }
+
+    const uint16_t regs[Z80_IDLE_REGS] = {
+        z->sp, z->ix, z->iy, z->mem_ptr, (z->a << 8) | z80_get_f(z), get_bc(z), get_de(z), get_hl(z),
+        (z->a_ << 8) | z->f_, z->bc_, z->de_, z->hl_,
+        (z->i << 8) | (z->r & 0x80) | (z->interrupt_mode << 2) | (z->iff1 << 1) | z->iff2,
+    };
+    // the previous iteration ran the decoded instructions, as it took exactly
+    // their t-states and opcode fetches without going through an interrupt
+    uint8_t fetches;
+    if (idle->valid && z->cyc - idle->cyc == idle->cycles && ((z->r - idle->r) & 0x7f) == (idle->fetches & 0x7f) &&
+        memcmp(regs, idle->regs, sizeof(regs)) == 0 && z->iff_delay == 0 && !z->nmi_pending &&
+        !(z->int_pending && z->iff1) && !z->exit_requested &&
+        idle_decode(z, z->pc, next, &fetches, true) == idle->cycles && (long) (z->run_until - z->cyc) > 0) {
+        const unsigned long count = (z->run_until - z->cyc - 1) / idle->cycles;
+        z->cyc += count * idle->cycles;
+        z->r = (z->r & 0x80) | ((z->r + count * idle->fetches) & 0x7f);
+    }
+
+    memcpy(idle->regs, regs, sizeof(regs));
+    idle->cyc   = z->cyc;
+    idle->r     = z->r;
+    idle->valid = true;
+}
+
+// must be called after a taken jump, once its t-states are accounted,
+// `next` being the address following the jump instruction
+static inline void idle_jump(z80* const z, uint16_t next)
+{
+    if (z->idle.active && (uint16_t) (next - z->pc - 1) < IDLE_MAX_BODY) {
+        idle_loop(z, next);
+    }
+}
+
 // MARK: opcodes
 // jumps to an address
 static inline void jump(z80* const z, uint16_t addr)
@@ -250,7 +690,9 @@ static inline void cond_jump(z80* const z, bool condition)
 {
     const uint16_t addr = nextw(z);
     if (condition) {
+        const uint16_t next = z->pc;
         jump(z, addr);
+        idle_jump(z, next);
     }
     z->mem_ptr = addr;
 }
@@ -300,8 +742,10 @@ static inline void cond_jr(z80* const z, bool condition)
 {
     const int8_t b = nextb(z);
     if (condition) {
+        const uint16_t next = z->pc;
         jr(z, b);
         z->cyc += 5;
+        idle_jump(z, next);
     }
 }
 
@@ -309,35 +753,46 @@ static inline void cond_jr(z80* const z, bool condition)
 static inline uint8_t addb(z80* const z, uint8_t a, uint8_t b, bool cy)
 {
     const uint8_t result = a + b + cy;
-    z->sf                = result >> 7;
-    z->zf                = result == 0;
-    z->hf                = carry(4, a, b, cy);
-    z->pf                = carry(7, a, b, cy) != carry(8, a, b, cy);
-    z->cf                = carry(8, a, b, cy);
-    z->nf                = 0;
-    z->xf                = GET_BIT(3, result);
-    z->yf                = GET_BIT(5, result);
+#if Z80_LAZY_FLAGS
+    flags_record(z, LAZY_ADD, a, b, cy, result);
+#else
+    z->sf = result >> 7;
+    z->zf = result == 0;
+    z->hf = carry(4, a, b, cy);
+    z->pf = carry(7, a, b, cy) != carry(8, a, b, cy);
+    z->cf = carry(8, a, b, cy);
+    z->nf = 0;
+    z->xf = GET_BIT(3, result);
+    z->yf = GET_BIT(5, result);
+#endif
     return result;
 }
 
 // SUBstract Byte: substracts two bytes (with optional carry)
 static inline uint8_t subb(z80* const z, uint8_t a, uint8_t b, bool cy)
 {
+#if Z80_LAZY_FLAGS
+    const uint8_t result = a - b - cy;
+    flags_record(z, LAZY_SUB, a, b, cy, result);
+    return result;
+#else
     uint8_t val = addb(z, a, ~b, !cy);
     z->cf       = !z->cf;
     z->hf       = !z->hf;
     z->nf       = 1;
     return val;
+#endif
 }
 
 // ADD Word: adds two words together
 static inline uint16_t addw(z80* const z, uint16_t a, uint16_t b, bool cy)
 {
     uint8_t lsb = addb(z, a, b, cy);
-    uint8_t msb = addb(z, a >> 8, b >> 8, z->cf);
+    uint8_t msb = addb(z, a >> 8, b >> 8, get_cf(z));
 
     uint16_t result = (msb << 8) | lsb;
-    z->zf           = result == 0;
+    flags_sync(z);
+    z->zf = result == 0;
     z->mem_ptr      = a + 1;
     return result;
 }
@@ -346,10 +801,11 @@ static inline uint16_t addw(z80* const z, uint16_t a, uint16_t b, bool cy)
 static inline uint16_t subw(z80* const z, uint16_t a, uint16_t b, bool cy)
 {
     uint8_t lsb = subb(z, a, b, cy);
-    uint8_t msb = subb(z, a >> 8, b >> 8, z->cf);
+    uint8_t msb = subb(z, a >> 8, b >> 8, get_cf(z));
 
     uint16_t result = (msb << 8) | lsb;
-    z->zf           = result == 0;
+    flags_sync(z);
+    z->zf = result == 0;
     z->mem_ptr      = a + 1;
     return result;
 }
@@ -357,6 +813,7 @@ static inline uint16_t subw(z80* const z, uint16_t a, uint16_t b, bool cy)
 // adds a word to HL
 static inline void addhl(z80* const z, uint16_t val)
 {
+    flags_sync(z);
     bool sf         = z->sf;
     bool zf         = z->zf;
     bool pf         = z->pf;
@@ -370,6 +827,7 @@ static inline void addhl(z80* const z, uint16_t val)
 // adds a word to IX or IY
 static inline void addiz(z80* const z, uint16_t* reg, uint16_t val)
 {
+    flags_sync(z);
     bool sf         = z->sf;
     bool zf         = z->zf;
     bool pf         = z->pf;
@@ -383,7 +841,7 @@ static inline void addiz(z80* const z, uint16_t* reg, uint16_t val)
 // adds a word (+ carry) to HL
 static inline void adchl(z80* const z, uint16_t val)
 {
-    uint16_t result = addw(z, get_hl(z), val, z->cf);
+    uint16_t result = addw(z, get_hl(z), val, get_cf(z));
     z->sf           = result >> 15;
     z->zf           = result == 0;
     set_hl(z, result);
@@ -392,7 +850,7 @@ static inline void adchl(z80* const z, uint16_t val)
 // substracts a word (+ carry) to HL
 static inline void sbchl(z80* const z, uint16_t val)
 {
-    const uint16_t result = subw(z, get_hl(z), val, z->cf);
+    const uint16_t result = subw(z, get_hl(z), val, get_cf(z));
     z->sf                 = result >> 15;
     z->zf                 = result == 0;
     set_hl(z, result);
@@ -401,18 +859,28 @@ static inline void sbchl(z80* const z, uint16_t val)
 // increments a byte value
 static inline uint8_t inc(z80* const z, uint8_t a)
 {
+#if Z80_LAZY_FLAGS
+    const uint8_t result = a + 1;
+    flags_record(z, LAZY_INC, a, 1, get_cf(z), result);
+#else
     bool cf        = z->cf;
     uint8_t result = addb(z, a, 1, 0);
     z->cf          = cf;
+#endif
     return result;
 }
 
 // decrements a byte value
 static inline uint8_t dec(z80* const z, uint8_t a)
 {
+#if Z80_LAZY_FLAGS
+    const uint8_t result = a - 1;
+    flags_record(z, LAZY_DEC, a, 1, get_cf(z), result);
+#else
     bool cf        = z->cf;
     uint8_t result = subb(z, a, 1, 0);
     z->cf          = cf;
+#endif
     return result;
 }
 
@@ -423,15 +891,19 @@ static inline uint8_t dec(z80* const z, uint8_t a)
 static inline void land(z80* const z, uint8_t val)
 {
     const uint8_t result = z->a & val;
-    z->sf                = result >> 7;
-    z->zf                = result == 0;
-    z->hf                = 1;
-    z->pf                = parity(result);
-    z->nf                = 0;
-    z->cf                = 0;
-    z->xf                = GET_BIT(3, result);
-    z->yf                = GET_BIT(5, result);
-    z->a                 = result;
+#if Z80_LAZY_FLAGS
+    flags_record(z, LAZY_AND, z->a, val, 0, result);
+#else
+    z->sf = result >> 7;
+    z->zf = result == 0;
+    z->hf = 1;
+    z->pf = parity(result);
+    z->nf = 0;
+    z->cf = 0;
+    z->xf = GET_BIT(3, result);
+    z->yf = GET_BIT(5, result);
+#endif
+    z->a = result;
 }
 
 // executes a logic "xor" between register A and a byte, then stores the
@@ -439,15 +911,19 @@ static inline void land(z80* const z, uint8_t val)
 static inline void lxor(z80* const z, const uint8_t val)
 {
     const uint8_t result = z->a ^ val;
-    z->sf                = result >> 7;
-    z->zf                = result == 0;
-    z->hf                = 0;
-    z->pf                = parity(result);
-    z->nf                = 0;
-    z->cf                = 0;
-    z->xf                = GET_BIT(3, result);
-    z->yf                = GET_BIT(5, result);
-    z->a                 = result;
+#if Z80_LAZY_FLAGS
+    flags_record(z, LAZY_OR, z->a, val, 0, result);
+#else
+    z->sf = result >> 7;
+    z->zf = result == 0;
+    z->hf = 0;
+    z->pf = parity(result);
+    z->nf = 0;
+    z->cf = 0;
+    z->xf = GET_BIT(3, result);
+    z->yf = GET_BIT(5, result);
+#endif
+    z->a = result;
 }
 
 // executes a logic "or" between register A and a byte, then stores the
@@ -455,20 +931,27 @@ static inline void lxor(z80* const z, const uint8_t val)
 static inline void lor(z80* const z, const uint8_t val)
 {
     const uint8_t result = z->a | val;
-    z->sf                = result >> 7;
-    z->zf                = result == 0;
-    z->hf                = 0;
-    z->pf                = parity(result);
-    z->nf                = 0;
-    z->cf                = 0;
-    z->xf                = GET_BIT(3, result);
-    z->yf                = GET_BIT(5, result);
-    z->a                 = result;
+#if Z80_LAZY_FLAGS
+    flags_record(z, LAZY_OR, z->a, val, 0, result);
+#else
+    z->sf = result >> 7;
+    z->zf = result == 0;
+    z->hf = 0;
+    z->pf = parity(result);
+    z->nf = 0;
+    z->cf = 0;
+    z->xf = GET_BIT(3, result);
+    z->yf = GET_BIT(5, result);
+#endif
+    z->a = result;
 }
 
 // compares a value with register A
 static inline void cp(z80* const z, const uint8_t val)
 {
+#if Z80_LAZY_FLAGS
+    flags_record(z, LAZY_CP, z->a, val, 0, z->a - val);
+#else
     subb(z, z->a, val, 0);
 
     // the only difference between cp and sub is that
@@ -476,12 +959,14 @@ static inline void cp(z80* const z, const uint8_t val)
     // not the result
     z->yf = GET_BIT(5, val);
     z->xf = GET_BIT(3, val);
+#endif
 }
 
 // 0xCB opcodes
 // rotate left with carry
 static inline uint8_t cb_rlc(z80* const z, uint8_t val)
 {
+    flags_sync(z);
     const bool old = val >> 7;
     val            = (val << 1) | old;
     z->sf          = val >> 7;
@@ -498,6 +983,7 @@ static inline uint8_t cb_rlc(z80* const z, uint8_t val)
 // rotate right with carry
 static inline uint8_t cb_rrc(z80* const z, uint8_t val)
 {
+    flags_sync(z);
     const bool old = val & 1;
     val            = (val >> 1) | (old << 7);
     z->sf          = val >> 7;
@@ -514,6 +1000,7 @@ static inline uint8_t cb_rrc(z80* const z, uint8_t val)
 // rotate left (simple)
 static inline uint8_t cb_rl(z80* const z, uint8_t val)
 {
+    flags_sync(z);
     const bool cf = z->cf;
     z->cf         = val >> 7;
     val           = (val << 1) | cf;
@@ -530,6 +1017,7 @@ static inline uint8_t cb_rl(z80* const z, uint8_t val)
 // rotate right (simple)
 static inline uint8_t cb_rr(z80* const z, uint8_t val)
 {
+    flags_sync(z);
     const bool c = z->cf;
     z->cf        = val & 1;
     val          = (val >> 1) | (c << 7);
@@ -546,6 +1034,7 @@ static inline uint8_t cb_rr(z80* const z, uint8_t val)
 // shift left preserving sign
 static inline uint8_t cb_sla(z80* const z, uint8_t val)
 {
+    flags_sync(z);
     z->cf   = val >> 7;
     val   <<= 1;
     z->sf   = val >> 7;
@@ -561,6 +1050,7 @@ static inline uint8_t cb_sla(z80* const z, uint8_t val)
 // SLL (exactly like SLA, but sets the first bit to 1)
 static inline uint8_t cb_sll(z80* const z, uint8_t val)
 {
+    flags_sync(z);
     z->cf   = val >> 7;
     val   <<= 1;
     val    |= 1;
@@ -577,6 +1067,7 @@ static inline uint8_t cb_sll(z80* const z, uint8_t val)
 // shift right preserving sign
 static inline uint8_t cb_sra(z80* const z, uint8_t val)
 {
+    flags_sync(z);
     z->cf = val & 1;
     val   = (val >> 1) | (val & 0x80); // 0b10000000
     z->sf = val >> 7;
@@ -592,6 +1083,7 @@ static inline uint8_t cb_sra(z80* const z, uint8_t val)
 // shift register right
 static inline uint8_t cb_srl(z80* const z, uint8_t val)
 {
+    flags_sync(z);
     z->cf   = val & 1;
     val   >>= 1;
     z->sf   = val >> 7;
@@ -607,6 +1099,7 @@ static inline uint8_t cb_srl(z80* const z, uint8_t val)
 // tests bit "n" from a byte
 static inline uint8_t cb_bit(z80* const z, uint8_t val, uint8_t n)
 {
+    flags_sync(z);
     const uint8_t result = val & (1 << n);
     z->sf                = result >> 7;
     z->zf                = result == 0;
@@ -620,6 +1113,7 @@ static inline uint8_t cb_bit(z80* const z, uint8_t val, uint8_t n)
 
 static inline void ldi(z80* const z)
 {
+    flags_sync(z);
     const uint16_t de = get_de(z);
     const uint16_t hl = get_hl(z);
     const uint8_t val = rb(z, hl);
@@ -651,8 +1145,9 @@ static inline void ldd(z80* const z)
 
 static inline void cpi(z80* const z)
 {
-    bool cf              = z->cf;
+    bool cf              = get_cf(z);
     const uint8_t result = subb(z, z->a, rb(z, get_hl(z)), 0);
+    flags_sync(z);
     set_hl(z, get_hl(z) + 1);
     set_bc(z, get_bc(z) - 1);
     z->xf       = GET_BIT(3, result - z->hf);
@@ -672,7 +1167,8 @@ static inline void cpd(z80* const z)
 
 static void in_r_c(z80* const z, uint8_t* r)
 {
-    *r    = z->port_in(z->userdata, (z->b << 8) | z->c);
+    flags_sync(z);
+    *r    = bus_in(z, (z->b << 8) | z->c);
     z->zf = *r == 0;
     z->sf = *r >> 7;
     z->pf = parity(*r);
@@ -682,7 +1178,8 @@ static void in_r_c(z80* const z, uint8_t* r)
 
 static void ini(z80* const z)
 {
-    uint8_t val = z->port_in(z->userdata, (z->b << 8) | z->c);
+    flags_sync(z);
+    uint8_t val = bus_in(z, (z->b << 8) | z->c);
     wb(z, get_hl(z), val);
     set_hl(z, get_hl(z) + 1);
     z->b       -= 1;
@@ -700,7 +1197,8 @@ static void ind(z80* const z)
 
 static void outi(z80* const z)
 {
-    z->port_out(z->userdata, get_bc(z), rb(z, get_hl(z)));
+    flags_sync(z);
+    bus_out(z, get_bc(z), rb(z, get_hl(z)));
     set_hl(z, get_hl(z) + 1);
     z->b       -= 1;
     z->zf       = z->b == 0;
@@ -717,6 +1215,7 @@ static void outd(z80* const z)
 
 static void daa(z80* const z)
 {
+    flags_sync(z);
     // "When this instruction is executed, the A register is BCD corrected
     // using the  contents of the flags. The exact process is the following:
     // if the least significant four bits of A contain a non-BCD digit
@@ -759,6 +1258,38 @@ static inline uint16_t displace(z80* const z, uint16_t base_addr, int8_t displac
     return addr;
 }
 
+// executes a single opcode, without chaining to the next instruction
+static inline void exec_opcode_once(z80* const z, uint8_t opcode)
+{
+    const bool chain = z->chain;
+    z->chain         = 0;
+    exec_opcode(z, opcode);
+    z->chain = chain;
+}
+
+// returns true if the run loop must handle something before the next
+// instruction: an interrupt, a halted CPU or an exit request
+static inline bool chain_blocked(z80* const z)
+{
+    return !z->chain || z->halted || z->iff_delay != 0 || z->nmi_pending || (z->int_pending && z->iff1) ||
+           z->exit_requested;
+}
+
+// returns true if the next instruction can be executed right away, without
+// going through z80_run loop: the budget is not consumed and neither the
+// interrupts nor the breakpoint hook need to be handled
+static inline bool chain_next(z80* const z)
+{
+    if ((long) (z->cyc - z->run_until) >= 0 || chain_blocked(z)) {
+        return false;
+    }
+    if (z->breakpoint != NULL && z->breakpoint(z->userdata, z->pc)) {
+        z->exit_requested = 1;
+        return false;
+    }
+    return true;
+}
+
 static inline void process_interrupts(z80* const z)
 {
     // "When an EI instruction is executed, any pending interrupt request
@@ -793,7 +1324,7 @@ static inline void process_interrupts(z80* const z)
         switch (z->interrupt_mode) {
             case 0:
                 z->cyc += 11;
-                exec_opcode(z, z->int_data);
+                exec_opcode_once(z, z->int_data);
                 break;
 
             case 1:
@@ -813,109 +1344,1414 @@ static inline void process_interrupts(z80* const z)
     }
 }
 
-// MARK: interface
-// initialises a z80 struct. Note that read_byte, write_byte, port_in, port_out
-// and userdata must be manually set by the user afterwards.
-void z80_init(z80* const z)
-{
-    z->read_byte  = NULL;
-    z->write_byte = NULL;
-    z->port_in    = NULL;
-    z->port_out   = NULL;
-    z->userdata   = NULL;
-
-    z->cyc = 0;
+// MARK: block instructions
+// Repeated block instructions (LDIR, CPIR, INIR, ...) rewind PC after each
+// iteration so that they are fetched and executed again. When the run loop
+// would do exactly that, the next iterations are executed right away. Memory
+// copies and searches are additionally performed in bulk on host memory, the
+// last allowed iteration still going through the regular path to set the
+// flags and registers like the CPU does.
 
-    z->pc      = 0;
-    z->sp      = 0xFFFF;
-    z->ix      = 0;
-    z->iy      = 0;
-    z->mem_ptr = 0;
+// returns true if the rewound block instruction can be repeated right away:
+// nothing needs to be handled by the run loop, and the instruction, still
+// in place, can be fetched from memory without side effects
+static inline bool block_can_repeat(z80* const z, uint8_t opcode)
+{
+    if (z->direct == NULL || !chain_next(z)) {
+        return false;
+    }
+    const uint8_t* prefix = z->direct(z->userdata, z->pc, false);
+    const uint8_t* op     = z->direct(z->userdata, z->pc + 1, false);
+    return prefix != NULL && op != NULL && *prefix == 0xED && *op == opcode;
+}
 
-    // af and sp are set to 0xFFFF after reset,
-    // and the other values are undefined (z80-documented)
-    z->a = 0xFF;
-    z->b = 0;
-    z->c = 0;
-    z->d = 0;
-    z->e = 0;
-    z->h = 0;
-    z->l = 0;
+// accounts for fetching the block instruction again
+static inline void block_refetch(z80* const z, uint8_t opcode)
+{
+    z->pc  += 2;
+    z->cyc += cyc_00[0xED] + cyc_ed[opcode];
+    inc_r(z);
+    inc_r(z);
+}
 
-    z->a_ = 0;
-    z->b_ = 0;
-    z->c_ = 0;
-    z->d_ = 0;
-    z->e_ = 0;
-    z->h_ = 0;
-    z->l_ = 0;
-    z->f_ = 0;
+// accounts for `count` iterations of a block instruction performed in bulk,
+// each one made of its fetch and its rewind
+static inline void block_skip(z80* const z, uint8_t opcode, unsigned count)
+{
+    z->cyc += (unsigned long) count * (cyc_00[0xED] + cyc_ed[opcode] + 5);
+    z->r    = (z->r & 0x80) | ((z->r + 2 * count) & 0x7f);
+}
 
-    z->i = 0;
-    z->r = 0;
+// returns how many iterations of a rewound block instruction can be done in
+// bulk, leaving the last one allowed by the budget and by `remaining` to the
+// regular path. `addr` iterations must stay in a single direct page.
+static inline unsigned block_bulk_count(z80* const z, uint8_t opcode, unsigned remaining, uint16_t addr, int dir)
+{
+    const unsigned cycles      = cyc_00[0xED] + cyc_ed[opcode] + 5;
+    const unsigned long to_run = z->run_until - z->cyc;
+    const unsigned long budget = (to_run + cycles - 1) / cycles;
+    const unsigned offset      = addr & (Z80_DIRECT_PAGE_SIZE - 1);
+    const unsigned in_page     = dir > 0 ? Z80_DIRECT_PAGE_SIZE - offset : offset + 1;
 
-    z->sf = 1;
-    z->zf = 1;
-    z->yf = 1;
-    z->hf = 1;
-    z->xf = 1;
-    z->pf = 1;
-    z->nf = 1;
-    z->cf = 1;
+    unsigned count = remaining - 1;
+    if (budget - 1 < count) {
+        count = budget - 1;
+    }
+    if (in_page < count) {
+        count = in_page;
+    }
+    return count;
+}
 
-    z->iff_delay      = 0;
-    z->interrupt_mode = 0;
-    z->iff1           = 0;
-    z->iff2           = 0;
-    z->halted         = 0;
-    z->int_pending    = 0;
-    z->nmi_pending    = 0;
-    z->int_data       = 0;
+// returns true if the rewound block instruction lies within `size` bytes at `mem`
+static inline bool block_overlaps_code(z80* const z, const uint8_t* mem, unsigned size)
+{
+    const uintptr_t start = (uintptr_t) mem;
+    for (int i = 0; i < 2; i++) {
+        const uintptr_t code = (uintptr_t) z->direct(z->userdata, z->pc + i, false);
+        if (code >= start && code < start + size) {
+            return true;
+        }
+    }
+    return false;
 }
 
-/* Get the size of the next instruction to execute, in bytes */
-int z80_instruction_size(z80* const z)
+// LDIR/LDDR iterations in bulk, `dir` being 1 or -1
+static void block_ld(z80* const z, uint8_t opcode, int dir)
 {
-    uint8_t opcode = rb(z, z->pc);
-    int size = op_size[opcode];
+    unsigned count = block_bulk_count(z, opcode, get_bc(z), get_hl(z), dir);
+    const unsigned de_count = block_bulk_count(z, opcode, get_bc(z), get_de(z), dir);
+    if (de_count < count) {
+        count = de_count;
+    }
+    if (count == 0) {
+        return;
+    }
 
-    if (size != 0) {
-        return size;
+    // take the lowest address of both ranges
+    const uint16_t src_addr = dir > 0 ? get_hl(z) : get_hl(z) - (count - 1);
+    const uint16_t dst_addr = dir > 0 ? get_de(z) : get_de(z) - (count - 1);
+    const uint8_t* src      = z->direct(z->userdata, src_addr, false);
+    uint8_t* dst            = z->direct(z->userdata, dst_addr, true);
+    if (src == NULL || dst == NULL || block_overlaps_code(z, dst, count)) {
+        return;
     }
-    /* Opcode is a prefix, we need to read the next byte */
-    uint8_t opcode2 = rb(z, z->pc + 1);
-    if (opcode == 0xFD || opcode == 0xDD) {
-        size = op_fddd_size[opcode2];
-        /* If the size is 0, the instruction is invalid */
-        return (size != 0) ? size : 4;
-    } else if (opcode == 0xED) {
-        size = op_ed_size[opcode2];
-        /* If the size is 0, the instruction is invalid */
-        return (size != 0) ? size : 2;
+
+    // the copy is done byte per byte by the CPU: when the destination overlaps
+    // the bytes still to be read, they must be propagated (memory fill idiom)
+    const uintptr_t s = (uintptr_t) src;
+    const uintptr_t d = (uintptr_t) dst;
+    if (dir > 0 && d > s && d < s + count) {
+        for (unsigned i = 0; i < count; i++) {
+            dst[i] = src[i];
+        }
+    } else if (dir < 0 && s > d && s < d + count) {
+        for (unsigned i = count; i-- > 0;) {
+            dst[i] = src[i];
+        }
     } else {
-        log_err_printf("[Z80] Invalid size for opcode %x\n", opcode);
+        memmove(dst, src, count);
     }
-    return 1;
-}
 
+    set_hl(z, get_hl(z) + dir * (int) count);
+    set_de(z, get_de(z) + dir * (int) count);
+    set_bc(z, get_bc(z) - count);
+    block_skip(z, opcode, count);
+}
 
-// executes the next instruction in memory + handles interrupts
-int z80_step(z80* const z)
+// CPIR/CPDR iterations in bulk, `dir` being 1 or -1
+static void block_cp(z80* const z, uint8_t opcode, int dir)
 {
-    int cycles = z->cyc;
-    if (z->halted) {
-        exec_opcode(z, 0x00);
+    unsigned count = block_bulk_count(z, opcode, get_bc(z), get_hl(z), dir);
+    if (count == 0) {
+        return;
+    }
+
+    const uint8_t* src = z->direct(z->userdata, get_hl(z), false);
+    if (src == NULL) {
+        return;
+    }
+
+    // the iteration that finds the byte ends the instruction, it must go
+    // through the regular path
+    if (dir > 0) {
+        const uint8_t* found = memchr(src, z->a, count);
+        if (found != NULL) {
+            count = found - src;
+        }
     } else {
-        const uint8_t opcode = nextb(z);
-        exec_opcode(z, opcode);
+        for (unsigned i = 0; i < count; i++) {
+            if (src[-(int) i] == z->a) {
+                count = i;
+                break;
+            }
+        }
     }
 
-    process_interrupts(z);
-    return z->cyc - cycles;
+    set_hl(z, get_hl(z) + dir * (int) count);
+    set_bc(z, get_bc(z) - count);
+    if (dir < 0) {
+        // CPDR doesn't reset MEMPTR when repeating
+        z->mem_ptr -= count;
+    }
+    block_skip(z, opcode, count);
+}
+
+// MARK: block cache
+// Straight-line code is decoded once into micro-ops, kept in a cache keyed on
+// the physical address of its first instruction. A block stays valid as long
+// as the write generation of its page, maintained by the host, is unchanged.
+// The most common instructions have a dedicated micro-op that doesn't fetch
+// anything from memory, the other ones are run by the interpreter. A block is
+// left as soon as PC doesn't follow the decoded code (taken jumps, repeated
+// block instructions, ...) or when the run loop needs to take over.
+#if CONFIG_Z80_BLOCK_CACHE
+#define Z80_BLOCK_CACHE 1
+#else
+#define Z80_BLOCK_CACHE 0
+#endif
+
+// test mode: each dedicated micro-op is checked against the interpreter
+#if CONFIG_Z80_BLOCK_CACHE_VERIFY
+#define Z80_BLOCK_CACHE_VERIFY 1
+#else
+#define Z80_BLOCK_CACHE_VERIFY 0
+#endif
+
+// recompiler of the hottest blocks, only available on x86-64 Linux
+#if CONFIG_Z80_JIT && Z80_BLOCK_CACHE && defined(__x86_64__) && defined(__linux__)
+#define Z80_JIT 1
+#else
+#define Z80_JIT 0
+#endif
+
+// test mode: each recompiled block is checked against the interpreter
+#if Z80_JIT && CONFIG_Z80_JIT_VERIFY
+#define Z80_JIT_VERIFY 1
+#else
+#define Z80_JIT_VERIFY 0
+#endif
+
+#if Z80_BLOCK_CACHE
+
+#define UOP_REG8(z, offset)  (*((uint8_t*) (z) + (offset)))
+#define UOP_REG16(z, offset) (*(uint16_t*) ((uint8_t*) (z) + (offset)))
+
+_Static_assert(offsetof(z80, sp) < 256 && offsetof(z80, l) < 256, "register offsets must fit in a micro-op");
+
+// 8-bit operands, indexed like in the opcodes: b, c, d, e, h, l, (hl), a
+static const uint8_t uop_reg8[8] = {
+    offsetof(z80, b), offsetof(z80, c), offsetof(z80, d), offsetof(z80, e),
+    offsetof(z80, h), offsetof(z80, l), 0,                offsetof(z80, a),
+};
+
+// 16-bit operands, indexed like in the opcodes: bc, de, hl, sp
+static const uint8_t uop_reg16[4] = {offsetof(z80, bc), offsetof(z80, de), offsetof(z80, hl), offsetof(z80, sp)};
+
+// accounts for the fetch of a non-prefixed instruction
+static inline void uop_fetch(z80* const z, const z80_uop* op)
+{
+    z->cyc += cyc_00[op->opcode];
+    inc_r(z);
+    z->pc += op->len;
 }
 
-// outputs to stdout a debug trace of the emulator
-void z80_debug_output(z80* const z)
+// condition codes, indexed like in the opcodes: nz, z, nc, c, po, pe, p, m
+static inline bool uop_cond(z80* const z, uint8_t cc)
+{
+    switch (cc) {
+        case 0: return !get_zf(z);
+        case 1: return get_zf(z);
+        case 2: return !get_cf(z);
+        case 3: return get_cf(z);
+        case 4: return !get_pf(z);
+        case 5: return get_pf(z);
+        case 6: return !get_sf(z);
+        default: return get_sf(z);
+    }
+}
+
+// instructions without a dedicated micro-op are fetched again from memory,
+// which still holds the decoded bytes since the page generation didn't change
+static void uop_fallback(z80* const z, const z80_uop* op)
+{
+    (void) op;
+    exec_opcode_once(z, nextb(z));
+}
+
+static void uop_nop(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+}
+
+static void uop_ld_r_r(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    UOP_REG8(z, op->dst) = UOP_REG8(z, op->src);
+}
+
+static void uop_ld_r_n(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    UOP_REG8(z, op->dst) = op->imm;
+}
+
+static void uop_ld_r_ihl(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    UOP_REG8(z, op->dst) = rb(z, get_hl(z));
+}
+
+static void uop_ld_ihl_r(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    wb(z, get_hl(z), UOP_REG8(z, op->src));
+}
+
+static void uop_ld_ihl_n(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    wb(z, get_hl(z), op->imm);
+}
+
+static void uop_ld_a_irr(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    const uint16_t addr = UOP_REG16(z, op->src);
+    z->a                = rb(z, addr);
+    z->mem_ptr          = addr + 1;
+}
+
+static void uop_ld_irr_a(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    const uint16_t addr = UOP_REG16(z, op->dst);
+    wb(z, addr, z->a);
+    z->mem_ptr = (z->a << 8) | ((addr + 1) & 0xFF);
+}
+
+static void uop_ld_a_inn(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    z->a       = rb(z, op->imm);
+    z->mem_ptr = op->imm + 1;
+}
+
+static void uop_ld_inn_a(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    wb(z, op->imm, z->a);
+    z->mem_ptr = (z->a << 8) | ((op->imm + 1) & 0xFF);
+}
+
+static void uop_ld_hl_inn(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    set_hl(z, rw(z, op->imm));
+    z->mem_ptr = op->imm + 1;
+}
+
+static void uop_ld_inn_hl(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    ww(z, op->imm, get_hl(z));
+    z->mem_ptr = op->imm + 1;
+}
+
+static void uop_ld_rr_nn(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    UOP_REG16(z, op->dst) = op->imm;
+}
+
+static void uop_inc_r(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    UOP_REG8(z, op->dst) = inc(z, UOP_REG8(z, op->dst));
+}
+
+static void uop_dec_r(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    UOP_REG8(z, op->dst) = dec(z, UOP_REG8(z, op->dst));
+}
+
+static void uop_inc_rr(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    UOP_REG16(z, op->dst) += 1;
+}
+
+static void uop_dec_rr(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    UOP_REG16(z, op->dst) -= 1;
+}
+
+static void uop_add_hl_rr(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    addhl(z, UOP_REG16(z, op->src));
+}
+
+static void uop_ex_de_hl(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    const uint16_t de = get_de(z);
+    set_de(z, get_hl(z));
+    set_hl(z, de);
+}
+
+static void uop_push(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    pushw(z, UOP_REG16(z, op->src));
+}
+
+static void uop_pop(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    UOP_REG16(z, op->dst) = popw(z);
+}
+
+// ALU operations on A, with a register, an immediate or (hl) as operand
+#define UOP_ALU(name, operation)                                  \
+    static void uop_##name##_r(z80* const z, const z80_uop* op)   \
+    {                                                             \
+        uop_fetch(z, op);                                         \
+        const uint8_t val = UOP_REG8(z, op->src);                 \
+        operation;                                                \
+    }                                                             \
+    static void uop_##name##_n(z80* const z, const z80_uop* op)   \
+    {                                                             \
+        uop_fetch(z, op);                                         \
+        const uint8_t val = op->imm;                              \
+        operation;                                                \
+    }                                                             \
+    static void uop_##name##_ihl(z80* const z, const z80_uop* op) \
+    {                                                             \
+        uop_fetch(z, op);                                         \
+        const uint8_t val = rb(z, get_hl(z));                     \
+        operation;                                                \
+    }
+
+UOP_ALU(add, z->a = addb(z, z->a, val, 0))
+UOP_ALU(adc, z->a = addb(z, z->a, val, get_cf(z)))
+UOP_ALU(sub, z->a = subb(z, z->a, val, 0))
+UOP_ALU(sbc, z->a = subb(z, z->a, val, get_cf(z)))
+UOP_ALU(and, land(z, val))
+UOP_ALU(xor, lxor(z, val))
+UOP_ALU(or, lor(z, val))
+UOP_ALU(cp, cp(z, val))
+
+// indexed like in the opcodes
+static void (*const uop_alu_r[8])(z80* const, const z80_uop*) = {
+    uop_add_r, uop_adc_r, uop_sub_r, uop_sbc_r, uop_and_r, uop_xor_r, uop_or_r, uop_cp_r,
+};
+static void (*const uop_alu_n[8])(z80* const, const z80_uop*) = {
+    uop_add_n, uop_adc_n, uop_sub_n, uop_sbc_n, uop_and_n, uop_xor_n, uop_or_n, uop_cp_n,
+};
+static void (*const uop_alu_ihl[8])(z80* const, const z80_uop*) = {
+    uop_add_ihl, uop_adc_ihl, uop_sub_ihl, uop_sbc_ihl, uop_and_ihl, uop_xor_ihl, uop_or_ihl, uop_cp_ihl,
+};
+
+static void uop_jr(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    const uint16_t next = z->pc;
+    jr(z, (int8_t) op->imm);
+    idle_jump(z, next);
+}
+
+static void uop_jr_cc(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    if (uop_cond(z, op->dst)) {
+        const uint16_t next = z->pc;
+        jr(z, (int8_t) op->imm);
+        z->cyc += 5;
+        idle_jump(z, next);
+    }
+}
+
+static void uop_djnz(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    if (--z->b != 0) {
+        jr(z, (int8_t) op->imm);
+        z->cyc += 5;
+    }
+}
+
+static void uop_jp(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    const uint16_t next = z->pc;
+    jump(z, op->imm);
+    idle_jump(z, next);
+}
+
+static void uop_jp_cc(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    if (uop_cond(z, op->dst)) {
+        const uint16_t next = z->pc;
+        jump(z, op->imm);
+        idle_jump(z, next);
+    }
+    z->mem_ptr = op->imm;
+}
+
+static void uop_call(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    call(z, op->imm);
+}
+
+static void uop_call_cc(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    if (uop_cond(z, op->dst)) {
+        call(z, op->imm);
+        z->cyc += 7;
+    }
+    z->mem_ptr = op->imm;
+}
+
+static void uop_ret(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    ret(z);
+}
+
+static void uop_ret_cc(z80* const z, const z80_uop* op)
+{
+    uop_fetch(z, op);
+    cond_ret(z, uop_cond(z, op->dst));
+}
+
+// returns true if the non-prefixed opcode accesses (hl), turned into (iz+d) by a DD/FD prefix
+static inline bool block_uses_ihl(uint8_t opcode)
+{
+    if (opcode >= 0x34 && opcode <= 0x36) {
+        return true;
+    }
+    if (opcode >= 0x40 && opcode < 0x80) {
+        return opcode != 0x76 && ((opcode & 7) == 6 || (opcode & 0x38) == 0x30);
+    }
+    return opcode >= 0x80 && opcode < 0xC0 && (opcode & 7) == 6;
+}
+
+// returns the size of the instruction at `code`, 0 if it can't be decoded
+// from the `avail` bytes or if it is made of several prefixes
+static unsigned block_op_size(const uint8_t* code, unsigned avail)
+{
+    if (op_size[code[0]] != 0) {
+        return op_size[code[0]];
+    }
+    if (code[0] == 0xCB) {
+        return 2;
+    }
+    if (avail < 2) {
+        return 0;
+    }
+    const uint8_t opcode = code[1];
+    if (code[0] == 0xED) {
+        // ld (**),rr and ld rr,(**)
+        return (opcode & 0xC7) == 0x43 ? 4 : 2;
+    }
+    if (opcode == 0xCB) {
+        return 4;
+    }
+    if (opcode == 0xDD || opcode == 0xFD || opcode == 0xED) {
+        return 0;
+    }
+    return 1 + op_size[opcode] + block_uses_ihl(opcode);
+}
+
+// returns true if no instruction can follow the given one in a block
+static inline bool block_ends(const uint8_t* code)
+{
+    switch (code[0]) {
+        case 0x18: // jr
+        case 0x76: // halt
+        case 0xC3: // jp
+        case 0xC9: // ret
+        case 0xCD: // call
+        case 0xE9: // jp (hl)
+            return true;
+        default:
+            // rst
+            return (code[0] & 0xC7) == 0xC7;
+    }
+}
+
+// decodes the instruction at `code` into a micro-op, returns false if it can't be cached
+static bool block_decode_op(z80_uop* op, const uint8_t* code, unsigned avail)
+{
+    const unsigned size = block_op_size(code, avail);
+    if (size == 0 || size > avail) {
+        return false;
+    }
+
+    const uint8_t opcode = code[0];
+    const uint8_t x      = (opcode >> 3) & 7;
+    const uint8_t y      = opcode & 7;
+    const uint8_t p      = (opcode >> 4) & 3;
+    op->exec             = uop_fallback;
+    op->opcode           = opcode;
+    op->len              = size;
+    op->imm              = size == 2 ? code[1] : size == 3 ? code[1] | (code[2] << 8) : 0;
+    op->dst              = 0;
+    op->src              = 0;
+
+    if (opcode >= 0x40 && opcode < 0x80) {
+        if (opcode == 0x76) {
+            // halt
+        } else if (y == 6) {
+            op->exec = uop_ld_r_ihl;
+            op->dst  = uop_reg8[x];
+        } else if (x == 6) {
+            op->exec = uop_ld_ihl_r;
+            op->src  = uop_reg8[y];
+        } else {
+            op->exec = uop_ld_r_r;
+            op->dst  = uop_reg8[x];
+            op->src  = uop_reg8[y];
+        }
+    } else if (opcode >= 0x80 && opcode < 0xC0) {
+        op->exec = y == 6 ? uop_alu_ihl[x] : uop_alu_r[x];
+        op->src  = uop_reg8[y];
+    } else if ((opcode & 0xC7) == 0xC6) {
+        op->exec = uop_alu_n[x];
+    } else if ((opcode & 0xC7) == 0x06) {
+        op->exec = x == 6 ? uop_ld_ihl_n : uop_ld_r_n;
+        op->dst  = uop_reg8[x];
+    } else if ((opcode & 0xC7) == 0x04 && x != 6) {
+        op->exec = uop_inc_r;
+        op->dst  = uop_reg8[x];
+    } else if ((opcode & 0xC7) == 0x05 && x != 6) {
+        op->exec = uop_dec_r;
+        op->dst  = uop_reg8[x];
+    } else if ((opcode & 0xE7) == 0x20) {
+        op->exec = uop_jr_cc;
+        op->dst  = x - 4;
+    } else if ((opcode & 0xC7) == 0xC2) {
+        op->exec = uop_jp_cc;
+        op->dst  = x;
+    } else if ((opcode & 0xC7) == 0xC4) {
+        op->exec = uop_call_cc;
+        op->dst  = x;
+    } else if ((opcode & 0xC7) == 0xC0) {
+        op->exec = uop_ret_cc;
+        op->dst  = x;
+    } else if ((opcode & 0xCF) == 0x01) {
+        op->exec = uop_ld_rr_nn;
+        op->dst  = uop_reg16[p];
+    } else if ((opcode & 0xCF) == 0x03) {
+        op->exec = uop_inc_rr;
+        op->dst  = uop_reg16[p];
+    } else if ((opcode & 0xCF) == 0x0B) {
+        op->exec = uop_dec_rr;
+        op->dst  = uop_reg16[p];
+    } else if ((opcode & 0xCF) == 0x09) {
+        op->exec = uop_add_hl_rr;
+        op->src  = uop_reg16[p];
+    } else if ((opcode & 0xCF) == 0xC5 && p != 3) {
+        op->exec = uop_push;
+        op->src  = uop_reg16[p];
+    } else if ((opcode & 0xCF) == 0xC1 && p != 3) {
+        op->exec = uop_pop;
+        op->dst  = uop_reg16[p];
+    } else {
+        switch (opcode) {
+            case 0x00: op->exec = uop_nop; break;
+            case 0x02: op->exec = uop_ld_irr_a; op->dst = uop_reg16[0]; break;
+            case 0x12: op->exec = uop_ld_irr_a; op->dst = uop_reg16[1]; break;
+            case 0x0A: op->exec = uop_ld_a_irr; op->src = uop_reg16[0]; break;
+            case 0x1A: op->exec = uop_ld_a_irr; op->src = uop_reg16[1]; break;
+            case 0x22: op->exec = uop_ld_inn_hl; break;
+            case 0x2A: op->exec = uop_ld_hl_inn; break;
+            case 0x32: op->exec = uop_ld_inn_a; break;
+            case 0x3A: op->exec = uop_ld_a_inn; break;
+            case 0xEB: op->exec = uop_ex_de_hl; break;
+            case 0x10: op->exec = uop_djnz; break;
+            case 0x18: op->exec = uop_jr; break;
+            case 0xC3: op->exec = uop_jp; break;
+            case 0xCD: op->exec = uop_call; break;
+            case 0xC9: op->exec = uop_ret; break;
+            default: break;
+        }
+    }
+    return true;
+}
+
+// decodes the code at PC into the given block
+static void block_decode(z80* const z, z80_block* blk, uint32_t phys, uint32_t gen)
+{
+    blk->phys   = phys;
+    blk->gen    = gen;
+    blk->count  = 0;
+    blk->hits   = 0;
+    blk->native = NULL;
+
+    const uint8_t* code = z->direct(z->userdata, z->pc, false);
+    if (code == NULL) {
+        return;
+    }
+    unsigned avail = Z80_DIRECT_PAGE_SIZE - (z->pc & (Z80_DIRECT_PAGE_SIZE - 1));
+    while (avail > 0 && blk->count < Z80_BLOCK_MAX_OPS) {
+        z80_uop* op = &blk->ops[blk->count];
+        if (!block_decode_op(op, code, avail)) {
+            break;
+        }
+        blk->count++;
+        if (block_ends(code)) {
+            break;
+        }
+        code  += op->len;
+        avail -= op->len;
+    }
+}
+
+#if Z80_BLOCK_CACHE_VERIFY || Z80_JIT_VERIFY
+#define VERIFY_MAX_WRITES 64
+
+// the reference interpreter runs on a copy of the CPU: its memory writes are
+// recorded instead of performed and its I/O accesses are skipped
+typedef struct {
+    z80* cpu;
+    const uint32_t* gen; // write generation of the page being verified, can be NULL
+    uint32_t ref_gen;    // same, as seen by the reference
+    bool io;             // an I/O access was skipped, the result can't be compared
+    int count;
+    uint16_t addr[VERIFY_MAX_WRITES];
+    uint8_t data[VERIFY_MAX_WRITES];
+} block_verify_t;
+
+static uint8_t block_verify_read(void* arg, uint16_t addr)
+{
+    const block_verify_t* verify = (const block_verify_t*) arg;
+    const int count              = verify->count < VERIFY_MAX_WRITES ? verify->count : VERIFY_MAX_WRITES;
+    for (int i = count - 1; i >= 0; i--) {
+        if (verify->addr[i] == addr) {
+            return verify->data[i];
+        }
+    }
+    return verify->cpu->read_byte(verify->cpu->userdata, addr);
+}
+
+static void block_verify_write(void* arg, uint16_t addr, uint8_t data)
+{
+    block_verify_t* verify = (block_verify_t*) arg;
+    const z80* cpu         = verify->cpu;
+    if (verify->count < VERIFY_MAX_WRITES) {
+        verify->addr[verify->count] = addr;
+        verify->data[verify->count] = data;
+    }
+    verify->count++;
+
+    uint32_t phys;
+    if (verify->gen != NULL && cpu->code_page(cpu->userdata, addr, &phys) == verify->gen) {
+        verify->ref_gen++;
+    }
+}
+
+static uint8_t block_verify_in(void* arg, uint16_t port)
+{
+    (void) port;
+    ((block_verify_t*) arg)->io = true;
+    return 0xFF;
+}
+
+static void block_verify_out(void* arg, uint16_t port, uint8_t data)
+{
+    (void) port;
+    (void) data;
+    ((block_verify_t*) arg)->io = true;
+}
+
+// makes `ref` a copy of the CPU that can run without any side effect
+static void block_verify_setup(z80* ref, block_verify_t* verify, z80* const z, const uint32_t* gen)
+{
+    *verify = (block_verify_t) {.cpu = z, .gen = gen, .ref_gen = gen != NULL ? *gen : 0};
+    *ref            = *z;
+    ref->userdata   = verify;
+    ref->read_byte  = block_verify_read;
+    ref->write_byte = block_verify_write;
+    ref->port_in    = block_verify_in;
+    ref->port_out   = block_verify_out;
+    ref->breakpoint = NULL;
+    ref->direct     = NULL;
+}
+
+// returns false if the CPU state differs from the reference one
+static bool block_verify_same(z80* const z, z80* ref, const block_verify_t* verify)
+{
+    // the reference doesn't call the breakpoint hook nor the devices
+    if (verify->io || verify->count > VERIFY_MAX_WRITES || z->exit_requested) {
+        return true;
+    }
+    bool same = ref->cyc == z->cyc && ref->pc == z->pc && ref->sp == z->sp && ref->ix == z->ix && ref->iy == z->iy &&
+                ref->mem_ptr == z->mem_ptr && ref->a == z->a && ref->bc == z->bc && ref->de == z->de &&
+                ref->hl == z->hl && ref->a_ == z->a_ && ref->f_ == z->f_ && ref->bc_ == z->bc_ &&
+                ref->de_ == z->de_ && ref->hl_ == z->hl_ && ref->i == z->i && ref->r == z->r &&
+                z80_get_f(ref) == z80_get_f(z) && ref->iff1 == z->iff1 && ref->iff2 == z->iff2 &&
+                ref->iff_delay == z->iff_delay && ref->interrupt_mode == z->interrupt_mode &&
+                ref->halted == z->halted;
+    for (int i = 0; same && i < verify->count; i++) {
+        same = rb(z, verify->addr[i]) == block_verify_read((void*) verify, verify->addr[i]);
+    }
+    return same;
+}
+#endif
+
+#if Z80_BLOCK_CACHE_VERIFY
+// runs the micro-op and reports any difference with the interpreter
+static void block_verify_op(z80* const z, const z80_uop* op)
+{
+    z80 ref;
+    block_verify_t verify;
+    block_verify_setup(&ref, &verify, z, NULL);
+    exec_opcode_once(&ref, nextb(&ref));
+
+    const uint16_t pc = z->pc;
+    op->exec(z, op);
+    if (!block_verify_same(z, &ref, &verify)) {
+        log_err_printf("[Z80] Block cache mismatch on opcode 0x%02X at PC 0x%04X\n", op->opcode, pc);
+    }
+}
+#endif
+
+static inline void block_run_op(z80* const z, const z80_uop* op)
+{
+#if Z80_BLOCK_CACHE_VERIFY
+    if (op->exec != uop_fallback) {
+        block_verify_op(z, op);
+        return;
+    }
+#endif
+    op->exec(z, op);
+}
+
+// interprets the micro-ops of a block
+static void block_run(z80* const z, const z80_block* blk, const uint32_t* gen)
+{
+    const z80_uop* op        = blk->ops;
+    const z80_uop* const end = op + blk->count;
+    uint16_t next            = z->pc;
+    do {
+        next += op->len;
+        block_run_op(z, op);
+        // stop when the code was modified, PC went elsewhere or the run loop needs to take over
+    } while (++op != end && *gen == blk->gen && z->pc == next && chain_next(z));
+}
+
+// MARK: x86-64 recompiler
+// Hot blocks are translated to native code that calls the micro-op handlers
+// one after the other, with the checks of block_run in between. The simplest
+// micro-ops are emitted inline. After the ones that only work on registers,
+// which can neither modify the code nor raise an interrupt, only the budget
+// and the breakpoint hook are checked. The native code keeps the CPU pointer
+// in rbx, the PC of the block in ebp and the write generation pointer in r12.
+// All the registers stay in the z80 struct, so the interpreter can take over
+// after any instruction.
+#if Z80_JIT
+
+_Static_assert(sizeof(unsigned long) == 8, "the recompiler expects a 64-bit cycle counter");
+
+#define Z80_JIT_THRESHOLD  32
+#define Z80_JIT_ARENA_SIZE (4 * 1024 * 1024)
+// upper bound of the native code size of a block
+#define Z80_JIT_BLOCK_SIZE 4096
+
+#define JIT_EAX 0
+#define JIT_ECX 1
+#define JIT_EBP 5
+
+// x86 condition codes of the exit jumps
+#define JIT_JNE 0x85
+#define JIT_JE  0x84
+#define JIT_JNS 0x89
+#define JIT_JMP 0
+
+typedef struct {
+    uint8_t* p;
+    int exit_count;
+    uint8_t* exits[Z80_BLOCK_MAX_OPS * 3]; // jumps to the epilogue, patched once it is emitted
+} jit_emitter;
+
+#define JIT_EMIT(e, ...) jit_bytes(e, (const uint8_t[]) {__VA_ARGS__}, sizeof((const uint8_t[]) {__VA_ARGS__}))
+
+static inline void jit_bytes(jit_emitter* e, const uint8_t* bytes, size_t size)
+{
+    memcpy(e->p, bytes, size);
+    e->p += size;
+}
+
+static inline void jit_u16(jit_emitter* e, uint16_t val)
+{
+    memcpy(e->p, &val, sizeof(val));
+    e->p += sizeof(val);
+}
+
+static inline void jit_u32(jit_emitter* e, uint32_t val)
+{
+    memcpy(e->p, &val, sizeof(val));
+    e->p += sizeof(val);
+}
+
+static inline void jit_u64(jit_emitter* e, uint64_t val)
+{
+    memcpy(e->p, &val, sizeof(val));
+    e->p += sizeof(val);
+}
+
+// ModRM byte and displacement of a [rbx + offset] operand
+static inline void jit_field(jit_emitter* e, uint8_t reg, size_t offset)
+{
+    JIT_EMIT(e, 0x80 | (reg << 3) | 3);
+    jit_u32(e, offset);
+}
+
+// jump to the epilogue, conditional unless `cc` is JIT_JMP
+static inline void jit_exit(jit_emitter* e, uint8_t cc)
+{
+    if (cc == JIT_JMP) {
+        JIT_EMIT(e, 0xE9);
+    } else {
+        JIT_EMIT(e, 0x0F, cc);
+    }
+    e->exits[e->exit_count++] = e->p;
+    jit_u32(e, 0);
+}
+
+// calls fn(z, arg)
+static void jit_call(jit_emitter* e, uintptr_t fn, uintptr_t arg)
+{
+    JIT_EMIT(e, 0x48, 0x89, 0xDF); // mov rdi, rbx
+    JIT_EMIT(e, 0x48, 0xBE);       // mov rsi, arg
+    jit_u64(e, arg);
+    JIT_EMIT(e, 0x48, 0xB8);       // mov rax, fn
+    jit_u64(e, fn);
+    JIT_EMIT(e, 0xFF, 0xD0);       // call rax
+}
+
+// native version of uop_fetch
+static void jit_fetch(jit_emitter* e, const z80_uop* op, bool advance_pc)
+{
+    JIT_EMIT(e, 0x48, 0x83); // add qword [cyc], cycles
+    jit_field(e, 0, offsetof(z80, cyc));
+    JIT_EMIT(e, cyc_00[op->opcode]);
+    JIT_EMIT(e, 0x0F, 0xB6); // movzx eax, byte [r]
+    jit_field(e, JIT_EAX, offsetof(z80, r));
+    JIT_EMIT(e, 0x8D, 0x48, 0x01, // lea ecx, [rax + 1]
+             0x83, 0xE1, 0x7F,    // and ecx, 0x7f
+             0x25, 0x80, 0, 0, 0, // and eax, 0x80
+             0x09, 0xC8,          // or eax, ecx
+             0x88);               // mov byte [r], al
+    jit_field(e, JIT_EAX, offsetof(z80, r));
+    if (advance_pc) {
+        JIT_EMIT(e, 0x66, 0x83); // add word [pc], len
+        jit_field(e, 0, offsetof(z80, pc));
+        JIT_EMIT(e, op->len);
+    }
+}
+
+// emits the micro-op inline if it only works on registers, returns false otherwise
+static bool jit_inline(jit_emitter* e, const z80_uop* op, bool last)
+{
+    if (op->exec == uop_nop) {
+        jit_fetch(e, op, true);
+    } else if (op->exec == uop_ld_r_r) {
+        jit_fetch(e, op, true);
+        JIT_EMIT(e, 0x0F, 0xB6); // movzx eax, byte [src]
+        jit_field(e, JIT_EAX, op->src);
+        JIT_EMIT(e, 0x88); // mov byte [dst], al
+        jit_field(e, JIT_EAX, op->dst);
+    } else if (op->exec == uop_ld_r_n) {
+        jit_fetch(e, op, true);
+        JIT_EMIT(e, 0xC6); // mov byte [dst], imm
+        jit_field(e, 0, op->dst);
+        JIT_EMIT(e, op->imm);
+    } else if (op->exec == uop_ld_rr_nn) {
+        jit_fetch(e, op, true);
+        JIT_EMIT(e, 0x66, 0xC7); // mov word [dst], imm
+        jit_field(e, 0, op->dst);
+        jit_u16(e, op->imm);
+    } else if (op->exec == uop_inc_rr || op->exec == uop_dec_rr) {
+        jit_fetch(e, op, true);
+        JIT_EMIT(e, 0x66, 0x83); // add/sub word [dst], 1
+        jit_field(e, op->exec == uop_inc_rr ? 0 : 5, op->dst);
+        JIT_EMIT(e, 1);
+    } else if (op->exec == uop_ex_de_hl) {
+        jit_fetch(e, op, true);
+        JIT_EMIT(e, 0x0F, 0xB7); // movzx eax, word [de]
+        jit_field(e, JIT_EAX, offsetof(z80, de));
+        JIT_EMIT(e, 0x0F, 0xB7); // movzx ecx, word [hl]
+        jit_field(e, JIT_ECX, offsetof(z80, hl));
+        JIT_EMIT(e, 0x66, 0x89); // mov word [de], cx
+        jit_field(e, JIT_ECX, offsetof(z80, de));
+        JIT_EMIT(e, 0x66, 0x89); // mov word [hl], ax
+        jit_field(e, JIT_EAX, offsetof(z80, hl));
+    } else if (op->exec == uop_jr && last && (int8_t) op->imm >= 0) {
+        // backward jumps are left to uop_jr, they may close a polling loop
+        jit_fetch(e, op, false);
+        JIT_EMIT(e, 0x0F, 0xB7); // movzx eax, word [pc]
+        jit_field(e, JIT_EAX, offsetof(z80, pc));
+        JIT_EMIT(e, 0x05); // add eax, len + displacement
+        jit_u32(e, (uint32_t) (op->len + (int8_t) op->imm));
+        JIT_EMIT(e, 0x66, 0x89); // mov word [pc], ax
+        jit_field(e, JIT_EAX, offsetof(z80, pc));
+        JIT_EMIT(e, 0x66, 0x89); // mov word [mem_ptr], ax
+        jit_field(e, JIT_EAX, offsetof(z80, mem_ptr));
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool jit_chain_next(z80* const z)
+{
+    return chain_next(z);
+}
+
+// leaves the block if chain_next returns false
+static void jit_chain_check(jit_emitter* e)
+{
+    jit_call(e, (uintptr_t) jit_chain_next, 0);
+    JIT_EMIT(e, 0x84, 0xC0); // test al, al
+    jit_exit(e, JIT_JE);
+}
+
+// leaves the block if PC is not `next` bytes after its first instruction
+static void jit_pc_check(jit_emitter* e, uint32_t next)
+{
+    JIT_EMIT(e, 0x0F, 0xB7); // movzx eax, word [pc]
+    jit_field(e, JIT_EAX, offsetof(z80, pc));
+    JIT_EMIT(e, 0x8D, 0x8D); // lea ecx, [rbp + next]
+    jit_u32(e, next);
+    JIT_EMIT(e, 0x66, 0x39, 0xC8); // cmp ax, cx
+    jit_exit(e, JIT_JNE);
+}
+
+// leaves the block if the budget of z80_run is consumed
+static void jit_budget_check(jit_emitter* e)
+{
+    JIT_EMIT(e, 0x48, 0x8B); // mov rax, [cyc]
+    jit_field(e, JIT_EAX, offsetof(z80, cyc));
+    JIT_EMIT(e, 0x48, 0x2B); // sub rax, [run_until]
+    jit_field(e, JIT_EAX, offsetof(z80, run_until));
+    jit_exit(e, JIT_JNS);
+}
+
+// calls the breakpoint hook if any, the block is left when it returns true
+static void jit_breakpoint_check(jit_emitter* e)
+{
+    JIT_EMIT(e, 0x48, 0x83); // cmp qword [breakpoint], 0
+    jit_field(e, 7, offsetof(z80, breakpoint));
+    JIT_EMIT(e, 0, 0x74, 0); // je skip
+    uint8_t* skip = e->p;
+    JIT_EMIT(e, 0x48, 0x8B); // mov rdi, [userdata]
+    jit_field(e, 7, offsetof(z80, userdata));
+    JIT_EMIT(e, 0x0F, 0xB7); // movzx esi, word [pc]
+    jit_field(e, 6, offsetof(z80, pc));
+    JIT_EMIT(e, 0xFF); // call [breakpoint]
+    jit_field(e, 2, offsetof(z80, breakpoint));
+    JIT_EMIT(e, 0x84, 0xC0, // test al, al
+             0x74, 0);      // je skip
+    uint8_t* cont = e->p;
+    JIT_EMIT(e, 0xC6); // mov byte [exit_requested], 1
+    jit_field(e, 0, offsetof(z80, exit_requested));
+    JIT_EMIT(e, 1);
+    jit_exit(e, JIT_JMP);
+    cont[-1] = (uint8_t) (e->p - cont);
+    skip[-1] = (uint8_t) (e->p - skip);
+}
+
+// micro-ops that don't access the memory nor the I/O ports: they can't modify
+// the code, raise an interrupt or request an exit
+static bool jit_register_only(const z80_uop* op)
+{
+    for (int i = 0; i < 8; i++) {
+        if (op->exec == uop_alu_r[i] || op->exec == uop_alu_n[i]) {
+            return true;
+        }
+    }
+    return op->exec == uop_nop || op->exec == uop_ld_r_r || op->exec == uop_ld_r_n || op->exec == uop_ld_rr_nn ||
+           op->exec == uop_inc_r || op->exec == uop_dec_r || op->exec == uop_inc_rr || op->exec == uop_dec_rr ||
+           op->exec == uop_add_hl_rr || op->exec == uop_ex_de_hl || op->exec == uop_jr || op->exec == uop_jr_cc ||
+           op->exec == uop_djnz || op->exec == uop_jp || op->exec == uop_jp_cc;
+}
+
+// translates the block into native code
+static void jit_emit_block(jit_emitter* e, const z80_block* blk)
+{
+    JIT_EMIT(e, 0x53,                   // push rbx
+             0x55,                      // push rbp
+             0x41, 0x54,                // push r12
+             0x48, 0x89, 0xFB,          // mov rbx, rdi
+             0x49, 0x89, 0xF4,          // mov r12, rsi
+             0x0F, 0xB7);               // movzx ebp, word [pc]
+    jit_field(e, JIT_EBP, offsetof(z80, pc));
+
+    uint32_t next = 0;
+    for (int i = 0; i < blk->count; i++) {
+        const z80_uop* op = &blk->ops[i];
+        const bool last   = i == blk->count - 1;
+        next += op->len;
+
+        const bool inlined = jit_inline(e, op, last);
+        if (!inlined) {
+            jit_call(e, (uintptr_t) op->exec, (uintptr_t) op);
+        }
+        if (last) {
+            break;
+        }
+
+        if (jit_register_only(op)) {
+            // the inlined micro-ops never jump when they are not the last one
+            if (!inlined) {
+                jit_pc_check(e, next);
+            }
+            jit_budget_check(e);
+            jit_breakpoint_check(e);
+        } else {
+            JIT_EMIT(e, 0x41, 0x81, 0x3C, 0x24); // cmp dword [r12], gen
+            jit_u32(e, blk->gen);
+            jit_exit(e, JIT_JNE);
+            jit_pc_check(e, next);
+            jit_chain_check(e);
+        }
+    }
+
+    for (int i = 0; i < e->exit_count; i++) {
+        const uint32_t rel = (uint32_t) (e->p - (e->exits[i] + 4));
+        memcpy(e->exits[i], &rel, sizeof(rel));
+    }
+    JIT_EMIT(e, 0x41, 0x5C, // pop r12
+             0x5D,          // pop rbp
+             0x5B,          // pop rbx
+             0xC3);         // ret
+}
+
+// recompiles the block, it stays interpreted if the arena can't be used
+static void jit_compile(z80_block_cache* const cache, z80_block* blk)
+{
+    if (cache->jit_failed) {
+        return;
+    }
+    if (cache->jit_arena == NULL) {
+        void* arena = mmap(NULL, Z80_JIT_ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena == MAP_FAILED) {
+            log_err_printf("[Z80] Could not allocate the recompiler arena, blocks will be interpreted\n");
+            cache->jit_failed = true;
+            return;
+        }
+        cache->jit_arena = arena;
+        cache->jit_used  = 0;
+    } else if (mprotect(cache->jit_arena, Z80_JIT_ARENA_SIZE, PROT_READ | PROT_WRITE) != 0) {
+        log_err_printf("[Z80] Could not write to the recompiler arena, blocks will be interpreted\n");
+        cache->jit_failed = true;
+        return;
+    }
+
+    // the arena is full: start over, the blocks still hot will be recompiled
+    if (cache->jit_used + Z80_JIT_BLOCK_SIZE > Z80_JIT_ARENA_SIZE) {
+        for (int i = 0; i < Z80_CACHE_BLOCKS; i++) {
+            cache->blocks[i].native = NULL;
+            cache->blocks[i].hits   = 0;
+        }
+        cache->jit_used = 0;
+    }
+
+    jit_emitter e = {.p = cache->jit_arena + cache->jit_used};
+    jit_emit_block(&e, blk);
+
+    if (mprotect(cache->jit_arena, Z80_JIT_ARENA_SIZE, PROT_READ | PROT_EXEC) != 0) {
+        log_err_printf("[Z80] Could not execute the recompiler arena, blocks will be interpreted\n");
+        cache->jit_failed = true;
+        return;
+    }
+    blk->native = (void (*)(z80* const, const uint32_t*))(uintptr_t) (cache->jit_arena + cache->jit_used);
+    cache->jit_used = (size_t) (e.p - cache->jit_arena + 15) & ~(size_t) 15;
+}
+
+// runs the native code of the block
+static void jit_run(z80* const z, const z80_block* blk, const uint32_t* gen)
+{
+#if Z80_JIT_VERIFY
+    z80 ref;
+    block_verify_t verify;
+    block_verify_setup(&ref, &verify, z, gen);
+    block_run(&ref, blk, &verify.ref_gen);
+
+    const uint16_t pc = z->pc;
+    blk->native(z, gen);
+    if (!block_verify_same(z, &ref, &verify)) {
+        log_err_printf("[Z80] JIT mismatch in block at PC 0x%04X\n", pc);
+    }
+#else
+    blk->native(z, gen);
+#endif
+}
+
+#endif // Z80_JIT
+
+// runs the cached block at PC, returns false if the instruction there can't be
+// cached and must be interpreted
+static bool block_exec(z80* const z)
+{
+    uint32_t phys;
+    const uint32_t* gen = z->code_page(z->userdata, z->pc, &phys);
+    if (gen == NULL) {
+        return false;
+    }
+
+    z80_block* blk = &z->cache->blocks[(phys ^ (phys >> 14)) & (Z80_CACHE_BLOCKS - 1)];
+    if (blk->phys != phys || blk->gen != *gen) {
+        block_decode(z, blk, phys, *gen);
+    }
+    if (blk->count == 0) {
+        return false;
+    }
+
+#if Z80_JIT
+    if (blk->native == NULL && ++blk->hits == Z80_JIT_THRESHOLD) {
+        jit_compile(z->cache, blk);
+    }
+    // the native code relies on the run loop state checked here
+    if (blk->native != NULL && !chain_blocked(z)) {
+        jit_run(z, blk, gen);
+    } else {
+        block_run(z, blk, gen);
+    }
+#else
+    block_run(z, blk, gen);
+#endif
+
+    process_interrupts(z);
+    return true;
+}
+
+#endif // Z80_BLOCK_CACHE
+
+// MARK: interface
+// initialises a z80 struct. Note that read_byte, write_byte, port_in, port_out
+// and userdata must be manually set by the user afterwards.
+void z80_init(z80* const z)
+{
+    z->read_byte  = NULL;
+    z->write_byte = NULL;
+    z->port_in    = NULL;
+    z->port_out   = NULL;
+    z->userdata   = NULL;
+    z->breakpoint = NULL;
+    z->direct     = NULL;
+    z->cache      = NULL;
+    z->code_page  = NULL;
+    z->idle_read  = NULL;
+
+    z->cyc            = 0;
+    z->run_until      = 0;
+    z->exit_requested = 0;
+    z->chain          = 0;
+    memset(&z->idle, 0, sizeof(z->idle));
+
+    z->pc      = 0;
+    z->sp      = 0xFFFF;
+    z->ix      = 0;
+    z->iy      = 0;
+    z->mem_ptr = 0;
+
+    // af and sp are set to 0xFFFF after reset,
+    // and the other values are undefined (z80-documented)
+    z->a = 0xFF;
+    z->b = 0;
+    z->c = 0;
+    z->d = 0;
+    z->e = 0;
+    z->h = 0;
+    z->l = 0;
+
+    z->a_ = 0;
+    z->b_ = 0;
+    z->c_ = 0;
+    z->d_ = 0;
+    z->e_ = 0;
+    z->h_ = 0;
+    z->l_ = 0;
+    z->f_ = 0;
+
+    z->i = 0;
+    z->r = 0;
+
+    z->sf = 1;
+    z->zf = 1;
+    z->yf = 1;
+    z->hf = 1;
+    z->xf = 1;
+    z->pf = 1;
+    z->nf = 1;
+    z->cf = 1;
+
+    z->lazy_op = LAZY_NONE;
+
+    z->iff_delay      = 0;
+    z->interrupt_mode = 0;
+    z->iff1           = 0;
+    z->iff2           = 0;
+    z->halted         = 0;
+    z->int_pending    = 0;
+    z->nmi_pending    = 0;
+    z->int_data       = 0;
+}
+
+/* Get the size of the next instruction to execute, in bytes */
+int z80_instruction_size(z80* const z)
+{
+    uint8_t opcode = rb(z, z->pc);
+    int size = op_size[opcode];
+
+    if (size != 0) {
+        return size;
+    }
+    /* Opcode is a prefix, we need to read the next byte */
+    uint8_t opcode2 = rb(z, z->pc + 1);
+    if (opcode == 0xFD || opcode == 0xDD) {
+        size = op_fddd_size[opcode2];
+        /* If the size is 0, the instruction is invalid */
+        return (size != 0) ? size : 4;
+    } else if (opcode == 0xED) {
+        size = op_ed_size[opcode2];
+        /* If the size is 0, the instruction is invalid */
+        return (size != 0) ? size : 2;
+    } else {
+        log_err_printf("[Z80] Invalid size for opcode %x\n", opcode);
+    }
+    return 1;
+}
+
+
+static inline void step(z80* const z)
+{
+    if (z->halted) {
+        exec_opcode(z, 0x00);
+    } else {
+        const uint8_t opcode = nextb(z);
+        exec_opcode(z, opcode);
+    }
+
+    process_interrupts(z);
+}
+
+// a halted CPU executes NOPs until an interrupt is accepted. Nothing can raise
+// one during a run while the CPU doesn't access the buses, so all the NOPs up
+// to the end of the run are executed at once.
+static inline void halt_skip(z80* const z)
+{
+    if (z->iff_delay != 0 || z->nmi_pending || (z->int_pending && z->iff1)) {
+        step(z);
+        return;
+    }
+    const unsigned long count = (z->run_until - z->cyc + 3) / 4;
+    z->cyc += count * 4;
+    z->r = (z->r & 0x80) | ((z->r + count) & 0x7f);
+}
+
+// executes the next instruction in memory + handles interrupts
+int z80_step(z80* const z)
+{
+    int cycles = z->cyc;
+    step(z);
+    return z->cyc - cycles;
+}
+
+// executes instructions until `budget` t-states have elapsed, an interrupt
+// is raised, the breakpoint hook returns true or an exit is requested.
+// The budget can be overshot by the length of the last instruction. While the
+// CPU is halted, the breakpoint hook is only called once per run since PC
+// doesn't change.
+// returns the number of t-states actually executed.
+long z80_run(z80* const z, long budget)
+{
+    const unsigned long start = z->cyc;
+    z->run_until      = start + budget;
+    z->exit_requested = 0;
+    z->chain          = 1;
+    z->idle.active    = 1;
+    z->idle.valid     = 0;
+
+    while ((long) (z->cyc - z->run_until) < 0) {
+        if (z->halted) {
+            halt_skip(z);
+        }
+#if Z80_BLOCK_CACHE
+        else if (z->cache == NULL || !block_exec(z)) {
+            step(z);
+        }
+#else
+        else {
+            step(z);
+        }
+#endif
+        if (z->exit_requested) {
+            break;
+        }
+        if (z->breakpoint != NULL && z->breakpoint(z->userdata, z->pc)) {
+            z->exit_requested = 1;
+            break;
+        }
+    }
+
+    z->chain       = 0;
+    z->idle.active = 0;
+    return (long) (z->cyc - start);
+}
+
+// invalidates all the blocks of the cache, must be called before its first use
+void z80_cache_flush(z80_block_cache* const cache)
+{
+    for (int i = 0; i < Z80_CACHE_BLOCKS; i++) {
+        cache->blocks[i].phys   = UINT32_MAX;
+        cache->blocks[i].count  = 0;
+        cache->blocks[i].hits   = 0;
+        cache->blocks[i].native = NULL;
+    }
+    // the recompiler arena is kept and reused
+    cache->jit_used = 0;
+}
+
+// releases the memory the cache allocated, it must be flushed again before its next use
+void z80_cache_release(z80_block_cache* const cache)
+{
+#if Z80_JIT
+    if (cache->jit_arena != NULL) {
+        munmap(cache->jit_arena, Z80_JIT_ARENA_SIZE);
+    }
+#endif
+    cache->jit_arena  = NULL;
+    cache->jit_used   = 0;
+    cache->jit_failed = false;
+}
+
+// ends the current z80_run call after the instruction being executed
+void z80_request_exit(z80* const z)
+{
+    z->exit_requested = 1;
+}
+
+// makes the current z80_run call stop at cycle `until` if it is earlier
+// than its current limit, used when a device schedules an earlier event
+void z80_shorten_run(z80* const z, unsigned long until)
+{
+    if ((long) (until - z->run_until) < 0) {
+        z->run_until = until;
+    }
+}
+
+// outputs to stdout a debug trace of the emulator
+void z80_debug_output(z80* const z)
 {
     log_printf("PC: %04X, AF: %04X, BC: %04X, DE: %04X, HL: %04X, SP: %04X, "
            "IX: %04X, IY: %04X, I: %02X, R: %02X",
@@ -943,298 +2779,350 @@ void z80_get_debug_output(z80* const z, char *s)
 // function to call when an NMI is to be serviced
 void z80_gen_nmi(z80* const z)
 {
-    z->nmi_pending = 1;
+    z->nmi_pending    = 1;
+    z->exit_requested = 1;
 }
 
 // function to call when an INT is to be serviced
 void z80_gen_int(z80* const z, uint8_t data)
 {
-    z->int_pending = 1;
-    z->int_data    = data;
+    z->int_pending    = 1;
+    z->int_data       = data;
+    z->exit_requested = 1;
 }
 
+#if Z80_THREADED_DISPATCH
+// labels as values and computed gotos are GNU extensions, only the handlers below use them
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
 // executes a non-prefixed opcode
 void exec_opcode(z80* const z, uint8_t opcode)
 {
     z->cyc += cyc_00[opcode];
     inc_r(z);
 
+#if Z80_THREADED_DISPATCH
+    static const void* const dispatch_00[256] = {
+        &&op_0x00, &&op_0x01, &&op_0x02, &&op_0x03, &&op_0x04, &&op_0x05, &&op_0x06, &&op_0x07,
+        &&op_0x08, &&op_0x09, &&op_0x0A, &&op_0x0B, &&op_0x0C, &&op_0x0D, &&op_0x0E, &&op_0x0F,
+        &&op_0x10, &&op_0x11, &&op_0x12, &&op_0x13, &&op_0x14, &&op_0x15, &&op_0x16, &&op_0x17,
+        &&op_0x18, &&op_0x19, &&op_0x1A, &&op_0x1B, &&op_0x1C, &&op_0x1D, &&op_0x1E, &&op_0x1F,
+        &&op_0x20, &&op_0x21, &&op_0x22, &&op_0x23, &&op_0x24, &&op_0x25, &&op_0x26, &&op_0x27,
+        &&op_0x28, &&op_0x29, &&op_0x2A, &&op_0x2B, &&op_0x2C, &&op_0x2D, &&op_0x2E, &&op_0x2F,
+        &&op_0x30, &&op_0x31, &&op_0x32, &&op_0x33, &&op_0x34, &&op_0x35, &&op_0x36, &&op_0x37,
+        &&op_0x38, &&op_0x39, &&op_0x3A, &&op_0x3B, &&op_0x3C, &&op_0x3D, &&op_0x3E, &&op_0x3F,
+        &&op_0x40, &&op_0x41, &&op_0x42, &&op_0x43, &&op_0x44, &&op_0x45, &&op_0x46, &&op_0x47,
+        &&op_0x48, &&op_0x49, &&op_0x4A, &&op_0x4B, &&op_0x4C, &&op_0x4D, &&op_0x4E, &&op_0x4F,
+        &&op_0x50, &&op_0x51, &&op_0x52, &&op_0x53, &&op_0x54, &&op_0x55, &&op_0x56, &&op_0x57,
+        &&op_0x58, &&op_0x59, &&op_0x5A, &&op_0x5B, &&op_0x5C, &&op_0x5D, &&op_0x5E, &&op_0x5F,
+        &&op_0x60, &&op_0x61, &&op_0x62, &&op_0x63, &&op_0x64, &&op_0x65, &&op_0x66, &&op_0x67,
+        &&op_0x68, &&op_0x69, &&op_0x6A, &&op_0x6B, &&op_0x6C, &&op_0x6D, &&op_0x6E, &&op_0x6F,
+        &&op_0x70, &&op_0x71, &&op_0x72, &&op_0x73, &&op_0x74, &&op_0x75, &&op_0x76, &&op_0x77,
+        &&op_0x78, &&op_0x79, &&op_0x7A, &&op_0x7B, &&op_0x7C, &&op_0x7D, &&op_0x7E, &&op_0x7F,
+        &&op_0x80, &&op_0x81, &&op_0x82, &&op_0x83, &&op_0x84, &&op_0x85, &&op_0x86, &&op_0x87,
+        &&op_0x88, &&op_0x89, &&op_0x8A, &&op_0x8B, &&op_0x8C, &&op_0x8D, &&op_0x8E, &&op_0x8F,
+        &&op_0x90, &&op_0x91, &&op_0x92, &&op_0x93, &&op_0x94, &&op_0x95, &&op_0x96, &&op_0x97,
+        &&op_0x98, &&op_0x99, &&op_0x9A, &&op_0x9B, &&op_0x9C, &&op_0x9D, &&op_0x9E, &&op_0x9F,
+        &&op_0xA0, &&op_0xA1, &&op_0xA2, &&op_0xA3, &&op_0xA4, &&op_0xA5, &&op_0xA6, &&op_0xA7,
+        &&op_0xA8, &&op_0xA9, &&op_0xAA, &&op_0xAB, &&op_0xAC, &&op_0xAD, &&op_0xAE, &&op_0xAF,
+        &&op_0xB0, &&op_0xB1, &&op_0xB2, &&op_0xB3, &&op_0xB4, &&op_0xB5, &&op_0xB6, &&op_0xB7,
+        &&op_0xB8, &&op_0xB9, &&op_0xBA, &&op_0xBB, &&op_0xBC, &&op_0xBD, &&op_0xBE, &&op_0xBF,
+        &&op_0xC0, &&op_0xC1, &&op_0xC2, &&op_0xC3, &&op_0xC4, &&op_0xC5, &&op_0xC6, &&op_0xC7,
+        &&op_0xC8, &&op_0xC9, &&op_0xCA, &&op_0xCB, &&op_0xCC, &&op_0xCD, &&op_0xCE, &&op_0xCF,
+        &&op_0xD0, &&op_0xD1, &&op_0xD2, &&op_0xD3, &&op_0xD4, &&op_0xD5, &&op_0xD6, &&op_0xD7,
+        &&op_0xD8, &&op_0xD9, &&op_0xDA, &&op_0xDB, &&op_0xDC, &&op_0xDD, &&op_0xDE, &&op_0xDF,
+        &&op_0xE0, &&op_0xE1, &&op_0xE2, &&op_0xE3, &&op_0xE4, &&op_0xE5, &&op_0xE6, &&op_0xE7,
+        &&op_0xE8, &&op_0xE9, &&op_0xEA, &&op_0xEB, &&op_0xEC, &&op_0xED, &&op_0xEE, &&op_0xEF,
+        &&op_0xF0, &&op_0xF1, &&op_0xF2, &&op_0xF3, &&op_0xF4, &&op_0xF5, &&op_0xF6, &&op_0xF7,
+        &&op_0xF8, &&op_0xF9, &&op_0xFA, &&op_0xFB, &&op_0xFC, &&op_0xFD, &&op_0xFE, &&op_0xFF,
+    };
+#endif
+
+    DISPATCH(dispatch_00, opcode);
     switch (opcode) {
-        case 0x7F: z->a = z->a; break; // ld a,a
-        case 0x78: z->a = z->b; break; // ld a,b
-        case 0x79: z->a = z->c; break; // ld a,c
-        case 0x7A: z->a = z->d; break; // ld a,d
-        case 0x7B: z->a = z->e; break; // ld a,e
-        case 0x7C: z->a = z->h; break; // ld a,h
-        case 0x7D: z->a = z->l; break; // ld a,l
-
-        case 0x47: z->b = z->a; break; // ld b,a
-        case 0x40: z->b = z->b; break; // ld b,b
-        case 0x41: z->b = z->c; break; // ld b,c
-        case 0x42: z->b = z->d; break; // ld b,d
-        case 0x43: z->b = z->e; break; // ld b,e
-        case 0x44: z->b = z->h; break; // ld b,h
-        case 0x45: z->b = z->l; break; // ld b,l
-
-        case 0x4F: z->c = z->a; break; // ld c,a
-        case 0x48: z->c = z->b; break; // ld c,b
-        case 0x49: z->c = z->c; break; // ld c,c
-        case 0x4A: z->c = z->d; break; // ld c,d
-        case 0x4B: z->c = z->e; break; // ld c,e
-        case 0x4C: z->c = z->h; break; // ld c,h
-        case 0x4D: z->c = z->l; break; // ld c,l
-
-        case 0x57: z->d = z->a; break; // ld d,a
-        case 0x50: z->d = z->b; break; // ld d,b
-        case 0x51: z->d = z->c; break; // ld d,c
-        case 0x52: z->d = z->d; break; // ld d,d
-        case 0x53: z->d = z->e; break; // ld d,e
-        case 0x54: z->d = z->h; break; // ld d,h
-        case 0x55: z->d = z->l; break; // ld d,l
-
-        case 0x5F: z->e = z->a; break; // ld e,a
-        case 0x58: z->e = z->b; break; // ld e,b
-        case 0x59: z->e = z->c; break; // ld e,c
-        case 0x5A: z->e = z->d; break; // ld e,d
-        case 0x5B: z->e = z->e; break; // ld e,e
-        case 0x5C: z->e = z->h; break; // ld e,h
-        case 0x5D: z->e = z->l; break; // ld e,l
-
-        case 0x67: z->h = z->a; break; // ld h,a
-        case 0x60: z->h = z->b; break; // ld h,b
-        case 0x61: z->h = z->c; break; // ld h,c
-        case 0x62: z->h = z->d; break; // ld h,d
-        case 0x63: z->h = z->e; break; // ld h,e
-        case 0x64: z->h = z->h; break; // ld h,h
-        case 0x65: z->h = z->l; break; // ld h,l
-
-        case 0x6F: z->l = z->a; break; // ld l,a
-        case 0x68: z->l = z->b; break; // ld l,b
-        case 0x69: z->l = z->c; break; // ld l,c
-        case 0x6A: z->l = z->d; break; // ld l,d
-        case 0x6B: z->l = z->e; break; // ld l,e
-        case 0x6C: z->l = z->h; break; // ld l,h
-        case 0x6D: z->l = z->l; break; // ld l,l
-
-        case 0x7E: z->a = rb(z, get_hl(z)); break; // ld a,(hl)
-        case 0x46: z->b = rb(z, get_hl(z)); break; // ld b,(hl)
-        case 0x4E: z->c = rb(z, get_hl(z)); break; // ld c,(hl)
-        case 0x56: z->d = rb(z, get_hl(z)); break; // ld d,(hl)
-        case 0x5E: z->e = rb(z, get_hl(z)); break; // ld e,(hl)
-        case 0x66: z->h = rb(z, get_hl(z)); break; // ld h,(hl)
-        case 0x6E: z->l = rb(z, get_hl(z)); break; // ld l,(hl)
-
-        case 0x77: wb(z, get_hl(z), z->a); break; // ld (hl),a
-        case 0x70: wb(z, get_hl(z), z->b); break; // ld (hl),b
-        case 0x71: wb(z, get_hl(z), z->c); break; // ld (hl),c
-        case 0x72: wb(z, get_hl(z), z->d); break; // ld (hl),d
-        case 0x73: wb(z, get_hl(z), z->e); break; // ld (hl),e
-        case 0x74: wb(z, get_hl(z), z->h); break; // ld (hl),h
-        case 0x75: wb(z, get_hl(z), z->l); break; // ld (hl),l
-
-        case 0x3E: z->a = nextb(z); break;            // ld a,*
-        case 0x06: z->b = nextb(z); break;            // ld b,*
-        case 0x0E: z->c = nextb(z); break;            // ld c,*
-        case 0x16: z->d = nextb(z); break;            // ld d,*
-        case 0x1E: z->e = nextb(z); break;            // ld e,*
-        case 0x26: z->h = nextb(z); break;            // ld h,*
-        case 0x2E: z->l = nextb(z); break;            // ld l,*
-        case 0x36: wb(z, get_hl(z), nextb(z)); break; // ld (hl),*
-
-        case 0x0A:
+        OP(0x7F) z->a = z->a; NEXT; // ld a,a
+        OP(0x78) z->a = z->b; NEXT; // ld a,b
+        OP(0x79) z->a = z->c; NEXT; // ld a,c
+        OP(0x7A) z->a = z->d; NEXT; // ld a,d
+        OP(0x7B) z->a = z->e; NEXT; // ld a,e
+        OP(0x7C) z->a = z->h; NEXT; // ld a,h
+        OP(0x7D) z->a = z->l; NEXT; // ld a,l
+
+        OP(0x47) z->b = z->a; NEXT; // ld b,a
+        OP(0x40) z->b = z->b; NEXT; // ld b,b
+        OP(0x41) z->b = z->c; NEXT; // ld b,c
+        OP(0x42) z->b = z->d; NEXT; // ld b,d
+        OP(0x43) z->b = z->e; NEXT; // ld b,e
+        OP(0x44) z->b = z->h; NEXT; // ld b,h
+        OP(0x45) z->b = z->l; NEXT; // ld b,l
+
+        OP(0x4F) z->c = z->a; NEXT; // ld c,a
+        OP(0x48) z->c = z->b; NEXT; // ld c,b
+        OP(0x49) z->c = z->c; NEXT; // ld c,c
+        OP(0x4A) z->c = z->d; NEXT; // ld c,d
+        OP(0x4B) z->c = z->e; NEXT; // ld c,e
+        OP(0x4C) z->c = z->h; NEXT; // ld c,h
+        OP(0x4D) z->c = z->l; NEXT; // ld c,l
+
+        OP(0x57) z->d = z->a; NEXT; // ld d,a
+        OP(0x50) z->d = z->b; NEXT; // ld d,b
+        OP(0x51) z->d = z->c; NEXT; // ld d,c
+        OP(0x52) z->d = z->d; NEXT; // ld d,d
+        OP(0x53) z->d = z->e; NEXT; // ld d,e
+        OP(0x54) z->d = z->h; NEXT; // ld d,h
+        OP(0x55) z->d = z->l; NEXT; // ld d,l
+
+        OP(0x5F) z->e = z->a; NEXT; // ld e,a
+        OP(0x58) z->e = z->b; NEXT; // ld e,b
+        OP(0x59) z->e = z->c; NEXT; // ld e,c
+        OP(0x5A) z->e = z->d; NEXT; // ld e,d
+        OP(0x5B) z->e = z->e; NEXT; // ld e,e
+        OP(0x5C) z->e = z->h; NEXT; // ld e,h
+        OP(0x5D) z->e = z->l; NEXT; // ld e,l
+
+        OP(0x67) z->h = z->a; NEXT; // ld h,a
+        OP(0x60) z->h = z->b; NEXT; // ld h,b
+        OP(0x61) z->h = z->c; NEXT; // ld h,c
+        OP(0x62) z->h = z->d; NEXT; // ld h,d
+        OP(0x63) z->h = z->e; NEXT; // ld h,e
+        OP(0x64) z->h = z->h; NEXT; // ld h,h
+        OP(0x65) z->h = z->l; NEXT; // ld h,l
+
+        OP(0x6F) z->l = z->a; NEXT; // ld l,a
+        OP(0x68) z->l = z->b; NEXT; // ld l,b
+        OP(0x69) z->l = z->c; NEXT; // ld l,c
+        OP(0x6A) z->l = z->d; NEXT; // ld l,d
+        OP(0x6B) z->l = z->e; NEXT; // ld l,e
+        OP(0x6C) z->l = z->h; NEXT; // ld l,h
+        OP(0x6D) z->l = z->l; NEXT; // ld l,l
+
+        OP(0x7E) z->a = rb(z, get_hl(z)); NEXT; // ld a,(hl)
+        OP(0x46) z->b = rb(z, get_hl(z)); NEXT; // ld b,(hl)
+        OP(0x4E) z->c = rb(z, get_hl(z)); NEXT; // ld c,(hl)
+        OP(0x56) z->d = rb(z, get_hl(z)); NEXT; // ld d,(hl)
+        OP(0x5E) z->e = rb(z, get_hl(z)); NEXT; // ld e,(hl)
+        OP(0x66) z->h = rb(z, get_hl(z)); NEXT; // ld h,(hl)
+        OP(0x6E) z->l = rb(z, get_hl(z)); NEXT; // ld l,(hl)
+
+        OP(0x77) wb(z, get_hl(z), z->a); NEXT; // ld (hl),a
+        OP(0x70) wb(z, get_hl(z), z->b); NEXT; // ld (hl),b
+        OP(0x71) wb(z, get_hl(z), z->c); NEXT; // ld (hl),c
+        OP(0x72) wb(z, get_hl(z), z->d); NEXT; // ld (hl),d
+        OP(0x73) wb(z, get_hl(z), z->e); NEXT; // ld (hl),e
+        OP(0x74) wb(z, get_hl(z), z->h); NEXT; // ld (hl),h
+        OP(0x75) wb(z, get_hl(z), z->l); NEXT; // ld (hl),l
+
+        OP(0x3E) z->a = nextb(z); NEXT;            // ld a,*
+        OP(0x06) z->b = nextb(z); NEXT;            // ld b,*
+        OP(0x0E) z->c = nextb(z); NEXT;            // ld c,*
+        OP(0x16) z->d = nextb(z); NEXT;            // ld d,*
+        OP(0x1E) z->e = nextb(z); NEXT;            // ld e,*
+        OP(0x26) z->h = nextb(z); NEXT;            // ld h,*
+        OP(0x2E) z->l = nextb(z); NEXT;            // ld l,*
+        OP(0x36) wb(z, get_hl(z), nextb(z)); NEXT; // ld (hl),*
+
+        OP(0x0A)
             z->a       = rb(z, get_bc(z));
             z->mem_ptr = get_bc(z) + 1;
-            break; // ld a,(bc)
-        case 0x1A:
+            NEXT; // ld a,(bc)
+        OP(0x1A)
             z->a       = rb(z, get_de(z));
             z->mem_ptr = get_de(z) + 1;
-            break; // ld a,(de)
-        case 0x3A: {
+            NEXT; // ld a,(de)
+        OP(0x3A) {
             const uint16_t addr = nextw(z);
             z->a                = rb(z, addr);
             z->mem_ptr          = addr + 1;
-        } break; // ld a,(**)
+        } NEXT; // ld a,(**)
 
-        case 0x02:
+        OP(0x02)
             wb(z, get_bc(z), z->a);
             z->mem_ptr = (z->a << 8) | ((get_bc(z) + 1) & 0xFF);
-            break; // ld (bc),a
+            NEXT; // ld (bc),a
 
-        case 0x12:
+        OP(0x12)
             wb(z, get_de(z), z->a);
             z->mem_ptr = (z->a << 8) | ((get_de(z) + 1) & 0xFF);
-            break; // ld (de),a
+            NEXT; // ld (de),a
 
-        case 0x32: {
+        OP(0x32) {
             const uint16_t addr = nextw(z);
             wb(z, addr, z->a);
             z->mem_ptr = (z->a << 8) | ((addr + 1) & 0xFF);
-        } break; // ld (**),a
+        } NEXT; // ld (**),a
 
-        case 0x01: set_bc(z, nextw(z)); break; // ld bc,**
-        case 0x11: set_de(z, nextw(z)); break; // ld de,**
-        case 0x21: set_hl(z, nextw(z)); break; // ld hl,**
-        case 0x31: z->sp = nextw(z); break;    // ld sp,**
+        OP(0x01) set_bc(z, nextw(z)); NEXT; // ld bc,**
+        OP(0x11) set_de(z, nextw(z)); NEXT; // ld de,**
+        OP(0x21) set_hl(z, nextw(z)); NEXT; // ld hl,**
+        OP(0x31) z->sp = nextw(z); NEXT;    // ld sp,**
 
-        case 0x2A: {
+        OP(0x2A) {
             const uint16_t addr = nextw(z);
             set_hl(z, rw(z, addr));
             z->mem_ptr = addr + 1;
-        } break; // ld hl,(**)
+        } NEXT; // ld hl,(**)
 
-        case 0x22: {
+        OP(0x22) {
             const uint16_t addr = nextw(z);
             ww(z, addr, get_hl(z));
             z->mem_ptr = addr + 1;
-        } break; // ld (**),hl
+        } NEXT; // ld (**),hl
 
-        case 0xF9: z->sp = get_hl(z); break; // ld sp,hl
+        OP(0xF9) z->sp = get_hl(z); NEXT; // ld sp,hl
 
-        case 0xEB: {
+        OP(0xEB) {
             const uint16_t de = get_de(z);
             set_de(z, get_hl(z));
             set_hl(z, de);
-        } break; // ex de,hl
+        } NEXT; // ex de,hl
 
-        case 0xE3: {
+        OP(0xE3) {
             const uint16_t val = rw(z, z->sp);
             ww(z, z->sp, get_hl(z));
             set_hl(z, val);
             z->mem_ptr = val;
-        } break; // ex (sp),hl
-
-        case 0x87: z->a = addb(z, z->a, z->a, 0); break;             // add a,a
-        case 0x80: z->a = addb(z, z->a, z->b, 0); break;             // add a,b
-        case 0x81: z->a = addb(z, z->a, z->c, 0); break;             // add a,c
-        case 0x82: z->a = addb(z, z->a, z->d, 0); break;             // add a,d
-        case 0x83: z->a = addb(z, z->a, z->e, 0); break;             // add a,e
-        case 0x84: z->a = addb(z, z->a, z->h, 0); break;             // add a,h
-        case 0x85: z->a = addb(z, z->a, z->l, 0); break;             // add a,l
-        case 0x86: z->a = addb(z, z->a, rb(z, get_hl(z)), 0); break; // add a,(hl)
-        case 0xC6: z->a = addb(z, z->a, nextb(z), 0); break;         // add a,*
-
-        case 0x8F: z->a = addb(z, z->a, z->a, z->cf); break;             // adc a,a
-        case 0x88: z->a = addb(z, z->a, z->b, z->cf); break;             // adc a,b
-        case 0x89: z->a = addb(z, z->a, z->c, z->cf); break;             // adc a,c
-        case 0x8A: z->a = addb(z, z->a, z->d, z->cf); break;             // adc a,d
-        case 0x8B: z->a = addb(z, z->a, z->e, z->cf); break;             // adc a,e
-        case 0x8C: z->a = addb(z, z->a, z->h, z->cf); break;             // adc a,h
-        case 0x8D: z->a = addb(z, z->a, z->l, z->cf); break;             // adc a,l
-        case 0x8E: z->a = addb(z, z->a, rb(z, get_hl(z)), z->cf); break; // adc a,(hl)
-        case 0xCE: z->a = addb(z, z->a, nextb(z), z->cf); break;         // adc a,*
-
-        case 0x97: z->a = subb(z, z->a, z->a, 0); break;             // sub a,a
-        case 0x90: z->a = subb(z, z->a, z->b, 0); break;             // sub a,b
-        case 0x91: z->a = subb(z, z->a, z->c, 0); break;             // sub a,c
-        case 0x92: z->a = subb(z, z->a, z->d, 0); break;             // sub a,d
-        case 0x93: z->a = subb(z, z->a, z->e, 0); break;             // sub a,e
-        case 0x94: z->a = subb(z, z->a, z->h, 0); break;             // sub a,h
-        case 0x95: z->a = subb(z, z->a, z->l, 0); break;             // sub a,l
-        case 0x96: z->a = subb(z, z->a, rb(z, get_hl(z)), 0); break; // sub a,(hl)
-        case 0xD6: z->a = subb(z, z->a, nextb(z), 0); break;         // sub a,*
-
-        case 0x9F: z->a = subb(z, z->a, z->a, z->cf); break;             // sbc a,a
-        case 0x98: z->a = subb(z, z->a, z->b, z->cf); break;             // sbc a,b
-        case 0x99: z->a = subb(z, z->a, z->c, z->cf); break;             // sbc a,c
-        case 0x9A: z->a = subb(z, z->a, z->d, z->cf); break;             // sbc a,d
-        case 0x9B: z->a = subb(z, z->a, z->e, z->cf); break;             // sbc a,e
-        case 0x9C: z->a = subb(z, z->a, z->h, z->cf); break;             // sbc a,h
-        case 0x9D: z->a = subb(z, z->a, z->l, z->cf); break;             // sbc a,l
-        case 0x9E: z->a = subb(z, z->a, rb(z, get_hl(z)), z->cf); break; // sbc a,(hl)
-        case 0xDE: z->a = subb(z, z->a, nextb(z), z->cf); break;         // sbc a,*
-
-        case 0x09: addhl(z, get_bc(z)); break; // add hl,bc
-        case 0x19: addhl(z, get_de(z)); break; // add hl,de
-        case 0x29: addhl(z, get_hl(z)); break; // add hl,hl
-        case 0x39: addhl(z, z->sp); break;     // add hl,sp
-
-        case 0xF3:
+        } NEXT; // ex (sp),hl
+
+        OP(0x87) z->a = addb(z, z->a, z->a, 0); NEXT;             // add a,a
+        OP(0x80) z->a = addb(z, z->a, z->b, 0); NEXT;             // add a,b
+        OP(0x81) z->a = addb(z, z->a, z->c, 0); NEXT;             // add a,c
+        OP(0x82) z->a = addb(z, z->a, z->d, 0); NEXT;             // add a,d
+        OP(0x83) z->a = addb(z, z->a, z->e, 0); NEXT;             // add a,e
+        OP(0x84) z->a = addb(z, z->a, z->h, 0); NEXT;             // add a,h
+        OP(0x85) z->a = addb(z, z->a, z->l, 0); NEXT;             // add a,l
+        OP(0x86) z->a = addb(z, z->a, rb(z, get_hl(z)), 0); NEXT; // add a,(hl)
+        OP(0xC6) z->a = addb(z, z->a, nextb(z), 0); NEXT;         // add a,*
+
+        OP(0x8F) z->a = addb(z, z->a, z->a, get_cf(z)); NEXT;             // adc a,a
+        OP(0x88) z->a = addb(z, z->a, z->b, get_cf(z)); NEXT;             // adc a,b
+        OP(0x89) z->a = addb(z, z->a, z->c, get_cf(z)); NEXT;             // adc a,c
+        OP(0x8A) z->a = addb(z, z->a, z->d, get_cf(z)); NEXT;             // adc a,d
+        OP(0x8B) z->a = addb(z, z->a, z->e, get_cf(z)); NEXT;             // adc a,e
+        OP(0x8C) z->a = addb(z, z->a, z->h, get_cf(z)); NEXT;             // adc a,h
+        OP(0x8D) z->a = addb(z, z->a, z->l, get_cf(z)); NEXT;             // adc a,l
+        OP(0x8E) z->a = addb(z, z->a, rb(z, get_hl(z)), get_cf(z)); NEXT; // adc a,(hl)
+        OP(0xCE) z->a = addb(z, z->a, nextb(z), get_cf(z)); NEXT;         // adc a,*
+
+        OP(0x97) z->a = subb(z, z->a, z->a, 0); NEXT;             // sub a,a
+        OP(0x90) z->a = subb(z, z->a, z->b, 0); NEXT;             // sub a,b
+        OP(0x91) z->a = subb(z, z->a, z->c, 0); NEXT;             // sub a,c
+        OP(0x92) z->a = subb(z, z->a, z->d, 0); NEXT;             // sub a,d
+        OP(0x93) z->a = subb(z, z->a, z->e, 0); NEXT;             // sub a,e
+        OP(0x94) z->a = subb(z, z->a, z->h, 0); NEXT;             // sub a,h
+        OP(0x95) z->a = subb(z, z->a, z->l, 0); NEXT;             // sub a,l
+        OP(0x96) z->a = subb(z, z->a, rb(z, get_hl(z)), 0); NEXT; // sub a,(hl)
+        OP(0xD6) z->a = subb(z, z->a, nextb(z), 0); NEXT;         // sub a,*
+
+        OP(0x9F) z->a = subb(z, z->a, z->a, get_cf(z)); NEXT;             // sbc a,a
+        OP(0x98) z->a = subb(z, z->a, z->b, get_cf(z)); NEXT;             // sbc a,b
+        OP(0x99) z->a = subb(z, z->a, z->c, get_cf(z)); NEXT;             // sbc a,c
+        OP(0x9A) z->a = subb(z, z->a, z->d, get_cf(z)); NEXT;             // sbc a,d
+        OP(0x9B) z->a = subb(z, z->a, z->e, get_cf(z)); NEXT;             // sbc a,e
+        OP(0x9C) z->a = subb(z, z->a, z->h, get_cf(z)); NEXT;             // sbc a,h
+        OP(0x9D) z->a = subb(z, z->a, z->l, get_cf(z)); NEXT;             // sbc a,l
+        OP(0x9E) z->a = subb(z, z->a, rb(z, get_hl(z)), get_cf(z)); NEXT; // sbc a,(hl)
+        OP(0xDE) z->a = subb(z, z->a, nextb(z), get_cf(z)); NEXT;         // sbc a,*
+
+        OP(0x09) addhl(z, get_bc(z)); NEXT; // add hl,bc
+        OP(0x19) addhl(z, get_de(z)); NEXT; // add hl,de
+        OP(0x29) addhl(z, get_hl(z)); NEXT; // add hl,hl
+        OP(0x39) addhl(z, z->sp); NEXT;     // add hl,sp
+
+        OP(0xF3)
             z->iff1 = 0;
             z->iff2 = 0;
-            break;                          // di
-        case 0xFB: z->iff_delay = 1; break; // ei
-        case 0x00: break;                   // nop
-        case 0x76: z->halted = 1; break;    // halt
-
-        case 0x3C: z->a = inc(z, z->a); break; // inc a
-        case 0x04: z->b = inc(z, z->b); break; // inc b
-        case 0x0C: z->c = inc(z, z->c); break; // inc c
-        case 0x14: z->d = inc(z, z->d); break; // inc d
-        case 0x1C: z->e = inc(z, z->e); break; // inc e
-        case 0x24: z->h = inc(z, z->h); break; // inc h
-        case 0x2C: z->l = inc(z, z->l); break; // inc l
-        case 0x34: {
+            NEXT;                          // di
+        OP(0xFB) z->iff_delay = 1; NEXT; // ei
+        OP(0x00) NEXT;                   // nop
+        OP(0x76) z->halted = 1; NEXT;    // halt
+
+        OP(0x3C) z->a = inc(z, z->a); NEXT; // inc a
+        OP(0x04) z->b = inc(z, z->b); NEXT; // inc b
+        OP(0x0C) z->c = inc(z, z->c); NEXT; // inc c
+        OP(0x14) z->d = inc(z, z->d); NEXT; // inc d
+        OP(0x1C) z->e = inc(z, z->e); NEXT; // inc e
+        OP(0x24) z->h = inc(z, z->h); NEXT; // inc h
+        OP(0x2C) z->l = inc(z, z->l); NEXT; // inc l
+        OP(0x34) {
             uint8_t result = inc(z, rb(z, get_hl(z)));
             wb(z, get_hl(z), result);
-        } break; // inc (hl)
-
-        case 0x3D: z->a = dec(z, z->a); break; // dec a
-        case 0x05: z->b = dec(z, z->b); break; // dec b
-        case 0x0D: z->c = dec(z, z->c); break; // dec c
-        case 0x15: z->d = dec(z, z->d); break; // dec d
-        case 0x1D: z->e = dec(z, z->e); break; // dec e
-        case 0x25: z->h = dec(z, z->h); break; // dec h
-        case 0x2D: z->l = dec(z, z->l); break; // dec l
-        case 0x35: {
+        } NEXT; // inc (hl)
+
+        OP(0x3D) z->a = dec(z, z->a); NEXT; // dec a
+        OP(0x05) z->b = dec(z, z->b); NEXT; // dec b
+        OP(0x0D) z->c = dec(z, z->c); NEXT; // dec c
+        OP(0x15) z->d = dec(z, z->d); NEXT; // dec d
+        OP(0x1D) z->e = dec(z, z->e); NEXT; // dec e
+        OP(0x25) z->h = dec(z, z->h); NEXT; // dec h
+        OP(0x2D) z->l = dec(z, z->l); NEXT; // dec l
+        OP(0x35) {
             uint8_t result = dec(z, rb(z, get_hl(z)));
             wb(z, get_hl(z), result);
-        } break; // dec (hl)
+        } NEXT; // dec (hl)
 
-        case 0x03: set_bc(z, get_bc(z) + 1); break; // inc bc
-        case 0x13: set_de(z, get_de(z) + 1); break; // inc de
-        case 0x23: set_hl(z, get_hl(z) + 1); break; // inc hl
-        case 0x33: z->sp = z->sp + 1; break;        // inc sp
+        OP(0x03) set_bc(z, get_bc(z) + 1); NEXT; // inc bc
+        OP(0x13) set_de(z, get_de(z) + 1); NEXT; // inc de
+        OP(0x23) set_hl(z, get_hl(z) + 1); NEXT; // inc hl
+        OP(0x33) z->sp = z->sp + 1; NEXT;        // inc sp
 
-        case 0x0B: set_bc(z, get_bc(z) - 1); break; // dec bc
-        case 0x1B: set_de(z, get_de(z) - 1); break; // dec de
-        case 0x2B: set_hl(z, get_hl(z) - 1); break; // dec hl
-        case 0x3B: z->sp = z->sp - 1; break;        // dec sp
+        OP(0x0B) set_bc(z, get_bc(z) - 1); NEXT; // dec bc
+        OP(0x1B) set_de(z, get_de(z) - 1); NEXT; // dec de
+        OP(0x2B) set_hl(z, get_hl(z) - 1); NEXT; // dec hl
+        OP(0x3B) z->sp = z->sp - 1; NEXT;        // dec sp
 
-        case 0x27: daa(z); break; // daa
+        OP(0x27) daa(z); NEXT; // daa
 
-        case 0x2F:
+        OP(0x2F)
+            flags_sync(z);
             z->a  = ~z->a;
             z->nf = 1;
             z->hf = 1;
             z->xf = GET_BIT(3, z->a);
             z->yf = GET_BIT(5, z->a);
-            break; // cpl
+            NEXT; // cpl
 
-        case 0x37:
+        OP(0x37)
+            flags_sync(z);
             z->cf = 1;
             z->nf = 0;
             z->hf = 0;
             z->xf = GET_BIT(3, z->a);
             z->yf = GET_BIT(5, z->a);
-            break; // scf
+            NEXT; // scf
 
-        case 0x3F:
+        OP(0x3F)
+            flags_sync(z);
             z->hf = z->cf;
             z->cf = !z->cf;
             z->nf = 0;
             z->xf = GET_BIT(3, z->a);
             z->yf = GET_BIT(5, z->a);
-            break; // ccf
+            NEXT; // ccf
 
-        case 0x07: {
+        OP(0x07) {
+            flags_sync(z);
             z->cf = z->a >> 7;
             z->a  = (z->a << 1) | z->cf;
             z->nf = 0;
             z->hf = 0;
             z->xf = GET_BIT(3, z->a);
             z->yf = GET_BIT(5, z->a);
-        } break; // rlca (rotate left)
+        } NEXT; // rlca (rotate left)
 
-        case 0x0F: {
+        OP(0x0F) {
+            flags_sync(z);
             z->cf = z->a & 1;
             z->a  = (z->a >> 1) | (z->cf << 7);
             z->nf = 0;
             z->hf = 0;
             z->xf = GET_BIT(3, z->a);
             z->yf = GET_BIT(5, z->a);
-        } break; // rrca (rotate right)
+        } NEXT; // rrca (rotate right)
 
-        case 0x17: {
+        OP(0x17) {
+            flags_sync(z);
             const bool cy = z->cf;
             z->cf         = z->a >> 7;
             z->a          = (z->a << 1) | cy;
@@ -1242,9 +3130,10 @@ void exec_opcode(z80* const z, uint8_t opcode)
             z->hf         = 0;
             z->xf         = GET_BIT(3, z->a);
             z->yf         = GET_BIT(5, z->a);
-        } break; // rla
+        } NEXT; // rla
 
-        case 0x1F: {
+        OP(0x1F) {
+            flags_sync(z);
             const bool cy = z->cf;
             z->cf         = z->a & 1;
             z->a          = (z->a >> 1) | (cy << 7);
@@ -1252,124 +3141,134 @@ void exec_opcode(z80* const z, uint8_t opcode)
             z->hf         = 0;
             z->xf         = GET_BIT(3, z->a);
             z->yf         = GET_BIT(5, z->a);
-        } break; // rra
-
-        case 0xA7: land(z, z->a); break;             // and a
-        case 0xA0: land(z, z->b); break;             // and b
-        case 0xA1: land(z, z->c); break;             // and c
-        case 0xA2: land(z, z->d); break;             // and d
-        case 0xA3: land(z, z->e); break;             // and e
-        case 0xA4: land(z, z->h); break;             // and h
-        case 0xA5: land(z, z->l); break;             // and l
-        case 0xA6: land(z, rb(z, get_hl(z))); break; // and (hl)
-        case 0xE6: land(z, nextb(z)); break;         // and *
-
-        case 0xAF: lxor(z, z->a); break;             // xor a
-        case 0xA8: lxor(z, z->b); break;             // xor b
-        case 0xA9: lxor(z, z->c); break;             // xor c
-        case 0xAA: lxor(z, z->d); break;             // xor d
-        case 0xAB: lxor(z, z->e); break;             // xor e
-        case 0xAC: lxor(z, z->h); break;             // xor h
-        case 0xAD: lxor(z, z->l); break;             // xor l
-        case 0xAE: lxor(z, rb(z, get_hl(z))); break; // xor (hl)
-        case 0xEE: lxor(z, nextb(z)); break;         // xor *
-
-        case 0xB7: lor(z, z->a); break;             // or a
-        case 0xB0: lor(z, z->b); break;             // or b
-        case 0xB1: lor(z, z->c); break;             // or c
-        case 0xB2: lor(z, z->d); break;             // or d
-        case 0xB3: lor(z, z->e); break;             // or e
-        case 0xB4: lor(z, z->h); break;             // or h
-        case 0xB5: lor(z, z->l); break;             // or l
-        case 0xB6: lor(z, rb(z, get_hl(z))); break; // or (hl)
-        case 0xF6: lor(z, nextb(z)); break;         // or *
-
-        case 0xBF: cp(z, z->a); break;             // cp a
-        case 0xB8: cp(z, z->b); break;             // cp b
-        case 0xB9: cp(z, z->c); break;             // cp c
-        case 0xBA: cp(z, z->d); break;             // cp d
-        case 0xBB: cp(z, z->e); break;             // cp e
-        case 0xBC: cp(z, z->h); break;             // cp h
-        case 0xBD: cp(z, z->l); break;             // cp l
-        case 0xBE: cp(z, rb(z, get_hl(z))); break; // cp (hl)
-        case 0xFE: cp(z, nextb(z)); break;         // cp *
-
-        case 0xC3: jump(z, nextw(z)); break;        // jm **
-        case 0xC2: cond_jump(z, z->zf == 0); break; // jp nz, **
-        case 0xCA: cond_jump(z, z->zf == 1); break; // jp z, **
-        case 0xD2: cond_jump(z, z->cf == 0); break; // jp nc, **
-        case 0xDA: cond_jump(z, z->cf == 1); break; // jp c, **
-        case 0xE2: cond_jump(z, z->pf == 0); break; // jp po, **
-        case 0xEA: cond_jump(z, z->pf == 1); break; // jp pe, **
-        case 0xF2: cond_jump(z, z->sf == 0); break; // jp p, **
-        case 0xFA: cond_jump(z, z->sf == 1); break; // jp m, **
-
-        case 0x10: cond_jr(z, --z->b != 0); break;  // djnz *
-        case 0x18: jr(z, (int8_t) nextb(z)); break; // jr *
-        case 0x20: cond_jr(z, z->zf == 0); break;   // jr nz, *
-        case 0x28: cond_jr(z, z->zf == 1); break;   // jr z, *
-        case 0x30: cond_jr(z, z->cf == 0); break;   // jr nc, *
-        case 0x38: cond_jr(z, z->cf == 1); break;   // jr c, *
-
-        case 0xE9: z->pc = get_hl(z); break; // jp (hl)
-        case 0xCD: call(z, nextw(z)); break; // call
-
-        case 0xC4: cond_call(z, z->zf == 0); break; // cnz
-        case 0xCC: cond_call(z, z->zf == 1); break; // cz
-        case 0xD4: cond_call(z, z->cf == 0); break; // cnc
-        case 0xDC: cond_call(z, z->cf == 1); break; // cc
-        case 0xE4: cond_call(z, z->pf == 0); break; // cpo
-        case 0xEC: cond_call(z, z->pf == 1); break; // cpe
-        case 0xF4: cond_call(z, z->sf == 0); break; // cp
-        case 0xFC: cond_call(z, z->sf == 1); break; // cm
-
-        case 0xC9: ret(z); break;                  // ret
-        case 0xC0: cond_ret(z, z->zf == 0); break; // ret nz
-        case 0xC8: cond_ret(z, z->zf == 1); break; // ret z
-        case 0xD0: cond_ret(z, z->cf == 0); break; // ret nc
-        case 0xD8: cond_ret(z, z->cf == 1); break; // ret c
-        case 0xE0: cond_ret(z, z->pf == 0); break; // ret po
-        case 0xE8: cond_ret(z, z->pf == 1); break; // ret pe
-        case 0xF0: cond_ret(z, z->sf == 0); break; // ret p
-        case 0xF8: cond_ret(z, z->sf == 1); break; // ret m
-
-        case 0xC7: call(z, 0x00); break; // rst 0
-        case 0xCF: call(z, 0x08); break; // rst 1
-        case 0xD7: call(z, 0x10); break; // rst 2
-        case 0xDF: call(z, 0x18); break; // rst 3
-        case 0xE7: call(z, 0x20); break; // rst 4
-        case 0xEF: call(z, 0x28); break; // rst 5
-        case 0xF7: call(z, 0x30); break; // rst 6
-        case 0xFF: call(z, 0x38); break; // rst 7
-
-        case 0xC5: pushw(z, get_bc(z)); break;              // push bc
-        case 0xD5: pushw(z, get_de(z)); break;              // push de
-        case 0xE5: pushw(z, get_hl(z)); break;              // push hl
-        case 0xF5: pushw(z, (z->a << 8) | get_f(z)); break; // push af
-
-        case 0xC1: set_bc(z, popw(z)); break; // pop bc
-        case 0xD1: set_de(z, popw(z)); break; // pop de
-        case 0xE1: set_hl(z, popw(z)); break; // pop hl
-        case 0xF1: {
+        } NEXT; // rra
+
+        OP(0xA7) land(z, z->a); NEXT;             // and a
+        OP(0xA0) land(z, z->b); NEXT;             // and b
+        OP(0xA1) land(z, z->c); NEXT;             // and c
+        OP(0xA2) land(z, z->d); NEXT;             // and d
+        OP(0xA3) land(z, z->e); NEXT;             // and e
+        OP(0xA4) land(z, z->h); NEXT;             // and h
+        OP(0xA5) land(z, z->l); NEXT;             // and l
+        OP(0xA6) land(z, rb(z, get_hl(z))); NEXT; // and (hl)
+        OP(0xE6) land(z, nextb(z)); NEXT;         // and *
+
+        OP(0xAF) lxor(z, z->a); NEXT;             // xor a
+        OP(0xA8) lxor(z, z->b); NEXT;             // xor b
+        OP(0xA9) lxor(z, z->c); NEXT;             // xor c
+        OP(0xAA) lxor(z, z->d); NEXT;             // xor d
+        OP(0xAB) lxor(z, z->e); NEXT;             // xor e
+        OP(0xAC) lxor(z, z->h); NEXT;             // xor h
+        OP(0xAD) lxor(z, z->l); NEXT;             // xor l
+        OP(0xAE) lxor(z, rb(z, get_hl(z))); NEXT; // xor (hl)
+        OP(0xEE) lxor(z, nextb(z)); NEXT;         // xor *
+
+        OP(0xB7) lor(z, z->a); NEXT;             // or a
+        OP(0xB0) lor(z, z->b); NEXT;             // or b
+        OP(0xB1) lor(z, z->c); NEXT;             // or c
+        OP(0xB2) lor(z, z->d); NEXT;             // or d
+        OP(0xB3) lor(z, z->e); NEXT;             // or e
+        OP(0xB4) lor(z, z->h); NEXT;             // or h
+        OP(0xB5) lor(z, z->l); NEXT;             // or l
+        OP(0xB6) lor(z, rb(z, get_hl(z))); NEXT; // or (hl)
+        OP(0xF6) lor(z, nextb(z)); NEXT;         // or *
+
+        OP(0xBF) cp(z, z->a); NEXT;             // cp a
+        OP(0xB8) cp(z, z->b); NEXT;             // cp b
+        OP(0xB9) cp(z, z->c); NEXT;             // cp c
+        OP(0xBA) cp(z, z->d); NEXT;             // cp d
+        OP(0xBB) cp(z, z->e); NEXT;             // cp e
+        OP(0xBC) cp(z, z->h); NEXT;             // cp h
+        OP(0xBD) cp(z, z->l); NEXT;             // cp l
+        OP(0xBE) cp(z, rb(z, get_hl(z))); NEXT; // cp (hl)
+        OP(0xFE) cp(z, nextb(z)); NEXT;         // cp *
+
+        OP(0xC3) {
+            const uint16_t addr = nextw(z);
+            const uint16_t next = z->pc;
+            jump(z, addr);
+            idle_jump(z, next);
+        } NEXT; // jm **
+        OP(0xC2) cond_jump(z, get_zf(z) == 0); NEXT; // jp nz, **
+        OP(0xCA) cond_jump(z, get_zf(z) == 1); NEXT; // jp z, **
+        OP(0xD2) cond_jump(z, get_cf(z) == 0); NEXT; // jp nc, **
+        OP(0xDA) cond_jump(z, get_cf(z) == 1); NEXT; // jp c, **
+        OP(0xE2) cond_jump(z, get_pf(z) == 0); NEXT; // jp po, **
+        OP(0xEA) cond_jump(z, get_pf(z) == 1); NEXT; // jp pe, **
+        OP(0xF2) cond_jump(z, get_sf(z) == 0); NEXT; // jp p, **
+        OP(0xFA) cond_jump(z, get_sf(z) == 1); NEXT; // jp m, **
+
+        OP(0x10) cond_jr(z, --z->b != 0); NEXT;  // djnz *
+        OP(0x18) {
+            const int8_t b      = nextb(z);
+            const uint16_t next = z->pc;
+            jr(z, b);
+            idle_jump(z, next);
+        } NEXT; // jr *
+        OP(0x20) cond_jr(z, get_zf(z) == 0); NEXT;   // jr nz, *
+        OP(0x28) cond_jr(z, get_zf(z) == 1); NEXT;   // jr z, *
+        OP(0x30) cond_jr(z, get_cf(z) == 0); NEXT;   // jr nc, *
+        OP(0x38) cond_jr(z, get_cf(z) == 1); NEXT;   // jr c, *
+
+        OP(0xE9) z->pc = get_hl(z); NEXT; // jp (hl)
+        OP(0xCD) call(z, nextw(z)); NEXT; // call
+
+        OP(0xC4) cond_call(z, get_zf(z) == 0); NEXT; // cnz
+        OP(0xCC) cond_call(z, get_zf(z) == 1); NEXT; // cz
+        OP(0xD4) cond_call(z, get_cf(z) == 0); NEXT; // cnc
+        OP(0xDC) cond_call(z, get_cf(z) == 1); NEXT; // cc
+        OP(0xE4) cond_call(z, get_pf(z) == 0); NEXT; // cpo
+        OP(0xEC) cond_call(z, get_pf(z) == 1); NEXT; // cpe
+        OP(0xF4) cond_call(z, get_sf(z) == 0); NEXT; // cp
+        OP(0xFC) cond_call(z, get_sf(z) == 1); NEXT; // cm
+
+        OP(0xC9) ret(z); NEXT;                  // ret
+        OP(0xC0) cond_ret(z, get_zf(z) == 0); NEXT; // ret nz
+        OP(0xC8) cond_ret(z, get_zf(z) == 1); NEXT; // ret z
+        OP(0xD0) cond_ret(z, get_cf(z) == 0); NEXT; // ret nc
+        OP(0xD8) cond_ret(z, get_cf(z) == 1); NEXT; // ret c
+        OP(0xE0) cond_ret(z, get_pf(z) == 0); NEXT; // ret po
+        OP(0xE8) cond_ret(z, get_pf(z) == 1); NEXT; // ret pe
+        OP(0xF0) cond_ret(z, get_sf(z) == 0); NEXT; // ret p
+        OP(0xF8) cond_ret(z, get_sf(z) == 1); NEXT; // ret m
+
+        OP(0xC7) call(z, 0x00); NEXT; // rst 0
+        OP(0xCF) call(z, 0x08); NEXT; // rst 1
+        OP(0xD7) call(z, 0x10); NEXT; // rst 2
+        OP(0xDF) call(z, 0x18); NEXT; // rst 3
+        OP(0xE7) call(z, 0x20); NEXT; // rst 4
+        OP(0xEF) call(z, 0x28); NEXT; // rst 5
+        OP(0xF7) call(z, 0x30); NEXT; // rst 6
+        OP(0xFF) call(z, 0x38); NEXT; // rst 7
+
+        OP(0xC5) pushw(z, get_bc(z)); NEXT;              // push bc
+        OP(0xD5) pushw(z, get_de(z)); NEXT;              // push de
+        OP(0xE5) pushw(z, get_hl(z)); NEXT;              // push hl
+        OP(0xF5) pushw(z, (z->a << 8) | get_f(z)); NEXT; // push af
+
+        OP(0xC1) set_bc(z, popw(z)); NEXT; // pop bc
+        OP(0xD1) set_de(z, popw(z)); NEXT; // pop de
+        OP(0xE1) set_hl(z, popw(z)); NEXT; // pop hl
+        OP(0xF1) {
             uint16_t val = popw(z);
             z->a         = val >> 8;
             set_f(z, val & 0xFF);
-        } break; // pop af
+        } NEXT; // pop af
 
-        case 0xDB: {
+        OP(0xDB) {
             const uint8_t port = nextb(z);
             const uint8_t a    = z->a;
-            z->a               = z->port_in(z->userdata, (z->a << 8) | port);
+            z->a               = bus_in(z, (z->a << 8) | port);
             z->mem_ptr         = (a << 8) | (z->a + 1);
-        } break; // in a,(n)
+        } NEXT; // in a,(n)
 
-        case 0xD3: {
+        OP(0xD3) {
             const uint8_t port = nextb(z);
-            z->port_out(z->userdata, (z->a << 8) | port, z->a);
+            bus_out(z, (z->a << 8) | port, z->a);
             z->mem_ptr = (port + 1) | (z->a << 8);
-        } break; // out (n), a
+        } NEXT; // out (n), a
 
-        case 0x08: {
+        OP(0x08) {
             uint8_t a = z->a;
             uint8_t f = get_f(z);
 
@@ -1378,31 +3277,25 @@ void exec_opcode(z80* const z, uint8_t opcode)
 
             z->a_ = a;
             z->f_ = f;
-        } break; // ex af,af'
-        case 0xD9: {
-            uint8_t b = z->b, c = z->c, d = z->d, e = z->e, h = z->h, l = z->l;
+        } NEXT; // ex af,af'
+        OP(0xD9) {
+            const uint16_t bc = z->bc, de = z->de, hl = z->hl;
 
-            z->b = z->b_;
-            z->c = z->c_;
-            z->d = z->d_;
-            z->e = z->e_;
-            z->h = z->h_;
-            z->l = z->l_;
+            z->bc = z->bc_;
+            z->de = z->de_;
+            z->hl = z->hl_;
 
-            z->b_ = b;
-            z->c_ = c;
-            z->d_ = d;
-            z->e_ = e;
-            z->h_ = h;
-            z->l_ = l;
-        } break; // exx
+            z->bc_ = bc;
+            z->de_ = de;
+            z->hl_ = hl;
+        } NEXT; // exx
 
-        case 0xCB: exec_opcode_cb(z, nextb(z)); break;
-        case 0xED: exec_opcode_ed(z, nextb(z)); break;
-        case 0xDD: exec_opcode_ddfd(z, nextb(z), &z->ix); break;
-        case 0xFD: exec_opcode_ddfd(z, nextb(z), &z->iy); break;
+        OP(0xCB) exec_opcode_cb(z, nextb(z)); NEXT;
+        OP(0xED) exec_opcode_ed(z, nextb(z)); NEXT;
+        OP(0xDD) exec_opcode_ddfd(z, nextb(z), &z->ix); NEXT;
+        OP(0xFD) exec_opcode_ddfd(z, nextb(z), &z->iy); NEXT;
 
-        default: fprintf(stderr, "unknown opcode %02X\n", opcode); break;
+        default: log_undefined("unknown opcode %02X\n", opcode); break;
     }
 }
 
@@ -1416,139 +3309,177 @@ void exec_opcode_ddfd(z80* const z, uint8_t opcode, uint16_t* const iz)
 #define IZH (*iz >> 8)
 #define IZL (*iz & 0xFF)
 
+#if Z80_THREADED_DISPATCH
+    static const void* const dispatch_ddfd[256] = {
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_0x09,    &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_0x19,    &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_0x21,    &&op_0x22,    &&op_0x23,    &&op_0x24,    &&op_0x25,    &&op_0x26,    &&op_default,
+        &&op_default, &&op_0x29,    &&op_0x2A,    &&op_0x2B,    &&op_0x2C,    &&op_0x2D,    &&op_0x2E,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0x34,    &&op_0x35,    &&op_0x36,    &&op_default,
+        &&op_default, &&op_0x39,    &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0x44,    &&op_0x45,    &&op_0x46,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0x4C,    &&op_0x4D,    &&op_0x4E,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0x54,    &&op_0x55,    &&op_0x56,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0x5C,    &&op_0x5D,    &&op_0x5E,    &&op_default,
+        &&op_0x60,    &&op_0x61,    &&op_0x62,    &&op_0x63,    &&op_0x64,    &&op_0x65,    &&op_0x66,    &&op_0x67,
+        &&op_0x68,    &&op_0x69,    &&op_0x6A,    &&op_0x6B,    &&op_0x6C,    &&op_0x6D,    &&op_0x6E,    &&op_0x6F,
+        &&op_0x70,    &&op_0x71,    &&op_0x72,    &&op_0x73,    &&op_0x74,    &&op_0x75,    &&op_default, &&op_0x77,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0x7C,    &&op_0x7D,    &&op_0x7E,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0x84,    &&op_0x85,    &&op_0x86,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0x8C,    &&op_0x8D,    &&op_0x8E,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0x94,    &&op_0x95,    &&op_0x96,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0x9C,    &&op_0x9D,    &&op_0x9E,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0xA4,    &&op_0xA5,    &&op_0xA6,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0xAC,    &&op_0xAD,    &&op_0xAE,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0xB4,    &&op_0xB5,    &&op_0xB6,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_0xBC,    &&op_0xBD,    &&op_0xBE,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_0xCB,    &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_0xE1,    &&op_default, &&op_0xE3,    &&op_default, &&op_0xE5,    &&op_default, &&op_default,
+        &&op_default, &&op_0xE9,    &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_0xF9,    &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+    };
+#endif
+
+    DISPATCH(dispatch_ddfd, opcode);
     switch (opcode) {
-        case 0xE1: *iz = popw(z); break; // pop iz
-        case 0xE5: pushw(z, *iz); break; // push iz
+        OP(0xE1) *iz = popw(z); break; // pop iz
+        OP(0xE5) pushw(z, *iz); break; // push iz
 
-        case 0xE9: jump(z, *iz); break; // jp iz
+        OP(0xE9) jump(z, *iz); break; // jp iz
 
-        case 0x09: addiz(z, iz, get_bc(z)); break; // add iz,bc
-        case 0x19: addiz(z, iz, get_de(z)); break; // add iz,de
-        case 0x29: addiz(z, iz, *iz); break;       // add iz,iz
-        case 0x39: addiz(z, iz, z->sp); break;     // add iz,sp
+        OP(0x09) addiz(z, iz, get_bc(z)); break; // add iz,bc
+        OP(0x19) addiz(z, iz, get_de(z)); break; // add iz,de
+        OP(0x29) addiz(z, iz, *iz); break;       // add iz,iz
+        OP(0x39) addiz(z, iz, z->sp); break;     // add iz,sp
 
-        case 0x84: z->a = addb(z, z->a, IZH, 0); break;            // add a,izh
-        case 0x85: z->a = addb(z, z->a, *iz & 0xFF, 0); break;     // add a,izl
-        case 0x8C: z->a = addb(z, z->a, IZH, z->cf); break;        // adc a,izh
-        case 0x8D: z->a = addb(z, z->a, *iz & 0xFF, z->cf); break; // adc a,izl
+        OP(0x84) z->a = addb(z, z->a, IZH, 0); break;            // add a,izh
+        OP(0x85) z->a = addb(z, z->a, *iz & 0xFF, 0); break;     // add a,izl
+        OP(0x8C) z->a = addb(z, z->a, IZH, get_cf(z)); break;        // adc a,izh
+        OP(0x8D) z->a = addb(z, z->a, *iz & 0xFF, get_cf(z)); break; // adc a,izl
 
-        case 0x86: z->a = addb(z, z->a, rb(z, IZD), 0); break;     // add a,(iz+*)
-        case 0x8E: z->a = addb(z, z->a, rb(z, IZD), z->cf); break; // adc a,(iz+*)
-        case 0x96: z->a = subb(z, z->a, rb(z, IZD), 0); break;     // sub (iz+*)
-        case 0x9E: z->a = subb(z, z->a, rb(z, IZD), z->cf); break; // sbc (iz+*)
+        OP(0x86) z->a = addb(z, z->a, rb(z, IZD), 0); break;     // add a,(iz+*)
+        OP(0x8E) z->a = addb(z, z->a, rb(z, IZD), get_cf(z)); break; // adc a,(iz+*)
+        OP(0x96) z->a = subb(z, z->a, rb(z, IZD), 0); break;     // sub (iz+*)
+        OP(0x9E) z->a = subb(z, z->a, rb(z, IZD), get_cf(z)); break; // sbc (iz+*)
 
-        case 0x94: z->a = subb(z, z->a, IZH, 0); break;            // sub izh
-        case 0x95: z->a = subb(z, z->a, *iz & 0xFF, 0); break;     // sub izl
-        case 0x9C: z->a = subb(z, z->a, IZH, z->cf); break;        // sbc izh
-        case 0x9D: z->a = subb(z, z->a, *iz & 0xFF, z->cf); break; // sbc izl
+        OP(0x94) z->a = subb(z, z->a, IZH, 0); break;            // sub izh
+        OP(0x95) z->a = subb(z, z->a, *iz & 0xFF, 0); break;     // sub izl
+        OP(0x9C) z->a = subb(z, z->a, IZH, get_cf(z)); break;        // sbc izh
+        OP(0x9D) z->a = subb(z, z->a, *iz & 0xFF, get_cf(z)); break; // sbc izl
 
-        case 0xA6: land(z, rb(z, IZD)); break; // and (iz+*)
-        case 0xA4: land(z, IZH); break;        // and izh
-        case 0xA5: land(z, *iz & 0xFF); break; // and izl
+        OP(0xA6) land(z, rb(z, IZD)); break; // and (iz+*)
+        OP(0xA4) land(z, IZH); break;        // and izh
+        OP(0xA5) land(z, *iz & 0xFF); break; // and izl
 
-        case 0xAE: lxor(z, rb(z, IZD)); break; // xor (iz+*)
-        case 0xAC: lxor(z, IZH); break;        // xor izh
-        case 0xAD: lxor(z, *iz & 0xFF); break; // xor izl
+        OP(0xAE) lxor(z, rb(z, IZD)); break; // xor (iz+*)
+        OP(0xAC) lxor(z, IZH); break;        // xor izh
+        OP(0xAD) lxor(z, *iz & 0xFF); break; // xor izl
 
-        case 0xB6: lor(z, rb(z, IZD)); break; // or (iz+*)
-        case 0xB4: lor(z, IZH); break;        // or izh
-        case 0xB5: lor(z, *iz & 0xFF); break; // or izl
+        OP(0xB6) lor(z, rb(z, IZD)); break; // or (iz+*)
+        OP(0xB4) lor(z, IZH); break;        // or izh
+        OP(0xB5) lor(z, *iz & 0xFF); break; // or izl
 
-        case 0xBE: cp(z, rb(z, IZD)); break; // cp (iz+*)
-        case 0xBC: cp(z, IZH); break;        // cp izh
-        case 0xBD: cp(z, *iz & 0xFF); break; // cp izl
+        OP(0xBE) cp(z, rb(z, IZD)); break; // cp (iz+*)
+        OP(0xBC) cp(z, IZH); break;        // cp izh
+        OP(0xBD) cp(z, *iz & 0xFF); break; // cp izl
 
-        case 0x23: *iz += 1; break; // inc iz
-        case 0x2B: *iz -= 1; break; // dec iz
+        OP(0x23) *iz += 1; break; // inc iz
+        OP(0x2B) *iz -= 1; break; // dec iz
 
-        case 0x34: {
+        OP(0x34) {
             uint16_t addr = IZD;
             wb(z, addr, inc(z, rb(z, addr)));
         } break; // inc (iz+*)
 
-        case 0x35: {
+        OP(0x35) {
             uint16_t addr = IZD;
             wb(z, addr, dec(z, rb(z, addr)));
         } break; // dec (iz+*)
 
-        case 0x24: *iz = IZL | ((inc(z, IZH)) << 8); break; // inc izh
-        case 0x25: *iz = IZL | ((dec(z, IZH)) << 8); break; // dec izh
-        case 0x2C: *iz = (IZH << 8) | inc(z, IZL); break;   // inc izl
-        case 0x2D: *iz = (IZH << 8) | dec(z, IZL); break;   // dec izl
+        OP(0x24) *iz = IZL | ((inc(z, IZH)) << 8); break; // inc izh
+        OP(0x25) *iz = IZL | ((dec(z, IZH)) << 8); break; // dec izh
+        OP(0x2C) *iz = (IZH << 8) | inc(z, IZL); break;   // inc izl
+        OP(0x2D) *iz = (IZH << 8) | dec(z, IZL); break;   // dec izl
 
-        case 0x2A: *iz = rw(z, nextw(z)); break; // ld iz,(**)
-        case 0x22: ww(z, nextw(z), *iz); break;  // ld (**),iz
-        case 0x21: *iz = nextw(z); break;        // ld iz,**
+        OP(0x2A) *iz = rw(z, nextw(z)); break; // ld iz,(**)
+        OP(0x22) ww(z, nextw(z), *iz); break;  // ld (**),iz
+        OP(0x21) *iz = nextw(z); break;        // ld iz,**
 
-        case 0x36: {
+        OP(0x36) {
             uint16_t addr = IZD;
             wb(z, addr, nextb(z));
         } break; // ld (iz+*),*
 
-        case 0x70: wb(z, IZD, z->b); break; // ld (iz+*),b
-        case 0x71: wb(z, IZD, z->c); break; // ld (iz+*),c
-        case 0x72: wb(z, IZD, z->d); break; // ld (iz+*),d
-        case 0x73: wb(z, IZD, z->e); break; // ld (iz+*),e
-        case 0x74: wb(z, IZD, z->h); break; // ld (iz+*),h
-        case 0x75: wb(z, IZD, z->l); break; // ld (iz+*),l
-        case 0x77: wb(z, IZD, z->a); break; // ld (iz+*),a
-
-        case 0x46: z->b = rb(z, IZD); break; // ld b,(iz+*)
-        case 0x4E: z->c = rb(z, IZD); break; // ld c,(iz+*)
-        case 0x56: z->d = rb(z, IZD); break; // ld d,(iz+*)
-        case 0x5E: z->e = rb(z, IZD); break; // ld e,(iz+*)
-        case 0x66: z->h = rb(z, IZD); break; // ld h,(iz+*)
-        case 0x6E: z->l = rb(z, IZD); break; // ld l,(iz+*)
-        case 0x7E: z->a = rb(z, IZD); break; // ld a,(iz+*)
-
-        case 0x44: z->b = IZH; break; // ld b,izh
-        case 0x4C: z->c = IZH; break; // ld c,izh
-        case 0x54: z->d = IZH; break; // ld d,izh
-        case 0x5C: z->e = IZH; break; // ld e,izh
-        case 0x7C: z->a = IZH; break; // ld a,izh
-
-        case 0x45: z->b = IZL; break; // ld b,izl
-        case 0x4D: z->c = IZL; break; // ld c,izl
-        case 0x55: z->d = IZL; break; // ld d,izl
-        case 0x5D: z->e = IZL; break; // ld e,izl
-        case 0x7D: z->a = IZL; break; // ld a,izl
-
-        case 0x60: *iz = IZL | (z->b << 8); break;     // ld izh,b
-        case 0x61: *iz = IZL | (z->c << 8); break;     // ld izh,c
-        case 0x62: *iz = IZL | (z->d << 8); break;     // ld izh,d
-        case 0x63: *iz = IZL | (z->e << 8); break;     // ld izh,e
-        case 0x64: break;                              // ld izh,izh
-        case 0x65: *iz = (IZL << 8) | IZL; break;      // ld izh,izl
-        case 0x67: *iz = IZL | (z->a << 8); break;     // ld izh,a
-        case 0x26: *iz = IZL | (nextb(z) << 8); break; // ld izh,*
-
-        case 0x68: *iz = (IZH << 8) | z->b; break;     // ld izl,b
-        case 0x69: *iz = (IZH << 8) | z->c; break;     // ld izl,c
-        case 0x6A: *iz = (IZH << 8) | z->d; break;     // ld izl,d
-        case 0x6B: *iz = (IZH << 8) | z->e; break;     // ld izl,e
-        case 0x6C: *iz = (IZH << 8) | IZH; break;      // ld izl,izh
-        case 0x6D: break;                              // ld izl,izl
-        case 0x6F: *iz = (IZH << 8) | z->a; break;     // ld izl,a
-        case 0x2E: *iz = (IZH << 8) | nextb(z); break; // ld izl,*
-
-        case 0xF9: z->sp = *iz; break; // ld sp,iz
-
-        case 0xE3: {
+        OP(0x70) wb(z, IZD, z->b); break; // ld (iz+*),b
+        OP(0x71) wb(z, IZD, z->c); break; // ld (iz+*),c
+        OP(0x72) wb(z, IZD, z->d); break; // ld (iz+*),d
+        OP(0x73) wb(z, IZD, z->e); break; // ld (iz+*),e
+        OP(0x74) wb(z, IZD, z->h); break; // ld (iz+*),h
+        OP(0x75) wb(z, IZD, z->l); break; // ld (iz+*),l
+        OP(0x77) wb(z, IZD, z->a); break; // ld (iz+*),a
+
+        OP(0x46) z->b = rb(z, IZD); break; // ld b,(iz+*)
+        OP(0x4E) z->c = rb(z, IZD); break; // ld c,(iz+*)
+        OP(0x56) z->d = rb(z, IZD); break; // ld d,(iz+*)
+        OP(0x5E) z->e = rb(z, IZD); break; // ld e,(iz+*)
+        OP(0x66) z->h = rb(z, IZD); break; // ld h,(iz+*)
+        OP(0x6E) z->l = rb(z, IZD); break; // ld l,(iz+*)
+        OP(0x7E) z->a = rb(z, IZD); break; // ld a,(iz+*)
+
+        OP(0x44) z->b = IZH; break; // ld b,izh
+        OP(0x4C) z->c = IZH; break; // ld c,izh
+        OP(0x54) z->d = IZH; break; // ld d,izh
+        OP(0x5C) z->e = IZH; break; // ld e,izh
+        OP(0x7C) z->a = IZH; break; // ld a,izh
+
+        OP(0x45) z->b = IZL; break; // ld b,izl
+        OP(0x4D) z->c = IZL; break; // ld c,izl
+        OP(0x55) z->d = IZL; break; // ld d,izl
+        OP(0x5D) z->e = IZL; break; // ld e,izl
+        OP(0x7D) z->a = IZL; break; // ld a,izl
+
+        OP(0x60) *iz = IZL | (z->b << 8); break;     // ld izh,b
+        OP(0x61) *iz = IZL | (z->c << 8); break;     // ld izh,c
+        OP(0x62) *iz = IZL | (z->d << 8); break;     // ld izh,d
+        OP(0x63) *iz = IZL | (z->e << 8); break;     // ld izh,e
+        OP(0x64) break;                              // ld izh,izh
+        OP(0x65) *iz = (IZL << 8) | IZL; break;      // ld izh,izl
+        OP(0x67) *iz = IZL | (z->a << 8); break;     // ld izh,a
+        OP(0x26) *iz = IZL | (nextb(z) << 8); break; // ld izh,*
+
+        OP(0x68) *iz = (IZH << 8) | z->b; break;     // ld izl,b
+        OP(0x69) *iz = (IZH << 8) | z->c; break;     // ld izl,c
+        OP(0x6A) *iz = (IZH << 8) | z->d; break;     // ld izl,d
+        OP(0x6B) *iz = (IZH << 8) | z->e; break;     // ld izl,e
+        OP(0x6C) *iz = (IZH << 8) | IZH; break;      // ld izl,izh
+        OP(0x6D) break;                              // ld izl,izl
+        OP(0x6F) *iz = (IZH << 8) | z->a; break;     // ld izl,a
+        OP(0x2E) *iz = (IZH << 8) | nextb(z); break; // ld izl,*
+
+        OP(0xF9) z->sp = *iz; break; // ld sp,iz
+
+        OP(0xE3) {
             const uint16_t val = rw(z, z->sp);
             ww(z, z->sp, *iz);
             *iz        = val;
             z->mem_ptr = val;
         } break; // ex (sp),iz
 
-        case 0xCB: {
+        OP(0xCB) {
             uint16_t addr = IZD;
             uint8_t op    = nextb(z);
             exec_opcode_dcb(z, op, addr);
         } break;
 
-        default: {
+        OP_DEFAULT {
             // any other FD/DD opcode behaves as a non-prefixed opcode:
-            exec_opcode(z, opcode);
+            exec_opcode_once(z, opcode);
             // R should not be incremented twice:
             z->r = (z->r & 0x80) | ((z->r - 1) & 0x7f);
         } break;
@@ -1655,7 +3586,7 @@ void exec_opcode_dcb(z80* const z, uint8_t opcode, uint16_t addr)
         case 2: result = val & ~(1 << y_); break; // res y, (iz+d)
         case 3: result = val | (1 << y_); break;  // set y, (iz+d)
 
-        default: fprintf(stderr, "unknown XYCB opcode: %02X\n", opcode); break;
+        default: log_undefined("unknown XYCB opcode: %02X\n", opcode); break;
     }
 
     // ld r[z], rot[y] (iz+d)
@@ -1688,11 +3619,50 @@ void exec_opcode_ed(z80* const z, uint8_t opcode)
 {
     z->cyc += cyc_ed[opcode];
     inc_r(z);
+#if Z80_THREADED_DISPATCH
+    static const void* const dispatch_ed[256] = {
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_0x40,    &&op_0x41,    &&op_0x42,    &&op_0x43,    &&op_0x44,    &&op_0x45,    &&op_0x46,    &&op_0x47,
+        &&op_0x48,    &&op_0x49,    &&op_0x4A,    &&op_0x4B,    &&op_0x4C,    &&op_0x4D,    &&op_default, &&op_0x4F,
+        &&op_0x50,    &&op_0x51,    &&op_0x52,    &&op_0x53,    &&op_0x54,    &&op_0x55,    &&op_0x56,    &&op_0x57,
+        &&op_0x58,    &&op_0x59,    &&op_0x5A,    &&op_0x5B,    &&op_0x5C,    &&op_0x5D,    &&op_0x5E,    &&op_0x5F,
+        &&op_0x60,    &&op_0x61,    &&op_0x62,    &&op_0x63,    &&op_0x64,    &&op_0x65,    &&op_0x66,    &&op_0x67,
+        &&op_0x68,    &&op_0x69,    &&op_0x6A,    &&op_0x6B,    &&op_0x6C,    &&op_0x6D,    &&op_default, &&op_0x6F,
+        &&op_0x70,    &&op_0x71,    &&op_0x72,    &&op_0x73,    &&op_0x74,    &&op_0x75,    &&op_0x76,    &&op_default,
+        &&op_0x78,    &&op_0x79,    &&op_0x7A,    &&op_0x7B,    &&op_0x7C,    &&op_0x7D,    &&op_0x7E,    &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_0xA0,    &&op_0xA1,    &&op_0xA2,    &&op_0xA3,    &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_0xA8,    &&op_0xA9,    &&op_0xAA,    &&op_0xAB,    &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_0xB0,    &&op_0xB1,    &&op_0xB2,    &&op_0xB3,    &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_0xB8,    &&op_0xB9,    &&op_0xBA,    &&op_0xBB,    &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+    };
+#endif
+
+    DISPATCH(dispatch_ed, opcode);
     switch (opcode) {
-        case 0x47: z->i = z->a; break; // ld i,a
-        case 0x4F: z->r = z->a; break; // ld r,a
+        OP(0x47) z->i = z->a; break; // ld i,a
+        OP(0x4F) z->r = z->a; break; // ld r,a
 
-        case 0x57:
+        OP(0x57)
+            flags_sync(z);
             z->a  = z->i;
             z->sf = z->a >> 7;
             z->zf = z->a == 0;
@@ -1701,7 +3671,8 @@ void exec_opcode_ed(z80* const z, uint8_t opcode)
             z->pf = z->iff2;
             break; // ld a,i
 
-        case 0x5F:
+        OP(0x5F)
+            flags_sync(z);
             z->a  = z->r;
             z->sf = z->a >> 7;
             z->zf = z->a == 0;
@@ -1710,197 +3681,244 @@ void exec_opcode_ed(z80* const z, uint8_t opcode)
             z->pf = z->iff2;
             break; // ld a,r
 
-        case 0x45:
-        case 0x55:
-        case 0x5D:
-        case 0x65:
-        case 0x6D:
-        case 0x75:
-        case 0x7D:
+        OP(0x45)
+        OP(0x55)
+        OP(0x5D)
+        OP(0x65)
+        OP(0x6D)
+        OP(0x75)
+        OP(0x7D)
             z->iff1 = z->iff2;
             ret(z);
             break;                // retn
-        case 0x4D: ret(z); break; // reti
+        OP(0x4D) ret(z); break; // reti
 
-        case 0xA0: ldi(z); break; // ldi
-        case 0xB0: {
+        OP(0xA0) ldi(z); break; // ldi
+        OP(0xB0) {
             ldi(z);
 
-            if (get_bc(z) != 0) {
+            while (get_bc(z) != 0) {
                 z->pc      -= 2;
                 z->cyc     += 5;
                 z->mem_ptr  = z->pc + 1;
+                if (!block_can_repeat(z, opcode)) {
+                    break;
+                }
+                block_ld(z, opcode, 1);
+                block_refetch(z, opcode);
+                ldi(z);
             }
         } break; // ldir
 
-        case 0xA8: ldd(z); break; // ldd
-        case 0xB8: {
+        OP(0xA8) ldd(z); break; // ldd
+        OP(0xB8) {
             ldd(z);
 
-            if (get_bc(z) != 0) {
+            while (get_bc(z) != 0) {
                 z->pc      -= 2;
                 z->cyc     += 5;
                 z->mem_ptr  = z->pc + 1;
+                if (!block_can_repeat(z, opcode)) {
+                    break;
+                }
+                block_ld(z, opcode, -1);
+                block_refetch(z, opcode);
+                ldd(z);
             }
         } break; // lddr
 
-        case 0xA1: cpi(z); break; // cpi
-        case 0xA9: cpd(z); break; // cpd
-        case 0xB1: {
+        OP(0xA1) cpi(z); break; // cpi
+        OP(0xA9) cpd(z); break; // cpd
+        OP(0xB1) {
             cpi(z);
-            if (get_bc(z) != 0 && !z->zf) {
+            while (get_bc(z) != 0 && !z->zf) {
                 z->pc      -= 2;
                 z->cyc     += 5;
                 z->mem_ptr  = z->pc + 1;
-            } else {
+                if (!block_can_repeat(z, opcode)) {
+                    break;
+                }
+                block_cp(z, opcode, 1);
+                block_refetch(z, opcode);
+                cpi(z);
+            }
+            if (get_bc(z) == 0 || z->zf) {
                 z->mem_ptr += 1;
             }
         } break; // cpir
-        case 0xB9: {
+        OP(0xB9) {
             cpd(z);
-            if (get_bc(z) != 0 && !z->zf) {
+            while (get_bc(z) != 0 && !z->zf) {
                 z->pc  -= 2;
                 z->cyc += 5;
-            } else {
+                if (!block_can_repeat(z, opcode)) {
+                    break;
+                }
+                block_cp(z, opcode, -1);
+                block_refetch(z, opcode);
+                cpd(z);
+            }
+            if (get_bc(z) == 0 || z->zf) {
                 z->mem_ptr += 1;
             }
         } break; // cpdr
 
-        case 0x40: in_r_c(z, &z->b); break; // in b, (c)
-        case 0x48: in_r_c(z, &z->c); break; // in c, (c)
-        case 0x50: in_r_c(z, &z->d); break; // in d, (c)
-        case 0x58: in_r_c(z, &z->e); break; // in e, (c)
-        case 0x60: in_r_c(z, &z->h); break; // in h, (c)
-        case 0x68: in_r_c(z, &z->l); break; // in l, (c)
-        case 0x70: {
+        OP(0x40) in_r_c(z, &z->b); break; // in b, (c)
+        OP(0x48) in_r_c(z, &z->c); break; // in c, (c)
+        OP(0x50) in_r_c(z, &z->d); break; // in d, (c)
+        OP(0x58) in_r_c(z, &z->e); break; // in e, (c)
+        OP(0x60) in_r_c(z, &z->h); break; // in h, (c)
+        OP(0x68) in_r_c(z, &z->l); break; // in l, (c)
+        OP(0x70) {
             uint8_t val;
             in_r_c(z, &val);
         } break; // in (c)
-        case 0x78:
+        OP(0x78)
             in_r_c(z, &z->a);
             z->mem_ptr = get_bc(z) + 1;
             break; // in a, (c)
 
-        case 0xA2: ini(z); break; // ini
-        case 0xB2:
+        OP(0xA2) ini(z); break; // ini
+        OP(0xB2)
             ini(z);
-            if (z->b > 0) {
+            while (z->b > 0) {
                 z->pc  -= 2;
                 z->cyc += 5;
+                if (!block_can_repeat(z, opcode)) {
+                    break;
+                }
+                block_refetch(z, opcode);
+                ini(z);
             }
             break;                // inir
-        case 0xAA: ind(z); break; // ind
-        case 0xBA:
+        OP(0xAA) ind(z); break; // ind
+        OP(0xBA)
             ind(z);
-            if (z->b > 0) {
+            while (z->b > 0) {
                 z->pc  -= 2;
                 z->cyc += 5;
+                if (!block_can_repeat(z, opcode)) {
+                    break;
+                }
+                block_refetch(z, opcode);
+                ind(z);
             }
             break; // indr
 
-        case 0x41: z->port_out(z->userdata, get_bc(z), z->b); break; // out (c), b
-        case 0x49: z->port_out(z->userdata, get_bc(z), z->c); break; // out (c), c
-        case 0x51: z->port_out(z->userdata, get_bc(z), z->d); break; // out (c), d
-        case 0x59: z->port_out(z->userdata, get_bc(z), z->e); break; // out (c), e
-        case 0x61: z->port_out(z->userdata, get_bc(z), z->h); break; // out (c), h
-        case 0x69: z->port_out(z->userdata, get_bc(z), z->l); break; // out (c), l
-        case 0x71: z->port_out(z->userdata, get_bc(z), 0); break;    // out (c), 0
-        case 0x79:
-            z->port_out(z->userdata, get_bc(z), z->a);
+        OP(0x41) bus_out(z, get_bc(z), z->b); break; // out (c), b
+        OP(0x49) bus_out(z, get_bc(z), z->c); break; // out (c), c
+        OP(0x51) bus_out(z, get_bc(z), z->d); break; // out (c), d
+        OP(0x59) bus_out(z, get_bc(z), z->e); break; // out (c), e
+        OP(0x61) bus_out(z, get_bc(z), z->h); break; // out (c), h
+        OP(0x69) bus_out(z, get_bc(z), z->l); break; // out (c), l
+        OP(0x71) bus_out(z, get_bc(z), 0); break;    // out (c), 0
+        OP(0x79)
+            bus_out(z, get_bc(z), z->a);
             z->mem_ptr = get_bc(z) + 1;
             break; // out (c), a
 
-        case 0xA3: outi(z); break; // outi
-        case 0xB3: {
+        OP(0xA3) outi(z); break; // outi
+        OP(0xB3) {
             outi(z);
-            if (z->b > 0) {
+            while (z->b > 0) {
                 z->pc  -= 2;
                 z->cyc += 5;
+                if (!block_can_repeat(z, opcode)) {
+                    break;
+                }
+                block_refetch(z, opcode);
+                outi(z);
             }
         } break;                   // otir
-        case 0xAB: outd(z); break; // outd
-        case 0xBB: {
+        OP(0xAB) outd(z); break; // outd
+        OP(0xBB) {
             outd(z);
-            if (z->b > 0) {
+            while (z->b > 0) {
                 z->pc -= 2;
+                if (!block_can_repeat(z, opcode)) {
+                    break;
+                }
+                block_refetch(z, opcode);
+                outd(z);
             }
         } break; // otdr
 
-        case 0x42: sbchl(z, get_bc(z)); break; // sbc hl,bc
-        case 0x52: sbchl(z, get_de(z)); break; // sbc hl,de
-        case 0x62: sbchl(z, get_hl(z)); break; // sbc hl,hl
-        case 0x72: sbchl(z, z->sp); break;     // sbc hl,sp
+        OP(0x42) sbchl(z, get_bc(z)); break; // sbc hl,bc
+        OP(0x52) sbchl(z, get_de(z)); break; // sbc hl,de
+        OP(0x62) sbchl(z, get_hl(z)); break; // sbc hl,hl
+        OP(0x72) sbchl(z, z->sp); break;     // sbc hl,sp
 
-        case 0x4A: adchl(z, get_bc(z)); break; // adc hl,bc
-        case 0x5A: adchl(z, get_de(z)); break; // adc hl,de
-        case 0x6A: adchl(z, get_hl(z)); break; // adc hl,hl
-        case 0x7A: adchl(z, z->sp); break;     // adc hl,sp
+        OP(0x4A) adchl(z, get_bc(z)); break; // adc hl,bc
+        OP(0x5A) adchl(z, get_de(z)); break; // adc hl,de
+        OP(0x6A) adchl(z, get_hl(z)); break; // adc hl,hl
+        OP(0x7A) adchl(z, z->sp); break;     // adc hl,sp
 
-        case 0x43: {
+        OP(0x43) {
             const uint16_t addr = nextw(z);
             ww(z, addr, get_bc(z));
             z->mem_ptr = addr + 1;
         } break; // ld (**), bc
 
-        case 0x53: {
+        OP(0x53) {
             const uint16_t addr = nextw(z);
             ww(z, addr, get_de(z));
             z->mem_ptr = addr + 1;
         } break; // ld (**), de
 
-        case 0x63: {
+        OP(0x63) {
             const uint16_t addr = nextw(z);
             ww(z, addr, get_hl(z));
             z->mem_ptr = addr + 1;
         } break; // ld (**), hl
 
-        case 0x73: {
+        OP(0x73) {
             const uint16_t addr = nextw(z);
             ww(z, addr, z->sp);
             z->mem_ptr = addr + 1;
         } break; // ld (**),sp
 
-        case 0x4B: {
+        OP(0x4B) {
             const uint16_t addr = nextw(z);
             set_bc(z, rw(z, addr));
             z->mem_ptr = addr + 1;
         } break; // ld bc, (**)
 
-        case 0x5B: {
+        OP(0x5B) {
             const uint16_t addr = nextw(z);
             set_de(z, rw(z, addr));
             z->mem_ptr = addr + 1;
         } break; // ld de, (**)
 
-        case 0x6B: {
+        OP(0x6B) {
             const uint16_t addr = nextw(z);
             set_hl(z, rw(z, addr));
             z->mem_ptr = addr + 1;
         } break; // ld hl, (**)
 
-        case 0x7B: {
+        OP(0x7B) {
             const uint16_t addr = nextw(z);
             z->sp               = rw(z, addr);
             z->mem_ptr          = addr + 1;
         } break; // ld sp,(**)
 
-        case 0x44:
-        case 0x54:
-        case 0x64:
-        case 0x74:
-        case 0x4C:
-        case 0x5C:
-        case 0x6C:
-        case 0x7C: z->a = subb(z, 0, z->a, 0); break; // neg
-
-        case 0x46:
-        case 0x66: z->interrupt_mode = 0; break; // im 0
-        case 0x56:
-        case 0x76: z->interrupt_mode = 1; break; // im 1
-        case 0x5E:
-        case 0x7E: z->interrupt_mode = 2; break; // im 2
-
-        case 0x67: {
+        OP(0x44)
+        OP(0x54)
+        OP(0x64)
+        OP(0x74)
+        OP(0x4C)
+        OP(0x5C)
+        OP(0x6C)
+        OP(0x7C) z->a = subb(z, 0, z->a, 0); break; // neg
+
+        OP(0x46)
+        OP(0x66) z->interrupt_mode = 0; break; // im 0
+        OP(0x56)
+        OP(0x76) z->interrupt_mode = 1; break; // im 1
+        OP(0x5E)
+        OP(0x7E) z->interrupt_mode = 2; break; // im 2
+
+        OP(0x67) {
+            flags_sync(z);
             uint8_t a   = z->a;
             uint8_t val = rb(z, get_hl(z));
             z->a        = (a & 0xF0) | (val & 0xF);
@@ -1916,7 +3934,8 @@ void exec_opcode_ed(z80* const z, uint8_t opcode)
             z->mem_ptr = get_hl(z) + 1;
         } break; // rrd
 
-        case 0x6F: {
+        OP(0x6F) {
+            flags_sync(z);
             uint8_t a   = z->a;
             uint8_t val = rb(z, get_hl(z));
             z->a        = (a & 0xF0) | (val >> 4);
@@ -1932,8 +3951,12 @@ void exec_opcode_ed(z80* const z, uint8_t opcode)
             z->mem_ptr = get_hl(z) + 1;
         } break; // rld
 
-        default: fprintf(stderr, "unknown ED opcode: %02X\n", opcode); break;
+        OP_DEFAULT log_undefined("unknown ED opcode: %02X\n", opcode); break;
     }
 }
 
+#if Z80_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
+
 #undef GET_BIT
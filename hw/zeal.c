@@ -11,60 +11,23 @@
 #include "hw/zeal.h"
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "debugger/debugger.h"
-#include "utils/config.h"
+#include "hw/zeal_bus.h"
 #include "utils/log.h"
 
-#ifdef PLATFORM_WEB
-#include <emscripten.h>
-#endif
-
-#define RAYLIB_KEY_COUNT 384
-
 #define CHECK_ERR(err)  \
     do {                \
         if (err)        \
             return err; \
     } while (0)
 
-typedef enum {
-    KEY_NOT_PRESSED,
-    KEY_PRESSED,
-    KEY_REPEATED,
-} kb_key_state_t;
-
-typedef struct {
-    kb_key_state_t state;
-    int duration;
-} kb_keys_t;
-
-#ifdef CONFIG_ENABLE_DEBUGGER
-int zeal_debugger_init(zeal_t *machine, dbg_t *dbg);
-#endif
-bool zeal_ui_input(zeal_t *machine);
-
 /**
- * @brief Array used to key tracked of the key states on the host. This array will help simulate
- * key press, release and repeat.
+ * @brief Memory read of a page that can't be accessed directly, it goes through its device
  */
-static kb_keys_t RAYLIB_KEYS[RAYLIB_KEY_COUNT];
-
-#ifdef PLATFORM_WEB
-EMSCRIPTEN_KEEPALIVE volatile
-#endif
-#if CONFIG_SHOW_FPS
-    bool show_fps = true;
-#else
-bool show_fps = false;
-#endif
-
-/**
- * @brief Callback invoked when the CPU tries to read a byte in memory space
- */
-static uint8_t zeal_mem_read(void *opaque, uint16_t virt_addr) {
-    const zeal_t *machine = (zeal_t *)opaque;
+uint8_t zeal_bus_mem_read_slow(zeal_t *machine, uint16_t virt_addr) {
     const int phys_addr = mmu_get_phys_addr(&machine->mmu, virt_addr);
     const map_entry_t *entry = &machine->mem_mapping[phys_addr / MMU_PAGE_SIZE];
     device_t *device = entry->dev;
@@ -99,29 +62,13 @@ static uint8_t zeal_phys_mem_read(void *opaque, uint32_t phys_addr) {
     return 0;
 }
 
-#if CONFIG_ENABLE_DEBUGGER
+
 /**
- * @brief Read a byte from memory for the debugger, so write-only areas can still be read
+ * @brief Memory write of a page that can't be accessed directly, it goes through its device
  */
-static uint8_t debug_read_memory(zeal_t *machine, hwaddr virt_addr) {
-    const int phys_addr = mmu_get_phys_addr(&machine->mmu, virt_addr);
-    const map_entry_t *entry = &machine->mem_mapping[phys_addr / MMU_PAGE_SIZE];
-    device_t *device = entry->dev;
-    const int start_addr = entry->page_from * MMU_PAGE_SIZE;
-
-    if (device) {
-        return device->mem_region.debug_read ? device->mem_region.debug_read(device, phys_addr - start_addr)
-                                             : device->mem_region.read(device, phys_addr - start_addr);
-    }
-
-    log_printf("[INFO] No device replied to memory read: 0x%04x (PC @ 0x%04x)\n", phys_addr, machine->cpu.pc);
-    return 0;
-}
-#endif
-
-static void zeal_mem_write(void *opaque, uint16_t virt_addr, uint8_t data) {
-    const zeal_t *machine = (zeal_t *)opaque;
+void zeal_bus_mem_write_slow(zeal_t *machine, uint16_t virt_addr, uint8_t data) {
     const int phys_addr = mmu_get_phys_addr(&machine->mmu, virt_addr);
+    zeal_code_modified(machine, phys_addr);
     const map_entry_t *entry = &machine->mem_mapping[phys_addr / MMU_PAGE_SIZE];
     device_t *device = entry->dev;
     const int start_addr = entry->page_from * MMU_PAGE_SIZE;
@@ -141,7 +88,8 @@ static void zeal_phys_mem_write(void *opaque, uint32_t phys_addr, uint8_t data)
         log_printf("[INFO] Invalid physical address memory write: 0x%04x\n", phys_addr);
         return;
     }
-    const zeal_t *machine = (zeal_t *)opaque;
+    zeal_t *machine = (zeal_t *)opaque;
+    zeal_code_modified(machine, phys_addr);
     const map_entry_t *entry = &machine->mem_mapping[phys_addr / MMU_PAGE_SIZE];
     device_t *device = entry->dev;
     const int start_addr = entry->page_from * MMU_PAGE_SIZE;
@@ -153,32 +101,271 @@ static void zeal_phys_mem_write(void *opaque, uint32_t phys_addr, uint8_t data)
     }
 }
 
-static uint8_t zeal_io_read(void *opaque, uint16_t addr) {
+typedef enum {
+    BLOCK_READ,
+    BLOCK_DEBUG_READ,
+    BLOCK_WRITE,
+} block_op_t;
+
+/**
+ * @brief Copy a block between the physical memory space and `buf`, split at the 16KB pages since each
+ * of them may belong to a different device
+ */
+static void zeal_phys_mem_block(zeal_t *machine, uint32_t phys_addr, uint8_t *buf, uint32_t len, block_op_t op) {
+    while (len > 0) {
+        if (phys_addr >= MEM_SPACE_SIZE) {
+            log_printf("[INFO] Invalid physical address memory block access: 0x%04x\n", phys_addr);
+            if (op != BLOCK_WRITE) {
+                memset(buf, 0, len);
+            }
+            return;
+        }
+        const uint32_t page_left = MMU_PAGE_SIZE - phys_addr % MMU_PAGE_SIZE;
+        const uint32_t count = len < page_left ? len : page_left;
+        const map_entry_t *entry = &machine->mem_mapping[phys_addr / MMU_PAGE_SIZE];
+        device_t *device = entry->dev;
+        const uint32_t dev_addr = phys_addr - entry->page_from * MMU_PAGE_SIZE;
+
+        if (device == NULL) {
+            log_printf("[INFO] No device replied to memory block access: 0x%04x\n", phys_addr);
+            if (op != BLOCK_WRITE) {
+                memset(buf, 0, count);
+            }
+        } else if (op == BLOCK_WRITE) {
+            zeal_code_modified(machine, phys_addr);
+            device_write_block(device, dev_addr, buf, count);
+        } else if (op == BLOCK_DEBUG_READ && device->mem_region.debug_read) {
+            /* Write-only areas can still be read by the debugger */
+            for (uint32_t i = 0; i < count; i++) {
+                buf[i] = device->mem_region.debug_read(device, dev_addr + i);
+            }
+        } else {
+            device_read_block(device, dev_addr, buf, count);
+        }
+        phys_addr += count;
+        buf += count;
+        len -= count;
+    }
+}
+
+/**
+ * @brief Same as `zeal_phys_mem_block` but with a virtual address, split at the MMU pages
+ */
+static void zeal_mem_block(zeal_t *machine, uint16_t virt_addr, uint8_t *buf, uint32_t len, block_op_t op) {
+    while (len > 0) {
+        const uint32_t page_left = MMU_PAGE_SIZE - virt_addr % MMU_PAGE_SIZE;
+        const uint32_t count = len < page_left ? len : page_left;
+        zeal_phys_mem_block(machine, mmu_get_phys_addr(&machine->mmu, virt_addr), buf, count, op);
+        virt_addr += count;
+        buf += count;
+        len -= count;
+    }
+}
+
+void zeal_bus_read_block(zeal_t *machine, uint16_t virt_addr, uint8_t *dst, uint32_t len) {
+    zeal_mem_block(machine, virt_addr, dst, len, BLOCK_READ);
+}
+
+void zeal_bus_write_block(zeal_t *machine, uint16_t virt_addr, const uint8_t *src, uint32_t len) {
+    /* The buffer is only read in write mode */
+    zeal_mem_block(machine, virt_addr, (uint8_t *)src, len, BLOCK_WRITE);
+}
+
+void zeal_bus_phys_read_block(zeal_t *machine, uint32_t phys_addr, uint8_t *dst, uint32_t len) {
+    zeal_phys_mem_block(machine, phys_addr, dst, len, BLOCK_READ);
+}
+
+void zeal_bus_phys_write_block(zeal_t *machine, uint32_t phys_addr, const uint8_t *src, uint32_t len) {
+    zeal_phys_mem_block(machine, phys_addr, (uint8_t *)src, len, BLOCK_WRITE);
+}
+
+static void zeal_phys_mem_read_bytes(void *opaque, uint32_t phys_addr, uint8_t *dst, size_t len) {
+    zeal_bus_phys_read_block((zeal_t *)opaque, phys_addr, dst, len);
+}
+
+static void zeal_phys_mem_write_bytes(void *opaque, uint32_t phys_addr, const uint8_t *src, size_t len) {
+    zeal_bus_phys_write_block((zeal_t *)opaque, phys_addr, src, len);
+}
+
+/**
+ * @brief RAM and VRAM can be copied in bulk, they support block operations in both directions
+ */
+static bool zeal_phys_mem_plain(void *opaque, uint32_t phys_addr) {
+    const zeal_t *machine = (zeal_t *)opaque;
+    if (phys_addr >= MEM_SPACE_SIZE) {
+        return false;
+    }
+    const device_t *device = machine->mem_mapping[phys_addr / MMU_PAGE_SIZE].dev;
+    return device && device->mem_region.read_block && device->mem_region.write_block;
+}
+
+/**
+ * @brief Another bus master, such as the DMA controller, holds the bus: the CPU waits for it
+ */
+static void zeal_bus_stall(void *opaque, unsigned long tstates) {
     zeal_t *machine = (zeal_t *)opaque;
-    const int low = addr & 0xff;
-    const map_entry_t *entry = &machine->io_mapping[low];
+    machine->cpu.cyc += tstates;
+}
+
+#if CONFIG_ENABLE_DEBUGGER
+/**
+ * @brief Read memory for the debugger, so write-only areas can still be read. The address is physical when
+ * its upper bit is set.
+ */
+static void debug_read_memory(zeal_t *machine, hwaddr addr, uint8_t *dst, uint32_t len) {
+    if (addr & 0x80000000) {
+        zeal_phys_mem_block(machine, addr & 0x7fffffff, dst, len, BLOCK_DEBUG_READ);
+    } else {
+        zeal_mem_block(machine, addr, dst, len, BLOCK_DEBUG_READ);
+    }
+}
+#endif
+
+/**
+ * @brief Callback invoked by the MMU to get the host pointer of a 16KB physical page
+ */
+static uint8_t *zeal_mem_direct(void *opaque, uint32_t phys_addr, bool write) {
+    const zeal_t *machine = (zeal_t *)opaque;
+    if (phys_addr >= MEM_SPACE_SIZE) {
+        return NULL;
+    }
+    const map_entry_t *entry = &machine->mem_mapping[phys_addr / MMU_PAGE_SIZE];
     device_t *device = entry->dev;
 
-    if (device && device->io_region.read) {
-        device->io_region.upper_addr = addr >> 8;
-        return device->io_region.read(device, low - entry->page_from);
+    if (device == NULL || device->mem_region.direct == NULL) {
+        return NULL;
     }
+    return device->mem_region.direct(device, phys_addr - entry->page_from * MMU_PAGE_SIZE, write);
+}
 
-    log_printf("[INFO] No device replied to I/O read: 0x%04x\n", low);
-    return 0;
+/**
+ * @brief Callback invoked by a memory device when its direct pointers changed
+ */
+static void zeal_mem_direct_changed(void *opaque) {
+    zeal_t *machine = (zeal_t *)opaque;
+    mmu_refresh(&machine->mmu);
+    /* The content behind the pointers may have changed too (flash programmed or erased) */
+    zeal_code_modified_all(machine);
 }
 
-static void zeal_io_write(void *opaque, uint16_t addr, uint8_t data) {
+/**
+ * @brief Callback invoked by the MMU when a physical page is unmapped, the CPU may be running code decoded
+ * from it and must not continue with it.
+ */
+static void zeal_mem_unmapped(void *opaque, uint32_t phys_addr) {
+    zeal_code_modified((zeal_t *)opaque, phys_addr);
+}
+
+/**
+ * @brief Check whether the CPU can skip a loop polling the given port
+ */
+static bool zeal_cpu_idle_read(void *opaque, uint16_t addr) {
     zeal_t *machine = (zeal_t *)opaque;
     const int low = addr & 0xff;
     const map_entry_t *entry = &machine->io_mapping[low];
     device_t *device = entry->dev;
 
-    if (device && device->io_region.write) {
-        device->io_region.write(device, low - entry->page_from, data);
-    } else {
-        log_printf("[INFO] No device replied to I/O write: 0x%04x\n", low);
+    return device && device->io_region.stable && device->io_region.stable(device, low - entry->page_from);
+}
+
+/**
+ * @brief Hook called by the CPU after each instruction when a breakpoint may need to stop the run.
+ */
+static bool zeal_cpu_breakpoint(void *opaque, uint16_t pc) {
+    zeal_t *machine = (zeal_t *)opaque;
+    if (machine->args.no_reset && pc == 0) {
+        return true;
+    }
+    if (machine->stop_pc_enabled && pc == machine->stop_pc) {
+        return true;
+    }
+#if CONFIG_ENABLE_DEBUGGER
+    if (machine->dbg_enabled && debugger_is_breakpoint_set(&machine->dbg, pc)) {
+        return true;
     }
+#else
+    (void)machine;
+#endif  // CONFIG_ENABLE_DEBUGGER
+    return false;
+}
+
+/**
+ * @brief Only install the breakpoint hook when it can stop the CPU, to keep the run loop tight otherwise.
+ */
+void zeal_update_cpu_hooks(zeal_t *machine) {
+    bool needed = machine->args.no_reset || machine->stop_pc_enabled;
+#if CONFIG_ENABLE_DEBUGGER
+    needed = needed || machine->dbg_enabled;
+#endif  // CONFIG_ENABLE_DEBUGGER
+    machine->cpu.breakpoint = needed ? zeal_cpu_breakpoint : NULL;
+}
+
+_Static_assert(MMU_PAGE_SIZE % Z80_DIRECT_PAGE_SIZE == 0, "CPU direct pages must not cross MMU pages");
+
+/**
+ * @brief Let the CPU access RAM and flash pages directly, used to run block instructions in bulk.
+ */
+static uint8_t *zeal_cpu_direct(void *opaque, uint16_t virt_addr, bool write) {
+    zeal_t *machine = (zeal_t *)opaque;
+    if (!write) {
+        return mmu_fast_read_ptr(&machine->mmu, virt_addr);
+    }
+    uint8_t *host = mmu_fast_write_ptr(&machine->mmu, virt_addr);
+    if (host) {
+        zeal_code_modified(machine, mmu_get_phys_addr(&machine->mmu, virt_addr));
+    }
+    return host;
+}
+
+#if CONFIG_Z80_BLOCK_CACHE
+/**
+ * @brief Let the CPU cache the code of RAM and flash pages, keyed on their physical address.
+ */
+static const uint32_t *zeal_cpu_code_page(void *opaque, uint16_t virt_addr, uint32_t *phys_addr) {
+    const zeal_t *machine = (zeal_t *)opaque;
+    if (mmu_fast_read_ptr(&machine->mmu, virt_addr) == NULL) {
+        return NULL;
+    }
+    *phys_addr = mmu_get_phys_addr(&machine->mmu, virt_addr);
+    return &machine->code_gen[*phys_addr / MMU_PAGE_SIZE];
+}
+
+void zeal_mem_gens(const zeal_t *machine, const device_t *dev, uint32_t offset, size_t size, uint32_t *gens) {
+    memset(gens, 0, (size + MMU_PAGE_SIZE - 1) / MMU_PAGE_SIZE * sizeof(uint32_t));
+
+    for (int page = 0; page < MEM_MAPPING_SIZE; page++) {
+        const map_entry_t *entry = &machine->mem_mapping[page];
+        if (entry->dev != dev) {
+            continue;
+        }
+        const uint32_t dev_addr = (page - entry->page_from) * MMU_PAGE_SIZE;
+        if (dev_addr >= offset && dev_addr - offset < size) {
+            gens[(dev_addr - offset) / MMU_PAGE_SIZE] += machine->code_gen[page];
+        }
+    }
+}
+
+void zeal_mem_modified(zeal_t *machine, const device_t *dev, uint32_t offset, size_t size) {
+    for (int page = 0; page < MEM_MAPPING_SIZE; page++) {
+        const map_entry_t *entry = &machine->mem_mapping[page];
+        if (entry->dev != dev) {
+            continue;
+        }
+        const uint32_t dev_addr = (page - entry->page_from) * MMU_PAGE_SIZE;
+        if (dev_addr + MMU_PAGE_SIZE > offset && dev_addr < offset + size) {
+            machine->code_gen[page]++;
+        }
+    }
+}
+#endif  // CONFIG_Z80_BLOCK_CACHE
+
+/**
+ * @brief Called by the scheduler when its earliest deadline changes, so that a device scheduling an
+ * event in the middle of a CPU run (flash programming, keyboard, ...) gets it dispatched on time.
+ */
+static void zeal_sched_listener(void *arg, unsigned long next) {
+    zeal_t *machine = (zeal_t *)arg;
+    z80_shorten_run(&machine->cpu, next);
 }
 
 /**
@@ -187,10 +374,18 @@ static void zeal_io_write(void *opaque, uint16_t addr, uint8_t data) {
 static void zeal_init_cpu(zeal_t *machine) {
     z80_init(&machine->cpu);
     machine->cpu.userdata = (void *)machine;
-    machine->cpu.read_byte = zeal_mem_read;
-    machine->cpu.write_byte = zeal_mem_write;
-    machine->cpu.port_in = zeal_io_read;
-    machine->cpu.port_out = zeal_io_write;
+    machine->cpu.read_byte = zeal_bus_mem_read;
+    machine->cpu.write_byte = zeal_bus_mem_write;
+    machine->cpu.port_in = zeal_bus_io_read;
+    machine->cpu.port_out = zeal_bus_io_write;
+    machine->cpu.direct = zeal_cpu_direct;
+    machine->cpu.idle_read = zeal_cpu_idle_read;
+#if CONFIG_Z80_BLOCK_CACHE
+    z80_cache_flush(&machine->cpu_cache);
+    machine->cpu.cache = &machine->cpu_cache;
+    machine->cpu.code_page = zeal_cpu_code_page;
+#endif  // CONFIG_Z80_BLOCK_CACHE
+    zeal_update_cpu_hooks(machine);
 }
 
 static void zeal_add_io_device(zeal_t *machine, int region_start, device_t *dev) {
@@ -239,87 +434,26 @@ static void zeal_add_mem_device(zeal_t *machine, const int region_start, device_
         }
         *entry = (map_entry_t){.dev = dev, .page_from = start_page};
     }
-}
-
-static int key_can_repeat(int code) {
-    const int modifiers[] = {KEY_LEFT_SHIFT,    KEY_LEFT_CONTROL, KEY_LEFT_ALT,    KEY_LEFT_SUPER, KEY_RIGHT_SHIFT,
-                             KEY_RIGHT_CONTROL, KEY_RIGHT_ALT,    KEY_RIGHT_SUPER, KEY_CAPS_LOCK,  KEY_NUM_LOCK};
-
-    for (unsigned int i = 0; i < DIM(modifiers); i++) {
-        if (modifiers[i] == code) {
-            return false;
-        }
-    }
-    return true;
-}
 
-static void zeal_read_keyboard_reset(zeal_t *machine) {
-    (void)machine;
-    /* Clear Raylib's key states */
-    while (GetKeyPressed()) {}
-
-    for (int i = 0; i < RAYLIB_KEY_COUNT; i++) {
-        RAYLIB_KEYS[i].duration = 0;
-        RAYLIB_KEYS[i].state = KEY_NOT_PRESSED;
-    }
+    device_register_direct_changed(dev, zeal_mem_direct_changed, machine);
 }
 
-static void zeal_read_keyboard(zeal_t *machine, int delta) {
-    int keyCode;
-
-    /* The initial delay is ~500ms before repeat starts */
-    const int start_delay = us_to_tstates(500000);
-    /* Then, repeat the key every 50ms */
-    const int repeat_delay = us_to_tstates(50000);
-
-    // look for newly pressed keys
-    while ((keyCode = GetKeyPressed())) {
-        RAYLIB_KEYS[keyCode].state = KEY_PRESSED;
-        RAYLIB_KEYS[keyCode].duration = 0;
-        key_pressed(&machine->keyboard, keyCode);
-    }
-
-    // look for newly released keys
-    for (keyCode = 0; keyCode < RAYLIB_KEY_COUNT; keyCode++) {
-        kb_keys_t *key = &RAYLIB_KEYS[keyCode];
-
-        if (key->state == KEY_NOT_PRESSED) {
-            continue;
-        }
-
-        if (IsKeyUp(keyCode)) {
-            key->state = KEY_NOT_PRESSED;
-            /* No need to clear the duration, it's done when the key is pressed */
-            key_released(&machine->keyboard, keyCode);
-            continue;
-        }
-
-        /* Key is still pressed, add the current delta to its duration and check it */
-        key->duration += delta;
-
-        if (key->state == KEY_PRESSED && key_can_repeat(keyCode) && key->duration >= start_delay) {
-            key_pressed(&machine->keyboard, keyCode);
-            key->state = KEY_REPEATED;
-            key->duration = 0;
-        } else if (key->state == KEY_REPEATED && key->duration >= repeat_delay) {
-            key->duration = 0;
-            key_pressed(&machine->keyboard, keyCode);
-        }
-    }
-}
-
-static memory_op_t s_ops = {
-    .read_byte = zeal_mem_read,
-    .write_byte = zeal_mem_write,
+static const memory_op_t s_ops = {
+    .read_byte = zeal_bus_mem_read,
+    .write_byte = zeal_bus_mem_write,
     .phys_read_byte = zeal_phys_mem_read,
     .phys_write_byte = zeal_phys_mem_write,
+    .phys_read_bytes = zeal_phys_mem_read_bytes,
+    .phys_write_bytes = zeal_phys_mem_write_bytes,
+    .phys_plain = zeal_phys_mem_plain,
+    .stall = zeal_bus_stall,
 };
 
 int zeal_reset(zeal_t *machine) {
+    /* The scheduler deadlines are based on the cycle counter, keep it running across resets */
+    const unsigned long cyc = machine->cpu.cyc;
     zeal_init_cpu(machine);
-    if (!machine->headless) {
-        zeal_read_keyboard_reset(machine);
-    }
+    machine->cpu.cyc = cyc;
     device_reset(DEVICE(&machine->mmu));
     device_reset(DEVICE(&machine->keyboard));
     if (!machine->headless) {
@@ -331,73 +465,38 @@ int zeal_reset(zeal_t *machine) {
         machine->dbg_state = ST_PAUSED;
     }
 #endif  // CONFIG_ENABLE_DEBUGGER
+    if (machine->on_reset) {
+        machine->on_reset(machine);
+    }
     return 0;
 }
 
-int zeal_init(zeal_t *machine) {
+int zeal_init_args(zeal_t *machine, const config_arguments_t *args) {
     int err = 0;
-    if (machine == NULL) {
+    if (machine == NULL || args == NULL) {
         return 1;
     }
 
-    /* It wouldn't make sense to have two machines now... */
-    if (s_ops.opaque != NULL) {
-        log_err_printf("[ZEAL] ERROR: machine already initialized\n");
-        return 2;
-    }
-    s_ops.opaque = machine;
-
     memset(machine, 0, sizeof(*machine));
-    machine->headless = config.arguments.headless;
+    machine->args = *args;
+    machine->mem_ops = s_ops;
+    machine->mem_ops.opaque = machine;
+    machine->headless = args->headless;
 #if CONFIG_ENABLE_DEBUGGER
     machine->dbg_read_memory = debug_read_memory;
     machine->dbg.running = true;
-    /* Set the debug mode in the machine structure as soon as possible */
-    machine->dbg_enabled = config_debugger_enabled() && !machine->headless;
 #endif  // CONFIG_ENABLE_DEBUGGER
 
-    if (!machine->headless) {
-        /* Initialize the UI. It must be done before any shader is created! */
-        SetTraceLogLevel(WIN_LOG_LEVEL);
-#ifndef PLATFORM_WEB
-        SetConfigFlags(FLAG_WINDOW_RESIZABLE);
-#endif
-
-        /* initialize raylib window */
-        InitWindow(640, 480, WIN_NAME);
-        SetExitKey(KEY_NULL);
-#ifndef PLATFORM_WEB
-        SetWindowFocused();  // force focus on the window to capture keypresses
-#endif
-#if !BENCHMARK
-        SetTargetFPS(60);
-#endif
-
-        /* Since we want to enable scaling, make the ZVB output always go to a texture first */
-        machine->zvb_out = LoadRenderTexture(ZVB_MAX_RES_WIDTH, ZVB_MAX_RES_HEIGHT);
-
-#if CONFIG_ENABLE_DEBUGGER
-        config_window_set(machine->dbg_enabled);
-        /* Initialize the debugger */
-        zeal_debugger_init(machine, &machine->dbg);
-        /* Load symbols if provided */
-        if (config.arguments.map_file) {
-            debugger_load_symbols(&machine->dbg, config.arguments.map_file);
-        }
-        if (config.arguments.breakpoints) {
-            debugger_set_breakpoints_str(&machine->dbg, config.arguments.breakpoints);
-        }
-#endif  // CONFIG_ENABLE_DEBUGGER
-    }
-
     zeal_init_cpu(machine);
+    sched_init(&machine->sched, &machine->cpu.cyc);
+    sched_set_listener(&machine->sched, zeal_sched_listener, machine);
 
     // const mmu = new MMU();
     err = mmu_init(&machine->mmu);
     CHECK_ERR(err);
 
     // const rom = new ROM(this);
-    err = (int)flash_init(&machine->rom);
+    err = (int)flash_init(&machine->rom, &machine->sched);
     CHECK_ERR(err);
 
     // const ram = new RAM(512*KB);
@@ -418,7 +517,7 @@ int zeal_init(zeal_t *machine) {
     CHECK_ERR(err);
 
     // const keyboard = new Keyboard(this, pio);
-    err = keyboard_init(&machine->keyboard, &machine->pio);
+    err = keyboard_init(&machine->keyboard, &machine->pio, &machine->sched);
     CHECK_ERR(err);
 
     // const ds1307 = new I2C_DS1307(this, i2c);
@@ -430,11 +529,11 @@ int zeal_init(zeal_t *machine) {
 
     // /* Extensions */
     // const compactflash = new CompactFlash(this);
-    const int cf_err = compactflash_init(&machine->compactflash, config.arguments.cf_filename);
+    const int cf_err = compactflash_init(&machine->compactflash, args->cf_filename);
 
     // /* We could pass an initial content to the EEPROM, but set it to null for the moment */
     // const eeprom = new I2C_EEPROM(this, i2c, null);
-    err = at24c512_init(&machine->eeprom, config.arguments.eeprom_filename);
+    err = at24c512_init(&machine->eeprom, args->eeprom_filename);
     CHECK_ERR(err);
 
     err = i2c_connect(&machine->i2c_bus, &machine->eeprom.parent);
@@ -449,11 +548,15 @@ int zeal_init(zeal_t *machine) {
 
     zeal_add_mem_device(machine, 0x080000, &machine->ram.parent);
     if (!machine->headless) {
-        err = zvb_init(&machine->zvb, false, &s_ops);
+        err = zvb_init(&machine->zvb, &machine->mem_ops, &machine->sched);
         CHECK_ERR(err);
         zeal_add_mem_device(machine, 0x100000, &machine->zvb.parent);
     }
 
+    /* The memory map is complete, the MMU can now resolve the RAM and flash pages to host pointers */
+    mmu_set_resolver(&machine->mmu, zeal_mem_direct, machine);
+    mmu_set_unmap_listener(&machine->mmu, zeal_mem_unmapped, machine);
+
     /* Register the devices in the I/O space */
     if (cf_err == 0) {
         zeal_add_io_device(machine, 0x70, &machine->compactflash.parent);
@@ -465,262 +568,99 @@ int zeal_init(zeal_t *machine) {
     zeal_add_io_device(machine, 0xe0, &machine->keyboard.parent);
     zeal_add_io_device(machine, 0xf0, &machine->mmu.parent);
 
-#if CONFIG_ENABLE_DEBUGGER
-    /* Since the debugger may depend on some components, make sure they are all initialized */
-    if (machine->dbg_enabled) {
-        zeal_debug_enable(machine);
-        /* Force the machine in RUNNING mode */
-        machine->dbg_state = ST_RUNNING;
-    }
-#endif  // CONFIG_ENABLE_DEBUGGER
-
     return 0;
 }
 
-/**
- * @brief Run Zeal 8-bit Computer VM in headless mode (no rendering/input)
- */
-static int zeal_headless_mode_run(zeal_t *machine) {
-    const int elapsed_tstates = z80_step(&machine->cpu);
-    if (config.arguments.no_reset && machine->cpu.pc == 0) {
-        /* PC is back to 0, that's a software reset! */
-        log_printf("[ZEAL] PC returned to 0x0000 after running (cyc=%lu), exiting\n", machine->cpu.cyc);
-        zeal_exit(machine);
-        return 0;
+int zeal_insert_user_program(zeal_t *machine, const char *uprog_filename) {
+    if (flash_load_user_program(&machine->rom, uprog_filename) != FLASH_ERR_OK) {
+        return 1;
     }
-
-    keyboard_tick(&machine->keyboard, &machine->pio, elapsed_tstates);
-    flash_tick(&machine->rom, elapsed_tstates);
+#if CONFIG_Z80_BLOCK_CACHE
+    /* The flash was written behind the CPU's back, drop whatever it decoded from it */
+    z80_cache_flush(&machine->cpu_cache);
+#endif
     return 0;
 }
 
-
-#if CONFIG_ENABLE_DEBUGGER
-int zeal_debug_enable(zeal_t *machine) {
-    if (machine->headless) {
-        return -1;
+int zeal_insert_cf(zeal_t *machine, const char *cf_filename) {
+    compactflash_deinit(&machine->compactflash);
+    if (compactflash_init(&machine->compactflash, cf_filename) != 0) {
+        /* Leave the slot empty rather than with a closed image */
+        for (int i = 0; i < IO_MAPPING_SIZE; i++) {
+            if (machine->io_mapping[i].dev == &machine->compactflash.parent) {
+                machine->io_mapping[i] = (map_entry_t){0};
+            }
+        }
+        return 1;
     }
-    config_window_update(machine->dbg_enabled);
-    int ret = 0;
-    machine->dbg_enabled = true;
-    machine->dbg_state = ST_PAUSED;
-    config_window_set(true);
-    if (machine->dbg_ui == NULL) {
-        dbg_ui_init_args_t args = {
-            .main_view = &machine->zvb_out,
-            .zvb = &machine->zvb,
-        };
-        args.debug_views = zvb_get_debug_textures(&machine->zvb, &args.debug_views_count);
-        ret = debugger_ui_init(&machine->dbg_ui, &args);
-    }
-    return ret;
-}
-
-int zeal_debug_disable(zeal_t *machine) {
-    config_window_update(machine->dbg_enabled);
-    machine->dbg_enabled = false;
-    machine->dbg_state = ST_RUNNING;
-    config_window_set(false);
+    zeal_add_io_device(machine, 0x70, &machine->compactflash.parent);
     return 0;
 }
 
-void zeal_debug_toggle(dbg_t *dbg) {
-    if (dbg == NULL)
-        return;
-    zeal_t *machine = (zeal_t *)(dbg->arg);
+int zeal_private_images(zeal_t *machine) {
+    at24c512_detach(&machine->eeprom);
+    return compactflash_use_copy(&machine->compactflash);
+}
 
-    if (machine->dbg_enabled) {
-        log_printf("[DEBUGGER]: Disabled\n");
-        zeal_debug_disable(machine);
-    } else {
-        log_printf("[DEBUGGER]: Enabled\n");
-        zeal_debug_enable(machine);
-    }
+void zeal_deinit(zeal_t *machine) {
+#if CONFIG_Z80_BLOCK_CACHE
+    z80_cache_release(&machine->cpu_cache);
+#endif
+    compactflash_deinit(&machine->compactflash);
+    at24c512_deinit(&machine->eeprom);
+    fifo_deinit(&machine->keyboard.queue);
+#if CONFIG_NOR_FLASH_DYNAMIC_ARRAY
+    free(machine->rom.data);
+    machine->rom.data = NULL;
+#endif
+#if CONFIG_RAM_DYNAMIC_ARRAY
+    free(machine->ram.data);
+    machine->ram.data = NULL;
+#endif
 }
 
 /**
- * Returns 1 if rendered, 0 else
+ * @brief Check whether the CPU performed a software reset and the emulator must exit because of it.
  */
-static int zeal_dbg_mode_display(zeal_t *machine) {
-    /**
-     * Prepare the rendering, if the returned value is true, we can
-     * proceed to rendering, else, we don't need to update the view.
-     * However, if the CPU is paused (breakpoint/step), force the rendering.
-     */
-    if (zvb_prepare_render(&machine->zvb)) {
-        /* Display all the devices that have a render function */
-        BeginTextureMode(machine->zvb_out);
-        zvb_render(&machine->zvb);
-        EndTextureMode();
-    } else if (machine->dbg_state == ST_PAUSED) {
-        /* No need for `prepare` in this case */
-        BeginTextureMode(machine->zvb_out);
-        zvb_force_render(&machine->zvb);
-        EndTextureMode();
-    } else {
-        /* Do not proceed, the CPU is currently running and the ZVB doens't need to be refreshed yet */
-        return 0;
-    }
-
-    /* Generate VRAM debug textures if the VRAM debugging window is opened */
-    if (debugger_ui_vram_panel_opened(machine->dbg_ui)) {
-        zvb_render_debug_textures(&machine->zvb);
-    }
-
-    debugger_ui_prepare_render(machine->dbg_ui, &machine->dbg);
-    BeginDrawing();
-    /* Grey brackground */
-    ClearBackground((Color){0x63, 0x63, 0x63, 0xff});
-    debugger_ui_render(machine->dbg_ui, &machine->dbg);
-    if (show_fps == true) {
-        DrawFPS(10, 10);
+static inline bool zeal_check_no_reset(zeal_t *machine) {
+    if (machine->args.no_reset && machine->cpu.pc == 0) {
+        /* PC is back to 0, that's a software reset! */
+        log_printf("[ZEAL] PC returned to 0x0000 after running (cyc=%lu), exiting\n", machine->cpu.cyc);
+        zeal_exit(machine);
+        return true;
     }
-
-    EndDrawing();
-
-    return 1;
+    return false;
 }
 
-/**
- * @brief Run Zeal 8-bit Computer VM in debug mode
- */
-static int zeal_dbg_mode_run(zeal_t *machine) {
-    if (machine->dbg_state != ST_PAUSED) {
-        if (machine->dbg_state == ST_REQ_STEP_OVER) {
-            int instr_size = z80_instruction_size(&machine->cpu);
-            debugger_set_temporary_breakpoint(&machine->dbg, machine->cpu.pc + instr_size);
-            machine->dbg_state = ST_RUNNING;
-        }
-
-        const int elapsed_tstates = z80_step(&machine->cpu);
-
-        /* Check if we need to poll the keyboard and transmit the data to the VM */
-        if (keyboard_check(&machine->keyboard, elapsed_tstates) &&
-            /* make sure the current keys are not a UI shortcut and the main view is focused */
-            !zeal_ui_input(machine) && debugger_ui_main_view_focused(machine->dbg_ui)) {
-            zeal_read_keyboard(machine, elapsed_tstates);
-        }
-
-        /* Go through all the devices that have a tick function */
-        zvb_tick(&machine->zvb, elapsed_tstates);
-        keyboard_tick(&machine->keyboard, &machine->pio, elapsed_tstates);
-        flash_tick(&machine->rom, elapsed_tstates);
-
-        /* Check if we reached a breakpoint or if we have to do a single step */
-        if (machine->dbg_state == ST_REQ_STEP || debugger_is_breakpoint_set(&machine->dbg, machine->cpu.pc)) {
-            machine->dbg_state = ST_PAUSED;
-            debugger_clear_breakpoint_if_temporary(&machine->dbg, machine->cpu.pc);
+bool zeal_run_until_event(zeal_t *machine) {
+    unsigned long budget = sched_remaining(&machine->sched);
+    if (machine->cycle_limit != 0) {
+        const unsigned long left = sched_before(machine->cpu.cyc, machine->cycle_limit) ?
+                                       machine->cycle_limit - machine->cpu.cyc : 0;
+        if (left < budget) {
+            budget = left;
         }
     }
-
-    int rendered = zeal_dbg_mode_display(machine);
-    /* If the CPU is paused, we didn't check the UI input! Check it once per frame */
-    if (rendered && machine->dbg_state == ST_PAUSED) {
-        zeal_ui_input(machine);
+    z80_run(&machine->cpu, budget);
+    if (zeal_check_no_reset(machine)) {
+        return false;
     }
-    return rendered;
-}
-#endif  // CONFIG_ENABLE_DEBUGGER
-
-/**
- * @brief Run Zeal 8-bit Computer VM in normal mode.
- *
- * Returns 1 if the screen was rendered, 0 else
- */
-static int zeal_normal_mode_run(zeal_t *machine) {
-    int rendered = 0;
-    const int elapsed_tstates = z80_step(&machine->cpu);
-    if (config.arguments.no_reset && machine->cpu.pc == 0) {
-        /* PC is back to 0, that's a software reset!
-         * Return 2 to tell the caller we rendered 2 frames, forcing it to exit the current loop and
-         * check for the close/exit flag */
-        log_printf("[ZEAL] PC returned to 0x0000 after running (cyc=%lu), exiting\n", machine->cpu.cyc);
+    if (machine->stop_pc_enabled && machine->cpu.pc == machine->stop_pc) {
         zeal_exit(machine);
-        return 2;
+        return false;
     }
-
-    /* Send keyboard keys to Zeal VM only if the UI didn't handle it */
-    if (keyboard_check(&machine->keyboard, elapsed_tstates)
-#if CONFIG_ENABLE_DEBUGGER
-        && !zeal_ui_input(machine)
-#endif
-    ) {
-        zeal_read_keyboard(machine, KEYBOARD_CHECK_PERIOD);
+    if (sched_due(&machine->sched)) {
+        sched_dispatch(&machine->sched);
     }
-
-    /* Go through all the devices that have a tick function */
-    zvb_tick(&machine->zvb, elapsed_tstates);
-    keyboard_tick(&machine->keyboard, &machine->pio, elapsed_tstates);
-    flash_tick(&machine->rom, elapsed_tstates);
-
-    if (zvb_prepare_render(&machine->zvb)) {
-        rendered = 1;
-        const int screen_w = GetScreenWidth();
-        const int screen_h = GetScreenHeight();
-        const float texture_ratio = (float)ZVB_MAX_RES_WIDTH / ZVB_MAX_RES_HEIGHT;
-        const float screen_ratio = (float)screen_w / screen_h;
-
-        int pos_x = 0;
-        int pos_y = 0;
-
-        int draw_w = ZVB_MAX_RES_WIDTH;
-        int draw_h = ZVB_MAX_RES_HEIGHT;
-
-        if (texture_ratio > screen_ratio) {
-            /* Texture is "wider" than the screen, add bars on top/bottom */
-            draw_w = screen_w;
-            draw_h = (int)(screen_w / texture_ratio);
-            pos_y = (screen_h - draw_h) / 2;
-        } else {
-            /* Texture is "taller" than the screen, add bars on left/right */
-            draw_h = screen_h;
-            draw_w = (int)(screen_h * texture_ratio);
-            pos_x = (screen_w - draw_w) / 2;
-        }
-
-        BeginTextureMode(machine->zvb_out);
-        zvb_render(&machine->zvb);
-        EndTextureMode();
-
-        BeginDrawing();
-        ClearBackground(DARKGRAY);
-        DrawTexturePro(machine->zvb_out.texture, (Rectangle){0, 0, ZVB_MAX_RES_WIDTH, ZVB_MAX_RES_HEIGHT},
-                       (Rectangle){pos_x, pos_y, draw_w, draw_h}, (Vector2){0, 0}, 0.0f, WHITE);
-        if (show_fps == true) {
-            DrawFPS(10, 10);
-        }
-        EndDrawing();
-    }
-    return rendered;
+    return true;
 }
 
-static void zeal_loop(zeal_t *machine) {
-    if (machine->headless) {
-        zeal_headless_mode_run(machine);
-        return;
-    }
-    int rendered = 0;
-    /**
-     * When compiling for WASM, it is not necessary to execute WindowShouldClose as often as possible.
-     * On the contrary, calling it too much would slow the emulation heavily!
-     * Calling it once every two rendered frames should be enough to get a stable 60FPS.
-     *
-     * When compiling as a native appliaction, it is necessarily to call it more often, let's call it
-     * once per frame, just like in Raylib examples.
-     */
-#if PLATFORM_WEB
-    while (rendered < 2) {
-#else
-    while (rendered < 1) {
-#endif
-
-#if CONFIG_ENABLE_DEBUGGER
-        if (machine->dbg_enabled) {
-            rendered += zeal_dbg_mode_run(machine);
-        } else
-#endif  // CONFIG_ENABLE_DEBUGGER
-        {
-            rendered += zeal_normal_mode_run(machine);
+void zeal_run_frame(zeal_t *machine) {
+    const unsigned long end = machine->cpu.cyc + ZEAL_FRAME_TSTATES;
+    while (!machine->should_exit && sched_before(machine->cpu.cyc, end)) {
+        zeal_run_until_event(machine);
+        if (machine->cycle_limit != 0 && !sched_before(machine->cpu.cyc, machine->cycle_limit)) {
+            zeal_exit(machine);
         }
     }
 }
@@ -730,46 +670,12 @@ void zeal_exit(zeal_t *machine) {
 }
 
 int zeal_run(zeal_t *machine) {
-    int ret = 0;
-
     if (machine == NULL) {
         return -1;
     }
 
-    while (!machine->should_exit && (machine->headless || !WindowShouldClose())) {
-#if CONFIG_ENABLE_DEBUGGER
-        if (!machine->dbg.running) {
-            break;
-        }
-#endif  // CONFIG_ENABLE_DEBUGGER
-        zeal_loop(machine);
-    }
-
-#ifdef PLATFORM_WEB
-    if (!machine->headless) {
-        CloseAudioDevice();
-    }
-#endif
-
-#if CONFIG_ENABLE_DEBUGGER
-    if (!machine->headless) {
-        config_window_update(machine->dbg_enabled);
-
-        if (machine->dbg_ui != NULL) {
-            debugger_ui_deinit(machine->dbg_ui);
-        }
-    }
-#else
-    if (!machine->headless) {
-        config_window_update(false);
+    while (!machine->should_exit) {
+        zeal_run_frame(machine);
     }
-#endif  // CONFIG_ENABLE_DEBUGGER
-
-    if (!machine->headless) {
-        zvb_deinit(&machine->zvb);
-
-        CloseWindow();
-    }
-
-    return ret;
+    return 0;
 }
@@ -16,6 +16,8 @@
 
 #include "debugger/debugger.h"
 #include "hw/zeal.h"
+#include "hw/zeal_bus.h"
+#include "hw/zeal_rewind.h"
 #include "utils/log.h"
 
 #define MAKE16(a, b) ((a) << 8 | (b))
@@ -81,6 +83,8 @@ static void zeal_debugger_set_regs(dbg_t *dbg, regs_t *regs) {
     cpu->r = regs->r;
     cpu->ix = regs->ix;
     cpu->iy = regs->iy;
+    /* The history can't replay this change, start again from it */
+    zeal_rewind_checkpoint(machine->rewind);
 }
 
 /**
@@ -90,17 +94,14 @@ static int zeal_debugger_get_mem(dbg_t *dbg, hwaddr addr, int len, uint8_t *val)
     zeal_t *machine = (zeal_t *)(dbg->arg);
 
     /* If upper bit in 32-bit address is set, interpret it as a physical address */
-    if (addr & 0x80000000) {
-        log_printf("TODO: MEM PHYSICAL ADDRESS READ: %08x\n", addr);
-    } else if (addr <= 0xffff) {
-        for (int i = 0; i < len; i++) {
-            val[i] = machine->dbg_read_memory(machine, (uint16_t)(addr + i));
-        }
+    if ((addr & 0x80000000) || addr <= 0xffff) {
+        machine->dbg_read_memory(machine, addr, val, len);
     } else {
         // Invalid address
         return -1;
     }
 
+    zeal_rewind_checkpoint(machine->rewind);
     return 0;
 }
 
@@ -112,11 +113,9 @@ static int zeal_debugger_set_mem(dbg_t *dbg, hwaddr addr, int len, uint8_t *val)
 
     /* If upper bit in 32-bit address is set, interpret it as a physical address */
     if (addr & 0x80000000) {
-        log_printf("TODO: PHYSICAL ADDRESS WRITE\n");
+        zeal_bus_phys_write_block(machine, addr & 0x7fffffff, val, len);
     } else if (addr <= 0xffff) {
-        for (int i = 0; i < len; i++) {
-            machine->cpu.write_byte(machine, (uint16_t)(addr + i), val[i]);
-        }
+        zeal_bus_write_block(machine, addr, val, len);
     } else {
         // Invalid address
         return -1;
@@ -158,6 +157,26 @@ static void zeal_debugger_step_over_cb(dbg_t *dbg) {
     machine->dbg_state = ST_REQ_STEP_OVER;
 }
 
+static void zeal_debugger_step_back_cb(dbg_t *dbg) {
+    zeal_t *machine = (zeal_t *)(dbg->arg);
+    if (machine->rewind == NULL) {
+        log_printf("[DEBUGGER] The execution history is disabled\n");
+        return;
+    }
+    machine->dbg_state = ST_PAUSED;
+    zeal_rewind_step_back(machine->rewind);
+}
+
+static void zeal_debugger_reverse_continue_cb(dbg_t *dbg) {
+    zeal_t *machine = (zeal_t *)(dbg->arg);
+    if (machine->rewind == NULL) {
+        log_printf("[DEBUGGER] The execution history is disabled\n");
+        return;
+    }
+    machine->dbg_state = ST_PAUSED;
+    zeal_rewind_reverse_continue(machine->rewind);
+}
+
 static void zeal_debugger_breakpoint_cb(dbg_t *dbg) {
     zeal_t *machine = (zeal_t *)(dbg->arg);
 
@@ -410,6 +429,8 @@ int zeal_debugger_init(zeal_t *machine, dbg_t *dbg) {
     dbg->reset_cb = zeal_debugger_reset_cb;
     dbg->step_cb = zeal_debugger_step_cb;
     dbg->step_over_cb = zeal_debugger_step_over_cb;
+    dbg->step_back_cb = zeal_debugger_step_back_cb;
+    dbg->reverse_continue_cb = zeal_debugger_reverse_continue_cb;
     dbg->breakpoint_cb = zeal_debugger_breakpoint_cb;
     dbg->get_regs_cb = zeal_debugger_get_regs;
     dbg->set_regs_cb = zeal_debugger_set_regs;
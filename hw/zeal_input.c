@@ -16,6 +16,7 @@
 #include "debugger/debugger.h"
 #include "debugger/debugger_ui.h"
 #include "hw/zeal.h"
+#include "hw/zeal_window.h"
 
 typedef struct {
     bool pressed; // TODO: support key repeat with GetTime()??
@@ -53,6 +54,27 @@ static void main_reset(dbg_t *dbg) {
     dbg->reset_cb(dbg);
 }
 
+static void main_save_state(dbg_t *dbg) {
+    if (dbg == NULL) {
+        return;
+    }
+    (void)zeal_window_save_state((zeal_t *)dbg->arg);
+}
+
+static void main_load_state(dbg_t *dbg) {
+    if (dbg == NULL) {
+        return;
+    }
+    (void)zeal_window_load_state((zeal_t *)dbg->arg);
+}
+
+static void main_turbo(dbg_t *dbg) {
+    if (dbg == NULL) {
+        return;
+    }
+    zeal_window_toggle_turbo((zeal_t *)dbg->arg);
+}
+
 static debugger_key_t debugger_key_toggle = {
     .label = "Toggle Debugger",
     .key = KEY_F1,
@@ -65,6 +87,9 @@ static debugger_key_t main_keys[] = {
     { .label = "Scale Up", .key = KEY_EQUAL, .callback = main_scale_up, .pressed = false, .shifted = true },
     { .label = "Scale Down", .key = KEY_MINUS, .callback = main_scale_down, .pressed = false, .shifted = true },
     { .label = "Reset", .key = KEY_BACKSPACE, .callback = main_reset, .pressed = false, .shifted = true },
+    { .label = "Save State", .key = KEY_F2, .callback = main_save_state, .pressed = false, .shifted = false },
+    { .label = "Load State", .key = KEY_F3, .callback = main_load_state, .pressed = false, .shifted = false },
+    { .label = "Turbo", .key = KEY_F4, .callback = main_turbo, .pressed = false, .shifted = false },
 };
 
 static debugger_key_t debugger_keys[] = {
@@ -73,10 +98,14 @@ static debugger_key_t debugger_keys[] = {
     { .label = "Continue", .key = KEY_F5, .callback = debugger_continue, .pressed = false, .shifted = false },
     { .label = "Step Over", .key = KEY_F10, .callback = debugger_step_over, .pressed = false, .shifted = false },
     { .label = "Step", .key = KEY_F11, .callback = debugger_step, .pressed = false, .shifted = false },
+    { .label = "Step Back", .key = KEY_F11, .callback = debugger_step_back, .pressed = false, .shifted = true },
+    { .label = "Reverse Continue", .key = KEY_F5, .callback = debugger_reverse_continue, .pressed = false, .shifted = true },
     { .label = "Toggle Breakpoint", .key = KEY_F9, .callback = debugger_breakpoint, .pressed = false, .shifted = false },
     { .label = "Reset", .key = KEY_BACKSPACE, .callback = debugger_reset, .pressed = false, .shifted = true },
     { .label = "Scale Up", .key = KEY_EQUAL, .callback = debugger_scale_up, .pressed = false, .shifted = true },
     { .label = "Scale Down", .key = KEY_MINUS, .callback = debugger_scale_down, .pressed = false, .shifted = true },
+    { .label = "Save State", .key = KEY_F2, .callback = main_save_state, .pressed = false, .shifted = false },
+    { .label = "Load State", .key = KEY_F3, .callback = main_load_state, .pressed = false, .shifted = false },
 };
 
 bool zeal_ui_input(zeal_t* machine)
@@ -0,0 +1,522 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "hw/zeal_rewind.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "debugger/debugger.h"
+#include "hw/zeal_bus.h"
+#include "hw/zeal_state.h"
+#include "utils/log.h"
+
+#define REWIND_PAGE_SIZE MMU_PAGE_SIZE
+/* RAM, flash and tileset */
+#define REWIND_MAX_REGIONS 3
+
+/**
+ * @brief Copy of a memory page, shared by all the checkpoints in which it didn't change
+ */
+typedef struct {
+    uint32_t refs;
+    uint8_t data[REWIND_PAGE_SIZE];
+} rewind_page_t;
+
+typedef struct {
+    unsigned long cycle;
+    /* Index of the first key received after the checkpoint, counted since the creation of the history */
+    size_t input;
+    /* Everything but the memories, with the size allocated for it */
+    zeal_snapshot_t devices;
+    rewind_page_t **pages;
+} rewind_checkpoint_t;
+
+typedef struct {
+    unsigned long cycle;
+    uint16_t scancode;
+    bool pressed;
+} rewind_input_t;
+
+/**
+ * @brief Memory split in pages, found in the memory space as part of `dev`, at `offset`
+ */
+typedef struct {
+    const device_t *dev;
+    uint32_t offset;
+    uint8_t *data;
+    size_t size;
+    int first_page;
+} rewind_region_t;
+
+struct zeal_rewind_t {
+    zeal_t *machine;
+    unsigned long interval;
+    unsigned long next_cycle;
+    size_t budget;
+    size_t used;
+
+    rewind_region_t regions[REWIND_MAX_REGIONS];
+    int region_count;
+    int page_count;
+    /* Write generation of each page when the newest checkpoint was taken, and a buffer to get the current ones */
+    uint32_t *page_gen;
+    uint32_t *cur_gen;
+
+    /* Ring of checkpoints, from the oldest to the newest */
+    rewind_checkpoint_t ring[REWIND_MAX_CHECKPOINTS];
+    int first;
+    int count;
+    /* Snapshot buffer reused by all the checkpoints, which only keep a copy of the right size */
+    zeal_snapshot_t scratch;
+
+    /* Keys received since the oldest checkpoint, `input_base` being the index of the first one */
+    rewind_input_t *inputs;
+    size_t input_base;
+    size_t input_count;
+    size_t input_capacity;
+};
+
+static rewind_checkpoint_t *rewind_at(zeal_rewind_t *rewind, int idx) {
+    return &rewind->ring[(rewind->first + idx) % REWIND_MAX_CHECKPOINTS];
+}
+
+static void rewind_add_region(zeal_rewind_t *rewind, const device_t *dev, uint32_t offset, uint8_t *data,
+                              size_t size) {
+    rewind_region_t *region = &rewind->regions[rewind->region_count++];
+    *region = (rewind_region_t){
+        .dev = dev,
+        .offset = offset,
+        .data = data,
+        .size = size,
+        .first_page = rewind->page_count,
+    };
+    rewind->page_count += (size + REWIND_PAGE_SIZE - 1) / REWIND_PAGE_SIZE;
+}
+
+/**
+ * @brief Get the host pointer and the size of a page out of its index in the history
+ */
+static uint8_t *rewind_page_data(zeal_rewind_t *rewind, int page, size_t *len) {
+    for (int i = 0; i < rewind->region_count; i++) {
+        const rewind_region_t *region = &rewind->regions[i];
+        const size_t offset = (size_t)(page - region->first_page) * REWIND_PAGE_SIZE;
+        if (page >= region->first_page && offset < region->size) {
+            *len = region->size - offset < REWIND_PAGE_SIZE ? region->size - offset : REWIND_PAGE_SIZE;
+            return region->data + offset;
+        }
+    }
+    *len = 0;
+    return NULL;
+}
+
+#if CONFIG_Z80_BLOCK_CACHE
+/**
+ * @brief Get the write generation of each page
+ */
+static void rewind_page_gens(zeal_rewind_t *rewind, uint32_t *gens) {
+    for (int i = 0; i < rewind->region_count; i++) {
+        const rewind_region_t *region = &rewind->regions[i];
+        zeal_mem_gens(rewind->machine, region->dev, region->offset, region->size, gens + region->first_page);
+    }
+}
+#endif  // CONFIG_Z80_BLOCK_CACHE
+
+static void rewind_page_release(zeal_rewind_t *rewind, rewind_page_t *page) {
+    if (page != NULL && --page->refs == 0) {
+        rewind->used -= sizeof(rewind_page_t);
+        free(page);
+    }
+}
+
+static void rewind_checkpoint_release(zeal_rewind_t *rewind, rewind_checkpoint_t *checkpoint) {
+    for (int i = 0; i < rewind->page_count; i++) {
+        rewind_page_release(rewind, checkpoint->pages[i]);
+        checkpoint->pages[i] = NULL;
+    }
+    rewind->used -= checkpoint->devices.capacity;
+    zeal_snapshot_free(&checkpoint->devices);
+}
+
+static void rewind_drop_oldest(zeal_rewind_t *rewind) {
+    rewind_checkpoint_release(rewind, rewind_at(rewind, 0));
+    rewind->first = (rewind->first + 1) % REWIND_MAX_CHECKPOINTS;
+    rewind->count--;
+
+    /* The keys received before the oldest checkpoint can't be replayed anymore */
+    const size_t keep_from = rewind->count > 0 ? rewind_at(rewind, 0)->input : rewind->input_base + rewind->input_count;
+    const size_t dropped = keep_from - rewind->input_base;
+    if (dropped > 0) {
+        memmove(rewind->inputs, rewind->inputs + dropped, (rewind->input_count - dropped) * sizeof(rewind_input_t));
+        rewind->input_count -= dropped;
+        rewind->input_base = keep_from;
+    }
+}
+
+/**
+ * @brief Drop the checkpoints taken after the one at `idx`
+ */
+static void rewind_truncate(zeal_rewind_t *rewind, int idx) {
+    while (rewind->count > idx + 1) {
+        rewind_checkpoint_release(rewind, rewind_at(rewind, rewind->count - 1));
+        rewind->count--;
+    }
+}
+
+zeal_rewind_t *zeal_rewind_create(zeal_t *machine, unsigned long interval, size_t budget) {
+    if (machine == NULL || interval == 0) {
+        return NULL;
+    }
+    zeal_rewind_t *rewind = calloc(1, sizeof(zeal_rewind_t));
+    if (rewind == NULL) {
+        return NULL;
+    }
+    rewind->machine = machine;
+    rewind->interval = interval;
+    rewind->budget = budget;
+    rewind->next_cycle = machine->cpu.cyc;
+
+    rewind_add_region(rewind, DEVICE(&machine->ram), 0, machine->ram.data, machine->ram.size);
+    rewind_add_region(rewind, DEVICE(&machine->rom), 0, machine->rom.data, machine->rom.size);
+    if (!machine->headless) {
+        rewind_add_region(rewind, DEVICE(&machine->zvb), ZVB_TILESET_ADDR, machine->zvb.tileset.raw,
+                          ZVB_TILESET_SIZE);
+    }
+
+    rewind->page_gen = calloc(rewind->page_count, sizeof(uint32_t));
+    rewind->cur_gen = calloc(rewind->page_count, sizeof(uint32_t));
+    rewind_page_t **pages = calloc((size_t)REWIND_MAX_CHECKPOINTS * rewind->page_count, sizeof(rewind_page_t *));
+    if (rewind->page_gen == NULL || rewind->cur_gen == NULL || pages == NULL) {
+        free(pages);
+        zeal_rewind_free(rewind);
+        return NULL;
+    }
+    for (int i = 0; i < REWIND_MAX_CHECKPOINTS; i++) {
+        rewind->ring[i].pages = pages + (size_t)i * rewind->page_count;
+    }
+    return rewind;
+}
+
+void zeal_rewind_free(zeal_rewind_t *rewind) {
+    if (rewind == NULL) {
+        return;
+    }
+    zeal_rewind_clear(rewind);
+    /* All the page tables were allocated at once */
+    free(rewind->ring[0].pages);
+    zeal_snapshot_free(&rewind->scratch);
+    free(rewind->inputs);
+    free(rewind->page_gen);
+    free(rewind->cur_gen);
+    free(rewind);
+}
+
+void zeal_rewind_clear(zeal_rewind_t *rewind) {
+    if (rewind == NULL) {
+        return;
+    }
+    while (rewind->count > 0) {
+        rewind_drop_oldest(rewind);
+    }
+    rewind->input_base += rewind->input_count;
+    rewind->input_count = 0;
+    rewind->next_cycle = rewind->machine->cpu.cyc;
+}
+
+void zeal_rewind_checkpoint(zeal_rewind_t *rewind) {
+    if (rewind == NULL) {
+        return;
+    }
+    zeal_t *machine = rewind->machine;
+    if (rewind->count == REWIND_MAX_CHECKPOINTS) {
+        rewind_drop_oldest(rewind);
+    }
+    if (zeal_state_save_devices(machine, &rewind->scratch) != 0) {
+        return;
+    }
+
+    const rewind_checkpoint_t *prev = rewind->count > 0 ? rewind_at(rewind, rewind->count - 1) : NULL;
+    rewind_checkpoint_t *checkpoint = rewind_at(rewind, rewind->count);
+    checkpoint->cycle = machine->cpu.cyc;
+    checkpoint->input = rewind->input_base + rewind->input_count;
+    checkpoint->devices.data = malloc(rewind->scratch.size);
+    if (checkpoint->devices.data == NULL) {
+        return;
+    }
+    memcpy(checkpoint->devices.data, rewind->scratch.data, rewind->scratch.size);
+    checkpoint->devices.size = rewind->scratch.size;
+    checkpoint->devices.capacity = rewind->scratch.size;
+    rewind->used += checkpoint->devices.capacity;
+
+#if CONFIG_Z80_BLOCK_CACHE
+    rewind_page_gens(rewind, rewind->cur_gen);
+#endif
+    for (int i = 0; i < rewind->page_count; i++) {
+        size_t len;
+        const uint8_t *data = rewind_page_data(rewind, i, &len);
+        /* Share the page of the previous checkpoint when it was not written since */
+#if CONFIG_Z80_BLOCK_CACHE
+        const bool same = prev != NULL && rewind->cur_gen[i] == rewind->page_gen[i];
+#else
+        const bool same = prev != NULL && memcmp(prev->pages[i]->data, data, len) == 0;
+#endif
+        if (same) {
+            checkpoint->pages[i] = prev->pages[i];
+            checkpoint->pages[i]->refs++;
+            continue;
+        }
+        rewind_page_t *page = malloc(sizeof(rewind_page_t));
+        if (page == NULL) {
+            /* Keep the checkpoint consistent, it will be dropped right away */
+            log_err_printf("[REWIND] Could not allocate a checkpoint\n");
+            rewind->count++;
+            rewind_truncate(rewind, rewind->count - 2);
+            return;
+        }
+        page->refs = 1;
+        memcpy(page->data, data, len);
+        checkpoint->pages[i] = page;
+        rewind->used += sizeof(rewind_page_t);
+    }
+    memcpy(rewind->page_gen, rewind->cur_gen, rewind->page_count * sizeof(uint32_t));
+    rewind->count++;
+    rewind->next_cycle = machine->cpu.cyc + rewind->interval;
+
+    /* The newest checkpoint is always kept, even if it doesn't fit in the budget on its own */
+    while (rewind->used > rewind->budget && rewind->count > 1) {
+        rewind_drop_oldest(rewind);
+    }
+}
+
+void zeal_rewind_record(zeal_rewind_t *rewind) {
+    if (rewind != NULL && !sched_before(rewind->machine->cpu.cyc, rewind->next_cycle)) {
+        zeal_rewind_checkpoint(rewind);
+    }
+}
+
+void zeal_rewind_key(zeal_rewind_t *rewind, uint16_t scancode, bool pressed) {
+    if (rewind == NULL || rewind->count == 0) {
+        return;
+    }
+    if (rewind->input_count == rewind->input_capacity) {
+        const size_t capacity = rewind->input_capacity ? rewind->input_capacity * 2 : 64;
+        rewind_input_t *bigger = realloc(rewind->inputs, capacity * sizeof(rewind_input_t));
+        if (bigger == NULL) {
+            log_err_printf("[REWIND] Could not record a key, dropping the history\n");
+            zeal_rewind_clear(rewind);
+            return;
+        }
+        rewind->inputs = bigger;
+        rewind->input_capacity = capacity;
+    }
+    rewind->inputs[rewind->input_count++] = (rewind_input_t){
+        .cycle = rewind->machine->cpu.cyc,
+        .scancode = scancode,
+        .pressed = pressed,
+    };
+}
+
+/**
+ * @brief Get the newest checkpoint taken strictly before `cycle`, -1 if there is none
+ */
+static int rewind_find(zeal_rewind_t *rewind, unsigned long cycle) {
+    for (int i = rewind->count - 1; i >= 0; i--) {
+        if (sched_before(rewind_at(rewind, i)->cycle, cycle)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Put the machine back in the state of a checkpoint, returns the index of the first key to replay
+ */
+static size_t rewind_restore(zeal_rewind_t *rewind, int idx) {
+    zeal_t *machine = rewind->machine;
+    const rewind_checkpoint_t *checkpoint = rewind_at(rewind, idx);
+
+    for (int i = 0; i < rewind->page_count; i++) {
+        size_t len;
+        uint8_t *data = rewind_page_data(rewind, i, &len);
+        memcpy(data, checkpoint->pages[i]->data, len);
+    }
+    /* Written behind the buses, the other copies of the memories must see these pages as modified */
+    zeal_code_modified_all(machine);
+    if (zeal_state_load_devices(machine, checkpoint->devices.data, checkpoint->devices.size) != 0) {
+        log_err_printf("[REWIND] Could not restore a checkpoint\n");
+    }
+    return checkpoint->input;
+}
+
+/**
+ * @brief Give the machine the recorded keys it received at the current cycle, or before if the replay
+ * went past them
+ */
+static void rewind_feed(zeal_rewind_t *rewind, size_t *input) {
+    zeal_t *machine = rewind->machine;
+    while (*input < rewind->input_base + rewind->input_count) {
+        const rewind_input_t *key = &rewind->inputs[*input - rewind->input_base];
+        if (sched_before(machine->cpu.cyc, key->cycle)) {
+            break;
+        }
+        if (key->pressed) {
+            key_pressed(&machine->keyboard, key->scancode);
+        } else {
+            key_released(&machine->keyboard, key->scancode);
+        }
+        (*input)++;
+    }
+}
+
+/**
+ * @brief Run the machine like its main loop does, but stop at `until` and at the cycles the recorded keys
+ * must be given at. Stops early when a breakpoint is reached.
+ */
+static void rewind_run(zeal_rewind_t *rewind, unsigned long until, size_t *input) {
+    zeal_t *machine = rewind->machine;
+    unsigned long budget = sched_remaining(&machine->sched);
+    if (until - machine->cpu.cyc < budget) {
+        budget = until - machine->cpu.cyc;
+    }
+    if (*input < rewind->input_base + rewind->input_count) {
+        const unsigned long key_cycle = rewind->inputs[*input - rewind->input_base].cycle;
+        if (key_cycle - machine->cpu.cyc < budget) {
+            budget = key_cycle - machine->cpu.cyc;
+        }
+    }
+    z80_run(&machine->cpu, budget);
+    if (sched_due(&machine->sched)) {
+        sched_dispatch(&machine->sched);
+    }
+    /* The frontend checks the host keys after each run, the recorded ones replace them */
+    keyboard_check(&machine->keyboard);
+    rewind_feed(rewind, input);
+}
+
+static void rewind_uart_discard(void *arg, char c) {
+    (void)arg;
+    (void)c;
+}
+
+/**
+ * @brief The characters sent on the UART while replaying were already output, hide them
+ */
+static void rewind_replay_begin(zeal_rewind_t *rewind, uart_output_t *output, void **arg) {
+    uart_t *uart = &rewind->machine->uart;
+    *output = uart->output;
+    *arg = uart->output_arg;
+    uart_set_output(uart, rewind_uart_discard, NULL);
+}
+
+/**
+ * @brief Make the checkpoint at `idx` the newest, restore it and run the machine to `target`, recording
+ * the checkpoints again on the way. The keys received after `target` are forgotten.
+ */
+static void rewind_go_to(zeal_rewind_t *rewind, int idx, unsigned long target) {
+    zeal_t *machine = rewind->machine;
+    rewind_truncate(rewind, idx);
+    size_t input = rewind_restore(rewind, idx);
+    rewind->next_cycle = rewind_at(rewind, idx)->cycle + rewind->interval;
+    /* The memory matches the newest checkpoint again */
+#if CONFIG_Z80_BLOCK_CACHE
+    rewind_page_gens(rewind, rewind->page_gen);
+#endif
+
+    rewind_feed(rewind, &input);
+    while (sched_before(machine->cpu.cyc, target)) {
+        rewind_run(rewind, target, &input);
+        zeal_rewind_record(rewind);
+    }
+    rewind->input_count = input - rewind->input_base;
+}
+
+int zeal_rewind_step_back(zeal_rewind_t *rewind) {
+    if (rewind == NULL) {
+        return 1;
+    }
+    zeal_t *machine = rewind->machine;
+    const unsigned long now = machine->cpu.cyc;
+    const int idx = rewind_find(rewind, now);
+    if (idx < 0) {
+        log_printf("[REWIND] No history before cycle %lu\n", now);
+        return 1;
+    }
+
+    uart_output_t output;
+    void *output_arg;
+    rewind_replay_begin(rewind, &output, &output_arg);
+
+    /* Find where the previous instruction started by replaying one instruction at a time */
+    size_t input = rewind_restore(rewind, idx);
+    unsigned long previous = machine->cpu.cyc;
+    rewind_feed(rewind, &input);
+    while (sched_before(machine->cpu.cyc, now)) {
+        previous = machine->cpu.cyc;
+        rewind_run(rewind, previous + 1, &input);
+    }
+    if (machine->cpu.cyc != now) {
+        log_err_printf("[REWIND] Replay diverged, reached cycle %lu instead of %lu\n", machine->cpu.cyc, now);
+    }
+
+    rewind_go_to(rewind, idx, previous);
+    uart_set_output(&machine->uart, output, output_arg);
+    return 0;
+}
+
+int zeal_rewind_reverse_continue(zeal_rewind_t *rewind) {
+#if CONFIG_ENABLE_DEBUGGER
+    if (rewind == NULL) {
+        return 1;
+    }
+    zeal_t *machine = rewind->machine;
+    const unsigned long now = machine->cpu.cyc;
+    const int newest = rewind_find(rewind, now);
+    if (newest < 0) {
+        log_printf("[REWIND] No history before cycle %lu\n", now);
+        return 1;
+    }
+
+    uart_output_t output;
+    void *output_arg;
+    rewind_replay_begin(rewind, &output, &output_arg);
+
+    /* Replay the intervals between the checkpoints from the newest to the oldest, the first one in which
+     * a breakpoint is reached holds the last one */
+    bool found = false;
+    unsigned long hit = 0;
+    int idx;
+    for (idx = newest; idx >= 0 && !found; idx--) {
+        const unsigned long end = idx == newest ? now : rewind_at(rewind, idx + 1)->cycle;
+        size_t input = rewind_restore(rewind, idx);
+        rewind_feed(rewind, &input);
+        while (sched_before(machine->cpu.cyc, end)) {
+            if (debugger_is_breakpoint_set(&machine->dbg, machine->cpu.pc)) {
+                found = true;
+                hit = machine->cpu.cyc;
+            }
+            rewind_run(rewind, end, &input);
+        }
+    }
+
+    if (found) {
+        rewind_go_to(rewind, idx + 1, hit);
+    } else {
+        /* Back to where the machine was */
+        log_printf("[REWIND] No breakpoint reached in the history\n");
+        size_t input = rewind_restore(rewind, newest);
+        rewind_feed(rewind, &input);
+        while (sched_before(machine->cpu.cyc, now)) {
+            rewind_run(rewind, now, &input);
+        }
+    }
+    uart_set_output(&machine->uart, output, output_arg);
+    return found ? 0 : 1;
+#else
+    /* Without the debugger, there are no breakpoints to reach */
+    (void)rewind;
+    return 1;
+#endif
+}
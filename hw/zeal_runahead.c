@@ -0,0 +1,197 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "hw/zeal_runahead.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hw/zeal_state.h"
+#include "utils/log.h"
+
+/* RAM, flash and tileset */
+#define RUNAHEAD_MAX_REGIONS 3
+
+/**
+ * @brief Memory saved page by page, found in the memory space as part of `dev`, at `offset`
+ */
+typedef struct {
+    const device_t *dev;
+    uint32_t offset;
+    uint8_t *data;
+    size_t size;
+    /* Content of the memory when the machine was saved */
+    uint8_t *copy;
+    /* Write generation of each page when `copy` last matched it, and a buffer to get the current ones */
+    uint32_t *copy_gen;
+    uint32_t *cur_gen;
+} runahead_region_t;
+
+struct zeal_runahead_t {
+    zeal_t *machine;
+    runahead_region_t regions[RUNAHEAD_MAX_REGIONS];
+    int region_count;
+    /* The copies were filled once, only the pages written since need to be copied again */
+    bool copied;
+    /* Everything but the memories */
+    zeal_snapshot_t devices;
+
+    /* Frontend callbacks put aside while running ahead */
+    uart_output_t output;
+    void *output_arg;
+    void (*on_reset)(struct zeal_t *machine);
+};
+
+static int runahead_add_region(zeal_runahead_t *runahead, const device_t *dev, uint32_t offset, uint8_t *data,
+                               size_t size) {
+    const size_t pages = (size + MMU_PAGE_SIZE - 1) / MMU_PAGE_SIZE;
+    runahead_region_t *region = &runahead->regions[runahead->region_count++];
+    *region = (runahead_region_t){
+        .dev = dev,
+        .offset = offset,
+        .data = data,
+        .size = size,
+        .copy = malloc(size),
+        .copy_gen = calloc(pages, sizeof(uint32_t)),
+        .cur_gen = calloc(pages, sizeof(uint32_t)),
+    };
+    return region->copy == NULL || region->copy_gen == NULL || region->cur_gen == NULL;
+}
+
+/**
+ * @brief Copy the pages of a region written since the copy was last synchronized with it, from the memory
+ * to the copy when `save` is true, from the copy to the memory else
+ */
+static void runahead_sync_region(zeal_runahead_t *runahead, runahead_region_t *region, bool save) {
+#if CONFIG_Z80_BLOCK_CACHE
+    zeal_mem_gens(runahead->machine, region->dev, region->offset, region->size, region->cur_gen);
+    for (size_t offset = 0; offset < region->size; offset += MMU_PAGE_SIZE) {
+        const size_t page = offset / MMU_PAGE_SIZE;
+        if (runahead->copied && region->cur_gen[page] == region->copy_gen[page]) {
+            continue;
+        }
+        const size_t len = region->size - offset < MMU_PAGE_SIZE ? region->size - offset : MMU_PAGE_SIZE;
+        if (save) {
+            memcpy(region->copy + offset, region->data + offset, len);
+        } else {
+            memcpy(region->data + offset, region->copy + offset, len);
+            /* Written behind the buses, the code the CPU decoded from the other pages is still valid */
+            zeal_mem_modified(runahead->machine, region->dev, region->offset + offset, len);
+        }
+        region->copy_gen[page] = region->cur_gen[page];
+    }
+    if (!save) {
+        /* The restored pages got new generations, the copy still matches all of them */
+        zeal_mem_gens(runahead->machine, region->dev, region->offset, region->size, region->copy_gen);
+    }
+#else
+    /* No write generation to tell the pages that changed */
+    (void)runahead;
+    if (save) {
+        memcpy(region->copy, region->data, region->size);
+    } else {
+        memcpy(region->data, region->copy, region->size);
+    }
+#endif
+}
+
+static void runahead_uart_discard(void *arg, char c) {
+    (void)arg;
+    (void)c;
+}
+
+zeal_runahead_t *zeal_runahead_create(zeal_t *machine) {
+    if (machine == NULL || machine->headless) {
+        return NULL;
+    }
+    zeal_runahead_t *runahead = calloc(1, sizeof(zeal_runahead_t));
+    if (runahead == NULL) {
+        return NULL;
+    }
+    runahead->machine = machine;
+
+    int err = runahead_add_region(runahead, DEVICE(&machine->ram), 0, machine->ram.data, machine->ram.size);
+    err |= runahead_add_region(runahead, DEVICE(&machine->rom), 0, machine->rom.data, machine->rom.size);
+    err |= runahead_add_region(runahead, DEVICE(&machine->zvb), ZVB_TILESET_ADDR, machine->zvb.tileset.raw,
+                               ZVB_TILESET_SIZE);
+    if (err) {
+        zeal_runahead_free(runahead);
+        return NULL;
+    }
+    return runahead;
+}
+
+void zeal_runahead_free(zeal_runahead_t *runahead) {
+    if (runahead == NULL) {
+        return;
+    }
+    for (int i = 0; i < runahead->region_count; i++) {
+        free(runahead->regions[i].copy);
+        free(runahead->regions[i].copy_gen);
+        free(runahead->regions[i].cur_gen);
+    }
+    zeal_snapshot_free(&runahead->devices);
+    free(runahead);
+}
+
+bool zeal_runahead_begin(zeal_runahead_t *runahead, int frames) {
+    zeal_t *machine = runahead->machine;
+    if (zeal_state_save_devices(machine, &runahead->devices) != 0) {
+        return false;
+    }
+    for (int i = 0; i < runahead->region_count; i++) {
+        runahead_sync_region(runahead, &runahead->regions[i], true);
+    }
+    runahead->copied = true;
+
+    /* The frontend must not see the frames that will be undone */
+    runahead->output = machine->uart.output;
+    runahead->output_arg = machine->uart.output_arg;
+    uart_set_output(&machine->uart, runahead_uart_discard, NULL);
+    runahead->on_reset = machine->on_reset;
+    machine->on_reset = NULL;
+
+    /* The V-blank is reached at a fixed rate, the bound only matters if the machine stops on the way */
+    const unsigned long end = machine->cpu.cyc + (unsigned long)frames * 2 * ZEAL_FRAME_TSTATES;
+    int reached = 0;
+    machine->zvb.need_render = false;
+    while (reached < frames && sched_before(machine->cpu.cyc, end)) {
+        if (!zeal_run_until_event(machine) ||
+            (machine->cycle_limit != 0 && !sched_before(machine->cpu.cyc, machine->cycle_limit))) {
+            break;
+        }
+        /* The frontend checks the host keys after each run, the machine keeps the ones it got */
+        keyboard_check(&machine->keyboard);
+        if (machine->zvb.need_render && ++reached < frames) {
+            machine->zvb.need_render = false;
+        }
+    }
+    return true;
+}
+
+void zeal_runahead_end(zeal_runahead_t *runahead) {
+    zeal_t *machine = runahead->machine;
+    zvb_sound_t *sound = &machine->zvb.sound;
+    unsigned int phases[VOICE_COUNT];
+    for (int i = 0; i < VOICE_COUNT; i++) {
+        phases[i] = sound->voices[i].phase;
+    }
+
+    for (int i = 0; i < runahead->region_count; i++) {
+        runahead_sync_region(runahead, &runahead->regions[i], false);
+    }
+    if (zeal_state_load_devices(machine, runahead->devices.data, runahead->devices.size) != 0) {
+        log_err_printf("[RUNAHEAD] Could not restore the machine\n");
+    }
+
+    for (int i = 0; i < VOICE_COUNT; i++) {
+        sound->voices[i].phase = phases[i];
+    }
+    /* The frame of the V-blank the machine was saved at was replaced by the one shown */
+    machine->zvb.need_render = false;
+    uart_set_output(&machine->uart, runahead->output, runahead->output_arg);
+    machine->on_reset = runahead->on_reset;
+}
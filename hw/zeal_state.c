@@ -0,0 +1,770 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "hw/zeal_state.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hw/zeal_bus.h"
+#include "utils/file.h"
+#include "utils/log.h"
+#include "utils/lz.h"
+
+#define STATE_MAGIC "ZISASTAT"
+#define STATE_MAGIC_LEN 8
+#define STATE_PAGE_SIZE 0x4000
+#define STATE_FLAG_VIDEO 1
+#define STATE_FLAG_NO_MEMORY 2
+
+/* Encoding of the memory pages */
+#define STATE_PAGE_RAW 0
+#define STATE_PAGE_FILL 1
+#define STATE_PAGE_LZ 2
+
+_Static_assert(STATE_PAGE_SIZE <= LZ_MAX_INPUT, "The pages must fit in the compressor window");
+
+/**
+ * @brief Serializer shared by the save and the load: each part of the machine is described once by a
+ * function visiting its fields, which either writes them or reads them back depending on `loading`.
+ * All the values are stored in little-endian, independently from the host.
+ *
+ * A load first walks the whole snapshot in a dry run, which checks it without storing anything in the
+ * machine, so that a snapshot that can't be restored leaves the machine untouched.
+ */
+typedef struct {
+    bool loading;
+    /* Loading without storing the values read, only the fields describing the layout are read */
+    bool dry_run;
+    bool error;
+    /* Leave the big memories out, their owner handles them */
+    bool no_memory;
+    /* Saving */
+    zeal_snapshot_t *out;
+    /* Loading, into the memories of `machine` */
+    zeal_t *machine;
+    const uint8_t *in;
+    size_t in_size;
+    size_t pos;
+    /* Compression output of a single page */
+    uint8_t scratch[STATE_PAGE_SIZE];
+} state_io_t;
+
+static void state_write(state_io_t *io, const void *data, size_t len) {
+    zeal_snapshot_t *out = io->out;
+    if (out->size + len > out->capacity) {
+        size_t capacity = out->capacity ? out->capacity : 1024 * 1024;
+        while (capacity < out->size + len) {
+            capacity *= 2;
+        }
+        uint8_t *bigger = realloc(out->data, capacity);
+        if (bigger == NULL) {
+            io->error = true;
+            return;
+        }
+        out->data = bigger;
+        out->capacity = capacity;
+    }
+    memcpy(out->data + out->size, data, len);
+    out->size += len;
+}
+
+/**
+ * @brief Get `len` bytes from the snapshot being loaded, NULL if it is too short
+ */
+static const uint8_t *state_read(state_io_t *io, size_t len) {
+    if (io->in_size - io->pos < len) {
+        io->error = true;
+        return NULL;
+    }
+    const uint8_t *data = io->in + io->pos;
+    io->pos += len;
+    return data;
+}
+
+/**
+ * @brief Whether the values read must be stored in the machine
+ */
+static inline bool state_applying(const state_io_t *io) {
+    return io->loading && !io->dry_run && !io->error;
+}
+
+/**
+ * @brief Visit `len` bytes. `meta` is set for the fields describing the layout of the snapshot (tags, sizes,
+ * encodings), held in locals: they are read in the dry run too, to walk the snapshot.
+ */
+static void state_data(state_io_t *io, void *data, size_t len, bool meta) {
+    if (io->error || len == 0) {
+        return;
+    }
+    if (!io->loading) {
+        state_write(io, data, len);
+        return;
+    }
+    const uint8_t *src = state_read(io, len);
+    if (src != NULL && (meta || !io->dry_run)) {
+        memcpy(data, src, len);
+    }
+}
+
+static void state_bytes(state_io_t *io, void *data, size_t len) {
+    state_data(io, data, len, false);
+}
+
+static void state_value(state_io_t *io, uint64_t *value, int size, bool meta) {
+    uint8_t bytes[8] = {0};
+    if (!io->loading) {
+        for (int i = 0; i < size; i++) {
+            bytes[i] = (uint8_t)(*value >> (8 * i));
+        }
+    }
+    state_data(io, bytes, size, meta);
+    if (io->loading && !io->error && (meta || !io->dry_run)) {
+        *value = 0;
+        for (int i = 0; i < size; i++) {
+            *value |= (uint64_t)bytes[i] << (8 * i);
+        }
+    }
+}
+
+static void state_uint(state_io_t *io, uint64_t *value, int size) {
+    state_value(io, value, size, false);
+}
+
+/* Helpers for each type, they go through a 64-bit value to handle both directions */
+#define STATE_TYPE(name, type, size, meta)             \
+    static void state_##name(state_io_t *io, type *v) { \
+        uint64_t value = (uint64_t)*v;                  \
+        state_value(io, &value, size, meta);            \
+        *v = (type)value;                               \
+    }
+
+STATE_TYPE(u8, uint8_t, 1, false)
+STATE_TYPE(u16, uint16_t, 2, false)
+STATE_TYPE(u32, uint32_t, 4, false)
+STATE_TYPE(ulong, unsigned long, 8, false)
+STATE_TYPE(int, int, 4, false)
+STATE_TYPE(bool, bool, 1, false)
+STATE_TYPE(meta_u8, uint8_t, 1, true)
+STATE_TYPE(meta_u32, uint32_t, 4, true)
+
+/**
+ * @brief Visit an index or the state of a device, which must be within [min, max]. It is read in the dry run too:
+ * a corrupted snapshot is rejected before a device can index out of its arrays with it.
+ */
+static void state_range(state_io_t *io, uint64_t *value, int size, uint64_t min, uint64_t max, const char *name) {
+    state_value(io, value, size, true);
+    if (io->loading && !io->error && (*value < min || *value > max)) {
+        log_err_printf("[STATE] Corrupted snapshot, %s %llu is out of range\n", name, (unsigned long long)*value);
+        io->error = true;
+    }
+}
+
+/* The value read is only stored once the dry run accepted the whole snapshot */
+#define STATE_RANGE(name, type, size)                                                                         \
+    static void state_##name##_range(state_io_t *io, type *v, uint64_t min, uint64_t max, const char *what) { \
+        uint64_t value = (uint64_t)*v;                                                                        \
+        state_range(io, &value, size, min, max, what);                                                        \
+        if (state_applying(io)) {                                                                             \
+            *v = (type)value;                                                                                 \
+        }                                                                                                     \
+    }
+
+STATE_RANGE(u8, uint8_t, 1)
+STATE_RANGE(int, int, 4)
+
+static void state_float(state_io_t *io, float *v) {
+    uint32_t bits;
+    memcpy(&bits, v, sizeof(bits));
+    state_u32(io, &bits);
+    memcpy(v, &bits, sizeof(bits));
+}
+
+/**
+ * @brief Tag starting each part of the snapshot, catches a snapshot that doesn't match the code reading it
+ */
+static void state_section(state_io_t *io, const char tag[4]) {
+    char read_tag[4];
+    memcpy(read_tag, tag, sizeof(read_tag));
+    state_data(io, read_tag, sizeof(read_tag), true);
+    if (io->loading && !io->error && memcmp(read_tag, tag, sizeof(read_tag)) != 0) {
+        log_err_printf("[STATE] Corrupted snapshot, expected section %.4s\n", tag);
+        io->error = true;
+    }
+}
+
+static bool state_page_filled(const uint8_t *page, size_t len) {
+    for (size_t i = 1; i < len; i++) {
+        if (page[i] != page[0]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Restore a page of the memory of `dev`, at `offset`, if it changed. The code the CPU decoded from the
+ * pages left as they were is kept, a run-ahead or a rewind doesn't have to decode everything again.
+ */
+static void state_page_restore(state_io_t *io, const device_t *dev, uint32_t offset, uint8_t *page,
+                               const uint8_t *src, size_t len) {
+    if (memcmp(page, src, len) == 0) {
+        return;
+    }
+    memcpy(page, src, len);
+#if CONFIG_Z80_BLOCK_CACHE
+    if (dev != NULL) {
+        zeal_mem_modified(io->machine, dev, offset, len);
+    }
+#else
+    (void)io;
+    (void)dev;
+    (void)offset;
+#endif
+}
+
+/**
+ * @brief Store a big memory, page by page, in the most compact of the page encodings. `dev` is the device
+ * mapping it in the memory space from `base`, NULL if the CPU can't reach it.
+ */
+static void state_memory(state_io_t *io, const device_t *dev, uint32_t base, uint8_t *data, size_t size) {
+    if (io->no_memory) {
+        return;
+    }
+    uint32_t stored_size = (uint32_t)size;
+    state_meta_u32(io, &stored_size);
+    if (io->loading && !io->error && stored_size != size) {
+        log_err_printf("[STATE] Memory size mismatch, %u bytes in the snapshot, %zu expected\n", stored_size, size);
+        io->error = true;
+    }
+
+    for (size_t offset = 0; offset < size && !io->error; offset += STATE_PAGE_SIZE) {
+        uint8_t *page = data + offset;
+        const size_t len = size - offset < STATE_PAGE_SIZE ? size - offset : STATE_PAGE_SIZE;
+        uint8_t kind = STATE_PAGE_RAW;
+        uint32_t packed = 0;
+
+        if (!io->loading) {
+            if (state_page_filled(page, len)) {
+                kind = STATE_PAGE_FILL;
+            } else {
+                /* Only keep the compressed page if it is smaller */
+                packed = (uint32_t)lz_compress(page, len, io->scratch, len - 1);
+                kind = packed ? STATE_PAGE_LZ : STATE_PAGE_RAW;
+            }
+        }
+        state_meta_u8(io, &kind);
+
+        switch (kind) {
+            case STATE_PAGE_RAW:
+                if (!io->loading) {
+                    state_bytes(io, page, len);
+                } else if (!io->error) {
+                    const uint8_t *src = state_read(io, len);
+                    if (state_applying(io)) {
+                        state_page_restore(io, dev, base + offset, page, src, len);
+                    }
+                }
+                break;
+
+            case STATE_PAGE_FILL: {
+                uint8_t value = page[0];
+                state_u8(io, &value);
+                if (state_applying(io)) {
+                    memset(io->scratch, value, len);
+                    state_page_restore(io, dev, base + offset, page, io->scratch, len);
+                }
+            } break;
+
+            case STATE_PAGE_LZ:
+                state_meta_u32(io, &packed);
+                if (!io->loading) {
+                    state_bytes(io, io->scratch, packed);
+                } else if (!io->error) {
+                    /* In the scratch buffer first, the dry run only checks the page can be decompressed */
+                    const uint8_t *src = state_read(io, packed);
+                    if (src != NULL && lz_decompress(src, packed, io->scratch, len) != 0) {
+                        io->error = true;
+                    }
+                    if (state_applying(io)) {
+                        state_page_restore(io, dev, base + offset, page, io->scratch, len);
+                    }
+                }
+                break;
+
+            default:
+                io->error = true;
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Scheduled events are stored as their deadline, they are placed back in the scheduler on load
+ */
+static void state_event(state_io_t *io, scheduler_t *sched, sched_event_t *ev) {
+    bool pending = sched_is_pending(ev);
+    unsigned long deadline = ev->deadline;
+    state_bool(io, &pending);
+    state_ulong(io, &deadline);
+    if (state_applying(io)) {
+        sched_cancel(sched, ev);
+        if (pending) {
+            sched_at(sched, ev, deadline);
+        } else {
+            /* Not used by the scheduler, but keeps a restored machine identical to the saved one */
+            ev->deadline = deadline;
+        }
+    }
+}
+
+static void state_fifo(state_io_t *io, fifo_t *fifo) {
+    uint32_t size = (uint32_t)fifo->size;
+    state_meta_u32(io, &size);
+    if (io->loading && size != fifo->size) {
+        io->error = true;
+        return;
+    }
+    /* A FIFO without storage keeps its positions at 0 */
+    const uint32_t last = size ? size - 1 : 0;
+    state_int_range(io, &fifo->rd, 0, last, "FIFO read position");
+    state_int_range(io, &fifo->wr, 0, last, "FIFO write position");
+    state_bool(io, &fifo->empty);
+    state_bytes(io, fifo->array, fifo->size);
+}
+
+static void state_cpu(state_io_t *io, z80 *cpu) {
+    state_section(io, "CPU ");
+    state_ulong(io, &cpu->cyc);
+    state_u16(io, &cpu->pc);
+    state_u16(io, &cpu->sp);
+    state_u16(io, &cpu->ix);
+    state_u16(io, &cpu->iy);
+    state_u16(io, &cpu->mem_ptr);
+    state_u8(io, &cpu->a);
+    state_u16(io, &cpu->bc);
+    state_u16(io, &cpu->de);
+    state_u16(io, &cpu->hl);
+    state_u8(io, &cpu->a_);
+    state_u8(io, &cpu->f_);
+    state_u16(io, &cpu->bc_);
+    state_u16(io, &cpu->de_);
+    state_u16(io, &cpu->hl_);
+    state_u8(io, &cpu->i);
+    state_u8(io, &cpu->r);
+    state_u8(io, &cpu->iff_delay);
+    state_u8(io, &cpu->interrupt_mode);
+    state_u8(io, &cpu->int_data);
+
+    /* Flags are lazily evaluated and some fields are bit-fields, go through plain values */
+    uint8_t f = z80_get_f(cpu);
+    uint8_t bits = (cpu->iff1 << 0) | (cpu->iff2 << 1) | (cpu->halted << 2) | (cpu->int_pending << 3) |
+                   (cpu->nmi_pending << 4);
+    state_u8(io, &f);
+    state_u8(io, &bits);
+    if (state_applying(io)) {
+        z80_set_f(cpu, f);
+        cpu->iff1 = (bits >> 0) & 1;
+        cpu->iff2 = (bits >> 1) & 1;
+        cpu->halted = (bits >> 2) & 1;
+        cpu->int_pending = (bits >> 3) & 1;
+        cpu->nmi_pending = (bits >> 4) & 1;
+        cpu->idle.valid = false;
+    }
+}
+
+static void state_memories(state_io_t *io, zeal_t *machine) {
+    state_section(io, "MMU ");
+    state_bytes(io, machine->mmu.pages, sizeof(machine->mmu.pages));
+
+    state_section(io, "RAM ");
+    state_memory(io, DEVICE(&machine->ram), 0, machine->ram.data, machine->ram.size);
+
+    state_section(io, "ROM ");
+    flash_t *rom = &machine->rom;
+    state_memory(io, DEVICE(rom), 0, rom->data, rom->size);
+    state_int_range(io, &rom->state, 0, FLASH_STATE_COUNT - 1, "flash state");
+    state_u8(io, &rom->writing_byte);
+    state_int(io, &rom->dirty);
+    state_event(io, &machine->sched, &rom->delay_event);
+}
+
+static void state_port(state_io_t *io, port_t *port) {
+    state_u8(io, &port->mode);
+    state_u8(io, &port->state);
+    state_u8(io, &port->dir);
+    state_u8(io, &port->int_vector);
+    state_u8(io, &port->int_enable);
+    state_u8(io, &port->int_mask);
+    state_u8(io, &port->and_op);
+    state_u8(io, &port->active_high);
+    state_u8(io, &port->mask_follows);
+    state_u8(io, &port->dir_follows);
+}
+
+static void state_io_devices(state_io_t *io, zeal_t *machine) {
+    state_section(io, "PIO ");
+    state_port(io, &machine->pio.port_a);
+    state_port(io, &machine->pio.port_b);
+
+    state_section(io, "UART");
+    uart_t *uart = &machine->uart;
+    state_ulong(io, &uart->bit_tstates);
+    state_bytes(io, uart->tx_fifo, sizeof(uart->tx_fifo));
+    state_u8_range(io, &uart->tx_pos, 0, UART_FRAME_BITS - 1, "UART position");
+
+    state_section(io, "KBD ");
+    keyboard_t *keyboard = &machine->keyboard;
+    state_event(io, &machine->sched, &keyboard->check_event);
+    state_bool(io, &keyboard->check_pending);
+    state_event(io, &machine->sched, &keyboard->ps2_event);
+    state_u8(io, &keyboard->shift_register);
+    state_fifo(io, &keyboard->queue);
+    state_u8(io, &keyboard->pin_state);
+    int ps2_state = keyboard->state;
+    state_int_range(io, &ps2_state, PS2_IDLE, PS2_INACTIVE, "PS/2 state");
+    keyboard->state = (ps2_state_t)ps2_state;
+
+    state_section(io, "I2C ");
+    i2c_t *i2c = &machine->i2c_bus;
+    state_int(io, &i2c->cur_bit);
+    state_u8(io, &i2c->cur_byte);
+    state_u8(io, &i2c->dev_addr);
+    state_bool(io, &i2c->output);
+    state_bool(io, &i2c->has_reply);
+    int i2c_state = i2c->st;
+    state_int_range(io, &i2c_state, I2C_IDLE, I2C_READDR_RCVED, "I2C state");
+    i2c->st = (i2c_state_t)i2c_state;
+
+    state_section(io, "RTC ");
+    ds1307_t *rtc = &machine->rtc;
+    int64_t time_diff = (int64_t)rtc->time_diff;
+    state_uint(io, (uint64_t *)&time_diff, 8);
+    rtc->time_diff = (time_t)time_diff;
+    state_u8_range(io, &rtc->reg, 0, DS1307_LEN - 1, "RTC register");
+    state_int(io, &rtc->count);
+    state_bytes(io, rtc->ram, sizeof(rtc->ram));
+    state_bool(io, &rtc->changed);
+
+    state_section(io, "EEPR");
+    at24c512_t *eeprom = &machine->eeprom;
+    state_memory(io, NULL, 0, eeprom->data, sizeof(eeprom->data));
+    state_u16(io, &eeprom->address);
+    state_int_range(io, &eeprom->sector_written, 0, AT24C512_SIZE / AT24C512_PAGE - 1, "EEPROM page");
+    state_int(io, &eeprom->count);
+    state_bool(io, &eeprom->writing);
+
+    state_section(io, "CF  ");
+    compactflash_t *cf = &machine->compactflash;
+    state_bytes(io, cf->sector_buffer, sizeof(cf->sector_buffer));
+    state_int_range(io, &cf->sector_buffer_idx, 0, sizeof(cf->sector_buffer) - 1, "CompactFlash position");
+    state_int_range(io, &cf->sec_cnt, 0, 256, "CompactFlash sector count");
+    int cf_state = cf->state;
+    state_int_range(io, &cf_state, IDE_DATA_IDLE, IDE_DATA_ERROR, "CompactFlash state");
+    cf->state = (compactflash_state_t)cf_state;
+    state_bool(io, &cf->master);
+    state_bool(io, &cf->lba_mode);
+    state_u8(io, &cf->status);
+    state_u8(io, &cf->sec_cur);
+    state_u8(io, &cf->feature);
+    state_u8(io, &cf->error);
+    state_u8(io, &cf->lba_0);
+    state_u8(io, &cf->lba_8);
+    state_u8(io, &cf->lba_16);
+    state_u8(io, &cf->lba_24);
+}
+
+static void state_sound(state_io_t *io, zvb_sound_t *sound) {
+    for (int i = 0; i < VOICE_COUNT; i++) {
+        zvb_voice_t *voice = &sound->voices[i];
+        state_u8(io, &voice->freq_low);
+        state_u8(io, &voice->freq_high);
+        state_u8(io, &voice->wave);
+        state_u8(io, &voice->duty);
+        state_u8(io, &voice->voice_volume);
+        state_bool(io, &voice->noise);
+        state_bool(io, &voice->hold);
+        state_float(io, &voice->volume);
+        uint32_t phase = voice->phase;
+        state_u32(io, &phase);
+        voice->phase = phase;
+    }
+
+    uint8_t voices[5] = {sound->hold_voices, sound->enabled_voices, sound->left_voices, sound->right_voices,
+                         sound->master_volume};
+    state_bytes(io, voices, sizeof(voices));
+    sound->hold_voices = voices[0];
+    sound->enabled_voices = voices[1];
+    sound->left_voices = voices[2];
+    sound->right_voices = voices[3];
+    sound->master_volume = voices[4];
+    state_float(io, &sound->left_volume);
+    state_float(io, &sound->right_volume);
+
+    zvb_sample_table_t *table = &sound->sample_table;
+    state_bool(io, &table->hold);
+    state_int(io, &table->divider);
+    state_int(io, &table->config);
+    state_bool(io, &table->is_u8);
+    state_bool(io, &table->is_signed);
+    state_int_range(io, &table->fifo_head, 0, SAMPLE_FIFO_SIZE - 1, "sample FIFO head");
+    state_int_range(io, &table->fifo_tail, 0, SAMPLE_FIFO_SIZE - 1, "sample FIFO tail");
+    int fifo_bytes = atomic_load(&table->fifo_bytes);
+    state_int_range(io, &fifo_bytes, 0, SAMPLE_FIFO_SIZE, "sample FIFO length");
+    if (state_applying(io)) {
+        atomic_store(&table->fifo_bytes, fifo_bytes);
+    }
+    state_bytes(io, table->fifo, sizeof(table->fifo));
+    state_int(io, &table->baud_count);
+}
+
+static void state_spi(state_io_t *io, zvb_spi_t *spi) {
+    state_u8(io, &spi->clk_div);
+    state_u8_range(io, &spi->ram_len, 0, 0xf, "SPI length");
+    state_bytes(io, spi->ram_rd.data, sizeof(spi->ram_rd.data));
+    state_u8_range(io, &spi->ram_rd.idx, 0, SPI_RAM_LEN - 1, "SPI read position");
+    state_bytes(io, spi->ram_wr.data, sizeof(spi->ram_wr.data));
+    state_u8_range(io, &spi->ram_wr.idx, 0, SPI_RAM_LEN - 1, "SPI write position");
+    state_u8(io, &spi->tf_cs);
+    int tf_state = spi->tf.state;
+    state_int_range(io, &tf_state, TF_WAIT_IDLE, TF_WRITE_BLOCK_SEND_RESP, "TF card state");
+    spi->tf.state = (zvb_tf_state_t)tf_state;
+    state_bytes(io, spi->tf.reply, sizeof(spi->tf.reply));
+    /* Both point right after the reply once it is fully sent */
+    state_int_range(io, &spi->tf.reply_idx, 0, sizeof(spi->tf.reply), "TF card reply position");
+    state_int_range(io, &spi->tf.reply_len, 0, sizeof(spi->tf.reply), "TF card reply length");
+}
+
+static void state_text(state_io_t *io, zvb_text_t *text) {
+    state_u16(io, &text->cursor_pos.raw);
+    state_u16(io, &text->cursor_save.raw);
+    state_u16(io, &text->scroll.raw);
+    state_u8(io, &text->cursor_time);
+    state_u8(io, &text->cursor_char);
+    state_u8(io, &text->cursor_color);
+    state_u8(io, &text->color);
+    state_u8(io, &text->flags.val);
+    state_bool(io, &text->wait_for_next_char);
+    /* Both divide the cursor position */
+    state_u8_range(io, &text->visible_lines, 1, TEXT_MAXIMUM_LINES, "text lines");
+    state_u8_range(io, &text->visible_columns, 1, TEXT_MAXIMUM_COLUMNS, "text columns");
+    state_int(io, &text->frame_counter);
+    state_bool(io, &text->cursor_shown);
+}
+
+static void state_video(state_io_t *io, zeal_t *machine) {
+    zvb_t *zvb = &machine->zvb;
+
+    state_section(io, "VRAM");
+    state_bytes(io, zvb->layers.raw_layer0, sizeof(zvb->layers.raw_layer0));
+    state_bytes(io, zvb->layers.raw_layer1, sizeof(zvb->layers.raw_layer1));
+    state_bytes(io, zvb->font.raw_font, sizeof(zvb->font.raw_font));
+    state_memory(io, DEVICE(zvb), ZVB_TILESET_ADDR, zvb->tileset.raw, sizeof(zvb->tileset.raw));
+    state_bytes(io, zvb->palette.raw_palette, sizeof(zvb->palette.raw_palette));
+    state_int(io, &zvb->palette.wr_latch);
+    for (int i = 0; i < ZVB_SPRITES_COUNT; i++) {
+        zvb_sprite_t *sprite = &zvb->sprites.data[i];
+        state_u16(io, &sprite->y);
+        state_u16(io, &sprite->x);
+        state_u16(io, &sprite->flags.raw);
+        state_u16(io, &sprite->extra_flags.raw);
+    }
+    state_int(io, &zvb->sprites.wr_latch);
+
+    state_section(io, "ZVB ");
+    int mode = zvb->mode;
+    state_int_range(io, &mode, 0, MODE_LAST, "video mode");
+    zvb->mode = (zvb_video_mode_t)mode;
+    state_u8(io, &zvb->status.raw);
+    state_u32(io, &zvb->ctrl.l0_latch);
+    state_u32(io, &zvb->ctrl.l1_latch);
+    state_u32(io, &zvb->ctrl.l0_scroll_x);
+    state_u32(io, &zvb->ctrl.l0_scroll_y);
+    state_u32(io, &zvb->ctrl.l1_scroll_x);
+    state_u32(io, &zvb->ctrl.l1_scroll_y);
+    state_bool(io, &zvb->screen_enabled);
+    state_u8(io, &zvb->io_bank);
+    state_bytes(io, zvb->scratch, sizeof(zvb->scratch));
+    state_int_range(io, &zvb->state, 0, STATE_COUNT - 1, "raster state");
+    state_event(io, &machine->sched, &zvb->raster_event);
+
+    state_section(io, "TEXT");
+    state_text(io, &zvb->text);
+    state_section(io, "SPI ");
+    state_spi(io, &zvb->spi);
+    state_section(io, "CRC ");
+    state_u32(io, &zvb->peri_crc32.sum);
+    state_section(io, "SND ");
+    state_sound(io, &zvb->sound);
+    state_section(io, "DMA ");
+    state_u32(io, &zvb->dma.desc_addr);
+    state_u8(io, &zvb->dma.clk.raw);
+
+    if (state_applying(io)) {
+        /* The whole VRAM changed, let the renderers pick it up */
+        zvb_invalidate(zvb);
+        zvb->need_render = true;
+    }
+}
+
+/**
+ * @brief Visit the whole machine, the order of the parts defines the snapshot format
+ */
+static void state_machine(state_io_t *io, zeal_t *machine) {
+    char magic[STATE_MAGIC_LEN];
+    memcpy(magic, STATE_MAGIC, STATE_MAGIC_LEN);
+    uint32_t version = ZEAL_STATE_VERSION;
+    uint32_t flags = (machine->headless ? 0 : STATE_FLAG_VIDEO) | (io->no_memory ? STATE_FLAG_NO_MEMORY : 0);
+    const uint32_t expected_flags = flags;
+
+    state_data(io, magic, sizeof(magic), true);
+    state_meta_u32(io, &version);
+    state_meta_u32(io, &flags);
+    if (io->loading && !io->error) {
+        if (memcmp(magic, STATE_MAGIC, STATE_MAGIC_LEN) != 0) {
+            log_err_printf("[STATE] Not a snapshot\n");
+            io->error = true;
+        } else if (version != ZEAL_STATE_VERSION) {
+            log_err_printf("[STATE] Snapshot version %u is not supported, expected %u\n", version,
+                           ZEAL_STATE_VERSION);
+            io->error = true;
+        } else if ((flags ^ expected_flags) & STATE_FLAG_NO_MEMORY) {
+            log_err_printf("[STATE] The snapshot %s the memories\n",
+                           (flags & STATE_FLAG_NO_MEMORY) ? "doesn't hold" : "holds");
+            io->error = true;
+        } else if (flags != expected_flags) {
+            log_err_printf("[STATE] The snapshot was taken %s video board\n",
+                           (flags & STATE_FLAG_VIDEO) ? "with" : "without");
+            io->error = true;
+        }
+    }
+    if (io->error) {
+        return;
+    }
+
+    /* The CPU goes first, the deadlines of the events are restored relative to its clock */
+    state_cpu(io, &machine->cpu);
+    state_memories(io, machine);
+    state_io_devices(io, machine);
+    if (!machine->headless) {
+        state_video(io, machine);
+    }
+    state_section(io, "END ");
+}
+
+static int state_save(zeal_t *machine, zeal_snapshot_t *snapshot, bool no_memory) {
+    state_io_t *io = malloc(sizeof(state_io_t));
+    if (io == NULL) {
+        return 1;
+    }
+    io->loading = false;
+    io->dry_run = false;
+    io->error = false;
+    io->no_memory = no_memory;
+    io->out = snapshot;
+    snapshot->size = 0;
+
+    state_machine(io, machine);
+
+    const int err = io->error;
+    free(io);
+    if (err) {
+        log_err_printf("[STATE] Could not allocate the snapshot\n");
+    }
+    return err;
+}
+
+static int state_load(zeal_t *machine, const uint8_t *data, size_t size, bool no_memory) {
+    state_io_t *io = malloc(sizeof(state_io_t));
+    if (io == NULL) {
+        return 1;
+    }
+    io->loading = true;
+    io->error = false;
+    io->no_memory = no_memory;
+    io->machine = machine;
+    io->in = data;
+    io->in_size = size;
+
+    /* Check the whole snapshot before storing anything, a failed load leaves the machine as it was */
+    for (int pass = 0; pass < 2 && !io->error; pass++) {
+        io->dry_run = pass == 0;
+        io->pos = 0;
+        state_machine(io, machine);
+    }
+    const int err = io->error;
+    free(io);
+    if (err) {
+        log_err_printf("[STATE] Could not restore the snapshot\n");
+        return err;
+    }
+
+    /* The pages mapped by the MMU and the flash state changed. The memory pages that changed were marked as
+     * modified while restoring them, the code the CPU decoded from the others is still valid. */
+    mmu_refresh(&machine->mmu);
+    machine->should_exit = false;
+    return 0;
+}
+
+int zeal_state_save(zeal_t *machine, zeal_snapshot_t *snapshot) {
+    return state_save(machine, snapshot, false);
+}
+
+int zeal_state_load(zeal_t *machine, const uint8_t *data, size_t size) {
+    return state_load(machine, data, size, false);
+}
+
+int zeal_state_save_devices(zeal_t *machine, zeal_snapshot_t *snapshot) {
+    return state_save(machine, snapshot, true);
+}
+
+int zeal_state_load_devices(zeal_t *machine, const uint8_t *data, size_t size) {
+    return state_load(machine, data, size, true);
+}
+
+void zeal_snapshot_free(zeal_snapshot_t *snapshot) {
+    free(snapshot->data);
+    *snapshot = (zeal_snapshot_t){0};
+}
+
+int zeal_state_save_file(zeal_t *machine, const char *path) {
+    zeal_snapshot_t snapshot = {0};
+    int err = zeal_state_save(machine, &snapshot);
+    if (err == 0) {
+        FILE *file = fopen(path, "wb");
+        if (file == NULL || fwrite(snapshot.data, 1, snapshot.size, file) != snapshot.size) {
+            log_perror("[STATE] Could not write %s", path);
+            err = 1;
+        }
+        if (file != NULL && fclose(file) != 0) {
+            err = 1;
+        }
+    }
+    if (err == 0) {
+        log_printf("[STATE] Saved %s (%zu bytes)\n", path, snapshot.size);
+    }
+    zeal_snapshot_free(&snapshot);
+    return err;
+}
+
+int zeal_state_load_file(zeal_t *machine, const char *path) {
+    size_t size = 0;
+    uint8_t *data = (uint8_t *)file_read(path, &size);
+    if (data == NULL) {
+        log_perror("[STATE] Could not read %s", path);
+        return 1;
+    }
+
+    const int err = zeal_state_load(machine, data, size);
+    if (err == 0) {
+        log_printf("[STATE] Loaded %s\n", path);
+    }
+    free(data);
+    return err;
+}
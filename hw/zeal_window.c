@@ -0,0 +1,891 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Zeal 8-bit Computer <contact@zeal8bit.com>; David Higgins <zoul0813@me.com>
+ *
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * SPDX-FileContributor: Modified by Robert Maupin 2026
+ */
+
+#include "hw/zeal_window.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "debugger/debugger.h"
+#include "hw/zeal_rewind.h"
+#include "hw/zeal_runahead.h"
+#include "hw/zeal_state.h"
+#include "utils/config.h"
+#include "utils/helpers.h"
+#include "utils/log.h"
+
+#ifdef CONFIG_ENABLE_DEBUGGER
+#include "debugger/debugger_ui.h"
+#endif
+
+#ifdef PLATFORM_WEB
+#include <emscripten.h>
+#endif
+
+#ifdef CONFIG_ENABLE_DEBUGGER
+int zeal_debugger_init(zeal_t *machine, dbg_t *dbg);
+#endif
+bool zeal_ui_input(zeal_t *machine);
+
+#ifdef PLATFORM_WEB
+EMSCRIPTEN_KEEPALIVE volatile
+#endif
+#if CONFIG_SHOW_FPS
+    bool show_fps = true;
+#else
+bool show_fps = false;
+#endif
+
+/**
+ * @brief Sound controller feeding the audio device. Raylib's callback doesn't take a context/opaque
+ * parameter and there is a single audio device per process anyway, so only the machine shown in the
+ * window owns this.
+ */
+static zvb_sound_t *s_sound;
+
+static void zeal_window_audio_callback(void *buffer, unsigned int frames) {
+    if (s_sound != NULL) {
+        zvb_sound_generate(s_sound, (int16_t *)buffer, frames);
+    }
+}
+
+static int key_can_repeat(int code) {
+    const int modifiers[] = {KEY_LEFT_SHIFT,    KEY_LEFT_CONTROL, KEY_LEFT_ALT,    KEY_LEFT_SUPER, KEY_RIGHT_SHIFT,
+                             KEY_RIGHT_CONTROL, KEY_RIGHT_ALT,    KEY_RIGHT_SUPER, KEY_CAPS_LOCK,  KEY_NUM_LOCK};
+
+    for (unsigned int i = 0; i < DIM(modifiers); i++) {
+        if (modifiers[i] == code) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void zeal_read_keyboard_reset(zeal_window_t *window) {
+    /* Clear Raylib's key states */
+    while (GetKeyPressed()) {}
+
+    for (int i = 0; i < RAYLIB_KEY_COUNT; i++) {
+        window->host_keys[i].duration = 0;
+        window->host_keys[i].state = KEY_NOT_PRESSED;
+    }
+}
+
+/**
+ * @brief Queue a key event for the machine, the event is lost if the machine didn't take the previous ones
+ */
+static void zeal_window_key(zeal_window_t *window, int keyCode, bool pressed) {
+    const unsigned int head = atomic_load_explicit(&window->key_head, memory_order_relaxed);
+    const unsigned int tail = atomic_load_explicit(&window->key_tail, memory_order_acquire);
+    if (head - tail >= WIN_KEY_QUEUE_SIZE) {
+        return;
+    }
+    window->key_queue[head % WIN_KEY_QUEUE_SIZE] = (win_key_event_t){
+        .scancode = keymap_to_scancode(keyCode),
+        .pressed = pressed,
+    };
+    atomic_store_explicit(&window->key_head, head + 1, memory_order_release);
+}
+
+/**
+ * @brief Send the queued key events to the machine, recorded in the history to replay them at the same cycle.
+ * Called by the thread running the machine.
+ */
+static void zeal_window_feed_keys(zeal_window_t *window) {
+    zeal_t *machine = window->machine;
+    const unsigned int head = atomic_load_explicit(&window->key_head, memory_order_acquire);
+    unsigned int tail = atomic_load_explicit(&window->key_tail, memory_order_relaxed);
+    for (; tail != head; tail++) {
+        const win_key_event_t *event = &window->key_queue[tail % WIN_KEY_QUEUE_SIZE];
+#if CONFIG_ENABLE_DEBUGGER
+        zeal_rewind_key(machine->rewind, event->scancode, event->pressed);
+#endif
+        if (event->pressed) {
+            key_pressed(&machine->keyboard, event->scancode);
+        } else {
+            key_released(&machine->keyboard, event->scancode);
+        }
+    }
+    atomic_store_explicit(&window->key_tail, tail, memory_order_release);
+}
+
+static void zeal_read_keyboard(zeal_window_t *window, int delta) {
+    int keyCode;
+
+    /* The initial delay is ~500ms before repeat starts */
+    const int start_delay = us_to_tstates(500000);
+    /* Then, repeat the key every 50ms */
+    const int repeat_delay = us_to_tstates(50000);
+
+    if (atomic_exchange(&window->keys_reset, false)) {
+        zeal_read_keyboard_reset(window);
+    }
+
+    // look for newly pressed keys
+    while ((keyCode = GetKeyPressed())) {
+        window->host_keys[keyCode].state = KEY_PRESSED;
+        window->host_keys[keyCode].duration = 0;
+        zeal_window_key(window, keyCode, true);
+    }
+
+    // look for newly released keys
+    for (keyCode = 0; keyCode < RAYLIB_KEY_COUNT; keyCode++) {
+        kb_keys_t *key = &window->host_keys[keyCode];
+
+        if (key->state == KEY_NOT_PRESSED) {
+            continue;
+        }
+
+        if (IsKeyUp(keyCode)) {
+            key->state = KEY_NOT_PRESSED;
+            /* No need to clear the duration, it's done when the key is pressed */
+            zeal_window_key(window, keyCode, false);
+            continue;
+        }
+
+        /* Key is still pressed, add the current delta to its duration and check it */
+        key->duration += delta;
+
+        if (key->state == KEY_PRESSED && key_can_repeat(keyCode) && key->duration >= start_delay) {
+            zeal_window_key(window, keyCode, true);
+            key->state = KEY_REPEATED;
+            key->duration = 0;
+        } else if (key->state == KEY_REPEATED && key->duration >= repeat_delay) {
+            key->duration = 0;
+            zeal_window_key(window, keyCode, true);
+        }
+    }
+}
+
+static void zeal_window_on_reset(zeal_t *machine) {
+    zeal_window_t *window = machine->window;
+    /* The keys held on the host are forgotten by the window, drop the ones it didn't send yet */
+    atomic_store_explicit(&window->key_tail, atomic_load_explicit(&window->key_head, memory_order_acquire),
+                          memory_order_release);
+    atomic_store(&window->keys_reset, true);
+#if CONFIG_ENABLE_DEBUGGER
+    zeal_rewind_checkpoint(machine->rewind);
+#endif
+}
+
+/**
+ * @brief Take the lock on the machine, held by the thread running it. Without a thread, there is nothing to do.
+ */
+static void zeal_window_lock(zeal_window_t *window) {
+#if WIN_EMULATION_THREAD
+    /* Ask the machine thread to let go of the lock, it holds it most of the time */
+    atomic_fetch_add(&window->lock_requests, 1);
+    pthread_mutex_lock(&window->lock);
+    atomic_fetch_sub(&window->lock_requests, 1);
+#else
+    (void)window;
+#endif
+}
+
+static void zeal_window_unlock(zeal_window_t *window) {
+#if WIN_EMULATION_THREAD
+    pthread_mutex_unlock(&window->lock);
+#if CONFIG_ENABLE_DEBUGGER
+    /* While debugging, the machine thread has nothing to do, don't wake it up for nothing */
+    if (!window->quit && window->machine->dbg_enabled) {
+        return;
+    }
+#endif
+    pthread_cond_signal(&window->cond);
+#else
+    (void)window;
+#endif
+}
+
+/**
+ * @brief Get how long to wait for the host time to catch up with the machine, running `speed` times faster
+ * than real time, as fast as possible when 0. When the machine is too far behind or ahead, after a pause
+ * or a state load, the speed is measured again from now.
+ */
+static double zeal_window_pace(zeal_window_t *window, int speed) {
+    const zeal_t *machine = window->machine;
+    if (speed == 0) {
+        return 0;
+    }
+    const double now = GetTime();
+    const double elapsed = (double)(machine->cpu.cyc - window->pace_cycle) / CPUFREQ / speed;
+    const double target = window->pace_time + elapsed;
+    if (target - now > 0.25 || now - target > 0.25) {
+        window->pace_time = now;
+        window->pace_cycle = machine->cpu.cyc;
+        return 0;
+    }
+    return target > now ? target - now : 0;
+}
+
+/**
+ * @brief Turn the turbo on or off, the speed is measured again from now
+ */
+static void zeal_window_set_turbo(zeal_window_t *window, bool turbo) {
+    window->turbo = turbo;
+    window->pace_time = GetTime();
+    window->pace_cycle = window->machine->cpu.cyc;
+    window->shown_time = window->pace_time;
+    window->shown_cycle = window->pace_cycle;
+#if !BENCHMARK && !WIN_EMULATION_THREAD
+    /* In turbo, the frames shown are paced by the turbo itself */
+    SetTargetFPS(turbo ? 0 : 60);
+#endif
+    /* The sound is generated in real time, it can't follow the machine */
+    SetAudioStreamVolume(window->audio, turbo ? 0.0f : 1.0f);
+}
+
+int zeal_window_init(zeal_window_t *window, zeal_t *machine) {
+    if (window == NULL || machine == NULL || machine->headless) {
+        return 1;
+    }
+
+    memset(window, 0, sizeof(*window));
+    window->machine = machine;
+    machine->window = window;
+    machine->on_reset = zeal_window_on_reset;
+#if CONFIG_ENABLE_DEBUGGER
+    machine->dbg_enabled = config_debugger_enabled();
+#endif  // CONFIG_ENABLE_DEBUGGER
+
+    /* Initialize the UI. It must be done before any shader is created! */
+    SetTraceLogLevel(WIN_LOG_LEVEL);
+#ifndef PLATFORM_WEB
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+#endif
+
+    /* initialize raylib window */
+    InitWindow(640, 480, WIN_NAME);
+    SetExitKey(KEY_NULL);
+#ifndef PLATFORM_WEB
+    SetWindowFocused();  // force focus on the window to capture keypresses
+#endif
+#if !BENCHMARK
+    SetTargetFPS(60);
+#endif
+
+    /* Since we want to enable scaling, make the ZVB output always go to a texture first */
+    window->zvb_out = LoadRenderTexture(ZVB_MAX_RES_WIDTH, ZVB_MAX_RES_HEIGHT);
+    int err = zvb_render_init(&window->render, &machine->zvb, false);
+    if (err) {
+        return err;
+    }
+#if WIN_EMULATION_THREAD
+    for (int i = 0; i < 3; i++) {
+        zvb_frame_init(&window->frames[i].video, &machine->zvb);
+    }
+    window->frame_back = 1;
+    window->frame_front = 2;
+    atomic_init(&window->frame_ready, 0);
+#endif
+
+    if (machine->args.run_ahead > 0) {
+        if (machine->args.run_ahead > RUNAHEAD_MAX_FRAMES) {
+            log_err_printf("[WINDOW] Run-ahead limited to %d frames\n", RUNAHEAD_MAX_FRAMES);
+            machine->args.run_ahead = RUNAHEAD_MAX_FRAMES;
+        }
+        window->runahead = zeal_runahead_create(machine);
+        if (window->runahead == NULL) {
+            log_err_printf("[WINDOW] Could not allocate the run-ahead\n");
+        }
+    }
+
+    InitAudioDevice();
+    s_sound = &machine->zvb.sound;
+    window->audio = LoadAudioStream(SAMPLE_RATE, 16, SOUND_CHANNELS);
+    SetAudioStreamCallback(window->audio, zeal_window_audio_callback);
+    PlayAudioStream(window->audio);
+
+    /* Without a multiplier, the turbo goes as fast as possible */
+    window->turbo_speed = machine->args.speed != 1 ? machine->args.speed : 0;
+    zeal_window_set_turbo(window, machine->args.speed != 1);
+
+#if CONFIG_ENABLE_DEBUGGER
+    config_window_set(machine->dbg_enabled);
+    /* Initialize the debugger */
+    zeal_debugger_init(machine, &machine->dbg);
+    /* Load symbols if provided */
+    if (machine->args.map_file) {
+        debugger_load_symbols(&machine->dbg, machine->args.map_file);
+    }
+    if (machine->args.breakpoints) {
+        debugger_set_breakpoints_str(&machine->dbg, machine->args.breakpoints);
+    }
+
+    if (machine->dbg_enabled) {
+        zeal_debug_enable(machine);
+        /* Force the machine in RUNNING mode */
+        machine->dbg_state = ST_RUNNING;
+    }
+
+    if (machine->args.rewind_mem > 0 && machine->args.rewind_interval > 0) {
+        machine->rewind = zeal_rewind_create(machine, us_to_tstates(machine->args.rewind_interval * 1000UL),
+                                             (size_t)machine->args.rewind_mem * 1024 * 1024);
+        if (machine->rewind == NULL) {
+            log_err_printf("[DEBUGGER] Could not allocate the execution history\n");
+        }
+    }
+#endif  // CONFIG_ENABLE_DEBUGGER
+
+    return 0;
+}
+
+/**
+ * @brief The state actions share a single file so that a load restores the latest save
+ */
+static const char *zeal_window_state_path(const zeal_t *machine) {
+    if (machine->args.save_state != NULL) {
+        return machine->args.save_state;
+    }
+    return machine->args.load_state != NULL ? machine->args.load_state : WIN_STATE_FILE;
+}
+
+int zeal_window_save_state(zeal_t *machine) {
+    return zeal_state_save_file(machine, zeal_window_state_path(machine));
+}
+
+int zeal_window_load_state(zeal_t *machine) {
+    const int err = zeal_state_load_file(machine, zeal_window_state_path(machine));
+    if (err == 0 && machine->window != NULL) {
+        /* The keys held on the host were not held in the restored machine */
+        atomic_store(&machine->window->keys_reset, true);
+    }
+#if CONFIG_ENABLE_DEBUGGER
+    if (err == 0) {
+        /* The history belongs to another execution */
+        zeal_rewind_clear(machine->rewind);
+    }
+#endif
+    return err;
+}
+
+void zeal_window_toggle_turbo(zeal_t *machine) {
+    zeal_window_t *window = machine->window;
+    if (window == NULL) {
+        return;
+    }
+    zeal_window_set_turbo(window, !window->turbo);
+    log_printf("[WINDOW] Turbo %s\n", window->turbo ? "on" : "off");
+}
+
+#if CONFIG_ENABLE_DEBUGGER
+int zeal_debug_enable(zeal_t *machine) {
+    zeal_window_t *window = machine->window;
+    if (window == NULL) {
+        return -1;
+    }
+    config_window_update(machine->dbg_enabled);
+    int ret = 0;
+    machine->dbg_enabled = true;
+    machine->dbg_state = ST_PAUSED;
+    zeal_update_cpu_hooks(machine);
+    config_window_set(true);
+    /* The textures were last updated from the frames of the machine thread */
+    zvb_invalidate(&machine->zvb);
+    if (window->dbg_ui == NULL) {
+        dbg_ui_init_args_t args = {
+            .main_view = &window->zvb_out,
+            .zvb = &machine->zvb,
+            .render = &window->render,
+        };
+        args.debug_views = zvb_get_debug_textures(&window->render, &args.debug_views_count);
+        ret = debugger_ui_init(&window->dbg_ui, &args);
+    }
+    return ret;
+}
+
+int zeal_debug_disable(zeal_t *machine) {
+    config_window_update(machine->dbg_enabled);
+    machine->dbg_enabled = false;
+    machine->dbg_state = ST_RUNNING;
+    zeal_update_cpu_hooks(machine);
+    config_window_set(false);
+    /* The textures were updated from the machine directly, the next frame must bring all of them back */
+    zvb_invalidate(&machine->zvb);
+    return 0;
+}
+
+void zeal_debug_toggle(dbg_t *dbg) {
+    if (dbg == NULL)
+        return;
+    zeal_t *machine = (zeal_t *)(dbg->arg);
+
+    if (machine->dbg_enabled) {
+        log_printf("[DEBUGGER]: Disabled\n");
+        zeal_debug_disable(machine);
+    } else {
+        log_printf("[DEBUGGER]: Enabled\n");
+        zeal_debug_enable(machine);
+    }
+}
+
+/**
+ * Returns 1 if rendered, 0 else
+ */
+static int zeal_dbg_mode_display(zeal_window_t *window) {
+    zeal_t *machine = window->machine;
+    /**
+     * Prepare the rendering, if the returned value is true, we can
+     * proceed to rendering, else, we don't need to update the view.
+     * However, if the CPU is paused (breakpoint/step), force the rendering.
+     */
+    if (zvb_prepare_render(&window->render, &machine->zvb)) {
+        /* Display all the devices that have a render function */
+        BeginTextureMode(window->zvb_out);
+        zvb_render(&window->render, &machine->zvb);
+        EndTextureMode();
+    } else if (machine->dbg_state == ST_PAUSED) {
+        /* No need for `prepare` in this case */
+        BeginTextureMode(window->zvb_out);
+        zvb_force_render(&window->render, &machine->zvb);
+        EndTextureMode();
+    } else {
+        /* Do not proceed, the CPU is currently running and the ZVB doens't need to be refreshed yet */
+        return 0;
+    }
+
+    /* Generate VRAM debug textures if the VRAM debugging window is opened */
+    if (debugger_ui_vram_panel_opened(window->dbg_ui)) {
+        zvb_render_debug_textures(&window->render, &machine->zvb);
+    }
+
+    debugger_ui_prepare_render(window->dbg_ui, &machine->dbg);
+    BeginDrawing();
+    /* Grey brackground */
+    ClearBackground((Color){0x63, 0x63, 0x63, 0xff});
+    debugger_ui_render(window->dbg_ui, &machine->dbg);
+    if (show_fps == true) {
+        DrawFPS(10, 10);
+    }
+
+    EndDrawing();
+
+    return 1;
+}
+
+/**
+ * @brief Run Zeal 8-bit Computer VM in debug mode
+ */
+static int zeal_dbg_mode_run(zeal_window_t *window) {
+    zeal_t *machine = window->machine;
+    if (machine->dbg_state != ST_PAUSED) {
+        if (machine->dbg_state == ST_REQ_STEP_OVER) {
+            int instr_size = z80_instruction_size(&machine->cpu);
+            debugger_set_temporary_breakpoint(&machine->dbg, machine->cpu.pc + instr_size);
+            machine->dbg_state = ST_RUNNING;
+        }
+
+        /* When running, the breakpoint hook stops the batch as soon as a breakpoint is reached */
+        if (machine->dbg_state == ST_REQ_STEP) {
+            z80_step(&machine->cpu);
+        } else {
+            z80_run(&machine->cpu, sched_remaining(&machine->sched));
+        }
+        if (sched_due(&machine->sched)) {
+            sched_dispatch(&machine->sched);
+        }
+
+        /* Check if we need to poll the keyboard and transmit the data to the VM */
+        if (keyboard_check(&machine->keyboard) &&
+            /* make sure the current keys are not a UI shortcut and the main view is focused */
+            !zeal_ui_input(machine) && debugger_ui_main_view_focused(window->dbg_ui)) {
+            zeal_read_keyboard(window, KEYBOARD_CHECK_PERIOD);
+            zeal_window_feed_keys(window);
+        }
+        zeal_rewind_record(machine->rewind);
+
+        /* Check if we reached a breakpoint or if we have to do a single step */
+        if (machine->dbg_state == ST_REQ_STEP || debugger_is_breakpoint_set(&machine->dbg, machine->cpu.pc)) {
+            machine->dbg_state = ST_PAUSED;
+            debugger_clear_breakpoint_if_temporary(&machine->dbg, machine->cpu.pc);
+        }
+    }
+
+    int rendered = zeal_dbg_mode_display(window);
+    /* If the CPU is paused, we didn't check the UI input! Check it once per frame */
+    if (rendered && machine->dbg_state == ST_PAUSED) {
+        zeal_ui_input(machine);
+    }
+    return rendered;
+}
+#endif  // CONFIG_ENABLE_DEBUGGER
+
+/**
+ * @brief Show the output of the video board scaled to the window, with the overlay
+ */
+static void zeal_window_present(zeal_window_t *window, double runahead_ms) {
+    const zeal_t *machine = window->machine;
+    const int screen_w = GetScreenWidth();
+    const int screen_h = GetScreenHeight();
+    const float texture_ratio = (float)ZVB_MAX_RES_WIDTH / ZVB_MAX_RES_HEIGHT;
+    const float screen_ratio = (float)screen_w / screen_h;
+
+    int pos_x = 0;
+    int pos_y = 0;
+
+    int draw_w = ZVB_MAX_RES_WIDTH;
+    int draw_h = ZVB_MAX_RES_HEIGHT;
+
+    if (texture_ratio > screen_ratio) {
+        /* Texture is "wider" than the screen, add bars on top/bottom */
+        draw_w = screen_w;
+        draw_h = (int)(screen_w / texture_ratio);
+        pos_y = (screen_h - draw_h) / 2;
+    } else {
+        /* Texture is "taller" than the screen, add bars on left/right */
+        draw_h = screen_h;
+        draw_w = (int)(screen_h * texture_ratio);
+        pos_x = (screen_w - draw_w) / 2;
+    }
+
+    window->presented_time = GetTime();
+    BeginDrawing();
+    ClearBackground(DARKGRAY);
+    /* The 320-pixel wide modes only fill the top-left of the texture, scale them up to the same area */
+    DrawTexturePro(window->zvb_out.texture, (Rectangle){0, 0, window->render.width, window->render.height},
+                   (Rectangle){pos_x, pos_y, draw_w, draw_h}, (Vector2){0, 0}, 0.0f, WHITE);
+    int text_y = 10;
+    if (show_fps == true) {
+        DrawFPS(10, text_y);
+        text_y += 20;
+    }
+    if (window->turbo) {
+        DrawText(TextFormat("Turbo: %.1fx", window->turbo_reached), 10, text_y, 20, LIME);
+    } else if (window->runahead != NULL) {
+        DrawText(TextFormat("Run-ahead %d: %.2f ms", machine->args.run_ahead, runahead_ms), 10, text_y, 20, LIME);
+    }
+    EndDrawing();
+}
+
+/**
+ * @brief Present the window again only when it changed: a new frame was drawn, an overlay is shown or the window
+ * was resized. Else, keep the image on screen, handle the host events and wait for the next frame.
+ */
+static void zeal_window_refresh(zeal_window_t *window, bool drawn, double runahead_ms) {
+    const bool overlay = show_fps || window->turbo || window->runahead != NULL;
+    if (drawn || overlay || IsWindowResized() || GetTime() - window->presented_time >= WIN_PRESENT_PERIOD) {
+        zeal_window_present(window, runahead_ms);
+        return;
+    }
+#if WIN_EMULATION_THREAD
+    PollInputEvents();
+    /* Wait like a presented frame would */
+    WaitTime(1.0 / 60);
+#else
+    /* Without the thread, EndDrawing is what paces the machine to 60 frames per second and yields to the
+     * browser. Nothing is drawn, so the canvas keeps its image */
+    BeginDrawing();
+    EndDrawing();
+#endif
+}
+
+/**
+ * @brief Measure the speed the machine reached since the last frame shown, `cycle` being the one of the frame
+ */
+static void zeal_window_shown(zeal_window_t *window, unsigned long cycle) {
+    const double now = GetTime();
+    window->turbo_reached = (double)(cycle - window->shown_cycle) / CPUFREQ / (now - window->shown_time);
+    window->shown_time = now;
+    window->shown_cycle = cycle;
+}
+
+#if WIN_EMULATION_THREAD
+/**
+ * @brief Publish the frame the video board just completed, or the one it completes a few frames ahead with the
+ * run-ahead, for the window to show. Called by the machine thread.
+ */
+static void zeal_window_publish(zeal_window_t *window) {
+    zeal_t *machine = window->machine;
+    /* In turbo, skip the frames completed before the window took the previous one */
+    if (window->turbo && (atomic_load(&window->frame_ready) & WIN_FRAME_NEW)) {
+        machine->zvb.need_render = false;
+        return;
+    }
+
+    bool ahead = false;
+    double start = 0;
+    if (window->runahead != NULL && !window->turbo) {
+        start = GetTime();
+        ahead = zeal_runahead_begin(window->runahead, machine->args.run_ahead);
+    }
+
+    win_frame_t *frame = &window->frames[window->frame_back];
+    zvb_frame_capture(&frame->video, &machine->zvb, window->vram_versions);
+    machine->zvb.need_render = false;
+    frame->cycle = machine->cpu.cyc;
+
+    if (ahead) {
+        zeal_runahead_end(window->runahead);
+        /* Smooth the value shown, it changes a lot from one frame to the next */
+        window->runahead_ms += ((GetTime() - start) * 1000 - window->runahead_ms) * 0.05;
+    }
+    frame->runahead_ms = window->runahead_ms;
+    window->frame_back = atomic_exchange(&window->frame_ready, window->frame_back | WIN_FRAME_NEW) & ~WIN_FRAME_NEW;
+}
+
+/**
+ * @brief Body of the machine thread, runs the machine as long as the window doesn't need it
+ */
+static void *zeal_window_emulate(void *arg) {
+    zeal_window_t *window = (zeal_window_t *)arg;
+    zeal_t *machine = window->machine;
+
+    pthread_mutex_lock(&window->lock);
+    while (!window->quit) {
+        if (atomic_load(&window->lock_requests) > 0 || machine->should_exit
+#if CONFIG_ENABLE_DEBUGGER
+            || machine->dbg_enabled
+#endif
+        ) {
+            pthread_cond_wait(&window->cond, &window->lock);
+            continue;
+        }
+
+        if (!zeal_run_until_event(machine)) {
+            continue;
+        }
+        if (machine->cycle_limit != 0 && !sched_before(machine->cpu.cyc, machine->cycle_limit)) {
+            zeal_exit(machine);
+            continue;
+        }
+        if (keyboard_check(&machine->keyboard)) {
+            zeal_window_feed_keys(window);
+        }
+#if CONFIG_ENABLE_DEBUGGER
+        zeal_rewind_record(machine->rewind);
+#endif
+        if (!machine->zvb.need_render) {
+            continue;
+        }
+        zeal_window_publish(window);
+
+        /* The machine runs a frame at a time, then waits for the host to catch up */
+        const double wait = zeal_window_pace(window, window->turbo ? window->turbo_speed : 1);
+        if (wait > 0) {
+            pthread_mutex_unlock(&window->lock);
+            WaitTime(wait);
+            pthread_mutex_lock(&window->lock);
+        }
+    }
+    pthread_mutex_unlock(&window->lock);
+    return NULL;
+}
+
+/**
+ * @brief Handle the host inputs and show the latest frame published by the machine thread.
+ *
+ * Returns 1, the window is always refreshed
+ */
+static int zeal_normal_mode_run(zeal_window_t *window) {
+    bool handled = false;
+#if CONFIG_ENABLE_DEBUGGER
+    zeal_window_lock(window);
+    handled = zeal_ui_input(window->machine);
+    zeal_window_unlock(window);
+#endif
+    if (!handled) {
+        zeal_read_keyboard(window, (int)us_to_tstates(GetFrameTime() * 1000000.0));
+    }
+
+    bool drawn = false;
+    if (atomic_load(&window->frame_ready) & WIN_FRAME_NEW) {
+        window->frame_front = atomic_exchange(&window->frame_ready, window->frame_front) & ~WIN_FRAME_NEW;
+        win_frame_t *frame = &window->frames[window->frame_front];
+        zvb_frame_prepare(&frame->video, window->tex_versions);
+        if (zvb_prepare_render(&window->render, &frame->video.zvb)) {
+            BeginTextureMode(window->zvb_out);
+            drawn = zvb_render(&window->render, &frame->video.zvb);
+            EndTextureMode();
+        }
+        if (window->turbo) {
+            zeal_window_shown(window, frame->cycle);
+        }
+    }
+    zeal_window_refresh(window, drawn, window->frames[window->frame_front].runahead_ms);
+    return 1;
+}
+#else
+/**
+ * @brief In turbo, tell whether the frame the video board just completed must be shown. The frames are
+ * shown at most 60 times per second and rendering them may take at most a tenth of the host time, the
+ * others are skipped. With a speed multiplier, also wait for the host time when the machine is ahead of it.
+ */
+static bool zeal_window_turbo_show(zeal_window_t *window) {
+    const double wait = zeal_window_pace(window, window->turbo_speed);
+    if (wait > 0) {
+        WaitTime(wait);
+    }
+    const double period = window->render_time * 10 > 1.0 / 60 ? window->render_time * 10 : 1.0 / 60;
+    return GetTime() - window->shown_time >= period;
+}
+
+/**
+ * @brief Run Zeal 8-bit Computer VM in normal mode.
+ *
+ * Returns 1 if the screen was rendered, 0 else
+ */
+static int zeal_normal_mode_run(zeal_window_t *window) {
+    zeal_t *machine = window->machine;
+    int rendered = 0;
+    if (!zeal_run_until_event(machine)) {
+        /* Return 2 to tell the caller we rendered 2 frames, forcing it to exit the current loop and
+         * check for the close/exit flag */
+        return 2;
+    }
+
+    /* Send keyboard keys to Zeal VM only if the UI didn't handle it */
+    if (keyboard_check(&machine->keyboard)
+#if CONFIG_ENABLE_DEBUGGER
+        && !zeal_ui_input(machine)
+#endif
+    ) {
+        zeal_read_keyboard(window, KEYBOARD_CHECK_PERIOD);
+        zeal_window_feed_keys(window);
+    }
+#if CONFIG_ENABLE_DEBUGGER
+    zeal_rewind_record(machine->rewind);
+#endif
+
+    if (window->turbo && machine->zvb.need_render && !zeal_window_turbo_show(window)) {
+        /* Skipped, the textures are updated when the next frame is shown */
+        machine->zvb.need_render = false;
+    }
+
+    /* Show the frame the machine reaches a few frames ahead, then bring it back */
+    bool ahead = false;
+    double ahead_time = 0;
+    if (window->runahead != NULL && !window->turbo && machine->zvb.need_render) {
+        const double start = GetTime();
+        ahead = zeal_runahead_begin(window->runahead, machine->args.run_ahead);
+        ahead_time = GetTime() - start;
+    }
+
+    const double render_start = GetTime();
+    if (zvb_prepare_render(&window->render, &machine->zvb)) {
+        rendered = 1;
+        BeginTextureMode(window->zvb_out);
+        const bool drawn = zvb_render(&window->render, &machine->zvb);
+        EndTextureMode();
+        zeal_window_refresh(window, drawn, window->runahead_ms);
+
+        if (window->turbo) {
+            /* Smoothed like the run-ahead time */
+            window->render_time += (GetTime() - render_start - window->render_time) * 0.05;
+            zeal_window_shown(window, machine->cpu.cyc);
+        }
+    }
+
+    if (ahead) {
+        const double start = GetTime();
+        zeal_runahead_end(window->runahead);
+        ahead_time += GetTime() - start;
+        /* Smooth the value shown, it changes a lot from one frame to the next */
+        window->runahead_ms += (ahead_time * 1000 - window->runahead_ms) * 0.05;
+    }
+    return rendered;
+}
+#endif  // WIN_EMULATION_THREAD
+
+static void zeal_window_loop(zeal_window_t *window) {
+    int rendered = 0;
+    /**
+     * When compiling for WASM, it is not necessary to execute WindowShouldClose as often as possible.
+     * On the contrary, calling it too much would slow the emulation heavily!
+     * Calling it once every two rendered frames should be enough to get a stable 60FPS.
+     *
+     * When compiling as a native appliaction, it is necessarily to call it more often, let's call it
+     * once per frame, just like in Raylib examples.
+     */
+#if PLATFORM_WEB
+    while (rendered < 2) {
+#else
+    while (rendered < 1) {
+#endif
+
+#if CONFIG_ENABLE_DEBUGGER
+        if (window->machine->dbg_enabled) {
+            /* The debugger runs the machine itself, the machine thread waits meanwhile */
+            zeal_window_lock(window);
+            rendered += zeal_dbg_mode_run(window);
+            zeal_window_unlock(window);
+        } else
+#endif  // CONFIG_ENABLE_DEBUGGER
+        {
+            rendered += zeal_normal_mode_run(window);
+        }
+    }
+}
+
+int zeal_window_run(zeal_window_t *window) {
+    if (window == NULL) {
+        return -1;
+    }
+    zeal_t *machine = window->machine;
+
+#if WIN_EMULATION_THREAD
+    pthread_mutex_init(&window->lock, NULL);
+    pthread_cond_init(&window->cond, NULL);
+    if (pthread_create(&window->thread, NULL, zeal_window_emulate, window) != 0) {
+        log_err_printf("[WINDOW] Could not create the machine thread\n");
+        pthread_cond_destroy(&window->cond);
+        pthread_mutex_destroy(&window->lock);
+        return -1;
+    }
+#endif
+
+    while (!WindowShouldClose()) {
+        zeal_window_lock(window);
+        bool stop = machine->should_exit;
+#if CONFIG_ENABLE_DEBUGGER
+        stop = stop || !machine->dbg.running;
+#endif  // CONFIG_ENABLE_DEBUGGER
+        zeal_window_unlock(window);
+        if (stop) {
+            break;
+        }
+        zeal_window_loop(window);
+    }
+
+#if WIN_EMULATION_THREAD
+    zeal_window_lock(window);
+    window->quit = true;
+    zeal_window_unlock(window);
+    pthread_join(window->thread, NULL);
+    pthread_cond_destroy(&window->cond);
+    pthread_mutex_destroy(&window->lock);
+#endif
+
+    StopAudioStream(window->audio);
+    s_sound = NULL;
+    UnloadAudioStream(window->audio);
+    CloseAudioDevice();
+
+#if CONFIG_ENABLE_DEBUGGER
+    config_window_update(machine->dbg_enabled);
+
+    if (window->dbg_ui != NULL) {
+        debugger_ui_deinit(window->dbg_ui);
+    }
+    zeal_rewind_free(machine->rewind);
+    machine->rewind = NULL;
+#else
+    config_window_update(false);
+#endif  // CONFIG_ENABLE_DEBUGGER
+
+    zeal_runahead_free(window->runahead);
+    window->runahead = NULL;
+    zvb_render_deinit(&window->render);
+    UnloadRenderTexture(window->zvb_out);
+    CloseWindow();
+
+    machine->window = NULL;
+    machine->on_reset = NULL;
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "hw/zisa.h"
+
+#include <stdlib.h>
+
+#include "hw/zeal.h"
+#include "hw/zeal_bus.h"
+#include "hw/zeal_state.h"
+#include "hw/zvb/zvb_framebuffer.h"
+#include "utils/log.h"
+
+_Static_assert(ZISA_SCREEN_WIDTH == ZVB_MAX_RES_WIDTH && ZISA_SCREEN_HEIGHT == ZVB_MAX_RES_HEIGHT,
+               "The public screen size must match the video board");
+_Static_assert(ZISA_AUDIO_SAMPLE_RATE == SAMPLE_RATE && ZISA_AUDIO_CHANNELS == SOUND_CHANNELS,
+               "The public audio format must match the sound controller");
+
+zisa_t *zisa_create(const config_arguments_t *args) {
+    const config_arguments_t defaults = {0};
+    /* The machine state is too big for the stack */
+    zeal_t *machine = malloc(sizeof(zeal_t));
+    if (machine == NULL) {
+        log_err_printf("[ZISA] Could not allocate a machine\n");
+        return NULL;
+    }
+    if (zeal_init_args(machine, args ? args : &defaults)) {
+        free(machine);
+        return NULL;
+    }
+    return machine;
+}
+
+void zisa_destroy(zisa_t *machine) {
+    if (machine != NULL) {
+        zeal_deinit(machine);
+        free(machine);
+    }
+}
+
+int zisa_load_rom(zisa_t *machine, const char *rom_filename, const char *uprog_filename) {
+    return flash_load_from_file(&machine->rom, rom_filename, uprog_filename) != FLASH_ERR_OK;
+}
+
+int zisa_reset(zisa_t *machine) {
+    machine->should_exit = false;
+    return zeal_reset(machine);
+}
+
+int zisa_save_state(zisa_t *machine, const char *path) {
+    return zeal_state_save_file(machine, path);
+}
+
+int zisa_load_state(zisa_t *machine, const char *path) {
+    return zeal_state_load_file(machine, path);
+}
+
+unsigned long zisa_run_cycles(zisa_t *machine, unsigned long tstates) {
+    const unsigned long start = machine->cpu.cyc;
+    const unsigned long saved_limit = machine->cycle_limit;
+    machine->cycle_limit = start + tstates;
+    while (!machine->should_exit && sched_before(machine->cpu.cyc, machine->cycle_limit)) {
+        zeal_run_until_event(machine);
+    }
+    machine->cycle_limit = saved_limit;
+    return machine->cpu.cyc - start;
+}
+
+unsigned long zisa_run_frames(zisa_t *machine, unsigned int frames) {
+    const unsigned long start = machine->cpu.cyc;
+    for (unsigned int i = 0; i < frames && !machine->should_exit; i++) {
+        zeal_run_frame(machine);
+    }
+    return machine->cpu.cyc - start;
+}
+
+bool zisa_stopped(const zisa_t *machine) {
+    return machine->should_exit;
+}
+
+void zisa_read_memory(zisa_t *machine, uint16_t virt_addr, uint8_t *dst, uint32_t len) {
+    zeal_bus_read_block(machine, virt_addr, dst, len);
+}
+
+void zisa_write_memory(zisa_t *machine, uint16_t virt_addr, const uint8_t *src, uint32_t len) {
+    zeal_bus_write_block(machine, virt_addr, src, len);
+}
+
+void zisa_read_phys_memory(zisa_t *machine, uint32_t phys_addr, uint8_t *dst, uint32_t len) {
+    zeal_bus_phys_read_block(machine, phys_addr, dst, len);
+}
+
+void zisa_write_phys_memory(zisa_t *machine, uint32_t phys_addr, const uint8_t *src, uint32_t len) {
+    zeal_bus_phys_write_block(machine, phys_addr, src, len);
+}
+
+void zisa_set_uart_output(zisa_t *machine, uart_output_t output, void *arg) {
+    uart_set_output(&machine->uart, output, arg);
+}
+
+void zisa_key_event(zisa_t *machine, uint16_t scancode, bool pressed) {
+    if (pressed) {
+        key_pressed(&machine->keyboard, scancode);
+    } else {
+        key_released(&machine->keyboard, scancode);
+    }
+}
+
+bool zisa_get_framebuffer(zisa_t *machine, uint32_t *pixels) {
+    if (machine->headless) {
+        return false;
+    }
+
+    const bool new_frame = machine->zvb.need_render;
+    machine->zvb.need_render = false;
+    zvb_framebuffer_render(&machine->zvb, pixels);
+    return new_frame;
+}
+
+unsigned int zisa_get_audio(zisa_t *machine, int16_t *buffer, unsigned int frames) {
+    if (machine->headless) {
+        return 0;
+    }
+    zvb_sound_generate(&machine->zvb.sound, buffer, frames);
+    return frames;
+}
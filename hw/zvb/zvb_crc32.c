@@ -12,7 +12,6 @@
 #include <assert.h>
 #include <string.h>
 
-#include "raylib.h"
 #include "utils/log.h"
 #include "utils/helpers.h"
 #include "hw/pio.h"
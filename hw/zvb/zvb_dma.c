@@ -10,8 +10,11 @@
 
 #include "hw/zvb/zvb_dma.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "utils/log.h"
+
 
 #define DEBUG_DMA 0
 
@@ -20,19 +23,66 @@ static inline uint32_t dma_get_addr(const uint8_t addr[3]) {
     return addr[0] | (addr[1] << 8) | (addr[2] << 16);
 }
 
-/// A more portable packed structure alternative
-static inline void dma_set_addr(uint8_t addr[3], uint32_t val) {
-    addr[0] = val & 0xFF;
-    addr[1] = (val >> 8) & 0xFF;
-    addr[2] = (val >> 16) & 0xFF;
+/**
+ * @brief Mask of the 24-bit physical addresses
+ */
+#define DMA_ADDR_MASK 0xFFFFFF
+
+/**
+ * @brief Granularity of the physical memory map, a bulk copy must not cross it since the next page
+ * may belong to another device
+ */
+#define DMA_PAGE_SIZE (16 * 1024)
+
+/**
+ * @brief Maximum number of bytes copied at once by the bulk path
+ */
+#define DMA_CHUNK_SIZE 256
+
+static inline uint32_t dma_step(int op) {
+    if (op == DMA_OP_INC) {
+        return 1;
+    } else if (op == DMA_OP_DEC) {
+        return (uint32_t)-1;
+    }
+    /* Fixed address */
+    return 0;
+}
+
+static inline uint32_t dma_min(uint32_t a, uint32_t b) {
+    return a < b ? a : b;
+}
+
+/**
+ * @brief Get the number of bytes that can be copied at once from `rd` to `wr`, 0 if the next byte
+ * must be copied alone. Both pages must behave like plain memory so that the result is the same as
+ * copying the bytes one by one.
+ */
+static uint32_t dma_chunk(const zvb_dma_t *dma, uint32_t rd, uint32_t wr, uint32_t len) {
+    const memory_op_t *ops = dma->ops;
+    if (ops->phys_plain == NULL || !ops->phys_plain(ops->opaque, rd) || !ops->phys_plain(ops->opaque, wr)) {
+        return 0;
+    }
+    uint32_t count = dma_min(len, DMA_CHUNK_SIZE);
+    count = dma_min(count, DMA_PAGE_SIZE - rd % DMA_PAGE_SIZE);
+    count = dma_min(count, DMA_PAGE_SIZE - wr % DMA_PAGE_SIZE);
+    /* A destination right after the source reads back the bytes written before, like the byte copy */
+    if (wr > rd && wr - rd < count) {
+        count = wr - rd;
+    }
+    return count;
 }
 
 static void dma_start_transfer(zvb_dma_t *dma) {
     /* Grab the first descriptor from memory */
     zvb_dma_descriptor_t desc = {0};
+    /* Number of bytes read and written by the controller, descriptors included */
+    unsigned long reads = 0;
+    unsigned long writes = 0;
 
     do {
         memory_phys_read_bytes(dma->ops, dma->desc_addr, (void *)&desc, sizeof(zvb_dma_descriptor_t));
+        reads += sizeof(zvb_dma_descriptor_t);
         const int rd_ops = desc.flags.rd_op;
         const int wr_ops = desc.flags.wr_op;
 
@@ -47,34 +97,44 @@ static void dma_start_transfer(zvb_dma_t *dma) {
         log_printf("    Last: %d\n", desc.flags.last);
 #endif
 
-        /* Descriptor is ready, perform the copy */
-        for (int i = 0; i < desc.length; i++) {
-            const uint8_t data = memory_phys_read_byte(dma->ops, dma_get_addr(desc.rd_addr));
-            memory_phys_write_byte(dma->ops, dma_get_addr(desc.wr_addr), data);
+        /* Descriptor is ready, perform the copy. Incrementing addresses are copied in bulk when possible */
+        const bool bulk = rd_ops == DMA_OP_INC && wr_ops == DMA_OP_INC;
+        uint32_t rd = dma_get_addr(desc.rd_addr);
+        uint32_t wr = dma_get_addr(desc.wr_addr);
+        uint32_t left = desc.length;
+
+        while (left > 0) {
+            const uint32_t count = bulk ? dma_chunk(dma, rd, wr, left) : 0;
+            if (count > 0) {
+                uint8_t buffer[DMA_CHUNK_SIZE];
+                memory_phys_read_bytes(dma->ops, rd, buffer, count);
+                memory_phys_write_bytes(dma->ops, wr, buffer, count);
+                rd = (rd + count) & DMA_ADDR_MASK;
+                wr = (wr + count) & DMA_ADDR_MASK;
+                left -= count;
+                continue;
+            }
+
+            const uint8_t data = memory_phys_read_byte(dma->ops, rd);
+            memory_phys_write_byte(dma->ops, wr, data);
 
 #if DEBUG_DMA
-            log_printf("Transfer: src=0x%08X, dst=0x%08X, byte=0x%02X\n", dma_get_addr(desc.rd_addr),
-                       dma_get_addr(desc.wr_addr), data);
+            log_printf("Transfer: src=0x%08X, dst=0x%08X, byte=0x%02X\n", rd, wr, data);
 #endif
 
-            /* Check if we have to modify the addresses */
-            if (rd_ops == DMA_OP_INC) {
-                dma_set_addr(desc.rd_addr, dma_get_addr(desc.rd_addr) + 1);
-            } else if (rd_ops == DMA_OP_DEC) {
-                dma_set_addr(desc.rd_addr, dma_get_addr(desc.rd_addr) - 1);
-            }
-
-            if (wr_ops == DMA_OP_INC) {
-                dma_set_addr(desc.wr_addr, dma_get_addr(desc.wr_addr) + 1);
-            } else if (wr_ops == DMA_OP_DEC) {
-                dma_set_addr(desc.wr_addr, dma_get_addr(desc.wr_addr) - 1);
-            }
+            rd = (rd + dma_step(rd_ops)) & DMA_ADDR_MASK;
+            wr = (wr + dma_step(wr_ops)) & DMA_ADDR_MASK;
+            left--;
         }
+        reads += desc.length;
+        writes += desc.length;
         /* Make the descriptor pointer go to the next descriptor */
         dma->desc_addr += sizeof(zvb_dma_descriptor_t);
     } while (!desc.flags.last);
 
-    /* TODO: add number of elapsed T-states to the CPU? */
+    /* The controller holds the bus during the whole transfer, each access takes the number of
+     * T-states programmed in the clock register */
+    memory_stall(dma->ops, reads * dma->clk.rd_cycle + writes * dma->clk.wr_cycle);
 }
 
 void zvb_dma_init(zvb_dma_t *dma, const memory_op_t *ops) {
@@ -0,0 +1,236 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "hw/zvb/zvb_framebuffer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FB_STRIDE ZVB_MAX_RES_WIDTH
+
+/* Tile size in graphics mode, and size of the tilemap in pixels */
+#define GFX_TILE_SIZE 16
+#define GFX_MAP_WIDTH (TEXT_MAXIMUM_COLUMNS * GFX_TILE_SIZE)
+#define GFX_MAP_HEIGHT (TEXT_MAXIMUM_LINES * GFX_TILE_SIZE)
+
+#define BITMAP_256_BORDER 32
+#define BITMAP_320_BORDER 20
+
+/**
+ * @brief Double the size of the top-left `width` x `height` picture to fill the whole framebuffer.
+ * The pixels are processed backwards so that none is overwritten before being read.
+ */
+static void fb_scale_up(uint32_t *pixels, int width, int height) {
+    for (int y = height - 1; y >= 0; y--) {
+        for (int x = width - 1; x >= 0; x--) {
+            const uint32_t color = pixels[y * FB_STRIDE + x];
+            uint32_t *dst = &pixels[2 * y * FB_STRIDE + 2 * x];
+            dst[0] = color;
+            dst[1] = color;
+            dst[FB_STRIDE] = color;
+            dst[FB_STRIDE + 1] = color;
+        }
+    }
+}
+
+static void fb_render_text(const zvb_t *zvb, const uint32_t *colors, uint32_t *pixels, int width, int height) {
+    zvb_text_info_t info;
+    zvb_text_get_info(&zvb->text, &info);
+
+    for (int y = 0; y < height; y++) {
+        const int char_y = y / ZVB_FONT_CHAR_HEIGHT;
+        for (int x = 0; x < width; x++) {
+            const int char_x = x / ZVB_FONT_CHAR_WIDTH;
+            int tile;
+            int fg;
+            int bg;
+
+            if (char_x == info.pos[0] && char_y == info.pos[1]) {
+                tile = info.charidx;
+                bg = info.color[0];
+                fg = info.color[1];
+            } else {
+                /* Take scrolling into account */
+                const int col = (char_x + info.scroll[0]) % TEXT_MAXIMUM_COLUMNS;
+                const int line = (char_y + info.scroll[1]) % TEXT_MAXIMUM_LINES;
+                const int idx = col + line * TEXT_MAXIMUM_COLUMNS;
+                const uint8_t attr = zvb->layers.raw_layer1[idx];
+                tile = zvb->layers.raw_layer0[idx];
+                bg = (attr >> 4) & 0xf;
+                fg = attr & 0xf;
+            }
+
+            const bool is_fg = zvb_font_pixel(&zvb->font, tile, x % ZVB_FONT_CHAR_WIDTH, y % ZVB_FONT_CHAR_HEIGHT);
+            pixels[y * FB_STRIDE + x] = colors[is_fg ? fg : bg];
+        }
+    }
+}
+
+static void fb_render_bitmap(const zvb_t *zvb, const uint32_t *colors, uint32_t *pixels) {
+    const uint8_t *bitmap = zvb->tileset.raw;
+    /* Last byte of the VRAM is used as the border color */
+    const uint32_t border = colors[bitmap[ZVB_TILESET_SIZE - 1]];
+    const bool mode_256 = zvb->mode == MODE_BITMAP_256;
+
+    for (int y = 0; y < ZVB_MAX_RES_HEIGHT / 2; y++) {
+        for (int x = 0; x < ZVB_MAX_RES_WIDTH / 2; x++) {
+            uint32_t color = border;
+            if (mode_256 && x >= BITMAP_256_BORDER && x < BITMAP_256_BORDER + 256) {
+                color = colors[bitmap[y * 256 + (x - BITMAP_256_BORDER)]];
+            } else if (!mode_256 && y >= BITMAP_320_BORDER && y < BITMAP_320_BORDER + 200) {
+                color = colors[bitmap[(y - BITMAP_320_BORDER) * 320 + x]];
+            }
+            pixels[y * FB_STRIDE + x] = color;
+        }
+    }
+}
+
+/**
+ * @brief Get the color index of a pixel from the tileset
+ *
+ * @param idx Index of the tile
+ * @param offset Offset of the pixel within the tile
+ */
+static inline uint8_t fb_tile_color(const zvb_t *zvb, int idx, int offset, bool color_4bit) {
+    uint32_t final_idx = idx * GFX_TILE_SIZE * GFX_TILE_SIZE + offset;
+    if (color_4bit) {
+        const uint8_t byte = zvb->tileset.raw[(final_idx / 2) % ZVB_TILESET_SIZE];
+        /* Odd pixels are in the lowest nibble */
+        return (final_idx % 2) ? (byte & 0x0f) : (byte >> 4);
+    }
+    return zvb->tileset.raw[final_idx % ZVB_TILESET_SIZE];
+}
+
+/**
+ * @brief Get the color of a pixel made of the tilemap layers in graphics mode. `from_l1` is set when the
+ * color comes from layer1, sprites behind the foreground are hidden by such pixels.
+ */
+static uint8_t fb_gfx_layers_color(const zvb_t *zvb, int x, int y, bool color_4bit, bool *from_l1) {
+    const uint8_t *layer0 = zvb->layers.raw_layer0;
+    const uint8_t *layer1 = zvb->layers.raw_layer1;
+    const int l0_x = (x + zvb->ctrl.l0_scroll_x) % GFX_MAP_WIDTH;
+    const int l0_y = (y + zvb->ctrl.l0_scroll_y) % GFX_MAP_HEIGHT;
+    const int l0_tile = (l0_x / GFX_TILE_SIZE) + (l0_y / GFX_TILE_SIZE) * TEXT_MAXIMUM_COLUMNS;
+    int l0_off_x = l0_x % GFX_TILE_SIZE;
+    int l0_off_y = l0_y % GFX_TILE_SIZE;
+
+    if (color_4bit) {
+        /* Layer1 holds the attributes of the tile: tileset half, flips and palette */
+        const uint8_t attr = layer1[l0_tile];
+        const int idx = layer0[l0_tile] + ((attr & 1) ? 256 : 0);
+        if (attr & 4) {
+            l0_off_y = (GFX_TILE_SIZE - 1) - l0_off_y;
+        }
+        if (attr & 8) {
+            l0_off_x = (GFX_TILE_SIZE - 1) - l0_off_x;
+        }
+        /* No transparency in 4-bit mode */
+        *from_l1 = true;
+        return fb_tile_color(zvb, idx, l0_off_y * GFX_TILE_SIZE + l0_off_x, true) + (attr & 0xf0);
+    }
+
+    const int l1_x = (x + zvb->ctrl.l1_scroll_x) % GFX_MAP_WIDTH;
+    const int l1_y = (y + zvb->ctrl.l1_scroll_y) % GFX_MAP_HEIGHT;
+    const int l1_tile = (l1_x / GFX_TILE_SIZE) + (l1_y / GFX_TILE_SIZE) * TEXT_MAXIMUM_COLUMNS;
+    const int l1_off = (l1_y % GFX_TILE_SIZE) * GFX_TILE_SIZE + (l1_x % GFX_TILE_SIZE);
+    const uint8_t l1_color = fb_tile_color(zvb, layer1[l1_tile], l1_off, false);
+    /* Color 0 of layer1 is transparent */
+    *from_l1 = l1_color != 0;
+    if (*from_l1) {
+        return l1_color;
+    }
+    return fb_tile_color(zvb, layer0[l0_tile], l0_off_y * GFX_TILE_SIZE + l0_off_x, false);
+}
+
+static void fb_render_gfx(const zvb_t *zvb, const uint32_t *colors, uint32_t *pixels, int width, int height) {
+    const bool color_4bit = zvb->mode == MODE_GFX_640_4BIT || zvb->mode == MODE_GFX_320_4BIT;
+    /* Sprites crossing the current line, in ascending order since the last one drawn wins */
+    uint8_t line_sprites[ZVB_SPRITES_COUNT];
+
+    for (int y = 0; y < height; y++) {
+        int count = 0;
+        for (int i = 0; i < ZVB_SPRITES_COUNT; i++) {
+            const zvb_sprite_t *sprite = &zvb->sprites.data[i];
+            const int top = sprite->y - GFX_TILE_SIZE;
+            const int sprite_height = sprite->extra_flags.bitmap.height_32 ? 2 * GFX_TILE_SIZE : GFX_TILE_SIZE;
+            if (y >= top && y < top + sprite_height) {
+                line_sprites[count++] = i;
+            }
+        }
+
+        for (int x = 0; x < width; x++) {
+            bool from_l1;
+            int color = fb_gfx_layers_color(zvb, x, y, color_4bit, &from_l1);
+
+            for (int i = 0; i < count; i++) {
+                const zvb_sprite_t *sprite = &zvb->sprites.data[line_sprites[i]];
+                const int left = sprite->x - GFX_TILE_SIZE;
+                if (x < left || x >= left + GFX_TILE_SIZE || (sprite->flags.bitmap.behind_fg && from_l1)) {
+                    continue;
+                }
+                const int sprite_height = sprite->extra_flags.bitmap.height_32 ? 2 * GFX_TILE_SIZE : GFX_TILE_SIZE;
+                int pix_x = x - left;
+                int pix_y = y - (sprite->y - GFX_TILE_SIZE);
+                if (sprite->flags.bitmap.flip_y) {
+                    pix_y = sprite_height - 1 - pix_y;
+                }
+                if (sprite->flags.bitmap.flip_x) {
+                    pix_x = GFX_TILE_SIZE - 1 - pix_x;
+                }
+                const int tile = (sprite->flags.bitmap.tileset_idx << 8) | sprite->flags.bitmap.tile_number;
+                const uint8_t icolor = fb_tile_color(zvb, tile, pix_x + pix_y * GFX_TILE_SIZE, color_4bit);
+                /* Color 0 is transparent, the palette is ignored in 8-bit mode */
+                if (icolor != 0) {
+                    color = icolor + (color_4bit ? sprite->flags.bitmap.palette << 4 : 0);
+                }
+            }
+            pixels[y * FB_STRIDE + x] = colors[color & 0xff];
+        }
+    }
+}
+
+void zvb_framebuffer_render(const zvb_t *zvb, uint32_t *pixels) {
+    uint32_t colors[ZVB_COLOR_PALETTE_COUNT];
+    zvb_palette_to_rgba(&zvb->palette, colors);
+
+    if (!zvb->status.vid_ena) {
+        const uint8_t black[4] = {0, 0, 0, 0xff};
+        uint32_t color;
+        memcpy(&color, black, sizeof(color));
+        for (int i = 0; i < ZVB_FRAMEBUFFER_PIXELS; i++) {
+            pixels[i] = color;
+        }
+        return;
+    }
+
+    bool mode_320 = true;
+    switch (zvb->mode) {
+        case MODE_TEXT_640:
+            mode_320 = false;
+            /* fall-through */
+        case MODE_TEXT_320:
+            fb_render_text(zvb, colors, pixels, ZVB_MAX_RES_WIDTH >> mode_320, ZVB_MAX_RES_HEIGHT >> mode_320);
+            break;
+
+        case MODE_BITMAP_256:
+        case MODE_BITMAP_320:
+            fb_render_bitmap(zvb, colors, pixels);
+            break;
+
+        case MODE_GFX_640_8BIT:
+        case MODE_GFX_640_4BIT:
+            mode_320 = false;
+            /* fall-through */
+        default:
+            fb_render_gfx(zvb, colors, pixels, ZVB_MAX_RES_WIDTH >> mode_320, ZVB_MAX_RES_HEIGHT >> mode_320);
+            break;
+    }
+
+    if (mode_320) {
+        fb_scale_up(pixels, ZVB_MAX_RES_WIDTH / 2, ZVB_MAX_RES_HEIGHT / 2);
+    }
+}
@@ -11,8 +11,6 @@
 #include "hw/zvb/zvb_palette.h"
 
 
-static void palette_rgb565_to_color(uint_fast16_t rgb, Color *color);
-
 /**
  * @brief Default palette, loaded on boot only (not on reset). Each color is an RGB565 value, stored in little-endian in memory.
  */
@@ -58,16 +56,7 @@ void zvb_palette_init(zvb_palette_t* pal)
     assert(pal != NULL);
 
     memcpy(pal->raw_palette, default_palette_565, sizeof(default_palette_565));
-    pal->img_pal = GenImageColor(ZVB_COLOR_PALETTE_COUNT, 1, BLACK);
-
-    /* Each color is 2 bytes big, in little-endian format */
-    Color* colors = (Color*) pal->img_pal.data;
-    for (size_t i = 0; i < sizeof(default_palette_565); i += 2) {
-        const uint_fast16_t rgb = default_palette_565[i] + (default_palette_565[i + 1] << 8);
-        palette_rgb565_to_color(rgb, &colors[i / 2]);
-    }
-    pal->tex_pal = LoadTextureFromImage(pal->img_pal);
-    pal->dirty = false;
+    zvb_dirty_clear(&pal->dirty);
 }
 
 
@@ -77,16 +66,11 @@ void zvb_palette_write(zvb_palette_t* pal, uint32_t addr, uint8_t data)
         pal->wr_latch = data;
         return;
     }
-    Color* colors = (Color*) (pal->img_pal.data);
 
     /* Odd address (MSB) written! */
     pal->raw_palette[addr - 1] = pal->wr_latch;
     pal->raw_palette[addr] = data;
-
-    /* Update the color in the dediacted table, so get the RGB565 out of the two bytes */
-    const uint_fast16_t rgb565 = (data << 8) | pal->wr_latch;
-    palette_rgb565_to_color(rgb565, &colors[addr / 2]);
-    pal->dirty = true;
+    zvb_dirty_mark(&pal->dirty, addr - 1, 2);
 }
 
 
@@ -96,21 +80,16 @@ uint8_t zvb_palette_read(zvb_palette_t* pal, uint32_t addr)
 }
 
 
-void zvb_palette_update(zvb_palette_t* pal)
+void zvb_palette_to_rgba(const zvb_palette_t* pal, uint32_t colors[ZVB_COLOR_PALETTE_COUNT])
 {
-    if (pal->dirty) {
-        UpdateTexture(pal->tex_pal, pal->img_pal.data);
-        pal->dirty = false;
+    for (int i = 0; i < ZVB_COLOR_PALETTE_COUNT; i++) {
+        const uint_fast16_t rgb = zvb_palette_rgb565(pal, i);
+        const uint8_t color[4] = {
+            ((rgb >> 11) & 0x1F) << 3,  // convert 5->8 bits
+            ((rgb >> 5)  & 0x3F) << 2,  // convert 6->8 bits
+            ((rgb >> 0)  & 0x1F) << 3,  // convert 5->8 bits
+            0xFF,
+        };
+        memcpy(&colors[i], color, sizeof(color));
     }
 }
-
-static void palette_rgb565_to_color(uint_fast16_t rgb, Color *color)
-{
-    const uint_fast8_t r = (rgb >> 11) & 0x1F;  // 5 bits for red
-    const uint_fast8_t g = (rgb >> 5)  & 0x3F;  // 6 bits for green
-    const uint_fast8_t b = (rgb >> 0)  & 0x1F;  // 5 bits for blue
-    color->r = (r << 3) | 0;  // convert 5->8 bits
-    color->g = (g << 2) | 0;  // convert 6->8 bits
-    color->b = (b << 3) | 0;  // convert 5->8 bits
-    color->a = 0xFF;
-}
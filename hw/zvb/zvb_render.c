@@ -0,0 +1,758 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Zeal 8-bit Computer <contact@zeal8bit.com>; David Higgins <zoul0813@me.com>
+ *
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * SPDX-FileContributor: Modified by Robert Maupin 2026
+ */
+
+#include "hw/zvb/zvb_render.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "raylib.h"
+#include "utils/log.h"
+
+/* Shaders as static strings */
+#include "shaders/bitmap_shader.h"
+#include "shaders/gfx_debug.h"
+#include "shaders/gfx_shader.h"
+#include "shaders/text_debug.h"
+#include "shaders/text_shader.h"
+
+
+#define BENCHMARK 0
+
+/**
+ * @brief The VRAM is uploaded as is, one byte per texel, the shaders unpack it. The tileset is 256 bytes
+ * per line, the font a character per line and the tilemaps a row of tiles per line, layer 1 after layer 0.
+ * The sprites are 4 bytes per texel, to read a sprite in two fetches.
+ */
+#define TILESET_TEX_WIDTH (256)
+#define TILESET_TEX_HEIGHT (ZVB_TILESET_SIZE / TILESET_TEX_WIDTH)
+#define TILEMAP_TEX_WIDTH (TEXT_MAXIMUM_COLUMNS)
+#define TILEMAP_TEX_HEIGHT (2 * ZVB_TILEMAP_SIZE / TILEMAP_TEX_WIDTH)
+#define SPRITES_TEX_WIDTH (ZVB_SPRITES_COUNT * sizeof(zvb_sprite_t) / sizeof(Color))
+/* Width and height of the sprites, in pixels, the height is doubled for the 32-pixel tall ones */
+#define SPRITE_SIZE (16)
+
+_Static_assert(TILEMAP_TEX_WIDTH * TILEMAP_TEX_HEIGHT == 2 * ZVB_TILEMAP_SIZE, "Tilemap texture size is invalid");
+
+/**
+ * @brief Calculate the size (width or height) counting a grid
+ */
+#define SIZE_WITH_GRID(TILESIZE, TILECOUNT) ((((TILESIZE) + 1) * TILECOUNT) + 1)
+
+/**
+ * @brief Names of the variables in the shader
+ */
+#define SHADER_VIDMODE_NAME "video_mode"
+#define SHADER_PALETTE_NAME "palette"
+#define SHADER_FONT_NAME "font"
+#define SHADER_TILEMAPS_NAME "tilemaps"
+#define SHADER_TILESET_NAME "tileset"
+#define SHADER_CURPOS_NAME "curpos"
+#define SHADER_CURCOLOR_NAME "curcolor"
+#define SHADER_CURCHAR_NAME "curchar"
+#define SHADER_TSCROLL_NAME "scroll"
+#define SHADER_SPRITES_NAME "sprites"
+#define SHADER_BANDS_NAME "sprite_bands"
+/* Scrolling vlaues for GFX mode */
+#define SHADER_SCROLL0_NAME "scroll_l0"
+#define SHADER_SCROLL1_NAME "scroll_l1"
+
+static void zvb_shader_init(zvb_render_t *dev) {
+    /* Get the indexes of the objects in the shaders */
+    zvb_shader_t *st_shader = &dev->shaders[SHADER_TEXT];
+    log_printf("Compiling shader text_shader\n");
+    Shader shader = LoadShaderFromMemory(NULL, s_text_shader);
+    st_shader->shader = shader;
+    st_shader->objects[TEXT_SHADER_VIDMODE_IDX] = GetShaderLocation(shader, SHADER_VIDMODE_NAME);
+    st_shader->objects[TEXT_SHADER_TILEMAPS_IDX] = GetShaderLocation(shader, SHADER_TILEMAPS_NAME);
+    st_shader->objects[TEXT_SHADER_FONT_IDX] = GetShaderLocation(shader, SHADER_FONT_NAME);
+    st_shader->objects[TEXT_SHADER_PALETTE_IDX] = GetShaderLocation(shader, SHADER_PALETTE_NAME);
+    st_shader->objects[TEXT_SHADER_CURPOS_IDX] = GetShaderLocation(shader, SHADER_CURPOS_NAME);
+    st_shader->objects[TEXT_SHADER_CURCOLOR_IDX] = GetShaderLocation(shader, SHADER_CURCOLOR_NAME);
+    st_shader->objects[TEXT_SHADER_CURCHAR_IDX] = GetShaderLocation(shader, SHADER_CURCHAR_NAME);
+    st_shader->objects[TEXT_SHADER_TSCROLL_IDX] = GetShaderLocation(shader, SHADER_TSCROLL_NAME);
+
+    /* Text debug shaders */
+    st_shader = &dev->shaders[SHADER_TEXT_DEBUG];
+    log_printf("Compiling shader text_debug\n");
+    shader = LoadShaderFromMemory(NULL, s_text_debug);
+    st_shader->shader = shader;
+    st_shader->objects[TEXT_SHADER_VIDMODE_IDX] = GetShaderLocation(shader, SHADER_VIDMODE_NAME);
+    st_shader->objects[TEXT_SHADER_TILEMAPS_IDX] = GetShaderLocation(shader, SHADER_TILEMAPS_NAME);
+    st_shader->objects[TEXT_SHADER_FONT_IDX] = GetShaderLocation(shader, SHADER_FONT_NAME);
+    st_shader->objects[TEXT_SHADER_PALETTE_IDX] = GetShaderLocation(shader, SHADER_PALETTE_NAME);
+    st_shader->objects[TEXT_SHADER_DBGMODE_IDX] = GetShaderLocation(shader, "debug_mode");
+
+    st_shader = &dev->shaders[SHADER_GFX];
+    log_printf("Compiling shader gfx_shader\n");
+    shader = LoadShaderFromMemory(NULL, s_gfx_shader);
+    st_shader->shader = shader;
+    st_shader->objects[GFX_SHADER_VIDMODE_IDX] = GetShaderLocation(shader, SHADER_VIDMODE_NAME);
+    st_shader->objects[GFX_SHADER_TILEMAPS_IDX] = GetShaderLocation(shader, SHADER_TILEMAPS_NAME);
+    st_shader->objects[GFX_SHADER_TILESET_IDX] = GetShaderLocation(shader, SHADER_TILESET_NAME);
+    st_shader->objects[GFX_SHADER_SPRITES_IDX] = GetShaderLocation(shader, SHADER_SPRITES_NAME);
+    st_shader->objects[GFX_SHADER_SCROLL0_IDX] = GetShaderLocation(shader, SHADER_SCROLL0_NAME);
+    st_shader->objects[GFX_SHADER_SCROLL1_IDX] = GetShaderLocation(shader, SHADER_SCROLL1_NAME);
+    st_shader->objects[GFX_SHADER_PALETTE_IDX] = GetShaderLocation(shader, SHADER_PALETTE_NAME);
+    st_shader->objects[GFX_SHADER_BANDS_IDX] = GetShaderLocation(shader, SHADER_BANDS_NAME);
+
+    st_shader = &dev->shaders[SHADER_BITMAP];
+    log_printf("Compiling shader bitmap_shader\n");
+    shader = LoadShaderFromMemory(NULL, s_bitmap_shader);
+    st_shader->shader = shader;
+    st_shader->objects[GFX_SHADER_VIDMODE_IDX] = GetShaderLocation(shader, SHADER_VIDMODE_NAME);
+    st_shader->objects[GFX_SHADER_TILESET_IDX] = GetShaderLocation(shader, SHADER_TILESET_NAME);
+    st_shader->objects[GFX_SHADER_PALETTE_IDX] = GetShaderLocation(shader, SHADER_PALETTE_NAME);
+
+    st_shader = &dev->shaders[SHADER_GFX_DEBUG];
+    log_printf("Compiling shader gfx_debug\n");
+    shader = LoadShaderFromMemory(NULL, s_gfx_debug);
+    st_shader->shader = shader;
+    st_shader->objects[GFX_SHADER_VIDMODE_IDX] = GetShaderLocation(shader, SHADER_VIDMODE_NAME);
+    st_shader->objects[GFX_SHADER_TILEMAPS_IDX] = GetShaderLocation(shader, SHADER_TILEMAPS_NAME);
+    st_shader->objects[GFX_SHADER_TILESET_IDX] = GetShaderLocation(shader, SHADER_TILESET_NAME);
+    st_shader->objects[GFX_SHADER_PALETTE_IDX] = GetShaderLocation(shader, SHADER_PALETTE_NAME);
+    st_shader->objects[GFX_SHADER_DBGMODE_IDX] = GetShaderLocation(shader, "debug_mode");
+}
+
+/**
+ * @brief Load a texture out of the given pixels, `format` being one of Raylib's PIXELFORMAT_*
+ */
+static Texture zvb_load_texture(const void *pixels, int width, int height, int format) {
+    const Image img = {
+        .data = (void *)pixels,
+        .width = width,
+        .height = height,
+        .mipmaps = 1,
+        .format = format,
+    };
+    return LoadTextureFromImage(img);
+}
+
+/**
+ * @brief Upload the bytes of `data` in the dirty range to `texture`, from its line `line`, `texel_size` bytes
+ * per texel, and clear the range. Within a single line, only the dirty texels are sent, else the whole lines.
+ */
+static void zvb_update_texture(Texture texture, int line, const uint8_t *data, int texel_size, zvb_dirty_t *dirty) {
+    if (!zvb_dirty_any(dirty)) {
+        return;
+    }
+    const uint32_t line_size = (uint32_t)(texture.width * texel_size);
+    const uint32_t first = dirty->start / line_size;
+    const uint32_t last = (dirty->end - 1) / line_size;
+    if (first == last) {
+        const uint32_t x = (dirty->start % line_size) / texel_size;
+        const uint32_t width = ((dirty->end - 1) % line_size) / texel_size + 1 - x;
+        UpdateTextureRec(texture, (Rectangle){x, line + first, width, 1}, data + first * line_size + x * texel_size);
+    } else {
+        UpdateTextureRec(texture, (Rectangle){0, line + first, texture.width, last - first + 1},
+                         data + first * line_size);
+    }
+    zvb_dirty_clear(dirty);
+}
+
+static void zvb_update_font(zvb_render_t *render, zvb_font_t *font) {
+    zvb_update_texture(render->tex_font, 0, font->raw_font, 1, &font->dirty);
+}
+
+static void zvb_update_palette(zvb_render_t *render, zvb_palette_t *palette) {
+    zvb_update_texture(render->tex_palette, 0, palette->raw_palette, 1, &palette->dirty);
+}
+
+static void zvb_update_tilemap(zvb_render_t *render, zvb_tilemap_t *tilemap) {
+    if (!zvb_dirty_any(&tilemap->dirty)) {
+        return;
+    }
+    /* Each layer is a separate array, split the range between them */
+    zvb_dirty_t layer0 = {0};
+    zvb_dirty_t layer1 = {0};
+    if (tilemap->dirty.start < ZVB_TILEMAP_SIZE) {
+        const uint32_t end = tilemap->dirty.end < ZVB_TILEMAP_SIZE ? tilemap->dirty.end : ZVB_TILEMAP_SIZE;
+        zvb_dirty_mark(&layer0, tilemap->dirty.start, end - tilemap->dirty.start);
+    }
+    if (tilemap->dirty.end > ZVB_TILEMAP_SIZE) {
+        const uint32_t start = tilemap->dirty.start > ZVB_TILEMAP_SIZE ? tilemap->dirty.start : ZVB_TILEMAP_SIZE;
+        zvb_dirty_mark(&layer1, start - ZVB_TILEMAP_SIZE, tilemap->dirty.end - start);
+    }
+    zvb_update_texture(render->tex_tilemap, 0, tilemap->raw_layer0, 1, &layer0);
+    zvb_update_texture(render->tex_tilemap, TILEMAP_TEX_HEIGHT / 2, tilemap->raw_layer1, 1, &layer1);
+    zvb_dirty_clear(&tilemap->dirty);
+}
+
+static void zvb_update_tileset(zvb_render_t *render, zvb_tileset_t *tileset) {
+    zvb_update_texture(render->tex_tileset, 0, tileset->raw, 1, &tileset->dirty);
+}
+
+/**
+ * @brief Sort the sprites in the bands of lines they cross, in ascending order since the last one drawn wins.
+ * The coordinates are the ones of the video mode, the 320-pixel wide modes only use the first half of the bands.
+ */
+static void zvb_bin_sprites(zvb_render_t *render, const zvb_sprites_t *sprites) {
+    for (int band = 0; band < ZVB_SPRITES_BAND_COUNT; band++) {
+        render->sprite_bands[band][0] = 0;
+    }
+    for (int i = 0; i < ZVB_SPRITES_COUNT; i++) {
+        const zvb_sprite_t *sprite = &sprites->data[i];
+        const int top = sprite->y - SPRITE_SIZE;
+        const int bottom = top + (sprite->extra_flags.bitmap.height_32 ? 2 * SPRITE_SIZE : SPRITE_SIZE);
+        if (bottom <= 0 || top >= ZVB_MAX_RES_HEIGHT) {
+            continue;
+        }
+        const int first = top < 0 ? 0 : top / ZVB_SPRITES_BAND_HEIGHT;
+        const int last = ((bottom < ZVB_MAX_RES_HEIGHT ? bottom : ZVB_MAX_RES_HEIGHT) - 1) / ZVB_SPRITES_BAND_HEIGHT;
+        for (int band = first; band <= last; band++) {
+            uint8_t *list = render->sprite_bands[band];
+            list[1 + list[0]++] = (uint8_t)i;
+        }
+    }
+}
+
+static void zvb_update_sprites(zvb_render_t *render, zvb_sprites_t *sprites) {
+    if (!zvb_dirty_any(&sprites->dirty)) {
+        return;
+    }
+    zvb_bin_sprites(render, sprites);
+    UpdateTexture(render->tex_sprite_bands, render->sprite_bands);
+    zvb_update_texture(render->tex_sprites, 0, (const uint8_t *)sprites->data, sizeof(Color), &sprites->dirty);
+}
+
+int zvb_render_init(zvb_render_t *render, const zvb_t *zvb, bool flipped_y) {
+    if (render == NULL || zvb == NULL) {
+        return 1;
+    }
+
+    memset(render, 0, sizeof(zvb_render_t));
+
+    /* Create the textures out of the current VRAM content, the later changes are picked up by the dirty ranges */
+    render->tex_font = zvb_load_texture(zvb->font.raw_font, ZVB_FONT_CHAR_SIZE, ZVB_FONT_CHAR_COUNT,
+                                        PIXELFORMAT_UNCOMPRESSED_GRAYSCALE);
+    render->tex_palette = zvb_load_texture(zvb->palette.raw_palette, sizeof(zvb->palette.raw_palette), 1,
+                                           PIXELFORMAT_UNCOMPRESSED_GRAYSCALE);
+    /* The two layers are not in a single array, load the texture empty and upload each of them */
+    render->tex_tilemap = zvb_load_texture(NULL, TILEMAP_TEX_WIDTH, TILEMAP_TEX_HEIGHT,
+                                           PIXELFORMAT_UNCOMPRESSED_GRAYSCALE);
+    zvb_tilemap_t layers = zvb->layers;
+    zvb_dirty_all(&layers.dirty, 2 * ZVB_TILEMAP_SIZE);
+    zvb_update_tilemap(render, &layers);
+    render->tex_tileset = zvb_load_texture(zvb->tileset.raw, TILESET_TEX_WIDTH, TILESET_TEX_HEIGHT,
+                                           PIXELFORMAT_UNCOMPRESSED_GRAYSCALE);
+    render->tex_sprites = zvb_load_texture(zvb->sprites.data, SPRITES_TEX_WIDTH, 1,
+                                           PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    zvb_bin_sprites(render, &zvb->sprites);
+    render->tex_sprite_bands = zvb_load_texture(render->sprite_bands, ZVB_SPRITES_BAND_SIZE, ZVB_SPRITES_BAND_COUNT,
+                                                PIXELFORMAT_UNCOMPRESSED_GRAYSCALE);
+    render->tex_dummy = LoadRenderTexture(ZVB_MAX_RES_WIDTH, ZVB_MAX_RES_HEIGHT);
+#ifdef CONFIG_ENABLE_DEBUGGER
+    render->debug_tex[DBG_TILEMAP_LAYER0] = LoadRenderTexture(ZVB_DBG_RES_WIDTH, ZVB_DBG_RES_HEIGHT);
+    render->debug_tex[DBG_TILEMAP_LAYER1] = LoadRenderTexture(ZVB_DBG_RES_WIDTH, ZVB_DBG_RES_HEIGHT);
+    /* Count the grid in the width. For the tileset, use a 16x32 tiles size */
+    render->debug_tex[DBG_TILESET] = LoadRenderTexture(SIZE_WITH_GRID(16, 16), SIZE_WITH_GRID(16, 32));
+    render->debug_tex[DBG_PALETTE] = LoadRenderTexture(SIZE_WITH_GRID(16, 16), SIZE_WITH_GRID(16, 16));
+    render->debug_tex[DBG_FONT] = LoadRenderTexture(SIZE_WITH_GRID(8, 16), SIZE_WITH_GRID(12, 16));
+#endif
+    zvb_shader_init(render);
+
+    /* For the debugger */
+    render->flipped_y = flipped_y;
+    render->width = ZVB_MAX_RES_WIDTH;
+    render->height = ZVB_MAX_RES_HEIGHT;
+    return 0;
+}
+
+/**
+ * @brief Run the current shader over the frame area of the target. Render textures are upside down: place
+ * the area at the bottom so that it covers the first lines of the texture, the top of the frame.
+ */
+static void zvb_draw_frame(const zvb_render_t *render) {
+    const int width = render->width;
+    const int height = render->height;
+    /* Flip the screen in Y since OpenGL treats (0,0) as the bottom left pixel of the screen */
+    DrawTextureRec(render->tex_dummy.texture, (Rectangle){0, 0, width, render->flipped_y ? -height : height},
+                   (Vector2){0, ZVB_MAX_RES_HEIGHT - height}, WHITE);
+}
+
+/**
+ * @brief Render the screen when `vid_ena` is set (screen disabled)
+ */
+static void zvb_render_disabled_mode(void) {
+    ClearBackground(BLACK);
+}
+
+/**
+ * @brief Render the screen in text mode (80x40 and 40x20)
+ */
+static void zvb_prepare_render_text_mode(zvb_render_t *render, zvb_t *zvb) {
+    zvb_update_palette(render, &zvb->palette);
+    zvb_update_font(render, &zvb->font);
+    zvb_update_tilemap(render, &zvb->layers);
+}
+
+static void zvb_render_text_mode(zvb_render_t *render, zvb_t *zvb) {
+    /* Update the palette to flush the changes to the shader */
+    zvb_shader_t *st_shader = &render->shaders[SHADER_TEXT];
+    const Shader shader = st_shader->shader;
+    const int mode_idx = st_shader->objects[TEXT_SHADER_VIDMODE_IDX];
+    const int tilemaps_idx = st_shader->objects[TEXT_SHADER_TILEMAPS_IDX];
+    const int font_idx = st_shader->objects[TEXT_SHADER_FONT_IDX];
+    const int cursor_pos_idx = st_shader->objects[TEXT_SHADER_CURPOS_IDX];
+    const int cursor_color_idx = st_shader->objects[TEXT_SHADER_CURCOLOR_IDX];
+    const int cursor_char_idx = st_shader->objects[TEXT_SHADER_CURCHAR_IDX];
+    const int scroll_idx = st_shader->objects[TEXT_SHADER_TSCROLL_IDX];
+    const int palette_idx = st_shader->objects[TEXT_SHADER_PALETTE_IDX];
+
+    /* Get the cursor position and its color */
+    zvb_text_info_t info;
+    zvb_text_get_info(&zvb->text, &info);
+
+    BeginShaderMode(shader);
+    /* Transfer all the texture to the GPU */
+    SetShaderValue(shader, mode_idx, &zvb->mode, SHADER_UNIFORM_INT);
+    SetShaderValueTexture(shader, palette_idx, render->tex_palette);
+    SetShaderValueTexture(shader, tilemaps_idx, render->tex_tilemap);
+    SetShaderValueTexture(shader, font_idx, render->tex_font);
+    /* Transfer the text-related variables */
+    SetShaderValue(shader, cursor_pos_idx, &info.pos, SHADER_UNIFORM_IVEC2);
+    SetShaderValue(shader, cursor_color_idx, &info.color, SHADER_UNIFORM_IVEC2);
+    SetShaderValue(shader, cursor_char_idx, &info.charidx, SHADER_UNIFORM_INT);
+    SetShaderValue(shader, scroll_idx, &info.scroll, SHADER_UNIFORM_IVEC2);
+
+    zvb_draw_frame(render);
+    EndShaderMode();
+}
+
+static void zvb_prepare_render_gfx_mode(zvb_render_t *render, zvb_t *zvb) {
+    zvb_update_palette(render, &zvb->palette);
+    zvb_update_tileset(render, &zvb->tileset);
+    zvb_update_tilemap(render, &zvb->layers);
+    zvb_update_sprites(render, &zvb->sprites);
+}
+
+static void zvb_prepare_render_bitmap_mode(zvb_render_t *render, zvb_t *zvb) {
+    zvb_update_palette(render, &zvb->palette);
+    zvb_update_tileset(render, &zvb->tileset);
+}
+
+/**
+ * @brief Render the screen in bitmap mode
+ */
+
+static void zvb_render_bitmap_mode(zvb_render_t *render, const zvb_t *zvb) {
+    zvb_shader_t *st_shader = &render->shaders[SHADER_BITMAP];
+    const Shader shader = st_shader->shader;
+    const int mode_idx = st_shader->objects[GFX_SHADER_VIDMODE_IDX];
+    const int tileset_idx = st_shader->objects[GFX_SHADER_TILESET_IDX];
+    const int palette_idx = st_shader->objects[GFX_SHADER_PALETTE_IDX];
+
+    BeginShaderMode(shader);
+    SetShaderValueTexture(shader, palette_idx, render->tex_palette);
+    /* Transfer all the texture to the GPU */
+    SetShaderValue(shader, mode_idx, &zvb->mode, SHADER_UNIFORM_INT);
+    SetShaderValueTexture(shader, tileset_idx, render->tex_tileset);
+
+    zvb_draw_frame(render);
+    EndShaderMode();
+}
+
+/**
+ * @brief Render the screen in graphics mode
+ */
+static void zvb_render_gfx_mode(zvb_render_t *render, const zvb_t *zvb) {
+    zvb_shader_t *st_shader = &render->shaders[SHADER_GFX];
+    const Shader shader = st_shader->shader;
+
+    const int mode_idx = st_shader->objects[GFX_SHADER_VIDMODE_IDX];
+    const int tilemaps_idx = st_shader->objects[GFX_SHADER_TILEMAPS_IDX];
+    const int tileset_idx = st_shader->objects[GFX_SHADER_TILESET_IDX];
+    const int sprites_idx = st_shader->objects[GFX_SHADER_SPRITES_IDX];
+    const int scroll0_idx = st_shader->objects[GFX_SHADER_SCROLL0_IDX];
+    const int scroll1_idx = st_shader->objects[GFX_SHADER_SCROLL1_IDX];
+    const int palette_idx = st_shader->objects[GFX_SHADER_PALETTE_IDX];
+    const int bands_idx = st_shader->objects[GFX_SHADER_BANDS_IDX];
+
+    BeginShaderMode(shader);
+    /* Transfer all the texture to the GPU */
+    SetShaderValue(shader, mode_idx, &zvb->mode, SHADER_UNIFORM_INT);
+    SetShaderValueTexture(shader, palette_idx, render->tex_palette);
+    SetShaderValueTexture(shader, tilemaps_idx, render->tex_tilemap);
+    SetShaderValueTexture(shader, tileset_idx, render->tex_tileset);
+    SetShaderValueTexture(shader, sprites_idx, render->tex_sprites);
+    SetShaderValueTexture(shader, bands_idx, render->tex_sprite_bands);
+    /* Transfer the text-related variables */
+    SetShaderValue(shader, scroll0_idx, &zvb->ctrl.l0_scroll_x, SHADER_UNIFORM_IVEC2);
+    SetShaderValue(shader, scroll1_idx, &zvb->ctrl.l1_scroll_x, SHADER_UNIFORM_IVEC2);
+
+    zvb_draw_frame(render);
+    EndShaderMode();
+}
+
+/* Prepare the rendering by updating the udnerneath textures */
+bool zvb_prepare_render(zvb_render_t *render, zvb_t *zvb) {
+    /* Only update the texture if we are going to render anything */
+    if (!zvb->need_render) {
+        return false;
+    }
+
+    switch (zvb->mode) {
+        case MODE_TEXT_640:
+        case MODE_TEXT_320:
+            zvb_prepare_render_text_mode(render, zvb);
+            break;
+
+        case MODE_BITMAP_256:
+        case MODE_BITMAP_320:
+            zvb_prepare_render_bitmap_mode(render, zvb);
+            break;
+
+        default:
+            zvb_prepare_render_gfx_mode(render, zvb);
+            break;
+    }
+
+    return true;
+}
+
+#ifdef CONFIG_ENABLE_DEBUGGER
+
+static void zvb_render_debug_gfx_mode(zvb_render_t *render, const zvb_t *zvb) {
+    /* Since we want to generate a debug texture, we only need to set it to debug mode */
+    zvb_shader_t *st_shader = &render->shaders[SHADER_GFX_DEBUG];
+    const Shader shader = st_shader->shader;
+    const int mode_idx = st_shader->objects[GFX_SHADER_VIDMODE_IDX];
+    const int dbg_mode_idx = st_shader->objects[GFX_SHADER_DBGMODE_IDX];
+    const int tilemaps_idx = st_shader->objects[GFX_SHADER_TILEMAPS_IDX];
+    const int tileset_idx = st_shader->objects[GFX_SHADER_TILESET_IDX];
+    const int palette_idx = st_shader->objects[GFX_SHADER_PALETTE_IDX];
+
+    int dbg_mode = GFX_DEBUG_LAYER0_MODE;
+    RenderTexture *texture = &render->debug_tex[DBG_TILEMAP_LAYER0];
+
+    BeginTextureMode(*texture);
+    BeginShaderMode(shader);
+    /* Transfer all the texture to the GPU */
+    SetShaderValue(shader, mode_idx, &zvb->mode, SHADER_UNIFORM_INT);
+    SetShaderValue(shader, dbg_mode_idx, &dbg_mode, SHADER_UNIFORM_INT);
+    SetShaderValueTexture(shader, palette_idx, render->tex_palette);
+    SetShaderValueTexture(shader, tilemaps_idx, render->tex_tilemap);
+    SetShaderValueTexture(shader, tileset_idx, render->tex_tileset);
+
+    DrawTextureRec(render->tex_dummy.texture, (Rectangle){0, 0, texture->texture.width, texture->texture.height},
+                   (Vector2){0, 0}, WHITE);
+    EndShaderMode();
+    EndTextureMode();
+
+    /* Debug layer 1, tell the shader to debug layer 1 in the mode (bit 30) */
+    dbg_mode = GFX_DEBUG_LAYER1_MODE;
+    texture = &render->debug_tex[DBG_TILEMAP_LAYER1];
+    BeginTextureMode(*texture);
+    BeginShaderMode(shader);
+    SetShaderValue(shader, dbg_mode_idx, &dbg_mode, SHADER_UNIFORM_INT);
+    DrawTextureRec(render->tex_dummy.texture, (Rectangle){0, 0, texture->texture.width, texture->texture.height},
+                   (Vector2){0, 0}, WHITE);
+    EndShaderMode();
+    EndTextureMode();
+
+    /* Debug the tileset, in this case, we have 16x32 tiles at most */
+    dbg_mode = GFX_DEBUG_TILESET_MODE;
+    texture = &render->debug_tex[DBG_TILESET];
+    BeginTextureMode(*texture);
+    ClearBackground(BLANK);
+    BeginShaderMode(shader);
+    SetShaderValue(shader, dbg_mode_idx, &dbg_mode, SHADER_UNIFORM_INT);
+    DrawTextureRec(render->tex_dummy.texture, (Rectangle){0, 0, texture->texture.width, texture->texture.height},
+                   (Vector2){0, 0}, WHITE);
+    EndShaderMode();
+    EndTextureMode();
+
+    /* Palette mode */
+    dbg_mode = GFX_DEBUG_PALETTE_MODE;
+    texture = &render->debug_tex[DBG_PALETTE];
+    BeginTextureMode(*texture);
+    ClearBackground(BLANK);
+    BeginShaderMode(shader);
+    SetShaderValue(shader, dbg_mode_idx, &dbg_mode, SHADER_UNIFORM_INT);
+    DrawTextureRec(render->tex_dummy.texture, (Rectangle){0, 0, texture->texture.width, texture->texture.height},
+                   (Vector2){0, 0}, WHITE);
+    EndShaderMode();
+    EndTextureMode();
+}
+
+/**
+ * @brief Render the debug textures when we are in text mode.
+ * The `zvb_render` function must be called first.
+ */
+static void zvb_render_debug_text_mode(zvb_render_t *render, const zvb_t *zvb) {
+    /* Since we want to generate a debug texture, we only need to set it to debug mode */
+    zvb_shader_t *st_shader = &render->shaders[SHADER_TEXT_DEBUG];
+    const Shader shader = st_shader->shader;
+    const int mode_idx = st_shader->objects[TEXT_SHADER_VIDMODE_IDX];
+    const int dbg_mode_idx = st_shader->objects[TEXT_SHADER_DBGMODE_IDX];
+    const int tilemaps_idx = st_shader->objects[TEXT_SHADER_TILEMAPS_IDX];
+    const int font_idx = st_shader->objects[TEXT_SHADER_FONT_IDX];
+    const int palette_idx = st_shader->objects[TEXT_SHADER_PALETTE_IDX];
+    /* Include the debug grid in the final texture width. Add one pixel to show a red outline */
+    const int grid_thickness = 1;
+    const int width = TEXT_MAXIMUM_COLUMNS * (TEXT_CHAR_WIDTH + grid_thickness) + 1;
+    const int height = TEXT_MAXIMUM_LINES * (TEXT_CHAR_HEIGHT + grid_thickness) + 1;
+
+    /* Tilemap mode */
+    int dbg_mode = TEXT_DEBUG_LAYER0_MODE;
+    BeginTextureMode(render->debug_tex[DBG_TILEMAP_LAYER0]);
+    BeginShaderMode(shader);
+    ClearBackground(BLANK);
+    /* Transfer all the texture to the GPU */
+    SetShaderValue(shader, dbg_mode_idx, &dbg_mode, SHADER_UNIFORM_INT);
+    SetShaderValue(shader, mode_idx, &zvb->mode, SHADER_UNIFORM_INT);
+    SetShaderValueTexture(shader, palette_idx, render->tex_palette);
+    SetShaderValueTexture(shader, tilemaps_idx, render->tex_tilemap);
+    SetShaderValueTexture(shader, font_idx, render->tex_font);
+    DrawTextureRec(render->tex_dummy.texture, (Rectangle){0, 0, width, height},
+                   /* Since the texture is bigger than the content, render the content at the top left */
+                   (Vector2){0, ZVB_DBG_RES_HEIGHT - height}, WHITE);
+    EndShaderMode();
+    EndTextureMode();
+
+    /* Font mode, no need to reload all the textures, they are all in the shaders already */
+    dbg_mode = TEXT_DEBUG_LAYER1_MODE;
+    BeginTextureMode(render->debug_tex[DBG_TILEMAP_LAYER1]);
+    ClearBackground(BLANK);
+    BeginShaderMode(shader);
+    SetShaderValue(shader, dbg_mode_idx, &dbg_mode, SHADER_UNIFORM_INT);
+    DrawTextureRec(render->tex_dummy.texture, (Rectangle){0, 0, width, height},
+                   /* Since the texture is bigger than the content, render the content at the top left */
+                   (Vector2){0, ZVB_DBG_RES_HEIGHT - height}, WHITE);
+    EndShaderMode();
+    EndTextureMode();
+
+    dbg_mode = TEXT_DEBUG_FONT_MODE;
+    RenderTexture *texture = &render->debug_tex[DBG_FONT];
+    BeginTextureMode(*texture);
+    ClearBackground(BLANK);
+    BeginShaderMode(shader);
+    SetShaderValue(shader, dbg_mode_idx, &dbg_mode, SHADER_UNIFORM_INT);
+    DrawTextureRec(render->tex_dummy.texture, (Rectangle){0, 0, texture->texture.width, texture->texture.height},
+                   (Vector2){0, 0}, WHITE);
+    EndShaderMode();
+    EndTextureMode();
+}
+
+void zvb_render_debug_textures(zvb_render_t *render, const zvb_t *zvb) {
+    switch (zvb->mode) {
+        case MODE_TEXT_640:
+        case MODE_TEXT_320:
+            zvb_render_debug_text_mode(render, zvb);
+            break;
+
+        case MODE_BITMAP_256:
+        case MODE_BITMAP_320:
+            // zvb_render_debug_bitmap_mode(zvb);
+            break;
+
+        default:
+            zvb_render_debug_gfx_mode(render, zvb);
+            break;
+    }
+}
+#endif /* CONFIG_ENABLE_DEBUGGER */
+
+/**
+ * @brief Get the size of the frame to draw for the current mode: the 320-pixel wide modes, bitmap ones
+ * included, are 320x240 and are not scaled up by the shaders
+ */
+static void zvb_frame_size(zvb_render_t *render, const zvb_t *zvb) {
+    switch (zvb->mode) {
+        case MODE_TEXT_320:
+        case MODE_GFX_320_8BIT:
+        case MODE_GFX_320_4BIT:
+        case MODE_BITMAP_256:
+        case MODE_BITMAP_320:
+            render->width = ZVB_MAX_RES_WIDTH / 2;
+            render->height = ZVB_MAX_RES_HEIGHT / 2;
+            break;
+
+        default:
+            render->width = ZVB_MAX_RES_WIDTH;
+            render->height = ZVB_MAX_RES_HEIGHT;
+            break;
+    }
+}
+
+bool zvb_render(zvb_render_t *render, zvb_t *zvb) {
+    if (zvb->need_render == false) {
+        return false;
+    }
+
+    zvb->need_render = false;
+    /* Nothing the screen shows changed, the target still holds the frame */
+    if (render->drawn && render->epoch == zvb->epoch) {
+        return false;
+    }
+    render->epoch = zvb->epoch;
+    render->drawn = true;
+    zvb_frame_size(render, zvb);
+
+#if BENCHMARK
+    double startTime = GetTime();
+    static double average = 0;
+    static int counter = 0;
+#endif
+
+    if (zvb->status.vid_ena) {
+        switch (zvb->mode) {
+            case MODE_TEXT_640:
+            case MODE_TEXT_320:
+                zvb_render_text_mode(render, zvb);
+                break;
+
+            case MODE_BITMAP_256:
+            case MODE_BITMAP_320:
+                zvb_render_bitmap_mode(render, zvb);
+                break;
+
+            default:
+                zvb_render_gfx_mode(render, zvb);
+                break;
+        }
+    } else {
+        zvb_render_disabled_mode();
+    }
+
+#if BENCHMARK
+    double endTime = GetTime();
+    double elapsedTime = endTime - startTime;
+    average += elapsedTime;
+    if (++counter == 60) {
+        log_printf("Time taken : %f ms\n", (average / 60) * 1000);
+        counter = 0;
+        average = 0;
+    }
+#endif
+    return true;
+}
+
+void zvb_force_render(zvb_render_t *render, zvb_t *zvb) {
+    zvb->need_render = true;
+    render->drawn = false;
+    zvb_prepare_render(render, zvb);
+    zvb_render(render, zvb);
+}
+
+/**
+ * @brief Get the dirty range of a VRAM part
+ */
+static zvb_dirty_t *zvb_part_dirty(zvb_t *zvb, int part) {
+    switch (part) {
+        case ZVB_PART_LAYERS:
+            return &zvb->layers.dirty;
+        case ZVB_PART_FONT:
+            return &zvb->font.dirty;
+        case ZVB_PART_TILESET:
+            return &zvb->tileset.dirty;
+        case ZVB_PART_PALETTE:
+            return &zvb->palette.dirty;
+        default:
+            return &zvb->sprites.dirty;
+    }
+}
+
+static uint32_t zvb_part_size(const zvb_t *zvb, int part) {
+    switch (part) {
+        case ZVB_PART_LAYERS:
+            return 2 * ZVB_TILEMAP_SIZE;
+        case ZVB_PART_FONT:
+            return ZVB_FONT_SIZE;
+        case ZVB_PART_TILESET:
+            return ZVB_TILESET_SIZE;
+        case ZVB_PART_PALETTE:
+            return sizeof(zvb->palette.raw_palette);
+        default:
+            return sizeof(zvb->sprites.data);
+    }
+}
+
+void zvb_frame_init(zvb_frame_t *frame, const zvb_t *zvb) {
+    frame->zvb = *zvb;
+    memset(frame->versions, 0, sizeof(frame->versions));
+}
+
+void zvb_frame_capture(zvb_frame_t *frame, zvb_t *zvb, uint32_t *versions) {
+    for (int part = 0; part < ZVB_PART_COUNT; part++) {
+        zvb_dirty_t *dirty = zvb_part_dirty(zvb, part);
+        const bool modified = zvb_dirty_any(dirty);
+        if (modified) {
+            versions[part]++;
+        }
+        if (frame->versions[part] != versions[part]) {
+            frame->versions[part] = versions[part];
+            switch (part) {
+                case ZVB_PART_LAYERS:
+                    frame->zvb.layers = zvb->layers;
+                    break;
+                case ZVB_PART_FONT:
+                    frame->zvb.font = zvb->font;
+                    break;
+                case ZVB_PART_TILESET:
+                    frame->zvb.tileset = zvb->tileset;
+                    break;
+                case ZVB_PART_PALETTE:
+                    frame->zvb.palette = zvb->palette;
+                    break;
+                default:
+                    frame->zvb.sprites = zvb->sprites;
+                    break;
+            }
+            /* The copy holds the range written since the previous version, unknown if it wasn't this one */
+            if (!modified) {
+                zvb_dirty_all(zvb_part_dirty(&frame->zvb, part), zvb_part_size(zvb, part));
+            }
+        }
+        zvb_dirty_clear(dirty);
+    }
+
+    /* The registers are small, always take them */
+    frame->zvb.epoch = zvb->epoch;
+    frame->zvb.mode = zvb->mode;
+    frame->zvb.text = zvb->text;
+    frame->zvb.status = zvb->status;
+    frame->zvb.ctrl = zvb->ctrl;
+    frame->zvb.screen_enabled = zvb->screen_enabled;
+}
+
+void zvb_frame_prepare(zvb_frame_t *frame, uint32_t *versions) {
+    for (int part = 0; part < ZVB_PART_COUNT; part++) {
+        zvb_dirty_t *dirty = zvb_part_dirty(&frame->zvb, part);
+        if (frame->versions[part] == versions[part]) {
+            zvb_dirty_clear(dirty);
+        } else if (frame->versions[part] != versions[part] + 1) {
+            /* More than one version behind, the range of the copy is not enough */
+            zvb_dirty_all(dirty, zvb_part_size(&frame->zvb, part));
+        }
+        versions[part] = frame->versions[part];
+    }
+    frame->zvb.need_render = true;
+}
+
+void zvb_render_deinit(zvb_render_t *render) {
+    UnloadRenderTexture(render->tex_dummy);
+#ifdef CONFIG_ENABLE_DEBUGGER
+    for (int i = 0; i < DBG_VIEW_TOTAL; i++) {
+        UnloadRenderTexture(render->debug_tex[i]);
+    }
+#endif
+    UnloadTexture(render->tex_font);
+    UnloadTexture(render->tex_palette);
+    UnloadTexture(render->tex_tilemap);
+    UnloadTexture(render->tex_tileset);
+    UnloadTexture(render->tex_sprites);
+    UnloadTexture(render->tex_sprite_bands);
+    for (int i = 0; i < SHADERS_COUNT; i++) {
+        UnloadShader(render->shaders[i].shader);
+    }
+}
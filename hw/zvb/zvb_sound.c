@@ -42,25 +42,13 @@ static inline bool voice_in_right(zvb_sound_t* sound, int i)
     return (sound->right_voices & BIT(i)) != 0;
 }
 
-static void audio_callback(void *buffer, unsigned int frames);
-
-static zvb_sound_t* g_sound;
-
 void zvb_sound_init(zvb_sound_t* sound) {
-    InitAudioDevice();
     assert(sound);
     memset(sound, 0, sizeof(*sound));
     sound->left_volume = 0.f;
     sound->right_volume = 0.f;
     sound->sample_table.fifo_bytes = 0;
     sound->sample_table.baud_count = 0;
-
-    /* Dirty hack but the callback doesn't take a context/opaque parameter... */
-    g_sound = sound;
-
-    sound->stream = LoadAudioStream(SAMPLE_RATE, 16, SOUND_CHANNELS);
-    SetAudioStreamCallback(sound->stream, audio_callback);
-    PlayAudioStream(sound->stream);
 }
 
 void zvb_sound_reset(zvb_sound_t* sound)
@@ -92,12 +80,6 @@ void zvb_sound_reset(zvb_sound_t* sound)
     sound->right_volume = 0.f;
 }
 
-void zvb_sound_deinit(zvb_sound_t* sound)
-{
-    StopAudioStream(sound->stream);
-    CloseAudioDevice();
-}
-
 /**
  * @brief Generate a 16-bit unsigned sample for the current voice
  */
@@ -184,30 +166,28 @@ static unsigned int table_samples_count(zvb_sample_table_t* tbl)
 }
 
 
-static void audio_callback(void* rbuf, unsigned int frames)
+void zvb_sound_generate(zvb_sound_t* sound, int16_t* buffer, unsigned int frames)
 {
-    int16_t *buffer = (int16_t*) rbuf;
-
     for (unsigned int i = 0; i < frames * 2; i += SOUND_CHANNELS) {
         int sample_left = 0;
         int sample_right = 0;
 
         for (int ch = 0; ch < VOICE_COUNT; ch++) {
-            int16_t sample = generate_wave(&g_sound->voices[ch]);
-            if (voice_in_left(g_sound, ch)) sample_left += sample;
-            if (voice_in_right(g_sound, ch)) sample_right += sample;
+            int16_t sample = generate_wave(&sound->voices[ch]);
+            if (voice_in_left(sound, ch)) sample_left += sample;
+            if (voice_in_right(sound, ch)) sample_right += sample;
         }
 
-        if (!g_sound->sample_table.hold && table_samples_count(&g_sound->sample_table) >= 1) {
-            int16_t sample = generate_sample(&g_sound->sample_table);
-            if (voice_in_left(g_sound, 7)) sample_left += sample;
-            if (voice_in_right(g_sound, 7)) sample_right += sample;
+        if (!sound->sample_table.hold && table_samples_count(&sound->sample_table) >= 1) {
+            int16_t sample = generate_sample(&sound->sample_table);
+            if (voice_in_left(sound, 7)) sample_left += sample;
+            if (voice_in_right(sound, 7)) sample_right += sample;
         }
 
         /* Apply master volume */
         /* No matter how many samples are enabled, divide by VOICE_COUNT and make it signed */
-        sample_left = (sample_left / VOICE_COUNT) * g_sound->left_volume;
-        sample_right = (sample_right / VOICE_COUNT) * g_sound->right_volume;
+        sample_left = (sample_left / VOICE_COUNT) * sound->left_volume;
+        sample_right = (sample_right / VOICE_COUNT) * sound->right_volume;
 
         buffer[i]   = (int16_t) sample_left;
         buffer[i+1] = (int16_t) sample_right;
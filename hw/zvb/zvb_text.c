@@ -167,6 +167,13 @@ bool zvb_text_update(zvb_text_t* text, zvb_text_info_t* info)
         }
     }
 
+    zvb_text_get_info(text, info);
+    return text->cursor_shown;
+}
+
+
+void zvb_text_get_info(const zvb_text_t* text, zvb_text_info_t* info)
+{
     *info = (zvb_text_info_t) {
         .pos   = { text->cursor_pos.x, text->cursor_pos.y },
         .color = { (text->cursor_color >> 4) & 0xf,
@@ -179,8 +186,6 @@ bool zvb_text_update(zvb_text_t* text, zvb_text_info_t* info)
         /* Hide the cursor by making the X coordinate out of bounds */
         info->pos[0] |= 0x80;
     }
-
-    return text->cursor_shown;
 }
 
 
@@ -10,9 +10,6 @@
 #include <string.h>
 #include "hw/zvb/zvb_tilemap.h"
 
-static void tilemap_update_img(zvb_tilemap_t* tilemap, int layer, uint32_t addr, uint_fast8_t data);
-
-
 void zvb_tilemap_init(zvb_tilemap_t* tilemap)
 {
     assert(tilemap != NULL);
@@ -20,22 +17,7 @@ void zvb_tilemap_init(zvb_tilemap_t* tilemap)
     /* Initialize both tilemaps to 0 on boot (not reset) */
     memset(tilemap->raw_layer0, 0, sizeof(tilemap->raw_layer0));
     memset(tilemap->raw_layer1, 0, sizeof(tilemap->raw_layer1));
-
-    /* Create an empty bitmap image, the goal is NOT to the have it represent the image
-     * to show, the goal is to be able to provide both layers to the shader efficiently.
-     * Moreover shaders cannot perform bitwise operations, so do it in this image/texture.
-     * For each pixel i, the data is organized as follows:
-     * R - Layer0[i]
-     * G - Layer1[i]
-     * B - (Layer1[i] >> 4) & 0xf (background)
-     * A - (Layer1[i] >> 0) & 0xf (foreground)
-     */
-    tilemap->img_tilemap = GenImageColor(ZVB_TILEMAP_SIZE, 1, BLACK);
-    /* Set all the bytes to 0 */
-    memset(tilemap->img_tilemap.data, 0, sizeof(Color) * ZVB_TILEMAP_SIZE);
-
-    tilemap->tex_tilemap = LoadTextureFromImage(tilemap->img_tilemap);
-    tilemap->dirty = 0;
+    zvb_dirty_clear(&tilemap->dirty);
 }
 
 
@@ -46,45 +28,23 @@ void zvb_tilemap_write(zvb_tilemap_t* tilemap, int layer, uint32_t addr, uint8_t
     } else {
         tilemap->raw_layer1[addr] = data;
     }
-    tilemap_update_img(tilemap, layer, addr, data);
-}
-
-
-uint8_t zvb_tilemap_read(zvb_tilemap_t* tilemap, int layer, uint32_t addr)
-{
-    if (layer == 0) {
-        return tilemap->raw_layer0[addr];
-    } else {
-        return tilemap->raw_layer1[addr];
-    }
+    zvb_dirty_mark(&tilemap->dirty, (layer == 0 ? 0 : ZVB_TILEMAP_SIZE) + addr, 1);
 }
 
 
-void zvb_tilemap_update(zvb_tilemap_t* tilemap)
+void zvb_tilemap_write_block(zvb_tilemap_t* tilemap, int layer, uint32_t addr, const uint8_t* data, uint32_t len)
 {
-    if (tilemap->dirty != 0) {
-        UpdateTexture(tilemap->tex_tilemap, tilemap->img_tilemap.data);
-        tilemap->dirty = 0;
-    }
+    memcpy((layer == 0 ? tilemap->raw_layer0 : tilemap->raw_layer1) + addr, data, len);
+    zvb_dirty_mark(&tilemap->dirty, (layer == 0 ? 0 : ZVB_TILEMAP_SIZE) + addr, len);
 }
 
 
-/**
- * @brief Update the image with incoming byte from a given layer
- */
-static void tilemap_update_img(zvb_tilemap_t* tilemap, int layer, uint32_t addr, uint_fast8_t data)
+uint8_t zvb_tilemap_read(zvb_tilemap_t* tilemap, int layer, uint32_t addr)
 {
-    /* Pixels of the image can be access as an array directly */
-    Color *pixels = (Color*) tilemap->img_tilemap.data;
-    Color *pixel  = pixels + addr;
-
     if (layer == 0) {
-        pixel->r = data;
+        return tilemap->raw_layer0[addr];
     } else {
-        pixel->g = data;
-        pixel->b = (data >> 4) & 0xf;
-        pixel->a = (data >> 0) & 0xf;
+        return tilemap->raw_layer1[addr];
     }
-
-    tilemap->dirty = 1;
 }
+
@@ -44,6 +44,8 @@ void debugger_set_registers(dbg_t *dbg, regs_t *regs);
 typedef void (*debugger_callback_t)(dbg_t *dbg);
 void debugger_step(dbg_t *dbg);
 void debugger_step_over(dbg_t *dbg);
+void debugger_step_back(dbg_t *dbg);
+void debugger_reverse_continue(dbg_t *dbg);
 void debugger_continue(dbg_t *dbg);
 void debugger_pause(dbg_t *dbg);
 void debugger_reset(dbg_t *dbg);
@@ -91,6 +91,8 @@ struct dbg_t {
     debugger_ctrl_op reset_cb;
     debugger_ctrl_op step_cb;
     debugger_ctrl_op step_over_cb;
+    debugger_ctrl_op step_back_cb;
+    debugger_ctrl_op reverse_continue_cb;
     debugger_ctrl_op breakpoint_cb;
     debugger_chk_op  is_paused_cb;
     debugger_regs_op get_regs_cb;
@@ -14,9 +14,11 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "ui/raylib-nuklear.h"
+#include "debugger/debugger.h"
 #include "utils/config.h"
 /* Workaround to have access to more info of the VRAM */
 #include "hw/zvb/zvb.h"
+#include "hw/zvb/zvb_render.h"
 
 #define WIN_UI_FONT_SIZE        13
 
@@ -56,6 +58,8 @@ struct dbg_ui_t {
     hwaddr             dis_size;
     struct nk_image    vram[DBG_MAX_VRAM_VIEWS];
     zvb_t*             zvb;
+    /* Renderer of the main view, to know the area of it the frame covers */
+    const zvb_render_t* render;
 };
 
 typedef void (*dbg_ui_panel_fn)(struct dbg_ui_panel_t*, struct dbg_ui_t*, dbg_t*);
@@ -79,6 +83,7 @@ typedef struct {
     const RenderTexture2D* debug_views;
     int debug_views_count;
     zvb_t* zvb;
+    const zvb_render_t* render;
 } dbg_ui_init_args_t;
 
 extern char DEBUG_BUFFER[256];
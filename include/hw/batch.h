@@ -0,0 +1,32 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+/**
+ * @file Batch runner, executes many headless machines in parallel
+ *
+ * The manifest describes one job per line as a list of `key=value` pairs separated by spaces, empty
+ * lines and lines starting with `#` are ignored. The recognized keys are:
+ *  - `rom`: ROM image to load, the default ROM is searched when omitted
+ *  - `uprog`: user program to load in the romdisk, same syntax as the `--uprog` option
+ *  - `cf`: CompactFlash image
+ *  - `eeprom`: EEPROM image
+ *  - `cycles`: number of T-states to emulate, mandatory
+ *  - `expect`: file containing the exact output the machine must send on the UART
+ *
+ * For example:
+ *   rom=roms/default.img uprog=tests/hello.bin cycles=50000000 expect=tests/hello.txt
+ *
+ * Each job runs on its own machine, a pool of worker threads picks them in order. The jobs write to private
+ * copies of their CompactFlash and EEPROM images, the files themselves are never modified.
+ */
+
+/**
+ * @brief Run all the jobs listed in the manifest with `threads` workers, 0 to use one per host CPU.
+ * Returns 0 if all the jobs passed, 1 else.
+ */
+int batch_run(const char *manifest, int threads);
@@ -96,3 +96,14 @@ typedef struct {
 } compactflash_t;
 
 int compactflash_init(compactflash_t* compactflash, const char *file_name);
+
+/**
+ * @brief Close the image opened by `compactflash_init`, if any
+ */
+void compactflash_deinit(compactflash_t* compactflash);
+
+/**
+ * @brief Replace the image by a temporary copy of it, the writes then never reach the file on disk.
+ * The file is opened again for the copy, the current stream may be shared with another process.
+ */
+int compactflash_use_copy(compactflash_t* compactflash);
@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #define DEVICE(dev) &((dev)->parent)
 
 typedef struct device_t device_t;
@@ -18,6 +21,17 @@ typedef struct {
     uint8_t (*read)(device_t* dev, uint32_t addr);
     uint8_t (*debug_read)(device_t* dev, uint32_t addr); /* Same as read but valid for write-only areas */
     void (*write)(device_t* dev, uint32_t addr, uint8_t data);
+    /* Optional, returns a host pointer to a whole 16KB page starting at `addr` that can be accessed
+     * directly, or NULL if the accesses must go through the callbacks above */
+    uint8_t* (*direct)(device_t* dev, uint32_t addr, bool write);
+    /* Optional, same as calling `read`/`write` for each byte of [addr, addr + len), which must stay in
+     * the region. Use device_read_block and device_write_block, they fall back to the byte callbacks */
+    void (*read_block)(device_t* dev, uint32_t addr, uint8_t* dst, uint32_t len);
+    void (*write_block)(device_t* dev, uint32_t addr, const uint8_t* src, uint32_t len);
+    /* Optional, returns true if reading `addr` has no side effect and its value can only change when
+     * a scheduled event is dispatched or the register is written, so that the CPU can skip the
+     * loops polling it */
+    bool (*stable)(device_t* dev, uint32_t addr);
     int size;
     uint8_t upper_addr;
 } region_t;
@@ -27,6 +41,9 @@ struct device_t {
     region_t io_region;
     region_t mem_region;
     void (*reset)(device_t* dev);
+    /* Invoked when the pointers returned by `mem_region.direct` are not valid anymore */
+    void (*direct_changed)(void* arg);
+    void* direct_changed_arg;
 };
 
 
@@ -73,6 +90,65 @@ static inline void device_register_reset(device_t* dev, void (*reset)(device_t*
     dev->reset = reset;
 }
 
+static inline void device_register_direct(device_t* dev, uint8_t* (*direct)(device_t*, uint32_t, bool))
+{
+    dev->mem_region.direct = direct;
+}
+
+static inline void device_register_mem_block(device_t* dev,
+                                             void (*read_block)(device_t*, uint32_t, uint8_t*, uint32_t),
+                                             void (*write_block)(device_t*, uint32_t, const uint8_t*, uint32_t))
+{
+    dev->mem_region.read_block = read_block;
+    dev->mem_region.write_block = write_block;
+}
+
+static inline void device_register_io_stable(device_t* dev, bool (*stable)(device_t*, uint32_t))
+{
+    dev->io_region.stable = stable;
+}
+
+static inline void device_register_direct_changed(device_t* dev, void (*callback)(void*), void* arg)
+{
+    dev->direct_changed = callback;
+    dev->direct_changed_arg = arg;
+}
+
+static inline void device_notify_direct_changed(device_t* dev)
+{
+    if (dev->direct_changed) {
+        dev->direct_changed(dev->direct_changed_arg);
+    }
+}
+
+/**
+ * @brief Read `len` bytes of the memory region of a device at once
+ */
+static inline void device_read_block(device_t* dev, uint32_t addr, uint8_t* dst, uint32_t len)
+{
+    if (dev->mem_region.read_block) {
+        dev->mem_region.read_block(dev, addr, dst, len);
+        return;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        dst[i] = dev->mem_region.read(dev, addr + i);
+    }
+}
+
+/**
+ * @brief Write `len` bytes to the memory region of a device at once
+ */
+static inline void device_write_block(device_t* dev, uint32_t addr, const uint8_t* src, uint32_t len)
+{
+    if (dev->mem_region.write_block) {
+        dev->mem_region.write_block(dev, addr, src, len);
+        return;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        dev->mem_region.write(dev, addr + i, src[i]);
+    }
+}
+
 static inline void device_reset(device_t* dev)
 {
     if (dev && dev->reset) {
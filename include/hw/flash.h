@@ -13,6 +13,7 @@
 
 #include <stdint.h>
 #include "hw/device.h"
+#include "hw/scheduler.h"
 
 #define NOR_FLASH_SIZE_KB_MAX (512 * 1024)
 #if CONFIG_NOR_FLASH_512KB
@@ -31,6 +32,9 @@ enum flash_error {
 };
 typedef enum flash_error flash_error_t;
 
+/* Number of states of the command FSM, `state` is always below it */
+#define FLASH_STATE_COUNT 10
+
 
 /**
  * @file Emulation for the NOR Flash (SST39)
@@ -47,17 +51,22 @@ typedef struct {
     int state;
     /* Byte being written to flash */
     uint8_t writing_byte;
-    /* Number of ticks remaining in case of a delay */
-    int ticks_remaining;
+    /* Event marking the end of a program/erase delay */
+    scheduler_t* sched;
+    sched_event_t delay_event;
     /* Flag set if any byte was changed (and needs write-back) */
     int dirty;
 } flash_t;
 
 
-flash_error_t flash_init(flash_t* flash);
-
-void flash_tick(flash_t* flash, int elapsed_tstates);
+flash_error_t flash_init(flash_t* flash, scheduler_t* sched);
 
 flash_error_t flash_load_from_file(flash_t* flash, const char* rom_filename, const char* userprog_filename);
 
+/**
+ * @brief Replace the romdisk of the Zeal 8-bit OS image already in the flash with a single user program,
+ * same syntax as the `--uprog` option
+ */
+flash_error_t flash_load_user_program(flash_t* flash, const char* userprog_filename);
+
 flash_error_t flash_save_to_file(flash_t* flash, const char* name);
@@ -0,0 +1,33 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "utils/config_args.h"
+
+/**
+ * @file Fork server, runs tests from an already booted machine
+ *
+ * The machine boots once, up to `--boot-pc` or `--boot-marker`, then the server listens on the Unix
+ * socket `--fork-server`. Each connection gets a copy-on-write child process of the booted machine.
+ *
+ * A request is a single line of `key=value` pairs separated by spaces, the recognized keys are:
+ *  - `uprog`: user program replacing the romdisk, same syntax as the `--uprog` option
+ *  - `cf`: CompactFlash image to insert
+ *  - `keys`: text file typed on the PS/2 keyboard, a new line is the Enter key
+ *  - `until`: hexadecimal address, the run ends when PC reaches it
+ *  - `cycles`: maximum number of T-states to emulate, mandatory
+ *
+ * The boot point must be reached before the OS reads the injected program or image. The reply is a
+ * single line followed by the raw bytes the machine sent on its UART:
+ *   status=<pc|reset|cycles|error> cycles=<T-states emulated> uart=<byte count>
+ * `reset` is only reported with `--no-reset`, when the program performed a software reset.
+ */
+
+/**
+ * @brief Boot the machine and serve the requests, only returns on error
+ */
+int fork_server_run(const config_arguments_t *args);
@@ -38,3 +38,10 @@ int at24c512_init(at24c512_t* eeprom, const char* filename);
  * that the changes will be flushed to the opened file.
  */
 void at24c512_deinit(at24c512_t* eeprom);
+
+
+/**
+ * @brief Close the file of the EEPROM, the changes made from now on are only
+ * kept in memory.
+ */
+void at24c512_detach(at24c512_t* eeprom);
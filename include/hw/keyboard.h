@@ -11,6 +11,7 @@
 
 #include "hw/device.h"
 #include "hw/pio.h"
+#include "hw/scheduler.h"
 #include "utils/fifo.h"
 
 #define IO_KEYBOARD_PIN 7
@@ -18,6 +19,15 @@
 #define FIFO_SIZE       512
 #define BREAK_CODE      0xF0
 
+/**
+ * @brief Scan codes given to `key_pressed` and `key_released` are the PS/2 set 2 make codes, the extended
+ * ones have their 0xE0 prefix in the upper byte. Pause and Print Screen are longer than that, use these
+ * values for them.
+ */
+#define PS2_SCANCODE_PAUSE          0xE1
+#define PS2_SCANCODE_PRINT_SCREEN   0xE07C
+#define PS2_SCANCODE_LEFT_SHIFT     0x12
+
 /**
  * @brief Period, in T-states, to check the host computer keyboard.
  * It is not necessary to check the keyboard events after each Z80
@@ -42,29 +52,42 @@ typedef struct {
     device_t    parent;
     size_t      size; // in bytes
     pio_t*      pio;
+    scheduler_t* sched;
 
     // Host keyboard check timer
-    uint32_t    check_timer;
+    sched_event_t check_event;
+    bool        check_pending;
+
+    // PS/2 timings, in T-states
+    unsigned long scancode_duration;
+    unsigned long key_timing;
+    unsigned long release_delay;
 
     // Keyboard specific
-    uint32_t    elapsed_tstates;    // 32-bit lets us count up to 7 minutes, more than enough
+    sched_event_t ps2_event;
     uint8_t     shift_register;
     fifo_t      queue;
     uint8_t     pin_state;
     ps2_state_t state;
 } keyboard_t;
 
-int keyboard_init(keyboard_t* keyboard, pio_t* pio);
-uint8_t key_pressed(keyboard_t* keyboard, uint16_t keycode);
-uint8_t key_released(keyboard_t* keyboard, uint16_t keycode);
+int keyboard_init(keyboard_t* keyboard, pio_t* pio, scheduler_t* sched);
+uint8_t key_pressed(keyboard_t* keyboard, uint16_t scancode);
+uint8_t key_released(keyboard_t* keyboard, uint16_t scancode);
+
+/**
+ * @brief Check whether the host keyboard must be read or not, the check
+ * timer elapses every KEYBOARD_CHECK_PERIOD T-states.
+ */
+bool keyboard_check(keyboard_t* keyboard);
 
 /**
- * @brief Tick the internal clock and checks whether the host keyboard
- * must be read or not.
+ * @brief Check whether all the codes sent to the keyboard were shifted out to the CPU
  */
-bool keyboard_check(keyboard_t* keyboard, int elapsed);
+bool keyboard_idle(keyboard_t* keyboard);
 
 /**
- * @brief Process the next keypresses if the keyboard is ready.
+ * @brief Get the scancode of the key typing the ASCII character `c` on a US layout, `shift` is set when
+ * Shift must be held. Returns 0 if no key types the character.
  */
-void keyboard_tick(keyboard_t* keyboard, pio_t* pio, int elapsed);
+uint16_t keyboard_ascii_scancode(char c, bool* shift);
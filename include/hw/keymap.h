@@ -0,0 +1,20 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Zeal 8-bit Computer <contact@zeal8bit.com>; David Higgins <zoul0813@me.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+#include <stdint.h>
+
+/**
+ * @brief Number of keys tracked on the host keyboard, matches Raylib's key codes
+ */
+#define RAYLIB_KEY_COUNT 384
+
+/**
+ * @brief Convert a Raylib key code into the PS/2 scan code expected by `key_pressed` and `key_released`,
+ * returns 0 if the key has no equivalent.
+ */
+uint16_t keymap_to_scancode(int key);
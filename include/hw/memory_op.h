@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct {
@@ -14,6 +16,14 @@ typedef struct {
     void (*write_byte)(void*, uint16_t, uint8_t);
     uint8_t (*phys_read_byte)(void*, uint32_t);
     void (*phys_write_byte)(void*, uint32_t, uint8_t);
+    /* Optional, copy a whole block at once instead of one byte at a time */
+    void (*phys_read_bytes)(void*, uint32_t, uint8_t*, size_t);
+    void (*phys_write_bytes)(void*, uint32_t, const uint8_t*, size_t);
+    /* Optional, true if the physical page containing the address behaves like plain memory: reads have
+     * no side effect and writes don't change what is read elsewhere */
+    bool (*phys_plain)(void*, uint32_t);
+    /* Optional, makes the CPU wait for the given number of T-states while another master holds the bus */
+    void (*stall)(void*, unsigned long);
     void* opaque;
 } memory_op_t;
 
@@ -52,6 +62,10 @@ static inline uint8_t memory_phys_read_byte(const memory_op_t* ops, uint32_t add
 
 static inline void memory_phys_read_bytes(const memory_op_t* ops, uint32_t addr, uint8_t* values, size_t size)
 {
+    if (ops->phys_read_bytes) {
+        ops->phys_read_bytes(ops->opaque, addr, values, size);
+        return;
+    }
     for (size_t i = 0; i < size; i++) {
         values[i] = ops->phys_read_byte(ops->opaque, addr + i);
     }
@@ -64,7 +78,18 @@ static inline void memory_phys_write_byte(const memory_op_t* ops, uint32_t addr,
 
 static inline void memory_phys_write_bytes(const memory_op_t* ops, uint32_t addr, uint8_t* values, size_t size)
 {
+    if (ops->phys_write_bytes) {
+        ops->phys_write_bytes(ops->opaque, addr, values, size);
+        return;
+    }
     for (size_t i = 0; i < size; i++) {
         ops->phys_write_byte(ops->opaque, addr + i, values[i]);
     }
 }
+
+static inline void memory_stall(const memory_op_t* ops, unsigned long tstates)
+{
+    if (ops->stall) {
+        ops->stall(ops->opaque, tstates);
+    }
+}
@@ -12,14 +12,65 @@
 #define MMU_PAGE_SIZE   (16 * 1024)
 #define MMU_PAGES_COUNT 4
 
+/**
+ * @brief Callback used to resolve a physical 16KB page into a host pointer, NULL if the page
+ * cannot be accessed directly.
+ */
+typedef uint8_t* (*mmu_resolve_t)(void* arg, uint32_t phys_addr, bool write);
+
+/**
+ * @brief Callback invoked when a physical 16KB page is not mapped anymore at a virtual page
+ */
+typedef void (*mmu_unmap_t)(void* arg, uint32_t phys_addr);
+
 typedef struct {
     device_t parent;
     uint8_t pages[MMU_PAGES_COUNT];
+    /* Host pointers to each virtual page, NULL when the access must go through the bus */
+    uint8_t* fast_read[MMU_PAGES_COUNT];
+    uint8_t* fast_write[MMU_PAGES_COUNT];
+    mmu_resolve_t resolve;
+    void* resolve_arg;
+    mmu_unmap_t unmap;
+    void* unmap_arg;
 } mmu_t;
 
 
 int mmu_init(mmu_t* mmu);
 
+/**
+ * @brief Set the callback used to fill the fast access tables and rebuild them
+ */
+void mmu_set_resolver(mmu_t* mmu, mmu_resolve_t resolve, void* arg);
+
+/**
+ * @brief Set the callback invoked each time a virtual page is remapped, with its previous physical page
+ */
+void mmu_set_unmap_listener(mmu_t* mmu, mmu_unmap_t unmap, void* arg);
+
+/**
+ * @brief Rebuild the fast access tables, must be called when the physical memory map changed
+ */
+void mmu_refresh(mmu_t* mmu);
+
+/**
+ * @brief Get the host pointer to the given virtual address, NULL if it must be read through the bus
+ */
+static inline uint8_t* mmu_fast_read_ptr(const mmu_t* mmu, uint16_t virt_addr)
+{
+    uint8_t* page = mmu->fast_read[virt_addr >> 14];
+    return page ? page + (virt_addr & (MMU_PAGE_SIZE - 1)) : NULL;
+}
+
+/**
+ * @brief Get the host pointer to the given virtual address, NULL if it must be written through the bus
+ */
+static inline uint8_t* mmu_fast_write_ptr(const mmu_t* mmu, uint16_t virt_addr)
+{
+    uint8_t* page = mmu->fast_write[virt_addr >> 14];
+    return page ? page + (virt_addr & (MMU_PAGE_SIZE - 1)) : NULL;
+}
+
 /**
  * @brief Get the physical address out of a virtual address
  */
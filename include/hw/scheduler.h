@@ -0,0 +1,126 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file Cycle-stamped event scheduler
+ *
+ * Devices that need to change their state after a given amount of T-states register an event
+ * with an absolute deadline, expressed in CPU cycles. The CPU can then run uninterrupted until
+ * the earliest deadline, at which point the due events are dispatched.
+ */
+
+/**
+ * @brief Maximum number of events that can be scheduled at the same time
+ */
+#define SCHED_MAX_EVENTS 16
+
+/**
+ * @brief Distance, in T-states, of the deadline reported when no event is scheduled.
+ * It must stay below 2^31 so that deadlines can be compared with a signed difference.
+ */
+#define SCHED_IDLE_PERIOD 0x10000000UL
+
+typedef struct scheduler_t scheduler_t;
+typedef struct sched_event_t sched_event_t;
+
+/**
+ * @brief Callback invoked when an event is due, `ev->deadline` contains the deadline it was
+ * scheduled for, which may be slightly in the past.
+ */
+typedef void (*sched_callback_t)(scheduler_t *sched, sched_event_t *ev, void *arg);
+
+/**
+ * @brief Callback invoked each time the earliest deadline is updated, it lets the CPU loop shorten
+ * its current run when a device schedules an event sooner than expected.
+ */
+typedef void (*sched_listener_t)(void *arg, unsigned long next);
+
+struct sched_event_t {
+    const char *name;  // Used for debugging
+    sched_callback_t callback;
+    void *arg;
+    unsigned long deadline;
+    /* Index in the heap, -1 when the event is not scheduled */
+    int index;
+};
+
+struct scheduler_t {
+    /* Cycle counter of the CPU, all the deadlines are based on it */
+    const unsigned long *clock;
+    /* Deadline of the earliest event, cached so that it can be checked after each instruction */
+    unsigned long next;
+    sched_listener_t listener;
+    void *listener_arg;
+    int count;
+    sched_event_t *heap[SCHED_MAX_EVENTS];
+};
+
+/**
+ * @brief Initialize the scheduler, `clock` must point to the CPU cycle counter.
+ */
+void sched_init(scheduler_t *sched, const unsigned long *clock);
+
+/**
+ * @brief Register the callback to invoke whenever the earliest deadline changes, can be NULL.
+ */
+void sched_set_listener(scheduler_t *sched, sched_listener_t listener, void *arg);
+
+/**
+ * @brief Initialize an event, it won't be scheduled until `sched_at` or `sched_in` is called.
+ */
+void sched_event_init(sched_event_t *ev, const char *name, sched_callback_t callback, void *arg);
+
+/**
+ * @brief Schedule (or reschedule) an event at the given absolute cycle.
+ */
+void sched_at(scheduler_t *sched, sched_event_t *ev, unsigned long deadline);
+
+/**
+ * @brief Remove an event from the scheduler, does nothing if it is not scheduled.
+ */
+void sched_cancel(scheduler_t *sched, sched_event_t *ev);
+
+/**
+ * @brief Dispatch all the events whose deadline has been reached.
+ */
+void sched_dispatch(scheduler_t *sched);
+
+/**
+ * @brief Check whether cycle `a` is before cycle `b`, taking into account the counter overflow
+ */
+static inline bool sched_before(unsigned long a, unsigned long b) {
+    return (long)(a - b) < 0;
+}
+
+/**
+ * @brief Schedule (or reschedule) an event in `delay` T-states from now.
+ */
+static inline void sched_in(scheduler_t *sched, sched_event_t *ev, unsigned long delay) {
+    sched_at(sched, ev, *sched->clock + delay);
+}
+
+static inline bool sched_is_pending(const sched_event_t *ev) {
+    return ev->index >= 0;
+}
+
+/**
+ * @brief Check whether at least one event is due.
+ */
+static inline bool sched_due(const scheduler_t *sched) {
+    return !sched_before(*sched->clock, sched->next);
+}
+
+/**
+ * @brief Number of T-states remaining before the next event, 0 if an event is due
+ */
+static inline unsigned long sched_remaining(const scheduler_t *sched) {
+    return sched_due(sched) ? 0 : sched->next - *sched->clock;
+}
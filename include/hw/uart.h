@@ -18,10 +18,33 @@
 
 #define BAUDRATE_US 17.361
 
+/**
+ * @brief Number of bits in a frame: start bit, 8 data bits and stop bit
+ */
+#define UART_FRAME_BITS 10
+
+/**
+ * @brief Callback receiving each character sent by the machine, when none is set they are
+ * printed on the standard output.
+ */
+typedef void (*uart_output_t)(void* arg, char c);
+
 typedef struct {
         // device_t
         device_t parent;
         size_t size; // in bytes
+
+        unsigned long bit_tstates;
+        uint8_t tx_fifo[UART_FRAME_BITS];
+        uint8_t tx_pos;
+
+        uart_output_t output;
+        void* output_arg;
 } uart_t;
 
 int uart_init(uart_t* uart, pio_t* pio);
+
+/**
+ * @brief Redirect the characters sent by the machine, `output` can be NULL to print them again
+ */
+void uart_set_output(uart_t* uart, uart_output_t output, void* arg);
@@ -11,28 +11,138 @@
 #ifndef Z80_Z80_H_
 #define Z80_Z80_H_
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
 
+/* Create a pair of registers that can be accessed as bytes of a single 16-bit value */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define Z80_REGISTER_PAIR(msb, lsb, pair) \
+    union { \
+        struct { \
+            uint8_t msb; \
+            uint8_t lsb; \
+        }; \
+        uint16_t pair; \
+    }
+#else
+#define Z80_REGISTER_PAIR(msb, lsb, pair) \
+    union { \
+        struct { \
+            uint8_t lsb; \
+            uint8_t msb; \
+        }; \
+        uint16_t pair; \
+    }
+#endif
+
+/* Granularity of the memory returned by the `direct` hook, must not be bigger than the MMU pages */
+#define Z80_DIRECT_PAGE_SIZE 0x4000
+
+/* Number of entries of the block cache, must be a power of two */
+#define Z80_CACHE_BLOCKS 1024
+/* Maximum number of instructions decoded in a single block */
+#define Z80_BLOCK_MAX_OPS 16
+
 typedef struct z80 z80;
+
+/* Pre-decoded instruction, `exec` runs it without fetching anything from memory */
+typedef struct z80_uop z80_uop;
+struct z80_uop {
+    void (*exec)(z80* const z, const z80_uop* op);
+    uint16_t imm;   // immediate operand
+    uint8_t opcode; // first byte of the instruction
+    uint8_t len;    // size of the instruction in bytes
+    uint8_t dst;    // offset of the destination register in the z80 structure
+    uint8_t src;    // offset of the source register in the z80 structure
+};
+
+/* Straight-line code decoded from a physical address */
+typedef struct {
+    uint32_t phys;  // physical address of the first instruction
+    uint32_t gen;   // write generation of its page when it was decoded
+    uint8_t count;  // number of instructions, 0 if the first one can't be cached
+    uint16_t hits;  // number of executions, used to find the blocks worth recompiling
+    // recompiled code, called with the write generation counter of the page, NULL if
+    // the block is interpreted
+    void (*native)(z80* const, const uint32_t*);
+    z80_uop ops[Z80_BLOCK_MAX_OPS];
+} z80_block;
+
+/* Must be zero-initialized and flushed before its first use */
+typedef struct {
+    z80_block blocks[Z80_CACHE_BLOCKS];
+    uint8_t* jit_arena; // executable memory holding the recompiled blocks, allocated on first use
+    size_t jit_used;
+    bool jit_failed;    // the arena couldn't be allocated, only interpret
+} z80_block_cache;
+
+/* Number of registers compared between two iterations of a polling loop */
+#define Z80_IDLE_REGS 13
+
+/* Polling loop watched by z80_run, skipped once it is known not to change anything */
+typedef struct {
+    uint16_t head, next;   // the loop goes from `head` to the jump ending at `next`
+    uint16_t cycles;       // t-states of an iteration, 0 if the loop doesn't only poll
+    uint8_t fetches;       // opcode fetches of an iteration
+    bool active;           // set during z80_run
+    bool valid;            // the fields below hold the state at the head of the previous iteration
+    uint8_t r;
+    unsigned long cyc;
+    uint16_t regs[Z80_IDLE_REGS];
+} z80_idle;
+
 struct z80 {
+    // buses, not used when the core is built with CONFIG_Z80_STATIC_BUS as it then calls the
+    // Zeal accessors directly
     uint8_t (*read_byte)(void*, uint16_t);
     void (*write_byte)(void*, uint16_t, uint8_t);
     uint8_t (*port_in)(void*, uint16_t);
     void (*port_out)(void*, uint16_t, uint8_t);
     void* userdata;
+    // optional, called by z80_run after each instruction (only once per run while the CPU is
+    // halted), returning true ends the run
+    bool (*breakpoint)(void*, uint16_t);
+    // optional, returns a host pointer to the byte at the given address if the whole
+    // Z80_DIRECT_PAGE_SIZE page containing it can be accessed directly (read or write),
+    // NULL otherwise. Requesting a write pointer means the page is about to be modified.
+    // Used to run block instructions in bulk.
+    uint8_t* (*direct)(void*, uint16_t, bool);
+    // optional, block cache used by z80_run, requires `direct` and `code_page`
+    z80_block_cache* cache;
+    // returns the write generation counter of the physical page containing the given
+    // address and stores the physical address of the latter, NULL if the code there must
+    // not be cached. The counter must change each time the content of the page changes.
+    const uint32_t* (*code_page)(void*, uint16_t, uint32_t*);
+    // optional, returns true if reading the given port has no side effect and its value can
+    // only change between two z80_run calls. Lets z80_run skip the loops polling it.
+    bool (*idle_read)(void*, uint16_t);
 
-    unsigned long cyc; // cycle count (t-states)
+    unsigned long cyc;       // cycle count (t-states)
+    unsigned long run_until; // cycle at which the current z80_run call stops
+    bool exit_requested;     // set to end the current z80_run call early
+    bool chain;              // set during z80_run, lets the threaded core dispatch instructions back to back
+    z80_idle idle;
 
     uint16_t pc, sp, ix, iy;                // special purpose registers
     uint16_t mem_ptr;                       // "wz" register
-    uint8_t a, b, c, d, e, h, l;            // main registers
-    uint8_t a_, b_, c_, d_, e_, h_, l_, f_; // alternate registers
+    uint8_t a;                              // main registers
+    Z80_REGISTER_PAIR(b, c, bc);
+    Z80_REGISTER_PAIR(d, e, de);
+    Z80_REGISTER_PAIR(h, l, hl);
+    uint8_t a_, f_;                         // alternate registers
+    Z80_REGISTER_PAIR(b_, c_, bc_);
+    Z80_REGISTER_PAIR(d_, e_, de_);
+    Z80_REGISTER_PAIR(h_, l_, hl_);
     uint8_t i, r;                           // interrupt vector, memory refresh
 
     // flags: sign, zero, yf, half-carry, xf, parity/overflow, negative, carry
     bool sf : 1, zf : 1, yf : 1, hf : 1, xf : 1, pf : 1, nf : 1, cf : 1;
+    // lazy flags mode: last ALU operation, the flags above are only computed
+    // from it when needed. Use z80_get_f to read the flags.
+    uint8_t lazy_op, lazy_a, lazy_b, lazy_res;
+    bool lazy_cy;
 
     uint8_t iff_delay;
     uint8_t interrupt_mode;
@@ -45,10 +155,15 @@ struct z80 {
 void z80_init(z80* const z);
 int z80_instruction_size(z80* const z);
 int  z80_step(z80* const z);
+long z80_run(z80* const z, long budget);
+void z80_request_exit(z80* const z);
+void z80_shorten_run(z80* const z, unsigned long until);
 void z80_debug_output(z80* const z);
 void z80_get_debug_output(z80* const z, char* s);
 void z80_gen_nmi(z80* const z);
 void z80_gen_int(z80* const z, uint8_t data);
+void z80_cache_flush(z80_block_cache* const cache);
+void z80_cache_release(z80_block_cache* const cache);
 
 /* Helpers to manipulate the flag register */
 uint8_t z80_get_f(z80* const z);
@@ -23,14 +23,14 @@
 #include "hw/mmu.h"
 #include "hw/pio.h"
 #include "hw/ram.h"
+#include "hw/scheduler.h"
 #include "hw/uart.h"
 #include "hw/z80.h"
 #include "hw/zvb/zvb.h"
-#include "raylib.h"
+#include "utils/config_args.h"
 
 #ifdef CONFIG_ENABLE_DEBUGGER
 #include "debugger/debugger_impl.h" // IWYU pragma: keep
-#include "debugger/debugger_ui.h"
 #endif
 
 typedef uint8_t dev_idx_t;
@@ -54,12 +54,10 @@ typedef uint8_t dev_idx_t;
 #define ZEAL_MAX_DEVICE_COUNT 32
 
 /**
- * @brief Macros related to RayLib window
+ * @brief Number of T-states emulated by a single iteration of the main loop when no frame is rendered,
+ * which corresponds to a 60Hz frame.
  */
-#define WIN_VISIBLE_WIDTH (ZVB_MAX_RES_WIDTH * 2)
-#define WIN_VISIBLE_HEIGHT (ZVB_MAX_RES_HEIGHT * 2)
-#define WIN_NAME "Zeal 8-bit Computer"
-#define WIN_LOG_LEVEL LOG_WARNING
+#define ZEAL_FRAME_TSTATES US_TO_TSTATES(16667)
 
 /**
  * @brief Each device needs to be associated to the physical page where its mapping starts.
@@ -76,6 +74,12 @@ struct zeal_t {
     map_entry_t mem_mapping[MEM_MAPPING_SIZE];
 
     z80 cpu;
+#if CONFIG_Z80_BLOCK_CACHE
+    z80_block_cache cpu_cache;
+    /* Write generation of each physical page, the code decoded from a page is discarded when it changes */
+    uint32_t code_gen[MEM_MAPPING_SIZE];
+#endif
+    scheduler_t sched;
     mmu_t mmu;
     flash_t rom;
     ram_t ram;
@@ -88,28 +92,50 @@ struct zeal_t {
     ds1307_t rtc;
     at24c512_t eeprom;
     compactflash_t compactflash;
-
-    /* Renderer */
-    RenderTexture2D zvb_out;
+    /* Memory operations given to the devices that access the memory space on their own */
+    memory_op_t mem_ops;
+
+    /* Arguments the machine was created with */
+    config_arguments_t args;
+    /* Headless runs stop once the CPU cycle counter reaches this value, 0 for no limit */
+    unsigned long cycle_limit;
+    /* Runs stop when the CPU is about to execute the instruction at `stop_pc`, if enabled */
+    bool stop_pc_enabled;
+    uint16_t stop_pc;
+
+    /* No video board is attached to headless machines */
     bool headless;
     bool should_exit;
 
+    /* Frontend showing the machine in a window, NULL when there is none */
+    struct zeal_window_t *window;
+    /* Invoked at the end of a reset, lets the frontend drop the state it keeps about the machine */
+    void (*on_reset)(struct zeal_t *machine);
+
     /* Debugger related */
 #if CONFIG_ENABLE_DEBUGGER
     bool dbg_enabled;
     dbg_state_t dbg_state;
     dbg_t dbg;
-    struct dbg_ui_t *dbg_ui;
-    uint8_t (*dbg_read_memory)(struct zeal_t *, hwaddr addr);
+    /* Execution history used to go backward, NULL when disabled */
+    struct zeal_rewind_t *rewind;
+    void (*dbg_read_memory)(struct zeal_t *, hwaddr addr, uint8_t *dst, uint32_t len);
 #endif
 };
 
 typedef struct zeal_t zeal_t;
 
 /**
- * @brief Initialize the Zeal 8-bit Computer virtual machine with optional parameters
+ * @brief Initialize the virtual machine with the given arguments. The video board is only attached when
+ * `args->headless` is false. Several machines can be initialized and run concurrently, each from its
+ * own thread.
+ */
+int zeal_init_args(zeal_t *machine, const config_arguments_t *args);
+
+/**
+ * @brief Release the resources allocated by the machine
  */
-int zeal_init(zeal_t *machine);
+void zeal_deinit(zeal_t *machine);
 
 /**
  * @brief Reset the Zeal 8-bit Computer
@@ -119,28 +145,60 @@ int zeal_init(zeal_t *machine);
 int zeal_reset(zeal_t *machine);
 
 /**
- * @brief Run the virtual machine, won't return until the emulation is terminated
+ * @brief Run the virtual machine without any frontend, won't return until the emulation is terminated
  */
 int zeal_run(zeal_t *machine);
 
 /**
- * @brief Stop the virtual machine, and call CloseWindow()
+ * @brief Run the CPU until the next scheduled event is due and dispatch it. The run may end earlier if
+ * an interrupt is raised or a breakpoint is reached.
+ *
+ * Returns false if the emulation must stop.
+ */
+bool zeal_run_until_event(zeal_t *machine);
+
+/**
+ * @brief Run a whole frame slice, ZEAL_FRAME_TSTATES T-states, or less if the machine stops
+ */
+void zeal_run_frame(zeal_t *machine);
+
+/**
+ * @brief Stop the virtual machine
  */
 void zeal_exit(zeal_t *machine);
 
-#ifdef CONFIG_ENABLE_DEBUGGER
 /**
- * @brief Enable Zeal Debugger view
+ * @brief Replace the romdisk of the loaded ROM with a user program, see `flash_load_user_program`
+ */
+int zeal_insert_user_program(zeal_t *machine, const char *uprog_filename);
+
+/**
+ * @brief Insert the CompactFlash image `cf_filename`, replacing the current one if any
+ */
+int zeal_insert_cf(zeal_t *machine, const char *cf_filename);
+
+/**
+ * @brief Keep the writes to the CompactFlash and EEPROM images private to the machine, the files on disk are
+ * left untouched. Returns 0 on success.
+ */
+int zeal_private_images(zeal_t *machine);
+
+/**
+ * @brief Install or remove the CPU hooks, must be called when the breakpoints are enabled or disabled
  */
-int zeal_debug_enable(zeal_t *machine);
+void zeal_update_cpu_hooks(zeal_t *machine);
 
+#if CONFIG_Z80_BLOCK_CACHE
 /**
- * @brief Disable Zeal Debugger view
+ * @brief Get the write generation of the 16KB pages of `dev` memory, `size` bytes from `offset`. A page
+ * mapped several times in the memory space, like the flash mirror, gets the sum of all its physical pages,
+ * which changes as soon as any of them is written.
  */
-int zeal_debug_disable(zeal_t *machine);
+void zeal_mem_gens(const zeal_t *machine, const device_t *dev, uint32_t offset, size_t size, uint32_t *gens);
 
 /**
- * @brief Toggle the Zeal Debugger view
+ * @brief Mark the pages of `dev` memory holding the `size` bytes from `offset` as modified, for a change made
+ * behind the buses. Unlike zeal_code_modified_all, the code the CPU decoded from the other pages is kept.
  */
-void zeal_debug_toggle(dbg_t *dbg);
-#endif // CONFIG_ENABLE_DEBUGGER
+void zeal_mem_modified(zeal_t *machine, const device_t *dev, uint32_t offset, size_t size);
+#endif
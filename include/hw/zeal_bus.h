@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hw/zeal.h"
+#include "utils/log.h"
+
+/**
+ * @file Memory and I/O buses of the Zeal 8-bit Computer, as seen by the CPU
+ *
+ * The accessors are inline so that, when the Z80 core is built with CONFIG_Z80_STATIC_BUS, the
+ * accesses to RAM and flash are reduced to a lookup in the MMU fast tables. Everything else goes
+ * through the devices registered in the machine mappings.
+ */
+
+/**
+ * @brief Mark the physical page containing `phys_addr` as modified, the code the CPU decoded from it
+ * must be discarded.
+ */
+static inline void zeal_code_modified(zeal_t *machine, uint32_t phys_addr) {
+#if CONFIG_Z80_BLOCK_CACHE
+    machine->code_gen[phys_addr / MMU_PAGE_SIZE]++;
+#else
+    (void)machine;
+    (void)phys_addr;
+#endif
+}
+
+/**
+ * @brief Mark the whole memory space as modified, for changes made behind the buses (flash erased, state
+ * restored, ...)
+ */
+static inline void zeal_code_modified_all(zeal_t *machine) {
+    for (uint32_t page = 0; page < MEM_MAPPING_SIZE; page++) {
+        zeal_code_modified(machine, page * MMU_PAGE_SIZE);
+    }
+}
+
+/**
+ * @brief Memory read and write that can't be done through the MMU fast tables
+ */
+uint8_t zeal_bus_mem_read_slow(zeal_t *machine, uint16_t virt_addr);
+void zeal_bus_mem_write_slow(zeal_t *machine, uint16_t virt_addr, uint8_t data);
+
+/**
+ * @brief Copy a block from/to the memory space, as seen by the CPU or physically. The copies are split at
+ * the 16KB pages and done by the devices at once when they support it.
+ */
+void zeal_bus_read_block(zeal_t *machine, uint16_t virt_addr, uint8_t *dst, uint32_t len);
+void zeal_bus_write_block(zeal_t *machine, uint16_t virt_addr, const uint8_t *src, uint32_t len);
+void zeal_bus_phys_read_block(zeal_t *machine, uint32_t phys_addr, uint8_t *dst, uint32_t len);
+void zeal_bus_phys_write_block(zeal_t *machine, uint32_t phys_addr, const uint8_t *src, uint32_t len);
+
+/**
+ * @brief Read a byte from the memory space, `opaque` being the machine
+ */
+static inline uint8_t zeal_bus_mem_read(void *opaque, uint16_t virt_addr) {
+    zeal_t *machine = (zeal_t *)opaque;
+    const uint8_t *page = machine->mmu.fast_read[virt_addr / MMU_PAGE_SIZE];
+    if (page) {
+        return page[virt_addr & (MMU_PAGE_SIZE - 1)];
+    }
+    return zeal_bus_mem_read_slow(machine, virt_addr);
+}
+
+/**
+ * @brief Write a byte to the memory space, `opaque` being the machine
+ */
+static inline void zeal_bus_mem_write(void *opaque, uint16_t virt_addr, uint8_t data) {
+    zeal_t *machine = (zeal_t *)opaque;
+    const int idx = virt_addr / MMU_PAGE_SIZE;
+    uint8_t *page = machine->mmu.fast_write[idx];
+    if (page) {
+        page[virt_addr & (MMU_PAGE_SIZE - 1)] = data;
+        zeal_code_modified(machine, machine->mmu.pages[idx] * MMU_PAGE_SIZE);
+        return;
+    }
+    zeal_bus_mem_write_slow(machine, virt_addr, data);
+}
+
+/**
+ * @brief Read a byte from the I/O space, `opaque` being the machine
+ */
+static inline uint8_t zeal_bus_io_read(void *opaque, uint16_t addr) {
+    zeal_t *machine = (zeal_t *)opaque;
+    const int low = addr & 0xff;
+    const map_entry_t *entry = &machine->io_mapping[low];
+    device_t *device = entry->dev;
+
+    if (device && device->io_region.read) {
+        device->io_region.upper_addr = addr >> 8;
+        return device->io_region.read(device, low - entry->page_from);
+    }
+
+    log_printf("[INFO] No device replied to I/O read: 0x%04x\n", low);
+    return 0;
+}
+
+/**
+ * @brief Write a byte to the I/O space, `opaque` being the machine
+ */
+static inline void zeal_bus_io_write(void *opaque, uint16_t addr, uint8_t data) {
+    zeal_t *machine = (zeal_t *)opaque;
+    const int low = addr & 0xff;
+    const map_entry_t *entry = &machine->io_mapping[low];
+    device_t *device = entry->dev;
+
+    if (device && device->io_region.write) {
+        device->io_region.write(device, low - entry->page_from, data);
+    } else {
+        log_printf("[INFO] No device replied to I/O write: 0x%04x\n", low);
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hw/zeal.h"
+
+/**
+ * @file Execution history of the machine, lets the debugger go backward
+ *
+ * While the machine runs, a checkpoint is taken every `interval` T-states in a ring bounded by a memory
+ * budget, the oldest checkpoints being dropped first. The RAM, the flash and the tileset are split in 16KB
+ * pages and a checkpoint only copies the pages written since the previous one, it shares the others with
+ * it. The keys received by the machine are recorded with the cycle they arrived at.
+ *
+ * Going backward restores the closest checkpoint and runs the machine again up to the wanted cycle,
+ * feeding it the recorded keys, which gives the exact same execution. The history after that cycle is
+ * dropped, the machine then runs from there as if it had never gone further. The content of the TF card
+ * and CompactFlash images is not restored, nor is the host time seen by the RTC.
+ */
+
+/**
+ * @brief Maximum number of checkpoints kept, whatever the memory budget
+ */
+#define REWIND_MAX_CHECKPOINTS 1024
+
+typedef struct zeal_rewind_t zeal_rewind_t;
+
+/**
+ * @brief Create the history of `machine`, with a checkpoint every `interval` T-states and using at most
+ * `budget` bytes. Returns NULL on error.
+ */
+zeal_rewind_t *zeal_rewind_create(zeal_t *machine, unsigned long interval, size_t budget);
+
+/**
+ * @brief Release the history and all its checkpoints
+ */
+void zeal_rewind_free(zeal_rewind_t *rewind);
+
+/**
+ * @brief Take a checkpoint if the interval elapsed since the previous one, to call between two runs of the
+ * CPU. Does nothing when `rewind` is NULL.
+ */
+void zeal_rewind_record(zeal_rewind_t *rewind);
+
+/**
+ * @brief Take a checkpoint right now, needed after the state of the machine was changed from outside, by
+ * a reset or by the debugger. Does nothing when `rewind` is NULL.
+ */
+void zeal_rewind_checkpoint(zeal_rewind_t *rewind);
+
+/**
+ * @brief Drop the whole history, needed when the machine state is replaced. Does nothing when `rewind`
+ * is NULL.
+ */
+void zeal_rewind_clear(zeal_rewind_t *rewind);
+
+/**
+ * @brief Record a key event the machine is about to receive. Does nothing when `rewind` is NULL.
+ */
+void zeal_rewind_key(zeal_rewind_t *rewind, uint16_t scancode, bool pressed);
+
+/**
+ * @brief Go back to the instruction executed before the current one. Returns 0 on success, non-zero if
+ * the history doesn't go that far.
+ */
+int zeal_rewind_step_back(zeal_rewind_t *rewind);
+
+/**
+ * @brief Go back to the last time the CPU reached a breakpoint. Returns 0 on success, non-zero if no
+ * breakpoint was reached in the history, the machine is then left untouched.
+ */
+int zeal_rewind_reverse_continue(zeal_rewind_t *rewind);
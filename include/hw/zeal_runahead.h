@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "hw/zeal.h"
+
+/**
+ * @file Run-ahead, hides the frames of latency between a key press and its effect on screen
+ *
+ * At each V-blank, the frontend saves the machine, runs it a few frames ahead with the keys it currently
+ * holds, shows the frame reached and restores the machine. A game that reacts to a key a frame after
+ * reading it then shows the reaction on the very frame the key was pressed.
+ *
+ * The saved state is kept in memory: the devices are snapshotted and only the 16KB pages of the RAM, the
+ * flash and the tileset written since the previous save are copied, only the pages written while running
+ * ahead are copied back. The voices of the sound controller keep the phase the audio output reached,
+ * restoring it every frame would be heard. The characters sent on the UART while running ahead are
+ * dropped, they are sent again when the machine really gets there.
+ */
+
+/**
+ * @brief Maximum number of frames the machine can run ahead
+ */
+#define RUNAHEAD_MAX_FRAMES 8
+
+typedef struct zeal_runahead_t zeal_runahead_t;
+
+/**
+ * @brief Create the run-ahead of `machine`, which must have a video board. Returns NULL on error.
+ */
+zeal_runahead_t *zeal_runahead_create(zeal_t *machine);
+
+/**
+ * @brief Release the run-ahead and its saved state
+ */
+void zeal_runahead_free(zeal_runahead_t *runahead);
+
+/**
+ * @brief Save the machine, then run it until it reached `frames` more V-blanks. To call when the video
+ * board has a frame to render, the frame to show instead is then the one of the video board.
+ * Returns false if the machine could not be saved, it was left untouched.
+ */
+bool zeal_runahead_begin(zeal_runahead_t *runahead, int frames);
+
+/**
+ * @brief Put the machine back in the state saved by `zeal_runahead_begin`, its frame was already shown
+ */
+void zeal_runahead_end(zeal_runahead_t *runahead);
@@ -0,0 +1,66 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hw/zeal.h"
+
+/**
+ * @file Snapshots of the whole machine state
+ *
+ * A snapshot holds the CPU, the memories and the state of every device, it can be restored in any
+ * machine created with the same video board presence. The content of the external images, TF card and
+ * CompactFlash, is not part of it: the same images must be attached when restoring.
+ *
+ * The memories are stored as 16KB pages, each one either raw, filled with a single byte or compressed,
+ * which keeps a save in the order of a millisecond.
+ */
+
+/**
+ * @brief Version of the snapshot format, snapshots of another version are refused
+ */
+#define ZEAL_STATE_VERSION 1
+
+/**
+ * @brief Buffer holding a snapshot in memory, can be reused for several saves to avoid reallocations
+ */
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} zeal_snapshot_t;
+
+/**
+ * @brief Save the state of the machine in `snapshot`. Returns 0 on success.
+ */
+int zeal_state_save(zeal_t *machine, zeal_snapshot_t *snapshot);
+
+/**
+ * @brief Restore a snapshot of `size` bytes. The snapshot is checked before anything is restored: on
+ * error, the machine is left untouched. Returns 0 on success.
+ */
+int zeal_state_load(zeal_t *machine, const uint8_t *data, size_t size);
+
+/**
+ * @brief Same as the two functions above, without the content of the RAM, the flash and the tileset, for
+ * the callers keeping these memories on their own. They must be restored before loading such a snapshot.
+ */
+int zeal_state_save_devices(zeal_t *machine, zeal_snapshot_t *snapshot);
+int zeal_state_load_devices(zeal_t *machine, const uint8_t *data, size_t size);
+
+/**
+ * @brief Release the memory of a snapshot buffer
+ */
+void zeal_snapshot_free(zeal_snapshot_t *snapshot);
+
+/**
+ * @brief Save or restore the state of the machine to or from a file. Return 0 on success.
+ */
+int zeal_state_save_file(zeal_t *machine, const char *path);
+int zeal_state_load_file(zeal_t *machine, const char *path);
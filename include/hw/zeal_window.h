@@ -0,0 +1,181 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Zeal 8-bit Computer <contact@zeal8bit.com>; David Higgins <zoul0813@me.com>
+ *
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * SPDX-FileContributor: Modified by Robert Maupin 2026
+ */
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hw/keymap.h"
+#include "hw/zeal.h"
+#include "hw/zvb/zvb_render.h"
+#include "raylib.h"
+
+/**
+ * @file Raylib frontend of the emulator: window, rendering, audio output and host keyboard.
+ */
+
+/**
+ * @brief The machine runs on a thread of its own so that the window never stalls it, except on the web
+ * where there are no threads
+ */
+#ifdef PLATFORM_WEB
+#define WIN_EMULATION_THREAD 0
+#else
+#define WIN_EMULATION_THREAD 1
+#include <pthread.h>
+#endif
+
+/**
+ * @brief Macros related to RayLib window
+ */
+#define WIN_VISIBLE_WIDTH (ZVB_MAX_RES_WIDTH * 2)
+#define WIN_VISIBLE_HEIGHT (ZVB_MAX_RES_HEIGHT * 2)
+#define WIN_NAME "Zeal 8-bit Computer"
+#define WIN_LOG_LEVEL LOG_WARNING
+/* State file of the save and load actions when none was given on the command line */
+#define WIN_STATE_FILE "zeal.state"
+/* Longest time, in seconds, the window keeps showing the same image without presenting it again */
+#define WIN_PRESENT_PERIOD 0.5
+
+typedef enum {
+    KEY_NOT_PRESSED,
+    KEY_PRESSED,
+    KEY_REPEATED,
+} kb_key_state_t;
+
+typedef struct {
+    kb_key_state_t state;
+    int duration;
+} kb_keys_t;
+
+/* Size of the queue of key events sent to the machine, a power of two */
+#define WIN_KEY_QUEUE_SIZE 256
+
+typedef struct {
+    uint16_t scancode;
+    bool pressed;
+} win_key_event_t;
+
+#if WIN_EMULATION_THREAD
+/* Flag set on the index of the latest frame published until the window takes it */
+#define WIN_FRAME_NEW 4
+
+/**
+ * @brief Frame published by the machine thread for the window
+ */
+typedef struct {
+    zvb_frame_t video;
+    unsigned long cycle;
+    double runahead_ms;
+} win_frame_t;
+#endif
+
+typedef struct zeal_window_t {
+    zeal_t *machine;
+
+    /* Renderer, the ZVB output always goes to a texture first to allow scaling */
+    zvb_render_t render;
+    RenderTexture2D zvb_out;
+    AudioStream audio;
+
+    /* Key states on the host, used to simulate key press, release and repeat */
+    kb_keys_t host_keys[RAYLIB_KEY_COUNT];
+    /* Key events for the machine, queued by the window and taken by the machine without locking */
+    win_key_event_t key_queue[WIN_KEY_QUEUE_SIZE];
+    atomic_uint key_head;
+    atomic_uint key_tail;
+    /* Set when the machine was reset, the window then forgets the keys held on the host */
+    atomic_bool keys_reset;
+
+#if WIN_EMULATION_THREAD
+    pthread_t thread;
+    /* Held by the thread running or modifying the machine. The window takes it to handle the shortcuts
+     * and to run the debugger, the machine thread waits on `cond` while the window wants it. */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    atomic_int lock_requests;
+    bool quit;
+
+    /* Triple buffer of frames: the machine thread writes the back one, the window reads the front one and
+     * `frame_ready` holds the latest one published, with WIN_FRAME_NEW until the window takes it */
+    win_frame_t frames[3];
+    atomic_int frame_ready;
+    int frame_back;
+    int frame_front;
+    /* Versions of the VRAM parts in the machine and in the textures of the renderer */
+    uint32_t vram_versions[ZVB_PART_COUNT];
+    uint32_t tex_versions[ZVB_PART_COUNT];
+#endif
+
+    /* Run-ahead, NULL when disabled, and the time it takes per frame in milliseconds */
+    struct zeal_runahead_t *runahead;
+    double runahead_ms;
+
+    /* Turbo, the machine runs `turbo_speed` times faster than real time, as fast as possible when 0, and
+     * only some of its frames are shown */
+    bool turbo;
+    int turbo_speed;
+    /* Host time and machine cycle the speed of the machine is measured from */
+    double pace_time;
+    unsigned long pace_cycle;
+    /* Host time and machine cycle of the last frame shown, how long it took to render and the speed reached */
+    double shown_time;
+    unsigned long shown_cycle;
+    double render_time;
+    double turbo_reached;
+    /* Host time the window was last presented at, it is skipped while nothing on it changes */
+    double presented_time;
+
+#if CONFIG_ENABLE_DEBUGGER
+    struct dbg_ui_t *dbg_ui;
+#endif
+} zeal_window_t;
+
+/**
+ * @brief Open the window showing `machine`, which must have been initialized with a video board
+ */
+int zeal_window_init(zeal_window_t *window, zeal_t *machine);
+
+/**
+ * @brief Run the machine in the window, won't return until the emulation is terminated or the window
+ * is closed. The window is closed when returning.
+ */
+int zeal_window_run(zeal_window_t *window);
+
+/**
+ * @brief Save or restore the machine state, in the `--save-state` file, else the `--load-state` one,
+ * else WIN_STATE_FILE. Return 0 on success.
+ */
+int zeal_window_save_state(zeal_t *machine);
+int zeal_window_load_state(zeal_t *machine);
+
+/**
+ * @brief Turn the turbo of the window showing `machine` on or off
+ */
+void zeal_window_toggle_turbo(zeal_t *machine);
+
+#ifdef CONFIG_ENABLE_DEBUGGER
+/**
+ * @brief Enable Zeal Debugger view
+ */
+int zeal_debug_enable(zeal_t *machine);
+
+/**
+ * @brief Disable Zeal Debugger view
+ */
+int zeal_debug_disable(zeal_t *machine);
+
+/**
+ * @brief Toggle the Zeal Debugger view
+ */
+void zeal_debug_toggle(dbg_t *dbg);
+#endif // CONFIG_ENABLE_DEBUGGER
@@ -0,0 +1,116 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hw/uart.h"
+#include "utils/config_args.h"
+
+/**
+ * @file Public API of the zisa_core library.
+ *
+ * The library emulates a whole Zeal 8-bit Computer without any window, audio device or host keyboard,
+ * those belong to the frontend. Machines are independent from each other, several of them can run
+ * concurrently as long as each one is only used from a single thread at a time.
+ */
+
+typedef struct zeal_t zisa_t;
+
+/**
+ * @brief Create a machine, `args` can be NULL to use the defaults. The video board is attached unless
+ * `args->headless` is set. Returns NULL on error.
+ */
+zisa_t *zisa_create(const config_arguments_t *args);
+
+/**
+ * @brief Release a machine created with `zisa_create`
+ */
+void zisa_destroy(zisa_t *machine);
+
+/**
+ * @brief Load a ROM image in the flash and optionally a user program in its romdisk, same syntax as the
+ * `--uprog` option. Returns 0 on success.
+ */
+int zisa_load_rom(zisa_t *machine, const char *rom_filename, const char *uprog_filename);
+
+/**
+ * @brief Reset the machine
+ */
+int zisa_reset(zisa_t *machine);
+
+/**
+ * @brief Save the whole state of the machine to a file, or restore it. The snapshot can only be restored
+ * in a machine created with the same `headless` argument. Return 0 on success.
+ */
+int zisa_save_state(zisa_t *machine, const char *path);
+int zisa_load_state(zisa_t *machine, const char *path);
+
+/**
+ * @brief Run the machine for `tstates` T-states, or less if it stops before.
+ * Returns the number of T-states actually emulated.
+ */
+unsigned long zisa_run_cycles(zisa_t *machine, unsigned long tstates);
+
+/**
+ * @brief Run the machine for `frames` 60Hz frames. Returns the number of T-states actually emulated.
+ */
+unsigned long zisa_run_frames(zisa_t *machine, unsigned int frames);
+
+/**
+ * @brief Check whether the machine stopped on its own, because of a software reset with `no_reset` set
+ */
+bool zisa_stopped(const zisa_t *machine);
+
+/**
+ * @brief Read or write the memory as seen by the CPU, through the MMU
+ */
+void zisa_read_memory(zisa_t *machine, uint16_t virt_addr, uint8_t *dst, uint32_t len);
+void zisa_write_memory(zisa_t *machine, uint16_t virt_addr, const uint8_t *src, uint32_t len);
+
+/**
+ * @brief Read or write the 4MB physical memory space
+ */
+void zisa_read_phys_memory(zisa_t *machine, uint32_t phys_addr, uint8_t *dst, uint32_t len);
+void zisa_write_phys_memory(zisa_t *machine, uint32_t phys_addr, const uint8_t *src, uint32_t len);
+
+/**
+ * @brief Set the callback receiving the bytes the machine sends on its UART
+ */
+void zisa_set_uart_output(zisa_t *machine, uart_output_t output, void *arg);
+
+/**
+ * @brief Send a key event to the PS/2 keyboard, `scancode` being a PS/2 set 2 make code as described in
+ * `hw/keyboard.h`
+ */
+void zisa_key_event(zisa_t *machine, uint16_t scancode, bool pressed);
+
+/**
+ * @brief Size of the framebuffer, in pixels
+ */
+#define ZISA_SCREEN_WIDTH 640
+#define ZISA_SCREEN_HEIGHT 480
+
+/**
+ * @brief Get the screen as ZISA_SCREEN_WIDTH x ZISA_SCREEN_HEIGHT pixels, each stored as R, G, B and A
+ * bytes. Returns true if a new frame was displayed since the previous call, the buffer is filled either way.
+ * Machines without video board leave the buffer untouched and return false.
+ */
+bool zisa_get_framebuffer(zisa_t *machine, uint32_t *pixels);
+
+/**
+ * @brief Sample rate and channel count of the audio produced by `zisa_get_audio`
+ */
+#define ZISA_AUDIO_SAMPLE_RATE 44091
+#define ZISA_AUDIO_CHANNELS 2
+
+/**
+ * @brief Generate the next `frames` audio frames of interleaved stereo 16-bit signed samples from the
+ * current state of the sound controller. Returns the number of frames generated, 0 without video board.
+ */
+unsigned int zisa_get_audio(zisa_t *machine, int16_t *buffer, unsigned int frames);
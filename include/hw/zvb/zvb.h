@@ -14,6 +14,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "hw/device.h"
+#include "hw/scheduler.h"
 #include "hw/zvb/zvb_font.h"
 #include "hw/zvb/zvb_palette.h"
 #include "hw/zvb/zvb_tilemap.h"
@@ -25,10 +26,6 @@
 #include "hw/zvb/zvb_sound.h"
 #include "hw/zvb/zvb_dma.h"
 
-#ifdef CONFIG_ENABLE_DEBUGGER
-#include "debugger/debugger_types.h"
-#endif
-
 /**
  * @file Emulation for the Zeal 8-bit VideoBoard
  */
@@ -39,11 +36,8 @@
 #define ZVB_MAX_RES_WIDTH   640
 #define ZVB_MAX_RES_HEIGHT  480
 
-/**
- * @brief Width and height for the debug textures, account for the grid of 1px
- */
-#define ZVB_DBG_RES_WIDTH   1361    // 80 tiles * (16px + 1px grid) + 1px grid right border
-#define ZVB_DBG_RES_HEIGHT  681     // 40 tiles * (16px + 1px grid) + 1px grid bottom border
+/* Offset of the tileset in the memory of the video board */
+#define ZVB_TILESET_ADDR    0x10000U
 
 /**
  * @brief Macros for the I/O registers
@@ -94,48 +88,6 @@
 #define STATE_COUNT         2
 
 
-/**
- * @brief Macros listing of all the objects in the shaders
- */
-#define TEXT_SHADER_VIDMODE_IDX     0
-#define TEXT_SHADER_TILEMAPS_IDX    1
-#define TEXT_SHADER_FONT_IDX        2
-#define TEXT_SHADER_PALETTE_IDX     3
-#define TEXT_SHADER_CURPOS_IDX      4
-#define TEXT_SHADER_CURCOLOR_IDX    5
-#define TEXT_SHADER_CURCHAR_IDX     6
-#define TEXT_SHADER_TSCROLL_IDX     7
-#define TEXT_SHADER_DBGMODE_IDX     4
-
-#define TEXT_SHADER_OBJ_COUNT       8
-
-
-#define GFX_SHADER_VIDMODE_IDX      0
-#define GFX_SHADER_TILEMAPS_IDX     1
-#define GFX_SHADER_TILESET_IDX      2
-#define GFX_SHADER_SPRITES_IDX      3
-#define GFX_SHADER_SCROLL0_IDX      4
-#define GFX_SHADER_SCROLL1_IDX      5
-#define GFX_SHADER_PALETTE_IDX      6
-#define GFX_SHADER_DBGMODE_IDX      3
-
-#define GFX_SHADER_OBJ_COUNT        7
-
-#define ZVB_SHADER_MAX_OBJ_COUNT    8
-
-/* Special mode to tell the shader to debug the texture */
-#define TEXT_DEBUG_MODE             0xffffffff
-#define GFX_DEBUG_TILESET_MODE      0
-#define GFX_DEBUG_LAYER0_MODE       1
-#define GFX_DEBUG_LAYER1_MODE       2
-#define GFX_DEBUG_PALETTE_MODE      3
-
-#define TEXT_DEBUG_FONT_MODE        0
-#define TEXT_DEBUG_LAYER0_MODE      1
-#define TEXT_DEBUG_LAYER1_MODE      2
-#define TEXT_DEBUG_PALETTE_MODE     3
-
-
 typedef enum {
     MODE_TEXT_640     = 0,
     MODE_TEXT_320     = 1,
@@ -174,22 +126,6 @@ typedef struct {
 } zvb_ctrl_t;
 
 
-typedef enum {
-    SHADER_TEXT = 0,
-    SHADER_GFX,
-    SHADER_BITMAP,
-    SHADER_GFX_DEBUG,
-    SHADER_TEXT_DEBUG,
-    SHADERS_COUNT,
-} zvb_shaders_type_t;
-
-
-typedef struct {
-    Shader shader;
-    int    objects[ZVB_SHADER_MAX_OBJ_COUNT];
-} zvb_shader_t;
-
-
 typedef struct {
     device_t         parent;
     zvb_video_mode_t mode;
@@ -206,13 +142,6 @@ typedef struct {
     zvb_sound_t      sound;
     zvb_dma_t        dma;
 
-    /* Internally used to make the shader work on the whole screen */
-    zvb_shader_t     shaders[SHADERS_COUNT];
-    RenderTexture    tex_dummy;
-#ifdef CONFIG_ENABLE_DEBUGGER
-    RenderTexture    debug_tex[DBG_VIEW_TOTAL];
-#endif
-
     /* Internal values */
     zvb_status_t     status;
     zvb_ctrl_t       ctrl;
@@ -220,11 +149,12 @@ typedef struct {
     uint8_t          io_bank;
     uint8_t          scratch[4];
     int              state; // Any of the STATE_* macros
-    long             tstates_counter;
+    sched_event_t    raster_event;
+    /* Set when the raster enters V-blank, cleared once the frame has been rendered */
     bool             need_render;
-    /* When rendering to the screen directly, Y must be flipped,
-     * But when rendering to a texture (debugger UI), it must not be*/
-    bool             flipped_y;
+    /* Bumped by each change of what the screen shows (VRAM, registers, cursor), a renderer having drawn
+     * the frame of the current epoch can keep it */
+    uint32_t         epoch;
 } zvb_t;
 
 
@@ -250,58 +180,13 @@ static inline bool zvb_is_text_mode(const zvb_t* zvb)
  * @brief Initialize the video board
  *
  * @param zvb Context to fill and return
- * @param flipped_y Whether to render the screen mirrored in Y axis
- */
-int zvb_init(zvb_t* zvb, bool flipped_y, const memory_op_t* ops);
-
-
-/**
- * @brief Function to call to let the video board be aware of how many
- * interrupts have elapsed.
- */
-void zvb_tick(zvb_t* zvb, const int tstates);
-
-
-/**
- * @brief Prepare the rendering, this will update the textures and images.
- * Must be called before `zvb_render`!
- *
- * @returns true if ZVB is ready to render (display reached refresh state), false else
- */
-bool zvb_prepare_render(zvb_t* zvb);
-
-
-/**
- * @brief Perform any rendering operation if necessary
+ * @param ops Memory operations used by the DMA controller
+ * @param sched Scheduler used to time the raster (V-blank) transitions
  */
-void zvb_render(zvb_t* zvb);
+int zvb_init(zvb_t* zvb, const memory_op_t* ops, scheduler_t* sched);
 
 
 /**
- * @brief Used for debugging purpose to show the current rendering when the CPU is stopped
+ * @brief Mark the whole VRAM as modified, the renderers then upload all of it again and redraw the screen
  */
-void zvb_force_render(zvb_t* zvb);
-
-
-/**
- * @brief Deinitialize the video board, closing the window and unloading all assets
- */
-void zvb_deinit(zvb_t* zvb);
-
-#ifdef CONFIG_ENABLE_DEBUGGER
-/**
- * @brief Render the current VRAM state in the debug textures, must be called after `render` function
- */
-void zvb_render_debug_textures(zvb_t* zvb);
-
-/**
- * @brief Get a pointer to the array of VRAM debug textures
- */
-static inline const RenderTexture* zvb_get_debug_textures(zvb_t* zvb, int* count)
-{
-    if (count) {
-        *count = DBG_VIEW_TOTAL;
-    }
-    return zvb->debug_tex;
-}
-#endif
+void zvb_invalidate(zvb_t* zvb);
@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Range of bytes of a VRAM area written since the renderer last picked up the changes, so that it
+ * only uploads these. The range is empty when `end` is 0.
+ */
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+} zvb_dirty_t;
+
+
+/**
+ * @brief Add the `len` bytes at `addr` to the range
+ */
+static inline void zvb_dirty_mark(zvb_dirty_t* dirty, uint32_t addr, uint32_t len)
+{
+    if (len == 0) {
+        return;
+    }
+    if (dirty->end == 0) {
+        dirty->start = addr;
+        dirty->end = addr + len;
+        return;
+    }
+    if (addr < dirty->start) {
+        dirty->start = addr;
+    }
+    if (addr + len > dirty->end) {
+        dirty->end = addr + len;
+    }
+}
+
+
+/**
+ * @brief Mark the whole area, `size` bytes big
+ */
+static inline void zvb_dirty_all(zvb_dirty_t* dirty, uint32_t size)
+{
+    dirty->start = 0;
+    dirty->end = size;
+}
+
+
+static inline void zvb_dirty_clear(zvb_dirty_t* dirty)
+{
+    dirty->start = 0;
+    dirty->end = 0;
+}
+
+
+static inline bool zvb_dirty_any(const zvb_dirty_t* dirty)
+{
+    return dirty->end != 0;
+}
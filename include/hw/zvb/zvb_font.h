@@ -7,9 +7,10 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
-#include "raylib.h"
 #include "hw/zvb/default_font.h"
+#include "hw/zvb/zvb_dirty.h"
 
 /* Size of a character in the font, in bytes */
 #define ZVB_FONT_CHAR_SIZE      (12)
@@ -26,19 +27,18 @@
 typedef struct {
     /* Raw data, as organized in the real hardware. Each character is a bitmap. */
     uint8_t raw_font[ZVB_FONT_SIZE];
-    /* Make rendering faster by using an Image and a Texture underneath */
-    Image   img_font;
-    Texture tex_font;
-    int     dirty;
+    /* Bytes written, cleared by the renderer once it picked up the changes */
+    zvb_dirty_t dirty;
 } zvb_font_t;
 
 
 /**
- * @brief Get the texture out of the font
+ * @brief Check whether the pixel (x,y) of the given character is set (foreground)
  */
-static inline Texture zvb_font_texture(zvb_font_t* font)
+static inline bool zvb_font_pixel(const zvb_font_t* font, int char_idx, int x, int y)
 {
-    return font->tex_font;
+    /* Bit 7 is leftmost, bit 0 is rightmost */
+    return (font->raw_font[char_idx * ZVB_FONT_CHAR_SIZE + y] >> (7 - x)) & 1;
 }
 
 
@@ -62,8 +62,3 @@ void zvb_font_write(zvb_font_t* font, uint32_t addr, uint8_t data);
  */
 uint8_t zvb_font_read(zvb_font_t* font, uint32_t addr);
 
-
-/**
- * @brief Update the font renderer, needs to be called before starting drawing anything on screen.
- */
-void zvb_font_update(zvb_font_t* font);
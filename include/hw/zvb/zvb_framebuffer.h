@@ -0,0 +1,30 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include "hw/zvb/zvb.h"
+
+/**
+ * @file Software renderer of the Zeal 8-bit VideoBoard.
+ *
+ * Produces the same picture as the shaders of the frontend, on the CPU, so that the screen can be
+ * read without a GPU (library users, tests, screenshots of a headless run).
+ */
+
+/**
+ * @brief Size in pixels of the framebuffer filled by `zvb_framebuffer_render`
+ */
+#define ZVB_FRAMEBUFFER_PIXELS  (ZVB_MAX_RES_WIDTH * ZVB_MAX_RES_HEIGHT)
+
+
+/**
+ * @brief Render the current VRAM state in `pixels`, ZVB_MAX_RES_WIDTH x ZVB_MAX_RES_HEIGHT pixels in row
+ * major order, each of them stored as R, G, B and A bytes. The 320 pixel wide modes are scaled by 2.
+ */
+void zvb_framebuffer_render(const zvb_t* zvb, uint32_t* pixels);
@@ -9,34 +9,27 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include "raylib.h"
+#include "hw/zvb/zvb_dirty.h"
 
 #define ZVB_COLOR_PALETTE_COUNT     (256)
 
 
-/**
- * @brief Color type for the shader.
- */
-typedef Vector3 zvb_color_t;
-
-
 typedef struct {
     /* Raw array representing the colors in VRAM, each color is 2 bytes big */
     uint8_t raw_palette[ZVB_COLOR_PALETTE_COUNT * 2];
     /* Writes are now latched */
     int     wr_latch;
-    Image   img_pal;
-    Texture tex_pal;
-    bool    dirty;
+    /* Bytes written, cleared by the renderer once it picked up the changes */
+    zvb_dirty_t dirty;
 } zvb_palette_t;
 
 
 /**
- * @brief Get the texture out of the palette
+ * @brief Get the RGB565 value of a color of the palette
  */
-static inline Texture zvb_pal_texture(zvb_palette_t* pal)
+static inline uint16_t zvb_palette_rgb565(const zvb_palette_t* pal, int idx)
 {
-    return pal->tex_pal;
+    return pal->raw_palette[idx * 2] | (pal->raw_palette[idx * 2 + 1] << 8);
 }
 
 
@@ -62,6 +55,6 @@ uint8_t zvb_palette_read(zvb_palette_t* pal, uint32_t addr);
 
 
 /**
- * @brief Update the palette renderer, needs to be called before starting drawing anything on screen.
+ * @brief Convert the whole palette to 32-bit colors, stored as R, G, B and A bytes in memory.
  */
-void zvb_palette_update(zvb_palette_t* pal);
+void zvb_palette_to_rgba(const zvb_palette_t* pal, uint32_t colors[ZVB_COLOR_PALETTE_COUNT]);
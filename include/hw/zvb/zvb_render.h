@@ -0,0 +1,233 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Zeal 8-bit Computer <contact@zeal8bit.com>; David Higgins <zoul0813@me.com>
+ *
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * SPDX-FileContributor: Modified by Robert Maupin 2026
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "raylib.h"
+#include "hw/zvb/zvb.h"
+
+#ifdef CONFIG_ENABLE_DEBUGGER
+#include "debugger/debugger_types.h"
+#endif
+
+/**
+ * @file GPU renderer of the Zeal 8-bit VideoBoard, part of the frontend.
+ *
+ * The video board model only holds the raw VRAM, this renderer uploads the bytes written to textures
+ * as is and draws the screen with the shaders, which unpack them.
+ */
+
+/**
+ * @brief Width and height for the debug textures, account for the grid of 1px
+ */
+#define ZVB_DBG_RES_WIDTH   1361    // 80 tiles * (16px + 1px grid) + 1px grid right border
+#define ZVB_DBG_RES_HEIGHT  681     // 40 tiles * (16px + 1px grid) + 1px grid bottom border
+
+/**
+ * @brief The sprites are sorted in bands of lines of the screen, the GFX shader only goes through the ones
+ * crossing the band of the pixel. A band holds the number of sprites, then their indexes.
+ */
+#define ZVB_SPRITES_BAND_HEIGHT 16
+#define ZVB_SPRITES_BAND_COUNT  (ZVB_MAX_RES_HEIGHT / ZVB_SPRITES_BAND_HEIGHT)
+#define ZVB_SPRITES_BAND_SIZE   (ZVB_SPRITES_COUNT + 1)
+
+/**
+ * @brief Macros listing of all the objects in the shaders
+ */
+#define TEXT_SHADER_VIDMODE_IDX     0
+#define TEXT_SHADER_TILEMAPS_IDX    1
+#define TEXT_SHADER_FONT_IDX        2
+#define TEXT_SHADER_PALETTE_IDX     3
+#define TEXT_SHADER_CURPOS_IDX      4
+#define TEXT_SHADER_CURCOLOR_IDX    5
+#define TEXT_SHADER_CURCHAR_IDX     6
+#define TEXT_SHADER_TSCROLL_IDX     7
+#define TEXT_SHADER_DBGMODE_IDX     4
+
+#define TEXT_SHADER_OBJ_COUNT       8
+
+
+#define GFX_SHADER_VIDMODE_IDX      0
+#define GFX_SHADER_TILEMAPS_IDX     1
+#define GFX_SHADER_TILESET_IDX      2
+#define GFX_SHADER_SPRITES_IDX      3
+#define GFX_SHADER_SCROLL0_IDX      4
+#define GFX_SHADER_SCROLL1_IDX      5
+#define GFX_SHADER_PALETTE_IDX      6
+#define GFX_SHADER_BANDS_IDX        7
+#define GFX_SHADER_DBGMODE_IDX      3
+
+#define GFX_SHADER_OBJ_COUNT        8
+
+#define ZVB_SHADER_MAX_OBJ_COUNT    8
+
+/* Special mode to tell the shader to debug the texture */
+#define TEXT_DEBUG_MODE             0xffffffff
+#define GFX_DEBUG_TILESET_MODE      0
+#define GFX_DEBUG_LAYER0_MODE       1
+#define GFX_DEBUG_LAYER1_MODE       2
+#define GFX_DEBUG_PALETTE_MODE      3
+
+#define TEXT_DEBUG_FONT_MODE        0
+#define TEXT_DEBUG_LAYER0_MODE      1
+#define TEXT_DEBUG_LAYER1_MODE      2
+#define TEXT_DEBUG_PALETTE_MODE     3
+
+
+typedef enum {
+    SHADER_TEXT = 0,
+    SHADER_GFX,
+    SHADER_BITMAP,
+    SHADER_GFX_DEBUG,
+    SHADER_TEXT_DEBUG,
+    SHADERS_COUNT,
+} zvb_shaders_type_t;
+
+
+typedef struct {
+    Shader shader;
+    int    objects[ZVB_SHADER_MAX_OBJ_COUNT];
+} zvb_shader_t;
+
+
+/**
+ * @brief Parts of the VRAM kept in a texture of their own
+ */
+typedef enum {
+    ZVB_PART_LAYERS = 0,
+    ZVB_PART_FONT,
+    ZVB_PART_TILESET,
+    ZVB_PART_PALETTE,
+    ZVB_PART_SPRITES,
+    ZVB_PART_COUNT,
+} zvb_part_t;
+
+
+/**
+ * @brief Copy of the video board state the renderer reads, for a renderer that doesn't run on the thread
+ * of the machine. Each part of the VRAM has a version, bumped when the part is modified, so that a copy
+ * only takes the parts modified since it was last made and a renderer only uploads the ones it doesn't
+ * have yet.
+ */
+typedef struct {
+    zvb_t            zvb;
+    uint32_t         versions[ZVB_PART_COUNT];
+} zvb_frame_t;
+
+
+typedef struct {
+    zvb_shader_t     shaders[SHADERS_COUNT];
+    /* Internally used to make the shader work on the whole screen */
+    RenderTexture    tex_dummy;
+#ifdef CONFIG_ENABLE_DEBUGGER
+    RenderTexture    debug_tex[DBG_VIEW_TOTAL];
+#endif
+
+    /* Textures holding the raw VRAM, unpacked by the shaders */
+    Texture          tex_font;
+    Texture          tex_palette;
+    Texture          tex_tilemap;
+    Texture          tex_tileset;
+    Texture          tex_sprites;
+    /* Sprites of each band, computed when the sprites change */
+    Texture          tex_sprite_bands;
+    uint8_t          sprite_bands[ZVB_SPRITES_BAND_COUNT][ZVB_SPRITES_BAND_SIZE];
+
+    /* When rendering to the screen directly, Y must be flipped,
+     * But when rendering to a texture (debugger UI), it must not be*/
+    bool             flipped_y;
+    /* Epoch of the video board the target holds the frame of, when `drawn` is set */
+    uint32_t         epoch;
+    bool             drawn;
+    /* Size of the frame drawn in the target, from its top-left corner. The 320-pixel wide modes are drawn
+     * at their own resolution, the caller scales it when showing it */
+    int              width;
+    int              height;
+} zvb_render_t;
+
+
+/**
+ * @brief Initialize the renderer, the window must be opened already.
+ *
+ * @param flipped_y Whether to render the screen mirrored in Y axis
+ */
+int zvb_render_init(zvb_render_t* render, const zvb_t* zvb, bool flipped_y);
+
+
+/**
+ * @brief Prepare the rendering, this will update the textures from the VRAM that changed.
+ * Must be called before `zvb_render`!
+ *
+ * @returns true if ZVB is ready to render (display reached refresh state), false else
+ */
+bool zvb_prepare_render(zvb_render_t* render, zvb_t* zvb);
+
+
+/**
+ * @brief Perform any rendering operation if necessary. The frame is drawn in the current target, which must
+ * be the same from one call to the next: when nothing changed since the previous frame, it is left as is.
+ *
+ * @returns true if the target was drawn, false if it still holds the previous frame
+ */
+bool zvb_render(zvb_render_t* render, zvb_t* zvb);
+
+
+/**
+ * @brief Used for debugging purpose to show the current rendering when the CPU is stopped, always draws
+ */
+void zvb_force_render(zvb_render_t* render, zvb_t* zvb);
+
+
+/**
+ * @brief Unload all the textures and shaders of the renderer
+ */
+void zvb_render_deinit(zvb_render_t* render);
+
+
+/**
+ * @brief Initialize a copy of `zvb` matching the textures a renderer was just initialized with
+ */
+void zvb_frame_init(zvb_frame_t* frame, const zvb_t* zvb);
+
+
+/**
+ * @brief Copy the frame `zvb` completed in `frame`, to call on the thread of the machine. `versions` holds
+ * the versions of the VRAM parts of `zvb`, bumped for the ones modified. The dirty ranges of `zvb` are
+ * cleared, they are now tracked by the versions.
+ */
+void zvb_frame_capture(zvb_frame_t* frame, zvb_t* zvb, uint32_t* versions);
+
+
+/**
+ * @brief Flag the parts of `frame` the renderer doesn't have yet, `versions` holding the versions of its
+ * textures, and mark the frame as ready to render. `zvb_prepare_render` can then be given the copy.
+ */
+void zvb_frame_prepare(zvb_frame_t* frame, uint32_t* versions);
+
+#ifdef CONFIG_ENABLE_DEBUGGER
+/**
+ * @brief Render the current VRAM state in the debug textures, must be called after `render` function
+ */
+void zvb_render_debug_textures(zvb_render_t* render, const zvb_t* zvb);
+
+/**
+ * @brief Get a pointer to the array of VRAM debug textures
+ */
+static inline const RenderTexture* zvb_get_debug_textures(zvb_render_t* render, int* count)
+{
+    if (count) {
+        *count = DBG_VIEW_TOTAL;
+    }
+    return render->debug_tex;
+}
+#endif
@@ -10,7 +10,6 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdatomic.h>
-#include "raylib.h"
 
 #define VOICE_COUNT      4
 #define SAMPLE_RATE      44091
@@ -92,8 +91,6 @@ typedef struct {
     uint_fast8_t       right_voices;
     uint_fast8_t       master_volume;
     zvb_sample_table_t sample_table;
-    /* RayLib's audio stream */
-    AudioStream        stream;
     /* Volume interpreted from the master_volume register */
     float              left_volume;
     float              right_volume;
@@ -130,6 +127,7 @@ void zvb_sound_write(zvb_sound_t* sound, uint32_t port, uint8_t value);
 
 
 /**
- * @brief Deinitialize the sound controller
+ * @brief Generate the next `frames` stereo frames of 16-bit signed samples in `buffer`, at SAMPLE_RATE.
+ * The frontend calls it from its audio thread, while the CPU keeps writing the registers.
  */
-void zvb_sound_deinit(zvb_sound_t* sound);
+void zvb_sound_generate(zvb_sound_t* sound, int16_t* buffer, unsigned int frames);
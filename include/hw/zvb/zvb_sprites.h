@@ -7,8 +7,9 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
-#include "raylib.h"
+#include "hw/zvb/zvb_dirty.h"
 
 
 /**
@@ -49,44 +50,17 @@ typedef struct {
 _Static_assert(sizeof(zvb_sprite_t) == 8, "Sprite structure must have a size of 8 bytes");
 
 
-/**
- * @brief Sprite type where each entry is a float (for the texture)
- */
-typedef struct {
-    float x;
-    float y;
-    float tile_number;
-    float palette;
-    float f_behind_fg;
-    float f_flip_y;
-    float f_flip_x;
-    float f_height_32;
-} zvb_fsprite_t;
-
-
 /**
  * @brief Define all the sprites in the system.
  */
 typedef struct {
     zvb_sprite_t    data[ZVB_SPRITES_COUNT];
-    zvb_fsprite_t   fdata[ZVB_SPRITES_COUNT];
     int             wr_latch;
-    /* Make rendering faster by using an Image and a Texture for both layers */
-    Image           img_sprites;
-    Texture         tex_sprites;
-    int             dirty;
+    /* Bytes written, cleared by the renderer once it picked up the changes */
+    zvb_dirty_t     dirty;
 } zvb_sprites_t;
 
 
-/**
- * @brief Get the shader out of the sprites
- */
-static inline Texture* zvb_sprites_texture(zvb_sprites_t* sprites)
-{
-    return &sprites->tex_sprites;
-}
-
-
 /**
  * @brief Initialize the sprites, must be called before using it.
  */
@@ -109,8 +83,3 @@ void zvb_sprites_write(zvb_sprites_t* sprites, uint32_t addr, uint8_t data);
  */
 uint8_t zvb_sprites_read(zvb_sprites_t* sprites, uint32_t addr);
 
-
-/**
- * @brief Update the sprites renderer, needs to be called before starting drawing anything on screen.
- */
-void zvb_sprites_update(zvb_sprites_t* sprites);
@@ -7,8 +7,9 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
-#include "raylib.h"
+#include "hw/zvb/zvb_dirty.h"
 
 /**
  * @brief Size of each tilemap, in bytes
@@ -20,23 +21,12 @@ typedef struct {
     /* Raw arrays representing the tilemaps in VRAM */
     uint8_t raw_layer0[ZVB_TILEMAP_SIZE];
     uint8_t raw_layer1[ZVB_TILEMAP_SIZE];
-    /* Make rendering faster by using an Image and a Texture for both layers */
-    Image   img_tilemap;
-    Texture tex_tilemap;
-    int     dirty;
+    /* Bytes written, cleared by the renderer once it picked up the changes. The bytes of layer 1 follow
+     * the ones of layer 0. */
+    zvb_dirty_t dirty;
 } zvb_tilemap_t;
 
 
-
-/**
- * @brief Get the shader out of the palette
- */
-static inline Texture* zvb_tilemap_texture(zvb_tilemap_t* tilemap)
-{
-    return &tilemap->tex_tilemap;
-}
-
-
 /**
  * @brief Initialize the tilemap, must be called before using it.
  */
@@ -62,6 +52,7 @@ uint8_t zvb_tilemap_read(zvb_tilemap_t* tilemap, int layer, uint32_t addr);
 
 
 /**
- * @brief Update the tilemap renderer, needs to be called before starting drawing anything on screen.
+ * @brief Same as calling `zvb_tilemap_write` for each of the `len` bytes of `data`.
  */
-void zvb_tilemap_update(zvb_tilemap_t* tilemap);
+void zvb_tilemap_write_block(zvb_tilemap_t* tilemap, int layer, uint32_t addr, const uint8_t* data, uint32_t len);
+
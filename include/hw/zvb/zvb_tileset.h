@@ -7,8 +7,9 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
-#include "raylib.h"
+#include "hw/zvb/zvb_dirty.h"
 
 /**
  * @brief Size of the tileset, in bytes
@@ -19,23 +20,11 @@
 typedef struct {
     /* Raw arrays representing the tileset in VRAM */
     uint8_t raw[ZVB_TILESET_SIZE];
-    /* Make rendering faster by using an Image and a Texture for the tileset */
-    Image   img_tileset;
-    Texture tex_tileset;
-    int     dirty;
+    /* Bytes written, cleared by the renderer once it picked up the changes */
+    zvb_dirty_t dirty;
 } zvb_tileset_t;
 
 
-
-/**
- * @brief Get the shader out of the palette
- */
-static inline Texture* zvb_tileset_texture(zvb_tileset_t* tileset)
-{
-    return &tileset->tex_tileset;
-}
-
-
 /**
  * @brief Initialize the tileset, must be called before using it.
  */
@@ -61,6 +50,7 @@ uint8_t zvb_tileset_read(zvb_tileset_t* tileset, uint32_t addr);
 
 
 /**
- * @brief Update the tileset renderer, needs to be called before starting drawing anything on screen.
+ * @brief Same as calling `zvb_tileset_write` for each of the `len` bytes of `data`.
  */
-void zvb_tileset_update(zvb_tileset_t* tileset);
+void zvb_tileset_write_block(zvb_tileset_t* tileset, uint32_t addr, const uint8_t* data, uint32_t len);
+
@@ -14,6 +14,7 @@
 
 #include "raylib.h"
 #include "rini.h"
+#include "utils/config_args.h"
 
 typedef struct {
     int width;
@@ -45,21 +46,6 @@ typedef struct {
     int y;
 } config_debugger_t;
 
-typedef struct {
-    const char *config_path;
-    const char *rom_filename;
-    const char *eeprom_filename;
-    const char *tf_filename;
-    const char *uprog_filename;
-    const char *cf_filename;
-    const char *map_file;
-    const char *breakpoints;
-    bool headless;
-    bool config_save;
-    bool verbose;
-    bool no_reset;
-} config_arguments_t;
-
 typedef struct {
     config_debugger_t debugger;
     config_window_t window;  // main window options
@@ -0,0 +1,48 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Zeal 8-bit Computer <contact@zeal8bit.com>; David Higgins <zoul0813@me.com>
+ *
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * SPDX-FileContributor: Modified by Robert Maupin 2026
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * @brief Arguments a machine is created with, kept apart from the rest of the configuration since the
+ * core library uses them without the frontend.
+ */
+typedef struct {
+    const char *config_path;
+    const char *rom_filename;
+    const char *eeprom_filename;
+    const char *tf_filename;
+    const char *uprog_filename;
+    const char *cf_filename;
+    const char *map_file;
+    const char *breakpoints;
+    const char *batch_manifest;
+    int batch_threads;
+    const char *fork_socket;
+    const char *boot_pc;
+    const char *boot_marker;
+    const char *save_state;
+    const char *load_state;
+    /* Memory used by the execution history of the debugger in MB, 0 disables it */
+    int rewind_mem;
+    /* Interval between two checkpoints of the history, in milliseconds */
+    int rewind_interval;
+    /* Number of frames the window shows ahead of the machine, 0 disables the run-ahead */
+    int run_ahead;
+    /* Speed of the window when the turbo is on, as a multiple of real time, 0 for as fast as possible.
+     * The turbo is on from the start when it isn't 1. */
+    int speed;
+    bool headless;
+    bool config_save;
+    bool verbose;
+    bool no_reset;
+} config_arguments_t;
@@ -0,0 +1,17 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief Read the whole content of a file, which doesn't need to be seekable. The data is followed by a
+ * NUL byte, not counted in `len`, so that text files can be used as strings. It must be freed by the caller.
+ *
+ * @returns the data, NULL on error with errno set
+ */
+char *file_read(const char *path, size_t *len);
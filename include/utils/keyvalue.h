@@ -0,0 +1,33 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * @file Parsing of the lines made of whitespace-separated `key=value` pairs, as found in the batch
+ * manifests and the fork server requests.
+ */
+
+typedef enum {
+    KV_END = 0, // no more pairs on the line
+    KV_PAIR,    // `key` and `value` were set
+    KV_INVALID, // the next word has no '=', `key` points to it
+} kv_result_t;
+
+/**
+ * @brief Split the next pair out of the line `cursor` points to, and move the cursor after it. The line is
+ * modified in place: `key` and `value` are NUL-terminated strings pointing inside it.
+ */
+kv_result_t kv_next(char **cursor, char **key, char **value);
+
+/**
+ * @brief Parse a whole value as an unsigned number in the given base, 0 to accept the C prefixes.
+ *
+ * @returns false if the value is empty or isn't only made of a number
+ */
+bool kv_parse_ulong(const char *value, int base, unsigned long *result);
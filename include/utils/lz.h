@@ -0,0 +1,29 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file Small LZ77 codec, in the spirit of the LZ4 block format, used to store the memories of the
+ * machine snapshots. It favors speed over ratio and works on inputs of at most LZ_MAX_INPUT bytes.
+ */
+
+#define LZ_MAX_INPUT 65536
+
+/**
+ * @brief Compress `len` bytes of `src` in `dst`, which can hold `cap` bytes.
+ * Returns the compressed size, or 0 if it doesn't fit in `cap`.
+ */
+size_t lz_compress(const uint8_t *src, size_t len, uint8_t *dst, size_t cap);
+
+/**
+ * @brief Decompress `len` bytes of `src`, the output must be exactly `dst_len` bytes long.
+ * Returns 0 on success, 1 if the data is corrupted.
+ */
+int lz_decompress(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_len);
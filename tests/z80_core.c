@@ -0,0 +1,22 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "z80_core.h"
+
+/* Built along with hw/z80.c, with the same renaming: Z80_CORE_TABLE is the name of the build */
+#define Z80_CORE_STR(x) #x
+#define Z80_CORE_NAME(x) Z80_CORE_STR(x)
+
+const z80_core_t Z80_CORE_TABLE = {
+    .name        = Z80_CORE_NAME(Z80_CORE_TABLE),
+    .init        = z80_init,
+    .run         = z80_run,
+    .gen_nmi     = z80_gen_nmi,
+    .gen_int     = z80_gen_int,
+    .cache_flush = z80_cache_flush,
+    .get_f       = z80_get_f,
+    .set_f       = z80_set_f,
+};
@@ -0,0 +1,29 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "hw/z80.h"
+
+/**
+ * @brief Entry points of one build of the Z80 core. hw/z80.c is compiled once per configuration under test,
+ * with its public functions renamed so that the builds can be linked together, see CMakeLists.txt.
+ */
+typedef struct {
+    const char* name;
+    void (*init)(z80* const z);
+    long (*run)(z80* const z, long budget);
+    void (*gen_nmi)(z80* const z);
+    void (*gen_int)(z80* const z, uint8_t data);
+    void (*cache_flush)(z80_block_cache* const cache);
+    uint8_t (*get_f)(z80* const z);
+    void (*set_f)(z80* const z, uint8_t val);
+} z80_core_t;
+
+/* Switch-based dispatch, flags computed after each operation, no block cache */
+extern const z80_core_t z80_reference;
+/* Threaded dispatch, lazy flags and block cache, as in the default build */
+extern const z80_core_t z80_optimized;
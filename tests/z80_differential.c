@@ -0,0 +1,286 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Differential test of the Z80 core: the optimized build runs the same random programs as the reference one,
+ * both must end each slice of the run in the same state, with the same memory and the same I/O accesses.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "z80_core.h"
+
+#define DEFAULT_PROGRAMS    2000
+#define SLICES_PER_PROGRAM  20
+/* Address the breakpoint hook stops at, when enabled */
+#define BREAKPOINT_ADDR     0x1234
+#define PAGE_COUNT          (0x10000 / Z80_DIRECT_PAGE_SIZE)
+
+typedef struct {
+    const z80_core_t* core;
+    z80 cpu;
+    uint8_t mem[0x10000];
+    /* Write generation of each page, for the block cache */
+    uint32_t gens[PAGE_COUNT];
+    /* Hash of the I/O accesses, in order, also feeds the values read from the ports */
+    uint32_t io_hash;
+    z80_block_cache cache;
+} machine_t;
+
+static machine_t machines[2];
+static uint32_t rng_state;
+
+static uint32_t rnd(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void io_mix(machine_t* m, uint32_t value) {
+    m->io_hash = (m->io_hash ^ value) * 16777619u;
+}
+
+static uint8_t mem_read(void* opaque, uint16_t addr) {
+    machine_t* m = opaque;
+    return m->mem[addr];
+}
+
+static void mem_write(void* opaque, uint16_t addr, uint8_t data) {
+    machine_t* m = opaque;
+    m->gens[addr / Z80_DIRECT_PAGE_SIZE]++;
+    m->mem[addr] = data;
+}
+
+static uint8_t io_read(void* opaque, uint16_t port) {
+    machine_t* m = opaque;
+    io_mix(m, port);
+    io_mix(m, 0x100);
+    return (uint8_t)(m->io_hash >> 8);
+}
+
+static void io_write(void* opaque, uint16_t port, uint8_t data) {
+    machine_t* m = opaque;
+    io_mix(m, port);
+    io_mix(m, data);
+}
+
+/* The first page is read-only for the bulk accesses, they must then go through the bus */
+static uint8_t* mem_direct(void* opaque, uint16_t addr, bool write) {
+    machine_t* m = opaque;
+    if (write) {
+        if (addr < Z80_DIRECT_PAGE_SIZE) {
+            return NULL;
+        }
+        m->gens[addr / Z80_DIRECT_PAGE_SIZE]++;
+    }
+    return &m->mem[addr];
+}
+
+static const uint32_t* mem_code_page(void* opaque, uint16_t addr, uint32_t* phys) {
+    machine_t* m = opaque;
+    *phys = addr;
+    return &m->gens[addr / Z80_DIRECT_PAGE_SIZE];
+}
+
+static bool breakpoint(void* opaque, uint16_t pc) {
+    (void) opaque;
+    return pc == BREAKPOINT_ADDR;
+}
+
+/**
+ * @brief Fill the memory of the machine with a random program and give its CPU random registers.
+ * With `blocks`, the program is biased towards the repeated block instructions.
+ */
+static void program_generate(machine_t* m, bool blocks) {
+    z80* const z = &m->cpu;
+    for (int i = 0; i < (int) sizeof(m->mem); i++) {
+        m->mem[i] = rnd();
+    }
+    if (blocks) {
+        static const uint8_t block_ops[] = { 0xB0, 0xB8, 0xB1, 0xB9, 0xB2, 0xB3, 0xBA, 0xBB };
+        for (int i = 0; i < 2000; i++) {
+            const uint16_t addr = rnd();
+            m->mem[addr] = 0xED;
+            m->mem[(uint16_t)(addr + 1)] = block_ops[rnd() % sizeof(block_ops)];
+        }
+        /* Let the searches find their value from time to time */
+        for (int i = 0; i < 4000; i++) {
+            m->mem[(uint16_t) rnd()] = rnd() & 7;
+        }
+    }
+
+    z->pc = rnd();
+    z->sp = rnd();
+    z->ix = rnd();
+    z->iy = rnd();
+    z->mem_ptr = rnd();
+    z->a = blocks ? (rnd() & 7) : rnd();
+    z->bc = rnd();
+    z->de = rnd();
+    z->hl = rnd();
+    z->a_ = rnd();
+    z->f_ = rnd();
+    z->bc_ = rnd();
+    z->de_ = rnd();
+    z->hl_ = rnd();
+    z->i = rnd();
+    z->r = rnd();
+    z->interrupt_mode = rnd() % 3;
+    z->iff1 = z->iff2 = rnd() & 1;
+    m->core->set_f(z, rnd());
+}
+
+static void machine_init(machine_t* m, bool use_breakpoint) {
+    z80* const z = &m->cpu;
+    m->core->init(z);
+    z->read_byte = mem_read;
+    z->write_byte = mem_write;
+    z->port_in = io_read;
+    z->port_out = io_write;
+    z->direct = mem_direct;
+    z->code_page = mem_code_page;
+    z->cache = &m->cache;
+    z->userdata = m;
+    z->breakpoint = use_breakpoint ? breakpoint : NULL;
+    m->core->cache_flush(&m->cache);
+    memset(m->gens, 0, sizeof(m->gens));
+    m->io_hash = 2166136261u;
+}
+
+/**
+ * @brief Give `dst` the program and the registers of `src`. The structure of the CPU is the same for all the
+ * builds of the core and the flags of `src` are up to date, only the pointers to the machine are kept.
+ */
+static void machine_copy(machine_t* dst, const machine_t* src) {
+    memcpy(dst->mem, src->mem, sizeof(dst->mem));
+    dst->cpu = src->cpu;
+    dst->cpu.userdata = dst;
+    dst->cpu.cache = &dst->cache;
+}
+
+/**
+ * @brief Run the machine until `budget` cycles elapsed, the breakpoint only ends a call to z80_run
+ */
+static void machine_run(machine_t* m, long budget) {
+    z80* const z = &m->cpu;
+    const unsigned long target = z->cyc + budget;
+    while ((long)(z->cyc - target) < 0) {
+        m->core->run(z, (long)(target - z->cyc));
+    }
+}
+
+/**
+ * @brief Compare the state of the two machines, print the first difference found
+ *
+ * @returns true if they are the same
+ */
+static bool machine_compare(machine_t* ref, machine_t* opt) {
+    z80* const a = &ref->cpu;
+    z80* const b = &opt->cpu;
+#define COMPARE(label, va, vb)                                                                                 \
+    if ((unsigned long) (va) != (unsigned long) (vb)) {                                                        \
+        printf("%s: %s %lx, %s %lx\n", label, ref->core->name, (unsigned long) (va), opt->core->name,           \
+               (unsigned long) (vb));                                                                          \
+        return false;                                                                                          \
+    }
+#define COMPARE_REG(reg) COMPARE(#reg, a->reg, b->reg)
+    COMPARE_REG(cyc);
+    COMPARE_REG(pc);
+    COMPARE_REG(sp);
+    COMPARE_REG(ix);
+    COMPARE_REG(iy);
+    COMPARE_REG(mem_ptr);
+    COMPARE_REG(a);
+    COMPARE("f", ref->core->get_f(a), opt->core->get_f(b));
+    COMPARE_REG(bc);
+    COMPARE_REG(de);
+    COMPARE_REG(hl);
+    COMPARE_REG(a_);
+    COMPARE_REG(f_);
+    COMPARE_REG(bc_);
+    COMPARE_REG(de_);
+    COMPARE_REG(hl_);
+    COMPARE_REG(i);
+    COMPARE_REG(r);
+    COMPARE_REG(iff_delay);
+    COMPARE_REG(interrupt_mode);
+    COMPARE_REG(iff1);
+    COMPARE_REG(iff2);
+    COMPARE_REG(halted);
+    COMPARE_REG(int_pending);
+    COMPARE_REG(nmi_pending);
+    COMPARE("io", ref->io_hash, opt->io_hash);
+#undef COMPARE_REG
+#undef COMPARE
+    for (int i = 0; i < (int) sizeof(ref->mem); i++) {
+        if (ref->mem[i] != opt->mem[i]) {
+            printf("mem[%04x]: %s %02x, %s %02x\n", i, ref->core->name, ref->mem[i], opt->core->name, opt->mem[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Run a random program on both cores, in slices separated by interrupts
+ *
+ * @returns true if the cores agreed all along
+ */
+static bool program_check(int index, bool blocks, bool use_breakpoint) {
+    machine_t* ref = &machines[0];
+    machine_t* opt = &machines[1];
+
+    rng_state = 0x9E3779B9u ^ ((uint32_t) index * 2654435761u);
+    if (rng_state == 0) {
+        rng_state = 1;
+    }
+    machine_init(ref, use_breakpoint);
+    machine_init(opt, use_breakpoint);
+    program_generate(ref, blocks);
+    machine_copy(opt, ref);
+
+    for (int slice = 0; slice < SLICES_PER_PROGRAM; slice++) {
+        const long budget = blocks ? (long)(rnd() % 60000) : (long)(rnd() % 400);
+        machine_run(ref, budget);
+        machine_run(opt, budget);
+        if (!machine_compare(ref, opt)) {
+            printf("program %d (blocks=%d, breakpoint=%d) diverged in slice %d\n",
+                   index, blocks, use_breakpoint, slice);
+            return false;
+        }
+        const uint32_t event = rnd() % 16;
+        if (event == 0) {
+            const uint8_t data = rnd();
+            ref->core->gen_int(&ref->cpu, data);
+            opt->core->gen_int(&opt->cpu, data);
+        } else if (event == 1) {
+            ref->core->gen_nmi(&ref->cpu);
+            opt->core->gen_nmi(&opt->cpu);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const int programs = argc > 1 ? atoi(argv[1]) : DEFAULT_PROGRAMS;
+    machines[0].core = &z80_reference;
+    machines[1].core = &z80_optimized;
+
+    for (int i = 0; i < programs; i++) {
+        /* Only one program out of ten is made of block instructions, they run for much longer */
+        const bool blocks = (i % 10) == 9;
+        if (!program_check(i, blocks, (i & 1) != 0)) {
+            return 1;
+        }
+    }
+    printf("%d programs, %s and %s agree\n", programs, z80_reference.name, z80_optimized.name);
+    return 0;
+}
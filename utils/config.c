@@ -31,6 +31,10 @@ config_t config = {
             .config_save = false,
             .no_reset = false,
             .headless = false,
+            .rewind_mem = 64,
+            .rewind_interval = 100,
+            .run_ahead = 0,
+            .speed = 1,
         },
 
     .debugger =
@@ -115,6 +119,17 @@ int usage(const char *progname) {
     log_printf(
         "  -n, --headless                     Run without GUI (no "
         "window/input/rendering)\n");
+    log_printf("  --batch <file>                     Run the headless jobs listed in the manifest\n");
+    log_printf("  -j, --jobs <n>                     Number of threads running the batch jobs\n");
+    log_printf("  --save-state <file>                Save the machine state when the emulator exits\n");
+    log_printf("  --load-state <file>                Restore the machine state at startup\n");
+    log_printf("  --rewind-mem <MB>                  Memory of the debugger history, 0 disables it (64)\n");
+    log_printf("  --rewind-interval <ms>             Interval between the history checkpoints (100)\n");
+    log_printf("  --run-ahead <frames>               Show the frame reached that many frames ahead (0)\n");
+    log_printf("  --speed <N|max>                    Run N times faster than real time, or as fast as possible\n");
+    log_printf("  --fork-server <socket>             Boot once, then fork a machine per test request\n");
+    log_printf("  --boot-pc <addr>                   Fork server boot ends when PC reaches the hex address\n");
+    log_printf("  --boot-marker <text>               Fork server boot ends when the UART sends the text\n");
     log_printf(
         "  -q, --no-reset                     Exit emulator when a reset "
         "is detected\n");
@@ -186,6 +201,44 @@ int parse_command_args(int argc, char *argv[]) {
         } else if (strcmp(arg, "-n") == 0 || strcmp(arg, "--headless") == 0) {
             config.arguments.headless = true;
             config.debugger.enabled = DEBUGGER_STATE_ARG_DISABLE;
+        } else if (strcmp(arg, "--batch") == 0) {
+            NEXT_ARG();
+            config.arguments.batch_manifest = argv[i];
+        } else if (strcmp(arg, "-j") == 0 || strcmp(arg, "--jobs") == 0) {
+            NEXT_ARG();
+            config.arguments.batch_threads = atoi(argv[i]);
+        } else if (strcmp(arg, "--save-state") == 0) {
+            NEXT_ARG();
+            config.arguments.save_state = argv[i];
+        } else if (strcmp(arg, "--load-state") == 0) {
+            NEXT_ARG();
+            config.arguments.load_state = argv[i];
+        } else if (strcmp(arg, "--rewind-mem") == 0) {
+            NEXT_ARG();
+            config.arguments.rewind_mem = atoi(argv[i]);
+        } else if (strcmp(arg, "--rewind-interval") == 0) {
+            NEXT_ARG();
+            config.arguments.rewind_interval = atoi(argv[i]);
+        } else if (strcmp(arg, "--run-ahead") == 0) {
+            NEXT_ARG();
+            config.arguments.run_ahead = atoi(argv[i]);
+        } else if (strcmp(arg, "--speed") == 0) {
+            NEXT_ARG();
+            if (strcmp(argv[i], "max") == 0) {
+                config.arguments.speed = 0;
+            } else if ((config.arguments.speed = atoi(argv[i])) < 1) {
+                log_err_printf("[CONFIG] Invalid speed %s, expected a multiplier or max\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(arg, "--fork-server") == 0) {
+            NEXT_ARG();
+            config.arguments.fork_socket = argv[i];
+        } else if (strcmp(arg, "--boot-pc") == 0) {
+            NEXT_ARG();
+            config.arguments.boot_pc = argv[i];
+        } else if (strcmp(arg, "--boot-marker") == 0) {
+            NEXT_ARG();
+            config.arguments.boot_marker = argv[i];
         } else if (strcmp(arg, "-v") == 0 || strcmp(arg, "--verbose") == 0) {
             config.arguments.verbose = true;
         } else if (strcmp(arg, "-q") == 0 || strcmp(arg, "--no-reset") == 0) {
@@ -0,0 +1,50 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "utils/file.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FILE_READ_CHUNK 4096
+
+char *file_read(const char *path, size_t *len) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    size_t cap = FILE_READ_CHUNK;
+    size_t size = 0;
+    char *data = malloc(cap);
+    while (data != NULL) {
+        /* Keep a byte for the terminator */
+        size += fread(data + size, 1, cap - 1 - size, file);
+        if (size < cap - 1) {
+            break;
+        }
+        cap *= 2;
+        char *bigger = realloc(data, cap);
+        if (bigger == NULL) {
+            free(data);
+        }
+        data = bigger;
+    }
+
+    const bool failed = data == NULL || ferror(file);
+    const int error = data == NULL ? ENOMEM : errno;
+    fclose(file);
+    if (failed) {
+        free(data);
+        errno = error;
+        return NULL;
+    }
+    data[size] = '\0';
+    *len = size;
+    return data;
+}
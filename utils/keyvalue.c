@@ -0,0 +1,45 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "utils/keyvalue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define KV_SPACES " \t\r\n"
+
+kv_result_t kv_next(char **cursor, char **key, char **value) {
+    char *word = *cursor + strspn(*cursor, KV_SPACES);
+    if (*word == '\0') {
+        *cursor = word;
+        return KV_END;
+    }
+
+    char *end = word + strcspn(word, KV_SPACES);
+    if (*end != '\0') {
+        *end++ = '\0';
+    }
+    *cursor = end;
+    *key = word;
+
+    char *equal = strchr(word, '=');
+    if (equal == NULL) {
+        return KV_INVALID;
+    }
+    *equal = '\0';
+    *value = equal + 1;
+    return KV_PAIR;
+}
+
+bool kv_parse_ulong(const char *value, int base, unsigned long *result) {
+    char *end = NULL;
+    const unsigned long parsed = strtoul(value, &end, base);
+    if (*value == '\0' || *end != '\0') {
+        return false;
+    }
+    *result = parsed;
+    return true;
+}
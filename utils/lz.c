@@ -0,0 +1,180 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Robert Maupin <chasesan@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "utils/lz.h"
+
+#include <string.h>
+
+/*
+ * The data is a list of sequences, each one made of:
+ *  - a token, literal count in the upper nibble, match length minus LZ_MIN_MATCH in the lower one. A
+ *    nibble of 15 is followed by bytes to add to it, until one of them is not 255;
+ *  - the literals;
+ *  - the match offset, 16-bit little-endian, and the extra match length bytes.
+ * The last sequence has no match, it ends with the data.
+ */
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+#define LZ_NIBBLE_MAX 15
+
+static inline uint32_t lz_read32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t lz_hash(uint32_t value) {
+    return (value * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+/**
+ * @brief Write the extra bytes of a length whose nibble overflowed, returns NULL if `end` is reached
+ */
+static uint8_t *lz_write_length(uint8_t *dst, const uint8_t *end, size_t length) {
+    for (; length >= 255; length -= 255) {
+        if (dst == end) {
+            return NULL;
+        }
+        *dst++ = 255;
+    }
+    if (dst == end) {
+        return NULL;
+    }
+    *dst++ = (uint8_t)length;
+    return dst;
+}
+
+/**
+ * @brief Emit a sequence, `match_len` being 0 for the last one. Returns NULL if `end` is reached.
+ */
+static uint8_t *lz_emit(uint8_t *dst, const uint8_t *end, const uint8_t *literals, size_t lit_len,
+                        size_t offset, size_t match_len) {
+    if (dst == end) {
+        return NULL;
+    }
+    const size_t match_code = match_len ? match_len - LZ_MIN_MATCH : 0;
+    uint8_t *token = dst++;
+    *token = (uint8_t)(((lit_len < LZ_NIBBLE_MAX ? lit_len : LZ_NIBBLE_MAX) << 4) |
+                       (match_code < LZ_NIBBLE_MAX ? match_code : LZ_NIBBLE_MAX));
+
+    if (lit_len >= LZ_NIBBLE_MAX && (dst = lz_write_length(dst, end, lit_len - LZ_NIBBLE_MAX)) == NULL) {
+        return NULL;
+    }
+    if ((size_t)(end - dst) < lit_len) {
+        return NULL;
+    }
+    memcpy(dst, literals, lit_len);
+    dst += lit_len;
+
+    if (match_len == 0) {
+        return dst;
+    }
+    if (end - dst < 2) {
+        return NULL;
+    }
+    *dst++ = offset & 0xff;
+    *dst++ = offset >> 8;
+    if (match_code >= LZ_NIBBLE_MAX) {
+        dst = lz_write_length(dst, end, match_code - LZ_NIBBLE_MAX);
+    }
+    return dst;
+}
+
+size_t lz_compress(const uint8_t *src, size_t len, uint8_t *dst, size_t cap) {
+    uint16_t table[1 << LZ_HASH_BITS];
+    const uint8_t *const dst_end = dst + cap;
+    uint8_t *out = dst;
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    if (len > LZ_MAX_INPUT) {
+        return 0;
+    }
+    memset(table, 0, sizeof(table));
+
+    while (len >= LZ_MIN_MATCH && pos <= len - LZ_MIN_MATCH) {
+        const uint32_t value = lz_read32(src + pos);
+        const uint32_t hash = lz_hash(value);
+        const size_t candidate = table[hash];
+        table[hash] = (uint16_t)pos;
+
+        if (candidate >= pos || lz_read32(src + candidate) != value) {
+            pos++;
+            continue;
+        }
+
+        size_t match_len = LZ_MIN_MATCH;
+        while (pos + match_len < len && src[candidate + match_len] == src[pos + match_len]) {
+            match_len++;
+        }
+        out = lz_emit(out, dst_end, src + anchor, pos - anchor, pos - candidate, match_len);
+        if (out == NULL) {
+            return 0;
+        }
+        pos += match_len;
+        anchor = pos;
+    }
+
+    out = lz_emit(out, dst_end, src + anchor, len - anchor, 0, 0);
+    return out ? (size_t)(out - dst) : 0;
+}
+
+/**
+ * @brief Read the extra bytes of a length whose nibble overflowed, returns 1 if the data ends before
+ */
+static int lz_read_length(const uint8_t **src, const uint8_t *end, size_t *length) {
+    uint8_t byte;
+    do {
+        if (*src == end) {
+            return 1;
+        }
+        byte = *(*src)++;
+        *length += byte;
+    } while (byte == 255);
+    return 0;
+}
+
+int lz_decompress(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_len) {
+    const uint8_t *const src_end = src + len;
+    size_t out = 0;
+
+    while (src < src_end) {
+        const uint8_t token = *src++;
+        size_t lit_len = token >> 4;
+        if (lit_len == LZ_NIBBLE_MAX && lz_read_length(&src, src_end, &lit_len)) {
+            return 1;
+        }
+        if ((size_t)(src_end - src) < lit_len || dst_len - out < lit_len) {
+            return 1;
+        }
+        memcpy(dst + out, src, lit_len);
+        src += lit_len;
+        out += lit_len;
+
+        /* The last sequence has no match */
+        if (src == src_end) {
+            break;
+        }
+
+        if (src_end - src < 2) {
+            return 1;
+        }
+        const size_t offset = src[0] | (src[1] << 8);
+        src += 2;
+        size_t match_len = (token & 0xf) + LZ_MIN_MATCH;
+        if ((token & 0xf) == LZ_NIBBLE_MAX && lz_read_length(&src, src_end, &match_len)) {
+            return 1;
+        }
+        if (offset == 0 || offset > out || dst_len - out < match_len) {
+            return 1;
+        }
+        /* The match may overlap the bytes it produces, copy them one by one */
+        for (size_t i = 0; i < match_len; i++, out++) {
+            dst[out] = dst[out - offset];
+        }
+    }
+    return out != dst_len;
+}